@@ -0,0 +1,965 @@
+/* ============================================================================
+ * MELVIN MICROBENCHMARKS
+ *
+ * One runner for the engine's hot kernels, on synthetic brains of known size.
+ * Builds against melvin.c directly (like test_runner.c) so it can reach the
+ * internal kernels:
+ *
+ *   gcc -O2 -o bench/melvin_bench bench/bench.c -lm -std=c99
+ *
+ *   bench/melvin_bench                       all benchmarks, all sizes
+ *   bench/melvin_bench --quick               fewer repetitions, no "large"
+ *   bench/melvin_bench --filter propagate    names containing "propagate"
+ *   bench/melvin_bench --size 4096,16,256    custom patterns,edges_per_node,input_len
+ *   bench/melvin_bench --out now.json        JSON to a file (default: stdout)
+ *   bench/melvin_bench --baseline old.json   compare p50 against an earlier run;
+ *                                            exits 1 if any is --threshold % slower
+ *   bench/melvin_bench --scaling             episode cost at 1k..1M patterns (see SCALING)
+ *   bench/melvin_bench --scaling --corpus test_input.txt --patterns 1000,3000,10000
+ *   bench/melvin_bench --modalities          audio cost as text patterns grow (see MODALITIES)
+ *
+ * Each benchmark runs warm-up repetitions, then timed ones. Each repetition
+ * performs a batch of operations, and its ns/op is one sample. Results are
+ * percentiles over the samples. Anything a repetition needs that isn't the
+ * kernel itself is done outside the timed region (prepare/finish). Progress
+ * goes to stderr.
+ * ============================================================================ */
+
+#include "../melvin.c"
+
+#define BENCH_VERSION 1
+#define DEFAULT_REPS 30
+#define DEFAULT_WARMUP 3
+#define QUICK_REPS 10
+#define QUICK_WARMUP 1
+#define DEFAULT_THRESHOLD 10.0     /* Percent slower at p50 that counts as a regression */
+#define STEPS_PER_REP 8            /* Generation steps timed per propagate/select repetition */
+#define EDGE_OPS 1024              /* create_or_strengthen_edge calls per repetition */
+#define MAX_SIZES 8
+
+/* Nodes the synthetic brains use - nothing that needs quoting in a brain file */
+static const char ALPHABET[] = "abcdefghijklmnopqrstuvwxyz0123456789 .,!";
+#define ALPHABET_SIZE ((uint32_t)(sizeof(ALPHABET) - 1))
+
+/* ============================================================================
+ * SYNTHETIC BRAINS
+ * ============================================================================ */
+
+typedef struct {
+    const char *name;
+    uint32_t patterns;
+    uint32_t edges_per_node;
+    uint32_t input_len;
+} BrainSize;
+
+static const BrainSize STANDARD_SIZES[] = {
+    {"small",   64,  4,   8},
+    {"medium", 512,  8,  32},
+    {"large", 2048, 16, 128},
+};
+#define STANDARD_SIZE_COUNT (sizeof(STANDARD_SIZES) / sizeof(STANDARD_SIZES[0]))
+
+/* xorshift64* - fixed seeds make every run build the same brains */
+typedef struct {
+    uint64_t state;
+} Rng;
+
+static uint32_t rng_next(Rng *rng) {
+    rng->state ^= rng->state >> 12;
+    rng->state ^= rng->state << 25;
+    rng->state ^= rng->state >> 27;
+    return (uint32_t)((rng->state * 2685821657736338717ull) >> 32);
+}
+
+static uint32_t rng_below(Rng *rng, uint32_t n) {
+    return rng_next(rng) % n;
+}
+
+static float rng_unit(Rng *rng) {
+    return (rng_next(rng) >> 8) / 16777216.0f;
+}
+
+static uint32_t random_node(Rng *rng) {
+    return (uint8_t)ALPHABET[rng_below(rng, ALPHABET_SIZE)];
+}
+
+/* A pattern as detect_patterns would leave it, with learned predictions */
+static void synth_pattern(MelvinGraph *g, Rng *rng) {
+    if (g->pattern_count >= g->pattern_capacity) {
+        g->pattern_capacity *= 2;
+        g->patterns = realloc(g->patterns, sizeof(Pattern) * g->pattern_capacity);
+    }
+    Pattern *pat = &g->patterns[g->pattern_count++];
+    memset(pat, 0, sizeof(Pattern));
+    initialize_pattern_enhancements(pat);
+
+    pat->length = 2 + rng_below(rng, 4);
+    pat->node_ids = malloc(sizeof(uint32_t) * pat->length);
+    for (uint32_t i = 0; i < pat->length; i++) {
+        /* One pattern in eight generalizes its first position */
+        pat->node_ids[i] = (i == 0 && rng_below(rng, 8) == 0) ? BLANK_NODE : random_node(rng);
+    }
+
+    pat->prediction_count = 1 + rng_below(rng, 3);
+    pat->predicted_nodes = malloc(sizeof(uint32_t) * pat->prediction_count);
+    pat->prediction_weights = malloc(sizeof(float) * pat->prediction_count);
+    for (uint32_t i = 0; i < pat->prediction_count; i++) {
+        pat->predicted_nodes[i] = random_node(rng);
+        pat->prediction_weights[i] = 0.2f + 0.8f * rng_unit(rng);
+    }
+
+    pat->strength = 0.3f + 0.7f * rng_unit(rng);
+    pat->threshold = 0.3f;
+    pat->prediction_attempts = rng_below(rng, 50);
+    pat->prediction_successes = pat->prediction_attempts ? rng_below(rng, (uint32_t)pat->prediction_attempts + 1) : 0;
+    pattern_take_context(g, pat);  /* Files it under the current context */
+
+    pat->outgoing_patterns.capacity = 4;
+    pat->outgoing_patterns.edges = malloc(sizeof(Edge) * pat->outgoing_patterns.capacity);
+    pat->incoming_patterns.capacity = 4;
+    pat->incoming_patterns.edges = malloc(sizeof(Edge) * pat->incoming_patterns.capacity);
+}
+
+/* Brain with the size's pattern count and out-degree over ALPHABET */
+static MelvinGraph* synth_brain(const BrainSize *size, uint64_t seed) {
+    Rng rng = {seed};
+    MelvinGraph *g = melvin_create();
+    inject_input(g, (const uint8_t*)ALPHABET, ALPHABET_SIZE);  /* Every node exists */
+
+    uint32_t degree = (size->edges_per_node < ALPHABET_SIZE) ? size->edges_per_node : ALPHABET_SIZE - 1;
+    for (uint32_t a = 0; a < ALPHABET_SIZE; a++) {
+        uint32_t from = (uint8_t)ALPHABET[a];
+        while (g->outgoing[from].count < degree) {
+            create_or_strengthen_edge(g, from, random_node(&rng));
+        }
+        EdgeList *out = &g->outgoing[from];
+        for (uint32_t e = 0; e < out->count; e++) {
+            out->edges[e].weight = 0.1f + 0.9f * rng_unit(&rng);
+            out->edges[e].use_count = 1 + rng_below(&rng, 20);
+            out->edges[e].success_count = rng_below(&rng, (uint32_t)out->edges[e].use_count + 1);
+        }
+    }
+    for (uint32_t p = 0; p < size->patterns; p++) {
+        synth_pattern(g, &rng);
+    }
+    compute_system_state(g);
+    return g;
+}
+
+/* Input made of the sequences of patterns first..first+count-1, so they match it */
+static void synth_input_from(const MelvinGraph *g, uint32_t first, uint32_t count, uint32_t len,
+                             uint64_t seed, uint8_t *out) {
+    Rng rng = {seed};
+    uint32_t n = 0;
+    while (n < len) {
+        const Pattern *pat = &g->patterns[first + rng_below(&rng, count)];
+        for (uint32_t i = 0; i < pat->length && n < len; i++) {
+            out[n++] = IS_BLANK_NODE(pat->node_ids[i]) ? (uint8_t)random_node(&rng) : (uint8_t)pat->node_ids[i];
+        }
+    }
+}
+
+/* Input any of the brain's patterns match */
+static void synth_input(const MelvinGraph *g, uint32_t len, uint64_t seed, uint8_t *out) {
+    synth_input_from(g, 0, g->pattern_count, len, seed, out);
+}
+
+/* Start of a generation episode, as run_episode does it: fresh activations,
+ * the input injected and lit, system state computed */
+static void prime_episode(MelvinGraph *g, const uint8_t *input, uint32_t len) {
+    g->input_length = 0;
+    g->output_length = 0;
+    for (int n = 0; n < BYTE_VALUES; n++) {
+        g->nodes[n].activation = 0.0f;
+        g->nodes[n].activated_by = 0;
+        g->nodes[n].adaptation = 0.0f;
+    }
+    for (uint32_t p = 0; p < g->pattern_count; p++) {
+        g->patterns[p].activation = 0.0f;
+        g->patterns[p].has_fired = false;
+        g->patterns[p].fired_predictions = 0;
+    }
+    inject_input(g, input, len);
+    compute_system_state(g);
+    for (uint32_t i = 0; i < g->input_length; i++) {
+        g->nodes[g->input_buffer[i]].activation = 1.0f;
+    }
+}
+
+/* ============================================================================
+ * BENCHMARKS
+ * ============================================================================ */
+
+typedef struct {
+    const BrainSize *size;
+    MelvinGraph *brain;
+    MelvinGraph *work;              /* Per-repetition copy or result */
+    uint8_t *input;
+    uint32_t *input_nodes;          /* Same input as node ids */
+    CoherenceContext ctx;
+    EdgeEvidence *evidence;
+    uint32_t evidence_count;
+    uint32_t *supporting;           /* Backing store for every evidence's supporting list */
+    uint32_t (*edge_pairs)[2];
+    char path[64];
+    volatile float sink;            /* Keeps results the compiler would drop */
+} Fixture;
+
+typedef struct {
+    const char *name;
+    void (*setup)(Fixture *f);      /* Once per size, untimed */
+    void (*prepare)(Fixture *f);    /* Before each repetition, untimed */
+    uint32_t (*run)(Fixture *f);    /* Timed - returns operations performed */
+    void (*finish)(Fixture *f);     /* After each repetition, untimed */
+    void (*teardown)(Fixture *f);
+} Bench;
+
+/* pattern_matches: every pattern at every input position */
+static uint32_t run_pattern_matches(Fixture *f) {
+    uint32_t matches = 0;
+    for (uint32_t p = 0; p < f->brain->pattern_count; p++) {
+        for (uint32_t pos = 0; pos < f->size->input_len; pos++) {
+            matches += pattern_matches(f->brain, p, f->input_nodes, f->size->input_len, pos);
+        }
+    }
+    f->sink = (float)matches;
+    return f->brain->pattern_count * f->size->input_len;
+}
+
+/* compute_relative_coherence: every edge one propagation step evaluates */
+static void setup_coherence(Fixture *f) {
+    MelvinGraph *g = f->brain;
+    prime_episode(g, f->input, f->size->input_len);
+    for (uint32_t p = 0; p < g->pattern_count; p++) {
+        update_pattern_context_activation(g, &g->patterns[p]);
+    }
+    coherence_context_build(g, &f->ctx);
+
+    uint32_t total = 0;
+    for (uint32_t s = 0; s < BYTE_VALUES; s++) total += g->outgoing[s].count;
+    f->evidence = malloc(sizeof(EdgeEvidence) * (total > 0 ? total : 1));
+    uint32_t *supporting = malloc(sizeof(uint32_t) * (g->pattern_count + 1) * (total > 0 ? total : 1));
+    f->supporting = supporting;
+    uint32_t first_edge[BYTE_VALUES];
+    uint32_t used = 0;
+    f->evidence_count = 0;
+    for (uint32_t source = 0; source < BYTE_VALUES; source++) {
+        EdgeList *out = &g->outgoing[source];
+        if (out->count == 0) continue;
+        index_first_edges(out, first_edge);
+        uint32_t candidates = patterns_containing(g, f->ctx.active, f->ctx.active_count, source, f->ctx.candidates);
+        for (uint32_t e = 0; e < out->count; e++) {
+            if (!out->edges[e].active || out->edges[e].to_id >= BYTE_VALUES) continue;
+            EdgeEvidence *ev = &f->evidence[f->evidence_count++];
+            ev->source = source;
+            ev->target = out->edges[e].to_id;
+            ev->first_edge = &out->edges[first_edge[ev->target]];
+            ev->supporting = &supporting[used];
+            ev->supporting_count = patterns_supporting(g, f->ctx.candidates, candidates,
+                                                       source, ev->target, &supporting[used]);
+            used += ev->supporting_count;
+        }
+    }
+}
+
+static uint32_t run_coherence(Fixture *f) {
+    float total = 0.0f;
+    for (uint32_t i = 0; i < f->evidence_count; i++) {
+        total += compute_relative_coherence(f->brain, &f->ctx, &f->evidence[i]);
+    }
+    f->sink = total;
+    return f->evidence_count;
+}
+
+static void teardown_coherence(Fixture *f) {
+    free(f->supporting);
+    free(f->evidence);
+    f->supporting = NULL;
+    f->evidence = NULL;
+    f->evidence_count = 0;
+    coherence_context_free(&f->ctx);
+}
+
+/* propagate_with_coherence: the first steps of a generation episode */
+static void prepare_episode(Fixture *f) {
+    prime_episode(f->brain, f->input, f->size->input_len);
+}
+
+static uint32_t run_propagate(Fixture *f) {
+    uint32_t last = 0;
+    for (uint32_t step = 0; step < STEPS_PER_REP; step++) {
+        last = propagate_with_coherence(f->brain);
+    }
+    f->sink = (float)last;
+    return STEPS_PER_REP;
+}
+
+/* select_output_node: after one propagation step */
+static void prepare_select(Fixture *f) {
+    prime_episode(f->brain, f->input, f->size->input_len);
+    propagate_with_coherence(f->brain);
+}
+
+static uint32_t run_select(Fixture *f) {
+    uint32_t last = 0;
+    for (uint32_t step = 0; step < STEPS_PER_REP; step++) {
+        last = select_output_node(f->brain);
+    }
+    f->sink = (float)last;
+    return STEPS_PER_REP;
+}
+
+/* create_or_strengthen_edge: mostly existing edges, some new */
+static void setup_edges(Fixture *f) {
+    Rng rng = {0x5eed0003};
+    f->edge_pairs = malloc(sizeof(*f->edge_pairs) * EDGE_OPS);
+    for (uint32_t i = 0; i < EDGE_OPS; i++) {
+        uint32_t from = random_node(&rng);
+        EdgeList *out = &f->brain->outgoing[from];
+        f->edge_pairs[i][0] = from;
+        f->edge_pairs[i][1] = (out->count > 0 && rng_below(&rng, 10) != 0) ?
+            out->edges[rng_below(&rng, out->count)].to_id : random_node(&rng);
+    }
+}
+
+static void prepare_edges(Fixture *f) {
+    f->work = melvin_clone(f->brain);  /* Weights grow with every call */
+}
+
+static uint32_t run_edges(Fixture *f) {
+    for (uint32_t i = 0; i < EDGE_OPS; i++) {
+        create_or_strengthen_edge(f->work, f->edge_pairs[i][0], f->edge_pairs[i][1]);
+    }
+    return EDGE_OPS;
+}
+
+static void finish_work(Fixture *f) {
+    melvin_destroy(f->work);
+    f->work = NULL;
+}
+
+static void teardown_edges(Fixture *f) {
+    free(f->edge_pairs);
+    f->edge_pairs = NULL;
+}
+
+/* detect_patterns: on a copy, since it adds patterns */
+static void prepare_detect(Fixture *f) {
+    f->work = melvin_clone(f->brain);
+    f->work->input_length = 0;
+    inject_input(f->work, f->input, f->size->input_len);
+}
+
+static uint32_t run_detect(Fixture *f) {
+    detect_patterns(f->work);
+    return 1;
+}
+
+/* melvin_save_brain and melvin_load_brain */
+static void setup_file(Fixture *f) {
+    snprintf(f->path, sizeof(f->path), "/tmp/melvin_bench_%d.m", (int)f->size->patterns);
+    melvin_save_brain(f->brain, f->path);
+}
+
+static uint32_t run_save(Fixture *f) {
+    melvin_save_brain(f->brain, f->path);
+    return 1;
+}
+
+static uint32_t run_load(Fixture *f) {
+    f->work = melvin_load_brain(f->path);
+    return 1;
+}
+
+static void teardown_file(Fixture *f) {
+    remove(f->path);
+}
+
+static const Bench BENCHES[] = {
+    {"pattern_matches",            NULL,            NULL,            run_pattern_matches, NULL,        NULL},
+    {"compute_relative_coherence", setup_coherence, NULL,            run_coherence,       NULL,        teardown_coherence},
+    {"propagate_with_coherence",   NULL,            prepare_episode, run_propagate,       NULL,        NULL},
+    {"select_output_node",         NULL,            prepare_select,  run_select,          NULL,        NULL},
+    {"create_or_strengthen_edge",  setup_edges,     prepare_edges,   run_edges,           finish_work, teardown_edges},
+    {"detect_patterns",            NULL,            prepare_detect,  run_detect,          finish_work, NULL},
+    {"save_brain",                 setup_file,      NULL,            run_save,            NULL,        teardown_file},
+    {"load_brain",                 setup_file,      NULL,            run_load,            finish_work, teardown_file},
+};
+#define BENCH_COUNT (sizeof(BENCHES) / sizeof(BENCHES[0]))
+
+/* ============================================================================
+ * HARNESS
+ * ============================================================================ */
+
+typedef struct {
+    double min, p50, p90, p99, max, mean;
+} Summary;
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+/* Nearest-rank percentile of sorted samples */
+static double percentile(const double *sorted, uint32_t n, double pct) {
+    uint32_t rank = (uint32_t)ceil(pct / 100.0 * n);
+    if (rank < 1) rank = 1;
+    return sorted[rank - 1];
+}
+
+static Summary summarize(double *samples, uint32_t n) {
+    qsort(samples, n, sizeof(double), compare_double);
+    Summary s = {samples[0], percentile(samples, n, 50), percentile(samples, n, 90),
+                 percentile(samples, n, 99), samples[n - 1], 0.0};
+    for (uint32_t i = 0; i < n; i++) s.mean += samples[i] / n;
+    return s;
+}
+
+/* Warm up, then time reps repetitions; returns ops per repetition */
+static uint32_t run_bench(const Bench *b, Fixture *f, uint32_t warmup, uint32_t reps, double *samples) {
+    uint32_t ops = 0;
+    for (uint32_t r = 0; r < warmup + reps; r++) {
+        if (b->prepare) b->prepare(f);
+        uint64_t start = clock_ns();
+        ops = b->run(f);
+        uint64_t elapsed = clock_ns() - start;
+        if (b->finish) b->finish(f);
+        if (r >= warmup) samples[r - warmup] = (double)elapsed / (ops > 0 ? ops : 1);
+    }
+    return ops;
+}
+
+/* p50 of name/size in a previous run's output, or -1 */
+static double baseline_p50(const char *path, const char *name, const char *size) {
+    FILE *file = fopen(path, "r");
+    if (!file) return -1.0;
+    char line[1024];
+    char want[160];
+    snprintf(want, sizeof(want), "\"name\":\"%s\",\"size\":\"%s\",", name, size);
+    double p50 = -1.0;
+    while (fgets(line, sizeof(line), file)) {
+        if (!strstr(line, want)) continue;
+        char *at = strstr(line, "\"p50\":");
+        if (at) p50 = atof(at + 6);
+        break;
+    }
+    fclose(file);
+    return p50;
+}
+
+/* ============================================================================
+ * SCALING
+ *
+ * --scaling grows one brain through a series of pattern counts, timing whole
+ * episodes at each: inference (no target), then training. Synthetic brains
+ * grow by adding generated patterns; with --corpus they grow by training on
+ * the corpus, as far as the budget allows. Every timed episode is profiled,
+ * so each size shows where its time goes. The exponent between two sizes is
+ * how cost grew with pattern count: 1.0 is linear, 2.0 quadratic. A size
+ * whose projected cost doesn't fit the budget is skipped, with larger ones.
+ * ============================================================================ */
+
+#define DEFAULT_SCALE_SIZES "1000,10000,100000,1000000"
+#define DEFAULT_SCALE_BUDGET 60.0   /* Seconds of timed episodes per size */
+#define SCALE_MIN_EPISODES 3
+#define SCALE_MAX_EPISODES 40
+#define SCALE_EDGES_PER_NODE 8
+#define SCALE_INPUT_LEN 32
+#define SCALE_TOP_SECTIONS 3        /* Sections named in the summary table */
+
+typedef struct {
+    uint32_t episodes;
+    Summary ms;
+    MelvinProfile profile;
+} ScalePhase;
+
+/* Where the episodes come from: generated sequences or corpus windows */
+typedef struct {
+    const uint8_t *corpus;          /* NULL: synthetic */
+    uint32_t corpus_size;
+    uint32_t pos;
+    uint64_t seed;
+    uint8_t input[SCALE_INPUT_LEN];
+    uint8_t target[SCALE_INPUT_LEN];
+} EpisodeSource;
+
+static void next_episode(EpisodeSource *src, const MelvinGraph *g) {
+    if (src->corpus) {
+        for (uint32_t i = 0; i < SCALE_INPUT_LEN; i++) {
+            src->input[i] = src->corpus[(src->pos + i) % src->corpus_size];
+            src->target[i] = src->corpus[(src->pos + SCALE_INPUT_LEN + i) % src->corpus_size];
+        }
+        src->pos = (src->pos + SCALE_INPUT_LEN) % src->corpus_size;
+    } else {
+        synth_input(g, SCALE_INPUT_LEN, src->seed++, src->input);
+        synth_input(g, SCALE_INPUT_LEN, src->seed++, src->target);
+    }
+}
+
+/* Timed, profiled episodes until the budget is spent */
+static ScalePhase time_episodes(MelvinGraph *g, EpisodeSource *src, bool train, double budget) {
+    ScalePhase phase;
+    memset(&phase, 0, sizeof(phase));
+    double samples[SCALE_MAX_EPISODES];
+    melvin_set_profiling(g, 1);
+    melvin_reset_profile(g);
+    uint64_t start = clock_ns();
+    while (phase.episodes < SCALE_MAX_EPISODES &&
+           (phase.episodes < SCALE_MIN_EPISODES || (clock_ns() - start) / 1e9 < budget)) {
+        next_episode(src, g);
+        uint64_t t = clock_ns();
+        run_episode(g, src->input, SCALE_INPUT_LEN, train ? src->target : NULL, train ? SCALE_INPUT_LEN : 0);
+        samples[phase.episodes++] = (clock_ns() - t) / 1e6;
+    }
+    melvin_get_profile(g, &phase.profile);
+    melvin_set_profiling(g, 0);
+    phase.ms = summarize(samples, phase.episodes);
+    return phase;
+}
+
+/* Sections of a profile by time spent, largest first */
+static void rank_sections(const MelvinProfile *prof, int *order) {
+    for (int s = 0; s < MELVIN_PROF_COUNT; s++) order[s] = s;
+    for (int i = 1; i < MELVIN_PROF_COUNT; i++) {
+        for (int j = i; j > 0 && prof->sections[order[j]].ns > prof->sections[order[j - 1]].ns; j--) {
+            int t = order[j];
+            order[j] = order[j - 1];
+            order[j - 1] = t;
+        }
+    }
+}
+
+/* d log(cost) / d log(patterns), or 0 if undefined */
+static double scale_exponent(double cost, double prev_cost, uint32_t patterns, uint32_t prev_patterns) {
+    if (prev_cost <= 0.0 || cost <= 0.0 || prev_patterns == 0 || patterns <= prev_patterns) return 0.0;
+    return log(cost / prev_cost) / log((double)patterns / prev_patterns);
+}
+
+static void write_phase(FILE *out, const char *name, const ScalePhase *phase, double exponent, bool has_exponent) {
+    fprintf(out, "\"%s\":{\"episodes\":%u,\"ms_per_episode\":{\"min\":%.3f,\"p50\":%.3f,\"p90\":%.3f,"
+                 "\"max\":%.3f,\"mean\":%.3f},",
+            name, phase->episodes, phase->ms.min, phase->ms.p50, phase->ms.p90, phase->ms.max, phase->ms.mean);
+    if (has_exponent) fprintf(out, "\"exponent\":%.2f,", exponent);
+    else fprintf(out, "\"exponent\":null,");
+    fprintf(out, "\"sections_ms_per_episode\":{");
+    for (int s = 0; s < MELVIN_PROF_COUNT; s++) {
+        double ms = phase->episodes ? phase->profile.sections[s].ns / 1e6 / phase->episodes : 0.0;
+        fprintf(out, "%s\"%s\":%.4f", s ? "," : "", melvin_profile_section_name((MelvinProfileSection)s), ms);
+    }
+    fprintf(out, "}}");
+}
+
+static void print_phase(const char *name, const ScalePhase *phase, double exponent, bool has_exponent) {
+    int order[MELVIN_PROF_COUNT];
+    rank_sections(&phase->profile, order);
+    fprintf(stderr, "  %-6s %12.3f ms/ep  ", name, phase->ms.p50);
+    if (has_exponent) fprintf(stderr, "exp %5.2f  ", exponent);
+    else fprintf(stderr, "exp     -  ");
+    for (int i = 0; i < SCALE_TOP_SECTIONS; i++) {
+        const MelvinProfileCounter *c = &phase->profile.sections[order[i]];
+        double share = phase->profile.episode_ns ? 100.0 * c->ns / phase->profile.episode_ns : 0.0;
+        fprintf(stderr, "%s%s %.0f%%", i ? ", " : "", melvin_profile_section_name((MelvinProfileSection)order[i]), share);
+    }
+    fprintf(stderr, "\n");
+}
+
+static int run_scaling(const char *size_list, const char *corpus_path, double budget, FILE *out) {
+    uint32_t targets[MAX_SIZES];
+    uint32_t target_count = 0;
+    for (const char *at = size_list; *at && target_count < MAX_SIZES; ) {
+        char *end;
+        unsigned long n = strtoul(at, &end, 10);
+        if (end == at) break;
+        if (n > 0) targets[target_count++] = (uint32_t)n;
+        at = (*end == ',') ? end + 1 : end;
+    }
+    if (target_count == 0) {
+        fprintf(stderr, "no pattern counts in \"%s\"\n", size_list);
+        return 2;
+    }
+
+    EpisodeSource src;
+    memset(&src, 0, sizeof(src));
+    src.seed = 0x5eed0100;
+    uint8_t *corpus = NULL;
+    if (corpus_path) {
+        FILE *file = fopen(corpus_path, "rb");
+        if (file) {
+            fseek(file, 0, SEEK_END);
+            long len = ftell(file);
+            fseek(file, 0, SEEK_SET);
+            corpus = malloc(len > 0 ? (size_t)len : 1);
+            src.corpus_size = (uint32_t)fread(corpus, 1, len > 0 ? (size_t)len : 0, file);
+            fclose(file);
+        }
+        if (!corpus || src.corpus_size < 2 * SCALE_INPUT_LEN) {
+            fprintf(stderr, "cannot read corpus %s\n", corpus_path);
+            free(corpus);
+            return 2;
+        }
+        src.corpus = corpus;
+    }
+
+    MelvinGraph *g;
+    Rng rng = {0x5eed0101};
+    if (corpus) {
+        g = melvin_create();
+    } else {
+        BrainSize base = {"scaling", 1, SCALE_EDGES_PER_NODE, SCALE_INPUT_LEN};
+        g = synth_brain(&base, 0x5eed0102);
+    }
+
+    fprintf(out, "{\n\"suite\":\"melvin_bench\",\"mode\":\"scaling\",\"version\":%d,\"timestamp\":%lld,"
+                 "\"source\":\"%s\",\"budget_seconds\":%.1f,\"input_len\":%u,\n\"sizes\":[\n",
+            BENCH_VERSION, (long long)time(NULL), corpus ? corpus_path : "synthetic", budget, SCALE_INPUT_LEN);
+    fprintf(stderr, "scaling on %s, %.0fs per size\n", corpus ? corpus_path : "synthetic brains", budget);
+
+    ScalePhase prev_infer, prev_train;
+    memset(&prev_infer, 0, sizeof(prev_infer));
+    memset(&prev_train, 0, sizeof(prev_train));
+    uint32_t prev_patterns = 0;
+    double last_exponent = 1.0;
+    bool stopped = false;
+    for (uint32_t t = 0; t < target_count; t++) {
+        uint32_t target = targets[t];
+        fprintf(out, "%s{\"target_patterns\":%u,", t ? ",\n" : "", target);
+
+        /* Skip what can't fit, assuming cost keeps growing as it last did (at least linearly) */
+        if (!stopped && prev_patterns > 0 && target > prev_patterns) {
+            double growth = pow((double)target / prev_patterns, last_exponent > 1.0 ? last_exponent : 1.0);
+            double projected = (prev_infer.ms.mean + prev_train.ms.mean) * growth * SCALE_MIN_EPISODES / 1e3;
+            if (projected > 2.0 * budget) {
+                fprintf(out, "\"skipped\":\"projected %.0fs for %d episodes\"}", projected, SCALE_MIN_EPISODES);
+                fprintf(stderr, "%9u patterns: skipped, projected %.0fs for %d episodes\n",
+                        target, projected, SCALE_MIN_EPISODES);
+                stopped = true;
+                continue;
+            }
+        }
+        if (stopped) {
+            fprintf(out, "\"skipped\":\"a smaller size was skipped or not reached\"}");
+            continue;
+        }
+
+        /* Grow */
+        uint64_t grow_start = clock_ns();
+        if (corpus) {
+            while (g->pattern_count < target && (clock_ns() - grow_start) / 1e9 < budget) {
+                next_episode(&src, g);
+                run_episode(g, src.input, SCALE_INPUT_LEN, src.target, SCALE_INPUT_LEN);
+            }
+        } else {
+            while (g->pattern_count < target) synth_pattern(g, &rng);
+            compute_system_state(g);
+        }
+        double grow_seconds = (clock_ns() - grow_start) / 1e9;
+        uint32_t patterns = g->pattern_count;
+        bool reached = patterns >= target;
+
+        ScalePhase infer = time_episodes(g, &src, false, budget / 2);
+        ScalePhase train = time_episodes(g, &src, true, budget / 2);
+        bool has_exponent = prev_patterns > 0;
+        double infer_exp = scale_exponent(infer.ms.mean, prev_infer.ms.mean, patterns, prev_patterns);
+        double train_exp = scale_exponent(train.ms.mean, prev_train.ms.mean, patterns, prev_patterns);
+
+        fprintf(out, "\"patterns\":%u,\"reached\":%s,\"grow_seconds\":%.3f,",
+                patterns, reached ? "true" : "false", grow_seconds);
+        write_phase(out, "infer", &infer, infer_exp, has_exponent);
+        fprintf(out, ",");
+        write_phase(out, "train", &train, train_exp, has_exponent);
+        fprintf(out, "}");
+
+        fprintf(stderr, "%9u patterns%s (grown in %.1fs)\n", patterns, reached ? "" : " (target not reached)", grow_seconds);
+        print_phase("infer", &infer, infer_exp, has_exponent);
+        print_phase("train", &train, train_exp, has_exponent);
+
+        prev_infer = infer;
+        prev_train = train;
+        prev_patterns = patterns;
+        if (has_exponent) last_exponent = (infer_exp > train_exp) ? infer_exp : train_exp;
+        if (!reached) stopped = true;
+    }
+    fprintf(out, "\n]\n}\n");
+
+    melvin_destroy(g);
+    free(corpus);
+    return 0;
+}
+
+/* ============================================================================
+ * MODALITIES: A mixed text/audio brain, timed per modality
+ *
+ * Each size is a brain of a few context-free patterns, a fixed set of audio
+ * patterns and a growing set of text patterns, each learned in its own
+ * context. It times inference in audio alone, then a mixed stream that
+ * switches between text and audio every episode. Scans only walk the
+ * patterns the active context admits, so audio episodes should cost about
+ * the same however much text the brain holds. The exponent is against the
+ * whole brain's pattern count: near 0 when audio cost ignores the text, 1.0
+ * when every pattern is walked.
+ * ============================================================================ */
+
+#define DEFAULT_MODAL_SIZES "1000,4000,16000"
+#define DEFAULT_MODAL_BUDGET 10.0   /* Seconds of timed episodes per size */
+#define MODAL_SHARED_PATTERNS 100   /* Learned with no context; every modality admits them */
+#define MODAL_AUDIO_PATTERNS 1000
+
+/* Cosine about 0.1: neither context admits the other's patterns */
+static float TEXT_CONTEXT[16] = {1.0f, 0.05f};
+static float AUDIO_CONTEXT[16] = {0.05f, 1.0f};
+
+typedef struct {
+    uint32_t first;                 /* The modality's patterns are first..first+count-1 */
+    uint32_t count;
+    float *context;
+} Modality;
+
+/* Inference episodes until the budget is spent. Mixed alternates audio and
+ * text, setting the context before each episode. */
+static ScalePhase time_modal_episodes(MelvinGraph *g, const Modality *audio, const Modality *text, bool mixed,
+                                      double budget, uint64_t *seed) {
+    ScalePhase phase;
+    memset(&phase, 0, sizeof(phase));
+    double samples[SCALE_MAX_EPISODES];
+    uint8_t input[SCALE_INPUT_LEN];
+    melvin_set_profiling(g, 1);
+    melvin_reset_profile(g);
+    uint64_t start = clock_ns();
+    while (phase.episodes < SCALE_MAX_EPISODES &&
+           (phase.episodes < SCALE_MIN_EPISODES || (clock_ns() - start) / 1e9 < budget)) {
+        const Modality *m = (mixed && phase.episodes % 2 == 1) ? text : audio;
+        synth_input_from(g, m->first, m->count, SCALE_INPUT_LEN, (*seed)++, input);
+        uint64_t t = clock_ns();
+        melvin_set_context(g, m->context);
+        run_episode(g, input, SCALE_INPUT_LEN, NULL, 0);
+        samples[phase.episodes++] = (clock_ns() - t) / 1e6;
+    }
+    melvin_get_profile(g, &phase.profile);
+    melvin_set_profiling(g, 0);
+    phase.ms = summarize(samples, phase.episodes);
+    return phase;
+}
+
+static int run_modalities(const char *size_list, double budget, FILE *out) {
+    uint32_t targets[MAX_SIZES];
+    uint32_t target_count = 0;
+    for (const char *at = size_list; *at && target_count < MAX_SIZES; ) {
+        char *end;
+        unsigned long n = strtoul(at, &end, 10);
+        if (end == at) break;
+        if (n > 0) targets[target_count++] = (uint32_t)n;
+        at = (*end == ',') ? end + 1 : end;
+    }
+    if (target_count == 0) {
+        fprintf(stderr, "no pattern counts in \"%s\"\n", size_list);
+        return 2;
+    }
+
+    fprintf(out, "{\n\"suite\":\"melvin_bench\",\"mode\":\"modalities\",\"version\":%d,\"timestamp\":%lld,"
+                 "\"budget_seconds\":%.1f,\"input_len\":%u,\"shared_patterns\":%u,\"audio_patterns\":%u,\n\"sizes\":[\n",
+            BENCH_VERSION, (long long)time(NULL), budget, SCALE_INPUT_LEN, MODAL_SHARED_PATTERNS, MODAL_AUDIO_PATTERNS);
+    fprintf(stderr, "modalities: %u audio patterns, growing text, %.0fs per size\n", MODAL_AUDIO_PATTERNS, budget);
+
+    ScalePhase prev_audio, prev_mixed;
+    memset(&prev_audio, 0, sizeof(prev_audio));
+    memset(&prev_mixed, 0, sizeof(prev_mixed));
+    uint32_t prev_patterns = 0;
+    uint64_t seed = 0x5eed0300;
+    for (uint32_t t = 0; t < target_count; t++) {
+        /* Fresh brain per size, so each modality's patterns are one id range */
+        BrainSize base = {"modalities", MODAL_SHARED_PATTERNS, SCALE_EDGES_PER_NODE, SCALE_INPUT_LEN};
+        MelvinGraph *g = synth_brain(&base, 0x5eed0301);
+        Rng rng = {0x5eed0302};
+        Modality audio = {g->pattern_count, MODAL_AUDIO_PATTERNS, AUDIO_CONTEXT};
+        melvin_set_context(g, AUDIO_CONTEXT);
+        while (g->pattern_count < audio.first + audio.count) synth_pattern(g, &rng);
+        Modality text = {g->pattern_count, targets[t], TEXT_CONTEXT};
+        melvin_set_context(g, TEXT_CONTEXT);
+        while (g->pattern_count < text.first + text.count) synth_pattern(g, &rng);
+        compute_system_state(g);
+        uint32_t patterns = g->pattern_count;
+
+        ScalePhase audio_only = time_modal_episodes(g, &audio, &text, false, budget / 2, &seed);
+        ScalePhase mixed = time_modal_episodes(g, &audio, &text, true, budget / 2, &seed);
+        bool has_exponent = prev_patterns > 0;
+        double audio_exp = scale_exponent(audio_only.ms.mean, prev_audio.ms.mean, patterns, prev_patterns);
+        double mixed_exp = scale_exponent(mixed.ms.mean, prev_mixed.ms.mean, patterns, prev_patterns);
+
+        fprintf(out, "%s{\"text_patterns\":%u,\"patterns\":%u,", t ? ",\n" : "", targets[t], patterns);
+        write_phase(out, "audio", &audio_only, audio_exp, has_exponent);
+        fprintf(out, ",");
+        write_phase(out, "mixed", &mixed, mixed_exp, has_exponent);
+        fprintf(out, "}");
+
+        fprintf(stderr, "%9u text + %u audio + %u shared patterns\n", targets[t], MODAL_AUDIO_PATTERNS,
+                MODAL_SHARED_PATTERNS);
+        print_phase("audio", &audio_only, audio_exp, has_exponent);
+        print_phase("mixed", &mixed, mixed_exp, has_exponent);
+
+        prev_audio = audio_only;
+        prev_mixed = mixed;
+        prev_patterns = patterns;
+        melvin_destroy(g);
+    }
+    fprintf(out, "\n]\n}\n");
+    return 0;
+}
+
+static void usage(const char *argv0) {
+    fprintf(stderr,
+            "usage: %s [--quick] [--filter NAME] [--reps N] [--warmup N]\n"
+            "          [--size PATTERNS,EDGES,INPUT]... [--out FILE]\n"
+            "          [--baseline FILE] [--threshold PCT] [--list]\n"
+            "       %s --scaling [--patterns N,N,...] [--corpus FILE] [--budget SECONDS] [--out FILE]\n"
+            "       %s --modalities [--patterns N,N,...] [--budget SECONDS] [--out FILE]\n",
+            argv0, argv0, argv0);
+}
+
+int main(int argc, char **argv) {
+    uint32_t reps = DEFAULT_REPS, warmup = DEFAULT_WARMUP;
+    bool quick = false;
+    const char *filter = NULL, *out_path = NULL, *baseline = NULL;
+    double threshold = DEFAULT_THRESHOLD;
+    BrainSize sizes[MAX_SIZES];
+    char size_names[MAX_SIZES][32];
+    uint32_t size_count = 0;
+    bool scaling = false, modalities = false;
+    const char *scale_sizes = NULL, *corpus = NULL;
+    double budget = 0.0;
+
+    for (int i = 1; i < argc; i++) {
+        const char *arg = argv[i];
+        const char *value = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (strcmp(arg, "--quick") == 0) {
+            quick = true;
+        } else if (strcmp(arg, "--list") == 0) {
+            for (size_t b = 0; b < BENCH_COUNT; b++) printf("%s\n", BENCHES[b].name);
+            return 0;
+        } else if (strcmp(arg, "--filter") == 0 && value) {
+            filter = argv[++i];
+        } else if (strcmp(arg, "--reps") == 0 && value) {
+            reps = (uint32_t)atoi(argv[++i]);
+        } else if (strcmp(arg, "--warmup") == 0 && value) {
+            warmup = (uint32_t)atoi(argv[++i]);
+        } else if (strcmp(arg, "--out") == 0 && value) {
+            out_path = argv[++i];
+        } else if (strcmp(arg, "--baseline") == 0 && value) {
+            baseline = argv[++i];
+        } else if (strcmp(arg, "--threshold") == 0 && value) {
+            threshold = atof(argv[++i]);
+        } else if (strcmp(arg, "--scaling") == 0) {
+            scaling = true;
+        } else if (strcmp(arg, "--modalities") == 0) {
+            modalities = true;
+        } else if (strcmp(arg, "--patterns") == 0 && value) {
+            scale_sizes = argv[++i];
+        } else if (strcmp(arg, "--corpus") == 0 && value) {
+            corpus = argv[++i];
+        } else if (strcmp(arg, "--budget") == 0 && value) {
+            budget = atof(argv[++i]);
+        } else if (strcmp(arg, "--size") == 0 && value && size_count < MAX_SIZES) {
+            BrainSize *s = &sizes[size_count];
+            if (sscanf(argv[++i], "%u,%u,%u", &s->patterns, &s->edges_per_node, &s->input_len) != 3 ||
+                s->patterns == 0 || s->input_len == 0) {
+                usage(argv[0]);
+                return 2;
+            }
+            snprintf(size_names[size_count], sizeof(size_names[0]), "p%u_e%u_i%u",
+                     s->patterns, s->edges_per_node, s->input_len);
+            s->name = size_names[size_count++];
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (quick) {
+        bool reps_set = false, warmup_set = false;
+        for (int i = 1; i < argc; i++) {
+            if (strcmp(argv[i], "--reps") == 0) reps_set = true;
+            if (strcmp(argv[i], "--warmup") == 0) warmup_set = true;
+        }
+        if (!reps_set) reps = QUICK_REPS;
+        if (!warmup_set) warmup = QUICK_WARMUP;
+    }
+    if (reps == 0) reps = 1;
+    if (size_count == 0) {
+        for (size_t s = 0; s < STANDARD_SIZE_COUNT; s++) {
+            if (quick && STANDARD_SIZES[s].patterns > 512) continue;
+            sizes[size_count++] = STANDARD_SIZES[s];
+        }
+    }
+
+    FILE *out = out_path ? fopen(out_path, "w") : stdout;
+    if (!out) {
+        fprintf(stderr, "cannot write %s\n", out_path);
+        return 2;
+    }
+    if (scaling) {
+        int status = run_scaling(scale_sizes ? scale_sizes : DEFAULT_SCALE_SIZES, corpus,
+                                 budget > 0.0 ? budget : DEFAULT_SCALE_BUDGET, out);
+        if (out != stdout) fclose(out);
+        return status;
+    }
+    if (modalities) {
+        int status = run_modalities(scale_sizes ? scale_sizes : DEFAULT_MODAL_SIZES,
+                                    budget > 0.0 ? budget : DEFAULT_MODAL_BUDGET, out);
+        if (out != stdout) fclose(out);
+        return status;
+    }
+    fprintf(out, "{\n\"suite\":\"melvin_bench\",\"version\":%d,\"timestamp\":%lld,\"reps\":%u,\"warmup\":%u,\n"
+                 "\"results\":[\n", BENCH_VERSION, (long long)time(NULL), reps, warmup);
+
+    double *samples = malloc(sizeof(double) * reps);
+    uint32_t regressions = 0;
+    bool first = true;
+    for (uint32_t s = 0; s < size_count; s++) {
+        Fixture f;
+        memset(&f, 0, sizeof(f));
+        f.size = &sizes[s];
+        f.brain = synth_brain(f.size, 0x5eed0001 + s);
+        f.input = malloc(f.size->input_len);
+        f.input_nodes = malloc(sizeof(uint32_t) * f.size->input_len);
+        synth_input(f.brain, f.size->input_len, 0x5eed0002 + s, f.input);
+        for (uint32_t i = 0; i < f.size->input_len; i++) f.input_nodes[i] = f.input[i];
+
+        for (size_t b = 0; b < BENCH_COUNT; b++) {
+            const Bench *bench = &BENCHES[b];
+            if (filter && !strstr(bench->name, filter)) continue;
+            if (bench->setup) bench->setup(&f);
+            uint32_t ops = run_bench(bench, &f, warmup, reps, samples);
+            if (bench->teardown) bench->teardown(&f);
+            Summary sum = summarize(samples, reps);
+
+            fprintf(out, "%s{\"name\":\"%s\",\"size\":\"%s\",\"patterns\":%u,\"edges_per_node\":%u,"
+                         "\"input_len\":%u,\"ops_per_rep\":%u,\"ns_per_op\":{\"min\":%.1f,\"p50\":%.1f,"
+                         "\"p90\":%.1f,\"p99\":%.1f,\"max\":%.1f,\"mean\":%.1f}}",
+                    first ? "" : ",\n", bench->name, f.size->name, f.size->patterns,
+                    f.size->edges_per_node, f.size->input_len, ops,
+                    sum.min, sum.p50, sum.p90, sum.p99, sum.max, sum.mean);
+            first = false;
+
+            fprintf(stderr, "%-28s %-16s p50 %12.1f ns/op  p90 %12.1f", bench->name, f.size->name,
+                    sum.p50, sum.p90);
+            double old = baseline ? baseline_p50(baseline, bench->name, f.size->name) : -1.0;
+            if (old > 0.0) {
+                double change = 100.0 * (sum.p50 - old) / old;
+                bool regressed = change > threshold;
+                regressions += regressed;
+                fprintf(stderr, "  %+7.1f%%%s", change, regressed ? "  REGRESSION" : "");
+            }
+            fprintf(stderr, "\n");
+        }
+        free(f.input);
+        free(f.input_nodes);
+        melvin_destroy(f.brain);
+    }
+    fprintf(out, "\n]\n}\n");
+    if (out != stdout) fclose(out);
+    free(samples);
+
+    if (baseline) {
+        fprintf(stderr, "%u regression%s over %.0f%% at p50 against %s\n",
+                regressions, regressions == 1 ? "" : "s", threshold, baseline);
+    }
+    return regressions > 0 ? 1 : 0;
+}
@@ -0,0 +1,346 @@
+/* ============================================================================
+ * MELVIN END-TO-END BENCHMARK
+ *
+ * Trains a fresh brain on the WikiText sample (test_input.txt), then answers
+ * a fixed set of queries against it, and reports what a user of the engine
+ * would see: throughput, episode latency, memory, growth and save/load time.
+ *
+ *   ./build.sh tools    (or: gcc -O2 -o bench/melvin_e2e bench/e2e.c melvin.c -lm -std=c99)
+ *
+ *   bench/melvin_e2e                          one training pass, 200 queries
+ *   bench/melvin_e2e --passes 3 --out e2e.json
+ *   bench/melvin_e2e --corpus other.txt --chunk 48
+ *
+ * Workload: each corpus line is cut at word boundaries into chunks of at most
+ * --chunk bytes, and every chunk is trained to predict the chunk after it on
+ * the same line (headings, being one chunk, are skipped). Queries are the
+ * inputs of every Nth pair, answered by one MelvinSession against the trained
+ * brain, so inference neither learns nor depends on query order. Everything
+ * is deterministic: the same corpus and flags time the same work.
+ *
+ * One JSON object goes to stdout (or --out); progress goes to stderr.
+ * ============================================================================ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <sys/resource.h>
+
+#include "../melvin.h"
+
+#define DEFAULT_CORPUS "test_input.txt"
+#define DEFAULT_CHUNK 32
+#define DEFAULT_PASSES 1
+#define DEFAULT_QUERIES 200
+#define GROWTH_SAMPLES 20          /* Points on the growth curve per run */
+#define MAX_ANSWER 4096
+
+typedef struct {
+    const uint8_t *input;
+    uint32_t input_len;
+    const uint8_t *target;
+    uint32_t target_len;
+} Pair;
+
+typedef struct {
+    double p50, p95, p99, max, mean;
+} Latency;
+
+typedef struct {
+    uint64_t episode;
+    uint32_t patterns;
+    uint64_t edges;
+    uint64_t pattern_edges;
+    long rss_kb;
+} GrowthPoint;
+
+/* ============================================================================
+ * MEASUREMENT
+ * ============================================================================ */
+
+static uint64_t clock_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static double seconds_since(uint64_t start_ns) {
+    return (clock_ns() - start_ns) / 1e9;
+}
+
+/* Peak resident set so far, in KB */
+static long peak_rss_kb(void) {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return -1;
+#ifdef __APPLE__
+    return usage.ru_maxrss / 1024;  /* Bytes there, KB on Linux */
+#else
+    return usage.ru_maxrss;
+#endif
+}
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+/* Nearest-rank percentile of sorted samples */
+static double percentile(const double *sorted, uint32_t n, double pct) {
+    uint32_t rank = (uint32_t)ceil(pct / 100.0 * n);
+    if (rank < 1) rank = 1;
+    return sorted[rank - 1];
+}
+
+/* Summary of per-episode times in ms; sorts them */
+static Latency summarize(double *ms, uint32_t n) {
+    Latency l = {0, 0, 0, 0, 0};
+    if (n == 0) return l;
+    qsort(ms, n, sizeof(double), compare_double);
+    l.p50 = percentile(ms, n, 50);
+    l.p95 = percentile(ms, n, 95);
+    l.p99 = percentile(ms, n, 99);
+    l.max = ms[n - 1];
+    for (uint32_t i = 0; i < n; i++) l.mean += ms[i] / n;
+    return l;
+}
+
+static GrowthPoint measure_growth(MelvinGraph *g, uint64_t episode) {
+    MelvinStats stats;
+    melvin_get_stats(g, &stats);
+    GrowthPoint p = {episode, stats.patterns, (uint64_t)stats.edges_active + stats.edges_tombstoned,
+                     stats.pattern_edges, peak_rss_kb()};
+    return p;
+}
+
+/* ============================================================================
+ * CORPUS
+ * ============================================================================ */
+
+static uint8_t* read_corpus(const char *path, uint32_t *size) {
+    FILE *file = fopen(path, "rb");
+    if (!file) return NULL;
+    fseek(file, 0, SEEK_END);
+    long len = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    uint8_t *data = malloc(len > 0 ? (size_t)len : 1);
+    *size = (uint32_t)fread(data, 1, len > 0 ? (size_t)len : 0, file);
+    fclose(file);
+    return data;
+}
+
+/* Consecutive chunks of each line as input -> target pairs */
+static uint32_t build_pairs(const uint8_t *text, uint32_t size, uint32_t chunk, Pair **out) {
+    uint32_t capacity = 256, count = 0;
+    Pair *pairs = malloc(sizeof(Pair) * capacity);
+    uint32_t pos = 0;
+    while (pos < size) {
+        uint32_t end = pos;
+        while (end < size && text[end] != '\n') end++;
+
+        /* Chunks of this line, cut after the last space that fits */
+        const uint8_t *prev = NULL;
+        uint32_t prev_len = 0;
+        uint32_t at = pos;
+        while (at < end) {
+            while (at < end && text[at] == ' ') at++;
+            if (at >= end) break;
+            uint32_t len = end - at;
+            if (len > chunk) {
+                len = chunk;
+                while (len > 1 && text[at + len] != ' ' && text[at + len - 1] != ' ') len--;
+                if (len == 1) len = chunk;  /* One word longer than a chunk */
+            }
+            while (len > 1 && text[at + len - 1] == ' ') len--;
+            if (prev) {
+                if (count >= capacity) {
+                    capacity *= 2;
+                    pairs = realloc(pairs, sizeof(Pair) * capacity);
+                }
+                pairs[count++] = (Pair){prev, prev_len, text + at, len};
+            }
+            prev = text + at;
+            prev_len = len;
+            at += len;
+        }
+        pos = end + 1;
+    }
+    *out = pairs;
+    return count;
+}
+
+/* ============================================================================
+ * MAIN
+ * ============================================================================ */
+
+static void usage(const char *argv0) {
+    fprintf(stderr, "usage: %s [--corpus FILE] [--chunk BYTES] [--passes N] [--queries N] [--out FILE]\n", argv0);
+}
+
+int main(int argc, char **argv) {
+    const char *corpus_path = NULL, *out_path = NULL;
+    uint32_t chunk = DEFAULT_CHUNK, passes = DEFAULT_PASSES, queries = DEFAULT_QUERIES;
+    for (int i = 1; i < argc; i++) {
+        const char *value = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (strcmp(argv[i], "--corpus") == 0 && value) corpus_path = argv[++i];
+        else if (strcmp(argv[i], "--chunk") == 0 && value) chunk = (uint32_t)atoi(argv[++i]);
+        else if (strcmp(argv[i], "--passes") == 0 && value) passes = (uint32_t)atoi(argv[++i]);
+        else if (strcmp(argv[i], "--queries") == 0 && value) queries = (uint32_t)atoi(argv[++i]);
+        else if (strcmp(argv[i], "--out") == 0 && value) out_path = argv[++i];
+        else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (chunk < 2) chunk = 2;
+    if (passes == 0) passes = 1;
+
+    /* Found from the repo root or from bench/ */
+    uint32_t corpus_size = 0;
+    uint8_t *corpus = NULL;
+    if (corpus_path) {
+        corpus = read_corpus(corpus_path, &corpus_size);
+    } else {
+        corpus_path = DEFAULT_CORPUS;
+        corpus = read_corpus(corpus_path, &corpus_size);
+        if (!corpus) {
+            corpus_path = "../" DEFAULT_CORPUS;
+            corpus = read_corpus(corpus_path, &corpus_size);
+        }
+    }
+    if (!corpus) {
+        fprintf(stderr, "cannot read corpus %s\n", corpus_path);
+        return 2;
+    }
+    Pair *pairs;
+    uint32_t pair_count = build_pairs(corpus, corpus_size, chunk, &pairs);
+    if (pair_count == 0) {
+        fprintf(stderr, "corpus %s has no lines longer than one chunk\n", corpus_path);
+        return 2;
+    }
+    fprintf(stderr, "%s: %u bytes, %u pairs of up to %u bytes\n", corpus_path, corpus_size, pair_count, chunk);
+
+    /* Training */
+    MelvinGraph *g = melvin_create();
+    uint64_t episodes = (uint64_t)pair_count * passes;
+    uint64_t sample_every = episodes / GROWTH_SAMPLES > 0 ? episodes / GROWTH_SAMPLES : 1;
+    double *train_ms = malloc(sizeof(double) * episodes);
+    GrowthPoint growth[GROWTH_SAMPLES + 2];
+    uint32_t growth_count = 0;
+    uint64_t train_bytes = 0;
+
+    growth[growth_count++] = measure_growth(g, 0);
+    uint64_t train_start = clock_ns();
+    for (uint64_t e = 0; e < episodes; e++) {
+        const Pair *p = &pairs[e % pair_count];
+        uint64_t start = clock_ns();
+        run_episode(g, p->input, p->input_len, p->target, p->target_len);
+        train_ms[e] = (clock_ns() - start) / 1e6;
+        train_bytes += p->input_len + p->target_len;
+        if ((e + 1) % sample_every == 0 && growth_count < GROWTH_SAMPLES + 1) {
+            growth[growth_count++] = measure_growth(g, e + 1);
+            fprintf(stderr, "  trained %llu/%llu episodes, %u patterns\n",
+                    (unsigned long long)(e + 1), (unsigned long long)episodes, melvin_get_pattern_count(g));
+        }
+    }
+    double train_seconds = seconds_since(train_start);
+    if (growth[growth_count - 1].episode != episodes) growth[growth_count++] = measure_growth(g, episodes);
+    Latency train_latency = summarize(train_ms, (uint32_t)episodes);
+
+    /* Inference */
+    if (queries == 0) queries = 1;
+    double *infer_ms = malloc(sizeof(double) * queries);
+    uint32_t stride = pair_count / queries > 0 ? pair_count / queries : 1;
+    uint64_t query_bytes = 0, answer_bytes = 0;
+    MelvinSession *session = melvin_session_create();
+    uint64_t infer_start = clock_ns();
+    for (uint32_t q = 0; q < queries; q++) {
+        const Pair *p = &pairs[((uint64_t)q * stride) % pair_count];
+        uint64_t start = clock_ns();
+        melvin_session_infer(g, session, p->input, p->input_len);
+        infer_ms[q] = (clock_ns() - start) / 1e6;
+        uint32_t *answer;
+        uint32_t answer_len;
+        melvin_session_get_output(session, &answer, &answer_len);
+        query_bytes += p->input_len;
+        answer_bytes += answer_len < MAX_ANSWER ? answer_len : MAX_ANSWER;
+    }
+    double infer_seconds = seconds_since(infer_start);
+    melvin_session_destroy(session);
+    Latency infer_latency = summarize(infer_ms, queries);
+    fprintf(stderr, "  answered %u queries\n", queries);
+
+    /* Save and load */
+    char path[64];
+    snprintf(path, sizeof(path), "/tmp/melvin_e2e_%ld.m", (long)time(NULL));
+    uint64_t save_start = clock_ns();
+    int saved = melvin_save_brain(g, path);
+    double save_seconds = seconds_since(save_start);
+    long brain_bytes = 0;
+    FILE *brain_file = fopen(path, "rb");
+    if (brain_file) {
+        fseek(brain_file, 0, SEEK_END);
+        brain_bytes = ftell(brain_file);
+        fclose(brain_file);
+    }
+    uint64_t load_start = clock_ns();
+    MelvinGraph *loaded = melvin_load_brain(path);
+    double load_seconds = seconds_since(load_start);
+    bool load_ok = saved == 0 && loaded != NULL;
+    uint32_t loaded_patterns = loaded ? melvin_get_pattern_count(loaded) : 0;  /* Save drops the weakest */
+    if (loaded) melvin_destroy(loaded);
+    remove(path);
+    if (!load_ok) fprintf(stderr, "warning: brain did not save and load through %s\n", path);
+
+    /* Report */
+    FILE *out = out_path ? fopen(out_path, "w") : stdout;
+    if (!out) {
+        fprintf(stderr, "cannot write %s\n", out_path);
+        return 2;
+    }
+    fprintf(out, "{\n\"suite\":\"melvin_e2e\",\"version\":1,\"timestamp\":%lld,\n", (long long)time(NULL));
+    fprintf(out, "\"corpus\":{\"path\":\"%s\",\"bytes\":%u,\"chunk\":%u,\"pairs\":%u,\"passes\":%u},\n",
+            corpus_path, corpus_size, chunk, pair_count, passes);
+    fprintf(out, "\"train\":{\"episodes\":%llu,\"seconds\":%.3f,\"episodes_per_sec\":%.1f,\"bytes_per_sec\":%.1f,"
+                 "\"latency_ms\":{\"p50\":%.4f,\"p95\":%.4f,\"p99\":%.4f,\"max\":%.4f,\"mean\":%.4f}},\n",
+            (unsigned long long)episodes, train_seconds, episodes / train_seconds, train_bytes / train_seconds,
+            train_latency.p50, train_latency.p95, train_latency.p99, train_latency.max, train_latency.mean);
+    fprintf(out, "\"infer\":{\"queries\":%u,\"seconds\":%.3f,\"queries_per_sec\":%.1f,\"bytes_per_sec\":%.1f,"
+                 "\"answer_bytes\":%llu,"
+                 "\"latency_ms\":{\"p50\":%.4f,\"p95\":%.4f,\"p99\":%.4f,\"max\":%.4f,\"mean\":%.4f}},\n",
+            queries, infer_seconds, queries / infer_seconds, query_bytes / infer_seconds,
+            (unsigned long long)answer_bytes,
+            infer_latency.p50, infer_latency.p95, infer_latency.p99, infer_latency.max, infer_latency.mean);
+    fprintf(out, "\"save\":{\"seconds\":%.4f,\"bytes\":%ld},\"load\":{\"seconds\":%.4f,\"ok\":%s,\"patterns\":%u},\n",
+            save_seconds, brain_bytes, load_seconds, load_ok ? "true" : "false", loaded_patterns);
+    fprintf(out, "\"peak_rss_kb\":%ld,\n\"growth\":[\n", peak_rss_kb());
+    for (uint32_t i = 0; i < growth_count; i++) {
+        fprintf(out, "{\"episode\":%llu,\"patterns\":%u,\"edges\":%llu,\"pattern_edges\":%llu,\"peak_rss_kb\":%ld}%s\n",
+                (unsigned long long)growth[i].episode, growth[i].patterns,
+                (unsigned long long)growth[i].edges, (unsigned long long)growth[i].pattern_edges,
+                growth[i].rss_kb, i + 1 < growth_count ? "," : "");
+    }
+    fprintf(out, "]\n}\n");
+    if (out != stdout) fclose(out);
+
+    fprintf(stderr, "train: %llu episodes in %.2fs (%.1f/s, %.0f B/s), p50 %.3f p95 %.3f p99 %.3f ms\n",
+            (unsigned long long)episodes, train_seconds, episodes / train_seconds, train_bytes / train_seconds,
+            train_latency.p50, train_latency.p95, train_latency.p99);
+    fprintf(stderr, "infer: %u queries in %.2fs (%.1f/s), p50 %.3f p95 %.3f p99 %.3f ms\n",
+            queries, infer_seconds, queries / infer_seconds,
+            infer_latency.p50, infer_latency.p95, infer_latency.p99);
+    fprintf(stderr, "brain: %u patterns, %ld bytes, save %.3fs, load %.3fs, peak RSS %ld KB\n",
+            melvin_get_pattern_count(g), brain_bytes, save_seconds, load_seconds, peak_rss_kb());
+
+    free(train_ms);
+    free(infer_ms);
+    free(pairs);
+    free(corpus);
+    melvin_destroy(g);
+    return load_ok ? 0 : 1;
+}
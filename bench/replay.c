@@ -0,0 +1,397 @@
+/* ============================================================================
+ * MELVIN REPLAY
+ *
+ * Replays a recording made with melvin_record_start against this build and
+ * checks that it answers and learns exactly as the recorded build did, then
+ * compares the time taken. Links against melvin.c like any other program, so
+ * building it against two versions of melvin.c is an A/B test:
+ *
+ *   gcc -O2 -o bench/melvin_replay bench/replay.c melvin.c -lm -std=c99
+ *
+ *   bench/melvin_replay run.mlvr                    outputs, checksum, timing
+ *   bench/melvin_replay run.mlvr --repeat 5         best of 5 runs
+ *   bench/melvin_replay run.mlvr --expect-faster 10 fail unless identical and
+ *                                                   at least 10% faster
+ *   bench/melvin_replay run.mlvr --brain base.m     recording started from base.m
+ *   bench/melvin_replay run.mlvr --write base.mlvr  re-record with this build's
+ *                                                   timings (an A/B baseline)
+ *
+ * Recorded timings come from whatever program recorded, so for a fair A/B
+ * re-record with the old build (--write), then replay that with the new one.
+ *
+ * Exit status: 0 identical (and fast enough), 1 diverged, 2 bad usage or
+ * recording, 3 identical but not --expect-faster.
+ * ============================================================================ */
+
+#define _POSIX_C_SOURCE 199309L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "../melvin.h"
+
+#define RECORD_MAGIC "MLVR"
+#define RECORD_VERSION 1
+#define RECORD_NO_TARGET 0xFFFFFFFFu
+#define SHOW_NODES 40               /* Nodes of a diverging output to print */
+
+typedef struct {
+    char type;                      /* 'C' context or 'E' episode */
+    float context[16];
+    uint8_t *input;
+    uint32_t input_len;
+    uint8_t *target;                /* NULL: no target */
+    uint32_t target_len;
+    uint32_t *output;
+    uint32_t output_len;
+    uint64_t ns;
+} Step;
+
+typedef struct {
+    uint64_t start_checksum;
+    uint64_t end_checksum;
+    bool has_end;                   /* False: recorder didn't stop cleanly */
+    Step *steps;
+    uint32_t step_count;
+    uint32_t episodes;
+} Recording;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/* ============================================================================
+ * READING
+ * ============================================================================ */
+
+static bool read_u32(FILE *f, uint32_t *v) {
+    uint8_t b[4];
+    if (fread(b, 1, sizeof(b), f) != sizeof(b)) return false;
+    *v = (uint32_t)b[0] | (uint32_t)b[1] << 8 | (uint32_t)b[2] << 16 | (uint32_t)b[3] << 24;
+    return true;
+}
+
+static bool read_u64(FILE *f, uint64_t *v) {
+    uint32_t lo, hi;
+    if (!read_u32(f, &lo) || !read_u32(f, &hi)) return false;
+    *v = (uint64_t)hi << 32 | lo;
+    return true;
+}
+
+static bool read_bytes(FILE *f, uint32_t len, uint8_t **out) {
+    *out = malloc(len > 0 ? len : 1);
+    return *out && fread(*out, 1, len, f) == len;
+}
+
+static bool read_recording(const char *path, Recording *rec) {
+    memset(rec, 0, sizeof(*rec));
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        fprintf(stderr, "cannot open %s\n", path);
+        return false;
+    }
+    char magic[4];
+    uint32_t version;
+    if (fread(magic, 1, 4, f) != 4 || memcmp(magic, RECORD_MAGIC, 4) != 0 ||
+        !read_u32(f, &version) || !read_u64(f, &rec->start_checksum)) {
+        fprintf(stderr, "%s is not a Melvin recording\n", path);
+        fclose(f);
+        return false;
+    }
+    if (version != RECORD_VERSION) {
+        fprintf(stderr, "%s is recording version %u; this replays version %d\n", path, version, RECORD_VERSION);
+        fclose(f);
+        return false;
+    }
+
+    uint32_t capacity = 64;
+    rec->steps = malloc(sizeof(Step) * capacity);
+    bool ok = true;
+    int type;
+    while (ok && (type = fgetc(f)) != EOF) {
+        if (type == 'Z') {
+            uint64_t episodes;
+            ok = read_u64(f, &episodes) && read_u64(f, &rec->end_checksum) && episodes == rec->episodes;
+            rec->has_end = ok;
+            break;
+        }
+        if (rec->step_count >= capacity) {
+            capacity *= 2;
+            rec->steps = realloc(rec->steps, sizeof(Step) * capacity);
+        }
+        Step *step = &rec->steps[rec->step_count];
+        memset(step, 0, sizeof(*step));
+        step->type = (char)type;
+        if (type == 'C') {
+            for (int i = 0; i < 16 && ok; i++) {
+                uint32_t bits;
+                ok = read_u32(f, &bits);
+                memcpy(&step->context[i], &bits, sizeof(bits));
+            }
+        } else if (type == 'E') {
+            ok = read_u32(f, &step->input_len) && read_bytes(f, step->input_len, &step->input) &&
+                 read_u32(f, &step->target_len);
+            if (ok && step->target_len != RECORD_NO_TARGET) {
+                ok = read_bytes(f, step->target_len, &step->target);
+            } else {
+                step->target_len = 0;
+            }
+            ok = ok && read_u32(f, &step->output_len);
+            if (ok) {
+                step->output = malloc(sizeof(uint32_t) * (step->output_len > 0 ? step->output_len : 1));
+                for (uint32_t i = 0; i < step->output_len && ok; i++) ok = read_u32(f, &step->output[i]);
+            }
+            ok = ok && read_u64(f, &step->ns);
+        } else {
+            ok = false;
+        }
+        if (ok) {
+            rec->step_count++;
+            if (type == 'E') rec->episodes++;
+        } else {
+            free(step->input);
+            free(step->target);
+            free(step->output);
+        }
+    }
+    if (!ok) fprintf(stderr, "%s: damaged record after %u steps\n", path, rec->step_count);
+    else if (!rec->has_end) fprintf(stderr, "%s: no end record (recorder not stopped); replaying %u steps\n",
+                                    path, rec->step_count);
+    fclose(f);
+    return true;
+}
+
+static void free_recording(Recording *rec) {
+    for (uint32_t i = 0; i < rec->step_count; i++) {
+        free(rec->steps[i].input);
+        free(rec->steps[i].target);
+        free(rec->steps[i].output);
+    }
+    free(rec->steps);
+}
+
+/* ============================================================================
+ * REPLAY
+ * ============================================================================ */
+
+typedef struct {
+    uint64_t total_ns;
+    uint64_t *episode_ns;
+    uint32_t diverged;              /* Episodes whose output differed */
+    int64_t first_divergence;       /* Step index, -1 if none */
+    uint32_t *first_output;         /* This build's output there */
+    uint32_t first_output_len;
+    uint64_t start_checksum;
+    uint64_t end_checksum;
+} Replay;
+
+static void print_nodes(const char *label, const uint32_t *nodes, uint32_t len) {
+    printf("    %-9s \"", label);
+    for (uint32_t i = 0; i < len && i < SHOW_NODES; i++) {
+        uint32_t c = nodes[i];
+        if (c >= 32 && c < 127 && c != '"' && c != '\\') putchar((int)c);
+        else printf("\\x%02x", c & 0xff);
+    }
+    printf("\"%s (%u nodes)\n", len > SHOW_NODES ? "..." : "", len);
+}
+
+static bool replay(const Recording *rec, const char *brain, const char *write_path, Replay *out) {
+    memset(out, 0, sizeof(*out));
+    out->first_divergence = -1;
+    out->episode_ns = malloc(sizeof(uint64_t) * (rec->episodes > 0 ? rec->episodes : 1));
+
+    MelvinGraph *g = brain ? melvin_load_brain(brain) : melvin_create();
+    if (!g) {
+        fprintf(stderr, "cannot %s brain %s\n", brain ? "load" : "create", brain ? brain : "");
+        return false;
+    }
+    out->start_checksum = melvin_checksum(g);
+
+    uint32_t episode = 0;
+    bool writing = false;
+    for (uint32_t s = 0; s < rec->step_count; s++) {
+        const Step *step = &rec->steps[s];
+        if (step->type == 'C') {
+            melvin_set_context(g, (float*)step->context);
+            continue;
+        }
+        /* Started at the first episode, so the new recording opens in the same context */
+        if (write_path && !writing) {
+            if (!melvin_record_start(g, write_path)) {
+                fprintf(stderr, "cannot write %s\n", write_path);
+                melvin_destroy(g);
+                return false;
+            }
+            writing = true;
+        }
+        uint64_t start = now_ns();
+        run_episode(g, step->input, step->input_len, step->target, step->target_len);
+        uint64_t ns = now_ns() - start;
+        out->episode_ns[episode++] = ns;
+        out->total_ns += ns;
+
+        uint32_t *output;
+        uint32_t output_len;
+        melvin_get_output(g, &output, &output_len);
+        if (output_len != step->output_len || memcmp(output, step->output, sizeof(uint32_t) * output_len) != 0) {
+            if (out->first_divergence < 0) {
+                out->first_divergence = s;
+                out->first_output_len = output_len;
+                out->first_output = malloc(sizeof(uint32_t) * (output_len > 0 ? output_len : 1));
+                memcpy(out->first_output, output, sizeof(uint32_t) * output_len);
+            }
+            out->diverged++;
+        }
+    }
+    out->end_checksum = melvin_checksum(g);
+    if (writing && !melvin_record_stop(g)) fprintf(stderr, "error writing %s\n", write_path);
+    melvin_destroy(g);
+    return true;
+}
+
+static void free_replay(Replay *r) {
+    free(r->episode_ns);
+    free(r->first_output);
+}
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+/* Median of n values; sorts them */
+static double median_ms(uint64_t *ns, uint32_t n) {
+    if (n == 0) return 0.0;
+    qsort(ns, n, sizeof(uint64_t), compare_u64);
+    return ns[(n - 1) / 2] / 1e6;
+}
+
+static void usage(const char *argv0) {
+    fprintf(stderr, "usage: %s RECORDING [--brain FILE] [--repeat N] [--expect-faster PCT] [--write FILE]\n", argv0);
+}
+
+int main(int argc, char **argv) {
+    const char *path = NULL, *brain = NULL, *write_path = NULL;
+    uint32_t repeat = 1;
+    double expect_faster = -1.0;
+    for (int i = 1; i < argc; i++) {
+        const char *value = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (strcmp(argv[i], "--brain") == 0 && value) brain = argv[++i];
+        else if (strcmp(argv[i], "--repeat") == 0 && value) repeat = (uint32_t)atoi(argv[++i]);
+        else if (strcmp(argv[i], "--expect-faster") == 0 && value) expect_faster = atof(argv[++i]);
+        else if (strcmp(argv[i], "--write") == 0 && value) write_path = argv[++i];
+        else if (argv[i][0] != '-' && !path) path = argv[i];
+        else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (!path) {
+        usage(argv[0]);
+        return 2;
+    }
+    if (repeat == 0) repeat = 1;
+
+    Recording rec;
+    if (!read_recording(path, &rec)) return 2;
+    uint64_t recorded_ns = 0;
+    uint64_t *recorded_episode_ns = malloc(sizeof(uint64_t) * (rec.episodes > 0 ? rec.episodes : 1));
+    uint32_t contexts = 0;
+    for (uint32_t s = 0, e = 0; s < rec.step_count; s++) {
+        if (rec.steps[s].type == 'C') {
+            contexts++;
+            continue;
+        }
+        recorded_ns += rec.steps[s].ns;
+        recorded_episode_ns[e++] = rec.steps[s].ns;
+    }
+    printf("recording: %s, %u episodes, %u context changes\n", path, rec.episodes, contexts);
+
+    /* Every run must match; the fastest is the one timed */
+    Replay best, run;
+    memset(&best, 0, sizeof(best));
+    bool diverged = false;
+    for (uint32_t r = 0; r < repeat; r++) {
+        if (!replay(&rec, brain, r == 0 ? write_path : NULL, &run)) return 2;
+        if (r == 0 || run.first_divergence >= 0 || (best.first_divergence < 0 && run.total_ns < best.total_ns)) {
+            if (r > 0) free_replay(&best);
+            best = run;
+        } else {
+            free_replay(&run);
+        }
+        if (best.first_divergence >= 0) {
+            diverged = true;
+            break;
+        }
+    }
+
+    if (best.start_checksum != rec.start_checksum) {
+        printf("start:     brain differs from the recorded one (%016llx, recorded %016llx)%s\n",
+               (unsigned long long)best.start_checksum, (unsigned long long)rec.start_checksum,
+               brain ? "" : " - was it recorded from a loaded brain? (--brain)");
+    }
+
+    if (best.first_divergence < 0) {
+        printf("outputs:   identical (%u/%u episodes)\n", rec.episodes, rec.episodes);
+    } else {
+        const Step *step = &rec.steps[best.first_divergence];
+        uint32_t episode = 0;
+        for (int64_t s = 0; s < best.first_divergence; s++) episode += rec.steps[s].type == 'E';
+        printf("outputs:   %u of %u episodes differ; first at episode %u\n", best.diverged, rec.episodes, episode);
+        uint32_t *input_nodes = malloc(sizeof(uint32_t) * (step->input_len + 1));
+        for (uint32_t i = 0; i < step->input_len; i++) input_nodes[i] = step->input[i];
+        print_nodes("input", input_nodes, step->input_len);
+        if (step->target) {
+            uint32_t *target_nodes = malloc(sizeof(uint32_t) * (step->target_len + 1));
+            for (uint32_t i = 0; i < step->target_len; i++) target_nodes[i] = step->target[i];
+            print_nodes("target", target_nodes, step->target_len);
+            free(target_nodes);
+        }
+        print_nodes("recorded", step->output, step->output_len);
+        print_nodes("replayed", best.first_output, best.first_output_len);
+        free(input_nodes);
+    }
+
+    bool checksum_ok = !rec.has_end || best.end_checksum == rec.end_checksum;
+    if (!rec.has_end) {
+        printf("checksum:  %016llx (recording has no end checksum)\n", (unsigned long long)best.end_checksum);
+    } else if (diverged) {
+        printf("checksum:  not compared - replay diverged\n");
+    } else if (checksum_ok) {
+        printf("checksum:  match %016llx\n", (unsigned long long)best.end_checksum);
+    } else {
+        printf("checksum:  differs - replayed %016llx, recorded %016llx (same outputs, different learned state)\n",
+               (unsigned long long)best.end_checksum, (unsigned long long)rec.end_checksum);
+    }
+
+    double recorded_s = recorded_ns / 1e9, replayed_s = best.total_ns / 1e9;
+    double speedup = best.total_ns > 0 ? (double)recorded_ns / best.total_ns : 0.0;
+    printf("time:      recorded %.3fs, replayed %.3fs%s (%.2fx %s); p50 episode %.3f -> %.3f ms\n",
+           recorded_s, replayed_s, repeat > 1 && !diverged ? " best of runs" : "",
+           speedup >= 1.0 ? speedup : (speedup > 0.0 ? 1.0 / speedup : 0.0),
+           speedup >= 1.0 ? "faster" : "slower",
+           median_ms(recorded_episode_ns, rec.episodes), median_ms(best.episode_ns, rec.episodes));
+
+    int status = 0;
+    if (diverged || !checksum_ok) {
+        status = 1;
+    } else if (expect_faster >= 0.0) {
+        double saved = recorded_ns > 0 ? 100.0 * (1.0 - (double)best.total_ns / recorded_ns) : 0.0;
+        bool fast_enough = saved >= expect_faster;
+        printf("verdict:   same output, %.1f%% %s (wanted >= %.1f%% faster)%s\n",
+               fabs(saved), saved >= 0.0 ? "faster" : "slower", expect_faster, fast_enough ? "" : " - FAIL");
+        if (!fast_enough) status = 3;
+    }
+
+    free_replay(&best);
+    free(recorded_episode_ns);
+    free_recording(&rec);
+    return status;
+}
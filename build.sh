@@ -1,24 +1,106 @@
 #!/bin/bash
+#
+# Builds the engine as a library and the programs that link against it.
+#
+#   ./build.sh          libmelvin + HTTP server
+#   ./build.sh lib      build/libmelvin.a and build/libmelvin.so only
+#   ./build.sh tools    libmelvin + server, Ollama bridge and trainer, the
+#                       distillation driver and stub teacher,
+#                       bench/melvin_e2e and bench/melvin_replay
+#
+# Environment:
+#   CC               Compiler (default gcc)
+#   CFLAGS           Added to every compile, e.g. "-g -fno-omit-frame-pointer"
+#                    for symbol-level profiling with perf
+#   MELVIN_LTO=0     Turn off link-time optimization (on by default)
+#   MELVIN_PGO       "generate": instrumented build writing profiles to
+#                    build/pgo; run the programs on real work (e.g.
+#                    bench/melvin_replay on a recording), then "use" to rebuild
+#                    with those profiles. gcc only.
+#
+# Programs include melvin.h and link build/libmelvin.a (everything, including
+# the internals some tests use) or -Lbuild -lmelvin (only the melvin.h API;
+# the shared library hides the rest).
 
-echo "Building Melvin HTTP Server..."
-echo
+CC=${CC:-gcc}
+TARGET=${1:-server}
+BUILD=build
 
-# Check if gcc is available
-if ! command -v gcc &> /dev/null; then
-    echo "ERROR: gcc not found. Please install gcc."
+if ! command -v "$CC" &> /dev/null; then
+    echo "ERROR: $CC not found. Please install gcc."
     exit 1
 fi
 
-echo "Compiling melvin_server.c and melvin.c..."
-gcc -o melvin_server melvin_server.c melvin.c -lm -std=c99 -Wall -pthread
-
-if [ $? -eq 0 ]; then
-    echo
-    echo "Build successful! Run ./melvin_server to start the server."
-    echo
-else
-    echo
-    echo "Build failed! Check the errors above."
-    echo
-    exit 1
+case "$TARGET" in
+    lib|server|tools) ;;
+    *) echo "usage: ./build.sh [lib|server|tools]"; exit 2 ;;
+esac
+
+CLANG=0
+if "$CC" --version 2>/dev/null | grep -qi clang; then
+    CLANG=1
+fi
+
+# Same optimization flags for the engine and the programs, so LTO and PGO see one build
+OPT="-O2${CFLAGS:+ $CFLAGS}"
+AR=ar
+if [ "${MELVIN_LTO:-1}" != "0" ]; then
+    if [ $CLANG -eq 1 ]; then
+        OPT="$OPT -flto=thin"
+        command -v llvm-ar &> /dev/null && AR=llvm-ar
+    else
+        # Fat objects keep libmelvin.a usable by links without -flto
+        OPT="$OPT -flto=auto -ffat-lto-objects"
+        command -v gcc-ar &> /dev/null && AR=gcc-ar
+    fi
 fi
+
+case "${MELVIN_PGO:-}" in
+    "") ;;
+    generate) OPT="$OPT -fprofile-generate=$PWD/$BUILD/pgo -fprofile-update=atomic" ;;
+    use) OPT="$OPT -fprofile-use=$PWD/$BUILD/pgo -fprofile-partial-training -Wno-missing-profile" ;;
+    *) echo "ERROR: MELVIN_PGO must be generate or use"; exit 2 ;;
+esac
+if [ -n "${MELVIN_PGO:-}" ] && [ $CLANG -eq 1 ]; then
+    echo "ERROR: MELVIN_PGO needs gcc (clang profiles must be merged with llvm-profdata)"
+    exit 2
+fi
+
+STD="-std=c99 -Wall"
+LIBS="-lm -pthread"
+
+# Stop at the first failing step
+set -e
+trap 'echo; echo "Build failed! Check the errors above."; echo' ERR
+
+mkdir -p "$BUILD"
+
+echo "Building libmelvin ($OPT)..."
+"$CC" $OPT $STD -fvisibility=hidden -c melvin.c -o "$BUILD/melvin.o"
+"$CC" $OPT $STD -fvisibility=hidden -fPIC -c melvin.c -o "$BUILD/melvin.pic.o"
+rm -f "$BUILD/libmelvin.a"
+"$AR" rcs "$BUILD/libmelvin.a" "$BUILD/melvin.o"
+"$CC" $OPT -shared -o "$BUILD/libmelvin.so" "$BUILD/melvin.pic.o" $LIBS
+
+if [ "$TARGET" != "lib" ]; then
+    echo "Linking melvin_server..."
+    "$CC" $OPT $STD -o melvin_server melvin_server.c "$BUILD/libmelvin.a" $LIBS
+fi
+
+if [ "$TARGET" = "tools" ]; then
+    echo "Linking the Ollama bridge and trainer, melvin_distill, melvin_teacher_stub,"
+    echo "bench/melvin_e2e, bench/melvin_replay..."
+    "$CC" $OPT $STD -o melvin_ollama_bridge melvin_ollama_bridge.c melvin_teacher.c "$BUILD/libmelvin.a" $LIBS
+    "$CC" $OPT $STD -o melvin_ollama_train melvin_ollama_train.c melvin_teacher.c "$BUILD/libmelvin.a" $LIBS
+    "$CC" $OPT $STD -o melvin_distill melvin_distill.c melvin_teacher.c "$BUILD/libmelvin.a" $LIBS
+    "$CC" $OPT $STD -o melvin_teacher_stub melvin_teacher_stub.c melvin_teacher.c $LIBS
+    "$CC" $OPT $STD -o bench/melvin_e2e bench/e2e.c "$BUILD/libmelvin.a" $LIBS
+    "$CC" $OPT $STD -o bench/melvin_replay bench/replay.c "$BUILD/libmelvin.a" $LIBS
+fi
+
+echo
+echo "Build successful! Libraries are in $BUILD/."
+if [ "$TARGET" != "lib" ]; then
+    echo "Run ./melvin_server to start the server."
+fi
+echo
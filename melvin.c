@@ -12,6 +12,10 @@
  * NO STATIC THRESHOLDS. NO MAX VALUES. NO ARBITRARY CUTOFFS.
  * ============================================================================ */
 
+#ifndef _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE 199309L  /* clock_gettime for the episode counters */
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -19,6 +23,9 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <time.h>
+#include <stdarg.h>
+
+#include "melvin.h"
 
 /* ============================================================================
  * UNIVERSAL CONSTANTS (Only physics/math, not behavior)
@@ -29,6 +36,8 @@
 #define END_MARKER 257         /* Special marker: pattern predicts end of output */
 #define INITIAL_CAPACITY 10000  /* Starting memory allocation (grows as needed) */
 #define INVALID_PATTERN_ID 0xFFFFFFFF  /* Invalid pattern ID (for parent tracking) */
+#define CONTEXT_CLASS_MAX 64    /* Interned context vectors (one bit each in a uint64_t) */
+#define CONTEXT_UNCLASSED 0xFFFF  /* Vector seen after the class table filled up */
 
 /* Debug output: enable with -DDEBUG_RUN_EPISODE when compiling */
 #ifndef DEBUG_RUN_EPISODE
@@ -37,12 +46,11 @@
 #define DEBUG_PRINT(...) fprintf(stderr, __VA_ARGS__); fflush(stderr)
 #endif
 
-/* Agent log: disable by default (causes massive performance overhead) */
-/* Enable with -DAGENT_LOG when compiling if needed */
-#ifndef AGENT_LOG
-#define SKIP_AGENT_LOG 1
-#else
-#define SKIP_AGENT_LOG 0
+/* Tracing: events up to this level are compiled in (see TRACING) */
+/* Build with -DMELVIN_TRACE_LEVEL=3 for everything; 0 compiles every trace point out */
+/* Levels MELVIN_TRACE_EPISODE/STEP/DETAIL are in melvin.h */
+#ifndef MELVIN_TRACE_LEVEL
+#define MELVIN_TRACE_LEVEL 0
 #endif
 
 #define IS_BLANK_NODE(id) ((id) == BLANK_NODE)
@@ -181,6 +189,7 @@ typedef struct {
     
     /* MODALITY CONTEXT: Store context vector for fine-grained matching */
     float context_vector[16];   /* Context encoding when pattern was learned */
+    uint16_t context_class;     /* Interned context_vector (see CONTEXT CLASSES) */
     
     /* PATTERN-TO-PATTERN CONNECTIONS: Patterns connect to other patterns (like nodes) */
     EdgeList outgoing_patterns; /* Edges to other patterns (dynamic array) */
@@ -328,6 +337,7 @@ typedef struct {
     
     /* Rates (derivatives - how fast things change) */
     float activation_rate;     /* Change in total activation */
+    float prev_total_activation; /* Last step's total_activation */
     float learning_rate;       /* Change in edge weights */
     float error_rate;          /* Proportion of incorrect predictions */
     
@@ -337,6 +347,7 @@ typedef struct {
     
     /* CONTEXT REPRESENTATION (for context-dependent output) */
     float context_vector[16];  /* 16D context encoding current task/mode */
+    uint16_t context_class;    /* Interned context_vector (see CONTEXT CLASSES) */
     
     /* SELF-TUNING PRESSURES (emerge from state, not set by us) */
     float learning_pressure;      /* From error_rate² (quadratic feedback) */
@@ -378,6 +389,13 @@ typedef struct {
     float contribution;  /* Edge weight × source activation */
 } EdgeContribution;
 
+/* Pattern ids in ascending order (one context partition, or a scan list) */
+typedef struct {
+    uint32_t *ids;
+    uint32_t count;
+    uint32_t capacity;
+} PatternIdList;
+
 typedef struct {
     PatternContribution *patterns;
     uint32_t pattern_count;
@@ -392,7 +410,7 @@ typedef struct {
  * All arrays DYNAMIC - no hardcoded limits
  * ============================================================================ */
 
-typedef struct {
+struct MelvinGraph {
     /* Nodes (fixed size - naturally limited to 256 by byte values) */
     Node nodes[BYTE_VALUES];
     
@@ -405,6 +423,14 @@ typedef struct {
     uint32_t pattern_count;
     uint32_t pattern_capacity;
     
+    /* Context classes: distinct context vectors seen, class 0 = no context */
+    float context_classes[CONTEXT_CLASS_MAX][16];
+    uint64_t context_admits[CONTEXT_CLASS_MAX];  /* Bit p of [s]: class-p patterns apply under class s */
+    uint32_t context_class_count;
+    PatternIdList context_partitions[CONTEXT_CLASS_MAX + 1];  /* Per class; last: unclassed */
+    PatternIdList context_scan_list;   /* Patterns the current context admits (see context_scan) */
+    bool context_scan_valid;
+    
     /* System state (computed each step) */
     SystemState state;
     
@@ -431,7 +457,32 @@ typedef struct {
     uint32_t input_history_capacity; /* Capacity of history buffer */
     uint32_t max_input_history;     /* Maximum inputs to keep (for universal pattern detection) */
     
-} MelvinGraph;
+    /* OUTPUT HOOK: Called with each node as emit_output produces it (streaming) */
+    MelvinOutputHook output_hook;
+    void *output_hook_ctx;
+    
+    /* EPISODE COUNTERS: Cumulative work done by run_episode */
+    uint64_t episode_count;
+    uint64_t step_count;
+    uint64_t output_count;          /* Nodes emitted */
+    uint64_t phase_ns[MELVIN_PHASE_COUNT];
+    
+    /* BUDGET: Limits applied to every run_episode (see melvin_set_budget) */
+    MelvinBudget budget;
+    MelvinStop stop_reason;         /* How the last episode's loop ended */
+    uint64_t stop_count[MELVIN_STOP_COUNT];
+    
+    /* PROFILE: Sampled section timings (see melvin_set_profiling) */
+    MelvinProfile profile;
+    bool profiling;                 /* This episode is a sample */
+    
+    /* TRACE: Ring of recent events, NULL until melvin_trace_enable */
+    struct MelvinTrace *trace;
+    
+    /* RECORD: Calls being written for replay, NULL until melvin_record_start */
+    struct MelvinRecord *record;
+    
+};
 
 /* ============================================================================
  * FORWARD DECLARATIONS
@@ -443,12 +494,6 @@ void normalize_edge_weights(MelvinGraph *g, uint32_t node_id);
 void update_node_dynamics(MelvinGraph *g, uint32_t node_id);
 float compute_firing_probability(MelvinGraph *g, uint32_t node_id);
 float compute_node_relevance(MelvinGraph *g, uint32_t node_id);
-float melvin_get_edge_weight(MelvinGraph *g, uint32_t from_id, uint32_t to_id);
-void melvin_set_context(MelvinGraph *g, float *context);
-/* Port functions removed - ports handle conversion externally in melvin_ports.c */
-int melvin_save_brain(MelvinGraph *g, const char *filename);
-MelvinGraph* melvin_load_brain(const char *filename);
-void melvin_destroy(MelvinGraph *g);
 void apply_error_feedback(MelvinGraph *g, float error_magnitude);  /* Universal negative feedback */
 bool pattern_matches(MelvinGraph *g, uint32_t pattern_id, const uint32_t *sequence, uint32_t seq_len, uint32_t start_pos);
 float pattern_forward_pass(MelvinGraph *g, uint32_t pattern_id, const uint32_t *input_nodes, uint32_t input_len);
@@ -469,6 +514,303 @@ void learn_activation_rule(MelvinGraph *g, uint32_t condition_pattern_id, uint32
 float compute_semantic_distance(MelvinGraph *g, uint32_t pattern_a_id, uint32_t pattern_b_id);
 void propagate_semantic_activation(MelvinGraph *g);
 
+/* ============================================================================
+ * TRACING: What the engine did, recorded only when asked
+ * 
+ * Every trace point names a level. Levels above MELVIN_TRACE_LEVEL compile to
+ * nothing; the rest cost one pointer test until melvin_trace_enable gives the
+ * brain a ring buffer. Events are formatted into the ring as they happen (the
+ * oldest are overwritten) and leave only through melvin_trace_flush, which
+ * writes them as JSON lines:
+ * 
+ *   {"seq":12,"t_ns":...,"episode":3,"event":"edge_strengthened","data":{...}}
+ * 
+ * The ring belongs to the brain, so brains in different threads trace without
+ * sharing anything. Clones and sessions don't trace.
+ * ============================================================================ */
+
+#define TRACE_DATA_SIZE 192         /* Formatted "data" object per event */
+#define TRACE_DEFAULT_CAPACITY 4096
+
+typedef struct {
+    uint64_t time_ns;
+    uint64_t episode;
+    const char *event;              /* Static name */
+    char data[TRACE_DATA_SIZE];     /* Body of the JSON "data" object */
+} TraceEvent;
+
+struct MelvinTrace {
+    int level;                      /* Runtime level, at most MELVIN_TRACE_LEVEL */
+    TraceEvent *events;
+    uint32_t capacity;
+    uint64_t recorded;              /* Events ever recorded - next sequence number */
+    uint64_t flushed;               /* Sequence numbers below this have been written */
+};
+
+/* True when events at `level` are both compiled in and enabled on g */
+#define TRACE_ON(g, lvl) \
+    ((lvl) <= MELVIN_TRACE_LEVEL && (g)->trace != NULL && (lvl) <= (g)->trace->level)
+
+/* Record an event: data is printf-formatted JSON members, e.g. "\"node\":%u" */
+#define TRACE(g, lvl, event, ...) \
+    do { \
+        if (TRACE_ON(g, lvl)) trace_record((g)->trace, (g)->episode_count, (event), __VA_ARGS__); \
+    } while (0)
+
+/* Monotonic nanoseconds for the episode counters */
+static uint64_t clock_ns(void) {
+#ifdef CLOCK_MONOTONIC
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+#else
+    return (uint64_t)clock() * (1000000000ull / CLOCKS_PER_SEC);
+#endif
+}
+
+/* Format checking where the compiler has it (same guard as MELVIN_API) */
+#if defined(__GNUC__) || defined(__clang__)
+#define MELVIN_PRINTF(fmt, args) __attribute__((format(printf, fmt, args)))
+#else
+#define MELVIN_PRINTF(fmt, args)
+#endif
+
+static void trace_record(struct MelvinTrace *t, uint64_t episode, const char *event,
+                         const char *fmt, ...) MELVIN_PRINTF(4, 5);
+
+static void trace_record(struct MelvinTrace *t, uint64_t episode, const char *event,
+                         const char *fmt, ...) {
+    TraceEvent *e = &t->events[t->recorded % t->capacity];
+    e->time_ns = clock_ns();
+    e->episode = episode;
+    e->event = event;
+    va_list args;
+    va_start(args, fmt);
+    vsnprintf(e->data, sizeof(e->data), fmt, args);
+    va_end(args);
+    t->recorded++;
+}
+
+/* Bytes or nodes as a JSON-safe string: anything unprintable, '"' or '\\' becomes '?' */
+static const char* trace_text(char *dst, size_t size, const uint8_t *bytes,
+                              const uint32_t *nodes, uint32_t len) {
+    size_t n = 0;
+    for (uint32_t i = 0; i < len && n + 1 < size; i++) {
+        uint32_t c = bytes ? bytes[i] : nodes[i];
+        dst[n++] = (c >= 32 && c < 127 && c != '"' && c != '\\') ? (char)c : '?';
+    }
+    dst[n] = '\0';
+    return dst;
+}
+
+/* Start recording events up to `level` in a ring of `capacity` (0 for the default).
+ * Calling again changes the level; the ring and its events are kept. */
+bool melvin_trace_enable(MelvinGraph *g, int level, uint32_t capacity) {
+    if (!g) return false;
+    if (!g->trace) {
+        struct MelvinTrace *t = calloc(1, sizeof(struct MelvinTrace));
+        if (!t) return false;
+        t->capacity = capacity > 0 ? capacity : TRACE_DEFAULT_CAPACITY;
+        t->events = malloc(t->capacity * sizeof(TraceEvent));
+        if (!t->events) {
+            free(t);
+            return false;
+        }
+        g->trace = t;
+    }
+    g->trace->level = level;
+    return level <= MELVIN_TRACE_LEVEL;  /* False: nothing at this level is compiled in */
+}
+
+/* Stop recording and drop unflushed events */
+void melvin_trace_disable(MelvinGraph *g) {
+    if (!g || !g->trace) return;
+    free(g->trace->events);
+    free(g->trace);
+    g->trace = NULL;
+}
+
+/* Write unflushed events, oldest first, as JSON lines. Gaps in "seq" are events
+ * the ring overwrote before they were flushed. Returns the number written. */
+uint32_t melvin_trace_flush(MelvinGraph *g, FILE *out) {
+    if (!g || !g->trace || !out) return 0;
+    struct MelvinTrace *t = g->trace;
+    uint64_t first = t->flushed;
+    if (t->recorded - first > t->capacity) first = t->recorded - t->capacity;
+    uint32_t written = 0;
+    for (uint64_t seq = first; seq < t->recorded; seq++) {
+        const TraceEvent *e = &t->events[seq % t->capacity];
+        fprintf(out, "{\"seq\":%llu,\"t_ns\":%llu,\"episode\":%llu,\"event\":\"%s\",\"data\":{%s}}\n",
+                (unsigned long long)seq, (unsigned long long)e->time_ns,
+                (unsigned long long)e->episode, e->event, e->data);
+        written++;
+    }
+    t->flushed = t->recorded;
+    return written;
+}
+
+/* ============================================================================
+ * RECORDING: run_episode and melvin_set_context calls, for replay
+ *
+ * Between melvin_record_start and melvin_record_stop, every episode (input,
+ * target, output, time taken) and every context change is appended to a
+ * file. Replaying it against another build (bench/replay.c) shows whether
+ * that build answers and learns exactly the same. Little-endian records:
+ *
+ *   header   "MLVR" u32 version, u64 checksum of the brain at start
+ *   context  'C' f32[16]                     (one follows the header)
+ *   episode  'E' u32 input_len, input bytes, u32 target_len, target bytes,
+ *                u32 output_len, u32 output[output_len], u64 ns
+ *            target_len is RECORD_NO_TARGET when run_episode had no target
+ *   end      'Z' u64 episodes, u64 checksum of the brain at stop
+ * ============================================================================ */
+
+#define RECORD_MAGIC "MLVR"
+#define RECORD_VERSION 1
+#define RECORD_NO_TARGET 0xFFFFFFFFu
+
+struct MelvinRecord {
+    FILE *file;
+    uint64_t episodes;
+};
+
+static void record_u32(FILE *f, uint32_t v) {
+    uint8_t b[4] = {(uint8_t)v, (uint8_t)(v >> 8), (uint8_t)(v >> 16), (uint8_t)(v >> 24)};
+    fwrite(b, 1, sizeof(b), f);
+}
+
+static void record_u64(FILE *f, uint64_t v) {
+    record_u32(f, (uint32_t)v);
+    record_u32(f, (uint32_t)(v >> 32));
+}
+
+static void record_f32(FILE *f, float v) {
+    uint32_t bits;
+    memcpy(&bits, &v, sizeof(bits));
+    record_u32(f, bits);
+}
+
+static void record_context(MelvinGraph *g) {
+    FILE *f = g->record->file;
+    fputc('C', f);
+    for (int i = 0; i < 16; i++) record_f32(f, g->state.context_vector[i]);
+}
+
+static void record_episode(MelvinGraph *g, const uint8_t *input, uint32_t input_len,
+                           const uint8_t *target, uint32_t target_len, uint64_t ns) {
+    FILE *f = g->record->file;
+    fputc('E', f);
+    record_u32(f, input_len);
+    if (input_len > 0) fwrite(input, 1, input_len, f);
+    record_u32(f, target ? target_len : RECORD_NO_TARGET);
+    if (target && target_len > 0) fwrite(target, 1, target_len, f);
+    record_u32(f, g->output_length);
+    for (uint32_t i = 0; i < g->output_length; i++) record_u32(f, g->output_buffer[i]);
+    record_u64(f, ns);
+    g->record->episodes++;
+}
+
+/* FNV-1a */
+static uint64_t checksum_bytes(uint64_t h, const void *data, size_t len) {
+    const uint8_t *p = data;
+    for (size_t i = 0; i < len; i++) {
+        h ^= p[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+#define CHECKSUM(h, field) ((h) = checksum_bytes((h), &(field), sizeof(field)))
+
+static uint64_t checksum_edges(uint64_t h, const EdgeList *list) {
+    CHECKSUM(h, list->count);
+    for (uint32_t e = 0; e < list->count; e++) {
+        const Edge *edge = &list->edges[e];
+        CHECKSUM(h, edge->to_id);
+        CHECKSUM(h, edge->weight);
+        CHECKSUM(h, edge->use_count);
+        CHECKSUM(h, edge->success_count);
+        CHECKSUM(h, edge->active);
+        CHECKSUM(h, edge->context_node);
+    }
+    return h;
+}
+
+/* Hash of what the brain has learned: nodes, edges, patterns with their
+ * predictions, pattern edges and learned parameters, and the error and
+ * learning rates. Floats are hashed by their bits, so a change in rounding
+ * shows. Per-episode activations are left out. */
+uint64_t melvin_checksum(const MelvinGraph *g) {
+    uint64_t h = 14695981039346656037ull;
+    if (!g) return h;
+    for (int n = 0; n < BYTE_VALUES; n++) {
+        CHECKSUM(h, g->nodes[n].exists);
+        CHECKSUM(h, g->nodes[n].fire_count);
+        h = checksum_edges(h, &g->outgoing[n]);
+    }
+    CHECKSUM(h, g->pattern_count);
+    for (uint32_t p = 0; p < g->pattern_count; p++) {
+        const Pattern *pat = &g->patterns[p];
+        CHECKSUM(h, pat->length);
+        h = checksum_bytes(h, pat->node_ids, sizeof(uint32_t) * pat->length);
+        CHECKSUM(h, pat->strength);
+        CHECKSUM(h, pat->threshold);
+        CHECKSUM(h, pat->prediction_attempts);
+        CHECKSUM(h, pat->prediction_successes);
+        CHECKSUM(h, pat->prediction_count);
+        h = checksum_bytes(h, pat->predicted_nodes, sizeof(uint32_t) * pat->prediction_count);
+        h = checksum_bytes(h, pat->prediction_weights, sizeof(float) * pat->prediction_count);
+        CHECKSUM(h, pat->dynamic_importance);
+        CHECKSUM(h, pat->context_vector);
+        CHECKSUM(h, pat->propagation_transfer_rate);
+        CHECKSUM(h, pat->propagation_decay_rate);
+        CHECKSUM(h, pat->propagation_threshold);
+        CHECKSUM(h, pat->propagation_boost_factor);
+        CHECKSUM(h, pat->selection_weight_factor);
+        CHECKSUM(h, pat->selection_activation_factor);
+        CHECKSUM(h, pat->selection_context_factor);
+        CHECKSUM(h, pat->selection_pattern_factor);
+        h = checksum_edges(h, &pat->outgoing_patterns);
+    }
+    CHECKSUM(h, g->state.error_rate);
+    CHECKSUM(h, g->state.learning_rate);
+    return h;
+}
+
+/* Start writing g's episodes and context changes to path (replacing it).
+ * A recording already in progress is stopped first. */
+bool melvin_record_start(MelvinGraph *g, const char *path) {
+    if (!g || !path) return false;
+    if (g->record) melvin_record_stop(g);
+    struct MelvinRecord *r = calloc(1, sizeof(struct MelvinRecord));
+    if (!r) return false;
+    r->file = fopen(path, "wb");
+    if (!r->file) {
+        free(r);
+        return false;
+    }
+    g->record = r;
+    fwrite(RECORD_MAGIC, 1, 4, r->file);
+    record_u32(r->file, RECORD_VERSION);
+    record_u64(r->file, melvin_checksum(g));
+    record_context(g);  /* Replays start in the context this brain is in */
+    return !ferror(r->file);
+}
+
+/* Finish the recording with the brain's checksum. False if any write failed. */
+bool melvin_record_stop(MelvinGraph *g) {
+    if (!g || !g->record) return false;
+    struct MelvinRecord *r = g->record;
+    fputc('Z', r->file);
+    record_u64(r->file, r->episodes);
+    record_u64(r->file, melvin_checksum(g));
+    bool ok = !ferror(r->file);
+    if (fclose(r->file) != 0) ok = false;
+    free(r);
+    g->record = NULL;
+    return ok;
+}
+
 /* ============================================================================
  * INITIALIZATION
  * ============================================================================ */
@@ -510,6 +852,10 @@ MelvinGraph* melvin_create(void) {
     g->pattern_count = 0;
     g->pattern_capacity = INITIAL_CAPACITY;
     
+    /* Context class 0 is the zero vector (calloc'd), which admits itself */
+    g->context_admits[0] = 1;
+    g->context_class_count = 1;
+    
     /* Initialize buffers */
     g->input_buffer = malloc(sizeof(uint32_t) * INITIAL_CAPACITY);
     g->input_length = 0;
@@ -614,9 +960,8 @@ void compute_system_state(MelvinGraph *g) {
     g->state.active_node_count = active_count;
     
     /* Compute activation rate (change from last step) */
-    static float prev_total_act = 0.0f;
-    g->state.activation_rate = total_act - prev_total_act;
-    prev_total_act = total_act;
+    g->state.activation_rate = total_act - g->state.prev_total_activation;
+    g->state.prev_total_activation = total_act;
     
     /* Compute competition pressure from activation distribution */
     /* High variance = high competition, low variance = cooperation */
@@ -902,11 +1247,6 @@ float compute_firing_probability(MelvinGraph *g, uint32_t node_id) {
  * ============================================================================ */
 
 void create_or_strengthen_edge(MelvinGraph *g, uint32_t from_id, uint32_t to_id) {
-    /* DEBUG: Track 'a'→'t' shortcut creation */
-    if (from_id == 'a' && to_id == 't') {
-        fprintf(stderr, "EDGE CREATE: 'a'→'t' being created/strengthened\n");
-    }
-    
     /* CRITICAL FIX: Prevent self-loops (root cause of chaotic outputs) */
     if (from_id == to_id) {
         return;  /* Never create edge from node to itself */
@@ -940,12 +1280,7 @@ void create_or_strengthen_edge(MelvinGraph *g, uint32_t from_id, uint32_t to_id)
             
             /* NATURAL CONTEXT: Remember what activated the source when this edge was used */
             uint32_t current_context = g->nodes[from_id].activated_by;
-            
-            /* DEBUG: Log context setting for key edges */
-            if (from_id == 'a' && (to_id == 'c' || to_id == 't')) {
-                fprintf(stderr, "EDGE_CTX: '%c'->'%c' current_ctx=%u, edge_ctx=%u\n",
-                       (char)from_id, (char)to_id, current_context, out->edges[i].context_node);
-            }
+            uint32_t edge_context = out->edges[i].context_node;
             
             /* Set context: Keep first learned context (don't overwrite) */
             /* This preserves the original context where edge was created */
@@ -981,17 +1316,12 @@ void create_or_strengthen_edge(MelvinGraph *g, uint32_t from_id, uint32_t to_id)
             /* Weak edges (low usage, low success) will stay small */
             /* Pruning will remove truly weak edges */
             
-            // #region agent log
-            FILE *f = fopen("f:\\Melvin_Research\\Melvin_o7\\melvin_o7\\.cursor\\debug.log", "a");
-            if (f) {
-                fprintf(f, "{\"location\":\"melvin.c:785\",\"message\":\"edge strengthened\",\"data\":{\"from\":%u,\"to\":%u,\"old_weight\":%.3f,\"new_weight\":%.3f,\"use\":%llu,\"success_rate\":%.3f},\"timestamp\":%lld,\"sessionId\":\"debug-session\",\"hypothesisId\":\"A\"}\n",
-                        from_id, to_id, old_weight, out->edges[i].weight, 
-                        (unsigned long long)out->edges[i].use_count,
-                        success_rate,
-                        (long long)time(NULL) * 1000);
-                fclose(f);
-            }
-            // #endregion
+            TRACE(g, MELVIN_TRACE_DETAIL, "edge_strengthened",
+                  "\"from\":%u,\"to\":%u,\"old_weight\":%.3f,\"new_weight\":%.3f,\"use\":%llu,"
+                  "\"success_rate\":%.3f,\"context\":%u,\"edge_context\":%u",
+                  from_id, to_id, old_weight, out->edges[i].weight,
+                  (unsigned long long)out->edges[i].use_count, success_rate,
+                  current_context, edge_context);
             
             /* Update total weight (for tracking) */
             normalize_edge_weights(g, from_id);
@@ -1017,6 +1347,8 @@ void create_or_strengthen_edge(MelvinGraph *g, uint32_t from_id, uint32_t to_id)
     e->context_node = g->nodes[from_id].activated_by;  /* Remember creation context */
     
     out->count++;
+    TRACE(g, MELVIN_TRACE_DETAIL, "edge_created", "\"from\":%u,\"to\":%u,\"context\":%u",
+          from_id, to_id, e->context_node);
     
     /* Update total weight (for tracking, not normalization) */
     normalize_edge_weights(g, from_id);
@@ -1063,9 +1395,15 @@ void prune_weak_edges(MelvinGraph *g, uint32_t node_id) {
 }
 
 /* ============================================================================
- * PATTERN MATCHING (with blank node support)
+ * CONTEXT CLASSES: Interned context vectors for modality gating
  * 
- * Check if a pattern matches a sequence, handling blank nodes as wildcards
+ * A brain sees a handful of distinct context vectors (one per modality), so
+ * each is interned once into a small table and patterns and the state carry
+ * its class. Whether patterns of one class apply under another is decided
+ * when a class is first seen, by the same cosine rule pattern_matches has
+ * always used, and kept as one bit per pair: gating a pattern is a lookup
+ * instead of a 16-float cosine. Vectors past CONTEXT_CLASS_MAX distinct ones
+ * stay CONTEXT_UNCLASSED and are gated by the cosine directly.
  * ============================================================================ */
 
 /* Compute context similarity (dot product, normalized) */
@@ -1084,6 +1422,122 @@ float context_similarity(const float *ctx1, const float *ctx2) {
     return dot / (sqrtf(mag1) * sqrtf(mag2) + 0.001f);  /* Cosine similarity */
 }
 
+/* Patterns learned in pattern_ctx apply under state_ctx. Near-zero similarity
+ * counts as "no modality" and is allowed. */
+static bool context_compatible(const float *pattern_ctx, const float *state_ctx) {
+    float sim = context_similarity(pattern_ctx, state_ctx);
+    return !(sim < 0.3f && sim > 0.001f);
+}
+
+/* Class of a vector, adding it (and its compatibility bits) if new */
+static uint16_t context_intern(MelvinGraph *g, const float *ctx) {
+    for (uint32_t c = 0; c < g->context_class_count; c++) {
+        if (memcmp(g->context_classes[c], ctx, sizeof(g->context_classes[c])) == 0) return (uint16_t)c;
+    }
+    if (g->context_class_count == CONTEXT_CLASS_MAX) return CONTEXT_UNCLASSED;
+
+    uint32_t n = g->context_class_count++;
+    memcpy(g->context_classes[n], ctx, sizeof(g->context_classes[n]));
+    g->context_admits[n] = 0;
+    for (uint32_t c = 0; c <= n; c++) {
+        if (context_compatible(g->context_classes[c], ctx)) g->context_admits[n] |= 1ull << c;
+        if (context_compatible(ctx, g->context_classes[c])) g->context_admits[c] |= 1ull << n;
+    }
+    return (uint16_t)n;
+}
+
+/* Pattern applies in the current context */
+static inline bool context_admits(const MelvinGraph *g, const Pattern *pat) {
+    uint16_t s = g->state.context_class, p = pat->context_class;
+    if (s == CONTEXT_UNCLASSED || p == CONTEXT_UNCLASSED) {
+        return context_compatible(pat->context_vector, g->state.context_vector);
+    }
+    return (g->context_admits[s] >> p) & 1;
+}
+
+/* ============================================================================
+ * CONTEXT PARTITIONS: Pattern ids filed by context class
+ * 
+ * Every class keeps the ids of its patterns in creation order, so a brain
+ * holding several modalities is stored as one partition per modality plus
+ * class 0, the shared partition of context-free patterns that every context
+ * admits. Scans that only care about patterns able to match walk
+ * context_scan instead of the whole table: the admitted partitions merged
+ * back into id order, so they visit the same patterns in the same order as
+ * a full walk that skipped the rest. The list is rebuilt when the context
+ * changes and extended as patterns are added, so a scan costs the active
+ * modality's patterns rather than the brain's.
+ * ============================================================================ */
+
+static void id_list_push(PatternIdList *list, uint32_t id) {
+    if (list->count == list->capacity) {
+        list->capacity = (list->capacity == 0) ? 16 : list->capacity * 2;
+        list->ids = realloc(list->ids, sizeof(uint32_t) * list->capacity);
+    }
+    list->ids[list->count++] = id;
+}
+
+static PatternIdList* context_partition(MelvinGraph *g, uint16_t context_class) {
+    return &g->context_partitions[context_class == CONTEXT_UNCLASSED ? CONTEXT_CLASS_MAX : context_class];
+}
+
+/* File a new pattern (the last one) under its class */
+static void context_partition_add(MelvinGraph *g, uint32_t pattern_id) {
+    const Pattern *pat = &g->patterns[pattern_id];
+    id_list_push(context_partition(g, pat->context_class), pattern_id);
+    if (g->context_scan_valid && context_admits(g, pat)) id_list_push(&g->context_scan_list, pattern_id);
+}
+
+/* Ids of the patterns the current context admits, ascending. Valid until a
+ * pattern is added or the context changes; don't add patterns while walking
+ * it. */
+static const uint32_t* context_scan(MelvinGraph *g, uint32_t *count) {
+    PatternIdList *scan = &g->context_scan_list;
+    if (!g->context_scan_valid) {
+        const PatternIdList *parts[CONTEXT_CLASS_MAX + 1];
+        uint32_t next[CONTEXT_CLASS_MAX + 1];
+        uint32_t part_count = 0;
+        uint16_t s = g->state.context_class;
+        for (uint32_t c = 0; c <= CONTEXT_CLASS_MAX; c++) {
+            const PatternIdList *part = &g->context_partitions[c];
+            if (part->count == 0) continue;
+            /* Classed pairs are settled by the bit; the rest are checked per pattern below */
+            if (c < CONTEXT_CLASS_MAX && s != CONTEXT_UNCLASSED && !((g->context_admits[s] >> c) & 1)) continue;
+            parts[part_count] = part;
+            next[part_count++] = 0;
+        }
+        scan->count = 0;
+        for (;;) {
+            uint32_t best = INVALID_PATTERN_ID, from = 0;
+            for (uint32_t i = 0; i < part_count; i++) {
+                if (next[i] < parts[i]->count && parts[i]->ids[next[i]] < best) {
+                    best = parts[i]->ids[next[i]];
+                    from = i;
+                }
+            }
+            if (best == INVALID_PATTERN_ID) break;
+            next[from]++;
+            if (context_admits(g, &g->patterns[best])) id_list_push(scan, best);
+        }
+        g->context_scan_valid = true;
+    }
+    *count = scan->count;
+    return scan->ids;
+}
+
+/* New patterns take the current context and join its partition */
+static void pattern_take_context(MelvinGraph *g, Pattern *pat) {
+    memcpy(pat->context_vector, g->state.context_vector, sizeof(pat->context_vector));
+    pat->context_class = g->state.context_class;
+    context_partition_add(g, (uint32_t)(pat - g->patterns));
+}
+
+/* ============================================================================
+ * PATTERN MATCHING (with blank node support)
+ * 
+ * Check if a pattern matches a sequence, handling blank nodes as wildcards
+ * ============================================================================ */
+
 bool pattern_matches(MelvinGraph *g, uint32_t pattern_id, const uint32_t *sequence, uint32_t seq_len, uint32_t start_pos) {
     Pattern *pat = &g->patterns[pattern_id];
     
@@ -1091,6 +1545,11 @@ bool pattern_matches(MelvinGraph *g, uint32_t pattern_id, const uint32_t *sequen
     /* Positional patterns: mostly blanks, match from start if sequence is long enough */
     /* Sequential patterns: match at specific start_pos (existing behavior) */
     
+    /* Context first: a lookup, and most mismatched patterns stop here */
+    if (!context_admits(g, pat)) {
+        return false;  /* Context mismatch - pattern doesn't apply to current modality */
+    }
+    
     bool is_positional_pattern = false;
     uint32_t non_blank_count = 0;
     uint32_t first_non_blank_pos = 0;
@@ -1124,12 +1583,6 @@ bool pattern_matches(MelvinGraph *g, uint32_t pattern_id, const uint32_t *sequen
     /* AUTO-LEARNED PORT CHECK: Check ports from actual nodes in sequence */
     /* Universal pattern matching - no port tracking (ports handle conversion externally) */
     
-    /* Also check context similarity for fine-grained matching */
-    float context_sim = context_similarity(pat->context_vector, g->state.context_vector);
-    if (context_sim < 0.3f && context_sim > 0.001f) {  /* Allow zero context (no modality set) */
-        return false;  /* Context mismatch - pattern doesn't apply to current modality */
-    }
-    
     /* Check each position, allowing blank nodes to match anything */
     for (uint32_t i = 0; i < pat->length; i++) {
         if (start_pos + i >= seq_len) {
@@ -1277,9 +1730,10 @@ void propagate_pattern_activation(MelvinGraph *g) {
         bool can_fire = false;
         uint32_t *match_sequence = NULL;
         uint32_t match_len = 0;
+        bool admitted = context_admits(g, pat);  /* Another modality's patterns match nowhere */
         
         /* Priority 1: Match END of output (continuation during wave propagation) */
-        if (g->output_length >= pat->length) {
+        if (admitted && g->output_length >= pat->length) {
             uint32_t start_pos = g->output_length - pat->length;
             if (pattern_matches(g, p, g->output_buffer, g->output_length, start_pos)) {
                 can_fire = true;
@@ -1291,7 +1745,7 @@ void propagate_pattern_activation(MelvinGraph *g) {
         /* Priority 2: Match ANYWHERE in input (context-aware matching) */
         /* Patterns should match longer sequences from input, not just the end */
         /* This allows patterns to use full question context, not just last few chars */
-        if (!can_fire && g->input_length >= pat->length) {
+        if (admitted && !can_fire && g->input_length >= pat->length) {
             /* Try matching from end of input (most relevant) backwards */
             /* Longer matches = more context = stronger activation */
             float best_match_strength = 0.0f;
@@ -1331,12 +1785,6 @@ void propagate_pattern_activation(MelvinGraph *g) {
             uint32_t *input_nodes = match_sequence;
             uint32_t input_len = match_len;
             
-            /* DEBUG: Pattern matched */
-            if (p < 2 && g->output_length == 0) {
-                fprintf(stderr, "PATTERN_MATCH: Pattern %u (len=%u) matched, prediction_count=%u\n",
-                        p, pat->length, pat->prediction_count);
-            }
-            
             /* Forward pass: compute activation using neural net */
             float net_output = pattern_forward_pass(g, p, input_nodes, input_len);
             
@@ -1351,11 +1799,11 @@ void propagate_pattern_activation(MelvinGraph *g) {
             
             pat->activation = net_output * pat->strength * context_boost;
             
-            /* DEBUG: Pattern activation after forward pass */
-            if (p < 2 && g->output_length == 0) {
-                fprintf(stderr, "PATTERN_ACT: Pattern %u: net_output=%.3f, strength=%.3f, context_boost=%.3f, final_activation=%.3f, threshold=%.3f\n",
-                        p, net_output, pat->strength, context_boost, pat->activation, pat->threshold);
-            }
+            TRACE(g, MELVIN_TRACE_DETAIL, "pattern_matched",
+                  "\"pattern\":%u,\"length\":%u,\"predictions\":%u,\"net_output\":%.3f,\"strength\":%.3f,"
+                  "\"context_boost\":%.3f,\"activation\":%.3f,\"threshold\":%.3f",
+                  p, pat->length, pat->prediction_count, net_output, pat->strength,
+                  context_boost, pat->activation, pat->threshold);
             
             /* LOCAL COMPETITION: Pattern competes with patterns that predict same nodes */
             /* Direct competition: patterns that predict same nodes compete locally */
@@ -1366,6 +1814,7 @@ void propagate_pattern_activation(MelvinGraph *g) {
             for (uint32_t p2 = 0; p2 < g->pattern_count; p2++) {
                 if (p2 == p) continue;  /* Don't compete with self */
                 Pattern *competitor = &g->patterns[p2];
+                if (competitor->activation <= 0.0f) continue;  /* Only active competitors count; most aren't */
                 
                 /* Check if competitor predicts any of the same nodes */
                 bool competes = false;
@@ -1380,7 +1829,7 @@ void propagate_pattern_activation(MelvinGraph *g) {
                 }
                 
                 /* If competitor predicts same nodes and is active, it's local competition */
-                if (competes && competitor->activation > 0.0f) {
+                if (competes) {
                     local_competition_strength += competitor->activation * competitor->strength;
                     local_competitor_count++;
                 }
@@ -1991,7 +2440,158 @@ void propagate_semantic_activation(MelvinGraph *g) {
  * The wave IS the decision.
  * ============================================================================ */
 
-float compute_relative_coherence(MelvinGraph *g, uint32_t source, uint32_t target) {
+/* ============================================================================
+ * COHERENCE CONTEXT: Per-step facts shared by every edge
+ *
+ * Pattern activations don't change while edges are evaluated, so the set of
+ * active patterns and the blank-node generalization term (which doesn't
+ * depend on the edge) are computed once per step instead of once per edge. Active ids are ascending, so sums accumulate in the same
+ * order as a full scan of the pattern array.
+ * ============================================================================ */
+
+typedef struct {
+    uint32_t *active;                   /* Patterns with activation > threshold */
+    uint32_t active_count;
+    uint8_t *is_active;                 /* Same set, indexed by pattern id */
+    uint32_t *candidates;               /* Scratch: active patterns containing one source */
+    uint32_t *supporting;               /* Scratch: active patterns supporting one edge */
+    float generalization_contribution;  /* Blank patterns matching the input (edge-independent) */
+    uint8_t in_input[BYTE_VALUES];      /* Node appears in the current input */
+    uint8_t after_last_output[BYTE_VALUES];  /* Active edge from the last output to node */
+} CoherenceContext;
+
+/* What propagation already knows about one edge, so coherence doesn't search for it */
+typedef struct {
+    uint32_t source;
+    uint32_t target;
+    const Edge *first_edge;             /* First active source -> target edge */
+    const uint32_t *supporting;         /* Active patterns supporting the edge, ascending */
+    uint32_t supporting_count;
+} EdgeEvidence;
+
+/* Does a pattern with blank nodes match somewhere in the current input? */
+static bool blank_pattern_matches_input(MelvinGraph *g, Pattern *pat) {
+    bool has_blank = false;
+    for (uint32_t i = 0; i < pat->length; i++) {
+        if (IS_BLANK_NODE(pat->node_ids[i])) {
+            has_blank = true;
+            break;
+        }
+    }
+    if (!has_blank) return false;
+
+    /* Test: if blank was filled with source/target, would pattern match input? */
+    for (uint32_t pos = 0; pos + pat->length <= g->input_length; pos++) {
+        bool match = true;
+        for (uint32_t i = 0; i < pat->length; i++) {
+            if (!MATCHES_BLANK(g->input_buffer[pos + i], pat->node_ids[i])) {
+                match = false;
+                break;
+            }
+        }
+        if (match) return true;
+    }
+    return false;
+}
+
+static void coherence_context_build(MelvinGraph *g, CoherenceContext *ctx) {
+    uint32_t n = (g->pattern_count > 0) ? g->pattern_count : 1;
+    memset(ctx, 0, sizeof(CoherenceContext));
+    ctx->active = malloc(sizeof(uint32_t) * n);
+    ctx->candidates = malloc(sizeof(uint32_t) * n);
+    ctx->supporting = malloc(sizeof(uint32_t) * n);
+    ctx->is_active = calloc(n, sizeof(uint8_t));
+
+    for (uint32_t p = 0; p < g->pattern_count; p++) {
+        Pattern *pat = &g->patterns[p];
+        if (pat->activation <= pat->threshold) continue;
+        ctx->active[ctx->active_count++] = p;
+        ctx->is_active[p] = 1;
+    }
+
+    /* GENERALIZATION: patterns with blank nodes that match the input */
+    for (uint32_t a = 0; a < ctx->active_count; a++) {
+        Pattern *pat = &g->patterns[ctx->active[a]];
+        if (!blank_pattern_matches_input(g, pat)) continue;
+
+        /* THIS STEP: Pattern strength (current relevance) */
+        float current_generalization = pat->strength;
+
+        /* PAST INFO: Exploration need modulates when to explore */
+        /* Low confidence = explore more, but don't let it dominate */
+        float exploration_modulator = 1.0f - (g->state.pattern_confidence * 0.5f);  /* Max 0.5x boost */
+
+        /* Pattern novelty: new patterns need exploration */
+        float pattern_novelty = (pat->prediction_attempts < 10) ? 1.0f :
+            (1.0f - ((float)pat->prediction_successes / (float)pat->prediction_attempts) * 0.5f);
+
+        ctx->generalization_contribution += current_generalization * exploration_modulator * pattern_novelty;
+    }
+
+    if (ctx->generalization_contribution > 1.0f) ctx->generalization_contribution = 1.0f;
+
+    /* CONTEXT FIT inputs: input membership and what the last output connects to */
+    for (uint32_t i = 0; i < g->input_length; i++) {
+        if (g->input_buffer[i] < BYTE_VALUES) ctx->in_input[g->input_buffer[i]] = 1;
+    }
+    if (g->output_length > 0 && g->output_buffer[g->output_length - 1] < BYTE_VALUES) {
+        EdgeList *last_edges = &g->outgoing[g->output_buffer[g->output_length - 1]];
+        for (uint32_t e = 0; e < last_edges->count; e++) {
+            if (last_edges->edges[e].active && last_edges->edges[e].to_id < BYTE_VALUES) {
+                ctx->after_last_output[last_edges->edges[e].to_id] = 1;
+            }
+        }
+    }
+}
+
+/* Index of the first active edge to each byte target (UINT32_MAX if none) */
+static void index_first_edges(const EdgeList *out, uint32_t *first_edge) {
+    for (uint32_t t = 0; t < BYTE_VALUES; t++) first_edge[t] = UINT32_MAX;
+    for (uint32_t e = out->count; e-- > 0; ) {
+        if (out->edges[e].active && out->edges[e].to_id < BYTE_VALUES) {
+            first_edge[out->edges[e].to_id] = e;
+        }
+    }
+}
+
+static void coherence_context_free(CoherenceContext *ctx) {
+    free(ctx->active);
+    free(ctx->is_active);
+    free(ctx->candidates);
+    free(ctx->supporting);
+    memset(ctx, 0, sizeof(CoherenceContext));
+}
+
+/* Does a pattern support the edge source -> target?
+ * Only reads the pattern's sequence and predictions, which inference never changes. */
+static bool pattern_supports_edge(const Pattern *pat, uint32_t source, uint32_t target) {
+    /* Support 1: Edge is in pattern sequence */
+    for (uint32_t idx = 0; idx + 1 < pat->length; idx++) {
+        if (MATCHES_BLANK(source, pat->node_ids[idx]) &&
+            MATCHES_BLANK(target, pat->node_ids[idx + 1])) {
+            return true;
+        }
+    }
+
+    /* Support 2: Pattern predicts target (and source is in pattern) */
+    bool source_in_pattern = false;
+    for (uint32_t idx = 0; idx < pat->length; idx++) {
+        if (MATCHES_BLANK(source, pat->node_ids[idx])) {
+            source_in_pattern = true;
+            break;
+        }
+    }
+    if (source_in_pattern) {
+        for (uint32_t pred = 0; pred < pat->prediction_count; pred++) {
+            if (pat->predicted_nodes[pred] == target) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+float compute_relative_coherence(MelvinGraph *g, const CoherenceContext *ctx, const EdgeEvidence *ev) {
     /* ========================================================================
      * RELATIVE COHERENCE: Everything relative to current context
      * Not historical averages, not absolute values
@@ -1999,88 +2599,41 @@ float compute_relative_coherence(MelvinGraph *g, uint32_t source, uint32_t targe
      * ======================================================================== */
     
     /* 1. PATTERN SUPPORT (Relative to current active patterns) */
-    float pattern_support = 0.0f;
-    float max_active_pattern_strength = 0.0f;
-    float total_active_pattern_strength = 0.0f;
+    /* Compute: How much do patterns support this edge RIGHT NOW? */
+    /* Past info: Modulates confidence (how much to trust), not weight */
+    float pattern_contribution = 0.0f;
+    float pattern_confidence_modulator = 1.0f;  /* Start neutral */
     
-    /* Find max active pattern strength (for relative comparison) */
-    for (uint32_t p = 0; p < g->pattern_count; p++) {
-        Pattern *pat = &g->patterns[p];
-        if (pat->activation > pat->threshold) {
-            if (pat->strength > max_active_pattern_strength) {
-                max_active_pattern_strength = pat->strength;
-            }
-            total_active_pattern_strength += pat->strength;
-        }
-    }
+    uint32_t source = ev->source;
+    uint32_t target = ev->target;
     
-    /* Check if patterns support this edge (relative to active patterns) */
-    for (uint32_t p = 0; p < g->pattern_count; p++) {
-        Pattern *pat = &g->patterns[p];
+    /* Only ACTIVE patterns (right now) that support this edge */
+    for (uint32_t a = 0; a < ev->supporting_count; a++) {
+        Pattern *pat = &g->patterns[ev->supporting[a]];
         
-        /* Only consider ACTIVE patterns (right now) */
-        if (pat->activation <= pat->threshold) continue;
-        
-        bool supports = false;
-        
-        /* Support 1: Edge is in pattern sequence */
-        for (uint32_t idx = 0; idx + 1 < pat->length; idx++) {
-            if (MATCHES_BLANK(source, pat->node_ids[idx]) && 
-                MATCHES_BLANK(target, pat->node_ids[idx + 1])) {
-                supports = true;
-                break;
-            }
-        }
+        /* THIS STEP: Pattern strength and activation (current relevance) */
+        float current_pattern_support = pat->strength * 
+            ((pat->activation - pat->threshold) / (1.0f - pat->threshold + 0.001f));
         
-        /* Support 2: Pattern predicts target (and source is in pattern) */
-        if (!supports) {
-            bool source_in_pattern = false;
-            for (uint32_t idx = 0; idx < pat->length; idx++) {
-                if (MATCHES_BLANK(source, pat->node_ids[idx])) {
-                    source_in_pattern = true;
-                    break;
-                }
-            }
-            
-            if (source_in_pattern) {
-                for (uint32_t pred = 0; pred < pat->prediction_count; pred++) {
-                    if (pat->predicted_nodes[pred] == target) {
-                        supports = true;
-                        break;
-                    }
-                }
-            }
-        }
+        pattern_contribution += current_pattern_support;
         
-        if (supports) {
-            /* RELATIVE: Compare to max active pattern (not absolute) */
-            float relative_strength = (max_active_pattern_strength > 0.001f) ?
-                (pat->strength / max_active_pattern_strength) : 0.0f;
-            
-            /* Meaning boost: patterns with meaning are more coherent */
-            float meaning_boost = 1.0f + (pat->accumulated_meaning * 0.5f);
-            if (meaning_boost > 5.0f) meaning_boost = 5.0f;
-            
-            pattern_support += relative_strength * meaning_boost;
+        /* PAST INFO: Modulates confidence (how much to trust this pattern) */
+        /* But doesn't change the contribution itself - just how much we trust it */
+        float pat_confidence = (pat->prediction_attempts > 0) ?
+            ((float)pat->prediction_successes / (float)pat->prediction_attempts) : 0.5f;
+        if (pat->rule_confidence > 0.0f) {
+            pat_confidence = (pat_confidence + pat->rule_confidence) / 2.0f;
         }
+        pattern_confidence_modulator *= (0.5f + pat_confidence * 0.5f);  /* Modulate, don't dominate */
     }
     
-    /* Normalize pattern support relative to active pattern count */
-    float relative_pattern_support = (total_active_pattern_strength > 0.001f) ?
-        (pattern_support / (total_active_pattern_strength + 1.0f)) : 0.0f;
-    if (relative_pattern_support > 1.0f) relative_pattern_support = 1.0f;
-    
     
     /* 2. CONTEXT FIT (Relative to current input/output) */
     float context_fit = 0.0f;
     
     /* Input context: Is source/target in current input? (right now) */
-    bool source_in_input = false;
-    bool target_in_input = false;
-    for (uint32_t i = 0; i < g->input_length; i++) {
-        if (g->input_buffer[i] == source) source_in_input = true;
-        if (g->input_buffer[i] == target) target_in_input = true;
-    }
+    bool source_in_input = ctx->in_input[source];
+    bool target_in_input = ctx->in_input[target];
     
     if (source_in_input) {
         context_fit += 0.4f;  /* Source is in input (strong context) */
@@ -2099,15 +2652,9 @@ float compute_relative_coherence(MelvinGraph *g, uint32_t source, uint32_t targe
         uint32_t last_output = g->output_buffer[g->output_length - 1];
         if (last_output == source) {
             context_fit += 0.5f;  /* Stronger - continues output sequence */
-        } else {
-            /* Check if edge exists from last_output to source */
-            EdgeList *last_edges = &g->outgoing[last_output];
-            for (uint32_t e = 0; e < last_edges->count; e++) {
-                if (last_edges->edges[e].to_id == source && last_edges->edges[e].active) {
-                    context_fit += 0.3f;  /* Moderate - connected to last output */
-                    break;
-                }
-            }
+        } else if (ctx->after_last_output[source]) {
+            /* Edge exists from last_output to source */
+            context_fit += 0.3f;  /* Moderate - connected to last output */
         }
     }
     
@@ -2119,64 +2666,15 @@ float compute_relative_coherence(MelvinGraph *g, uint32_t source, uint32_t targe
     float sequence_coherence = 0.0f;
     
     /* Does this edge have a good success rate? (right now) */
-    EdgeList *source_edges = &g->outgoing[source];
-    for (uint32_t e = 0; e < source_edges->count; e++) {
-        if (source_edges->edges[e].to_id == target && source_edges->edges[e].active) {
-            Edge *edge = &source_edges->edges[e];
-            if (edge->use_count > 0) {
-                sequence_coherence = (float)edge->success_count / (float)edge->use_count;
-            } else {
-                sequence_coherence = 0.5f;  /* Unknown - neutral */
-            }
-            break;
-        }
-    }
-    
-    
-    /* 4. GENERALIZATION (Blank node hypothesis testing) */
-    float generalization = 0.0f;
-    
-    /* For patterns with blank nodes, test if this edge would be coherent */
-    for (uint32_t p = 0; p < g->pattern_count; p++) {
-        Pattern *pat = &g->patterns[p];
-        if (pat->activation <= pat->threshold) continue;
-        
-        /* Check if pattern has blank nodes */
-        bool has_blank = false;
-        for (uint32_t i = 0; i < pat->length; i++) {
-            if (IS_BLANK_NODE(pat->node_ids[i])) {
-                has_blank = true;
-                break;
-            }
-        }
-        
-        if (has_blank) {
-            /* Test: if blank was filled with source/target, would pattern match input? */
-            bool would_match = false;
-            for (uint32_t pos = 0; pos + pat->length <= g->input_length; pos++) {
-                bool match = true;
-                for (uint32_t i = 0; i < pat->length; i++) {
-                    if (!MATCHES_BLANK(g->input_buffer[pos + i], pat->node_ids[i])) {
-                        match = false;
-                        break;
-                    }
-                }
-                if (match) {
-                    would_match = true;
-                    break;
-                }
-            }
-            
-            if (would_match) {
-                /* Pattern with blank matches input - generalization is coherent */
-                generalization += pat->strength * 0.5f;
-            }
+    const Edge *edge = ev->first_edge;
+    if (edge) {
+        if (edge->use_count > 0) {
+            sequence_coherence = (float)edge->success_count / (float)edge->use_count;
+        } else {
+            sequence_coherence = 0.5f;  /* Unknown - neutral */
         }
     }
     
-    /* Normalize generalization */
-    if (generalization > 1.0f) generalization = 1.0f;
-    
     
     /* ========================================================================
      * INDEPENDENT COMPONENT EVALUATION: Each step is new
@@ -2186,66 +2684,12 @@ float compute_relative_coherence(MelvinGraph *g, uint32_t source, uint32_t targe
      * ======================================================================== */
     
     /* 1. PATTERN SUPPORT CONTRIBUTION */
-    /* Compute: How much do patterns support this edge RIGHT NOW? */
-    /* Past info: Modulates confidence (how much to trust), not weight */
-    float pattern_contribution = 0.0f;
-    float pattern_confidence_modulator = 1.0f;  /* Start neutral */
-    
-    for (uint32_t p = 0; p < g->pattern_count; p++) {
-        Pattern *pat = &g->patterns[p];
-        if (pat->activation <= pat->threshold) continue;
-        
-        /* Check if this pattern supports the edge (THIS step) */
-        bool supports = false;
-        for (uint32_t idx = 0; idx + 1 < pat->length; idx++) {
-            if (MATCHES_BLANK(source, pat->node_ids[idx]) && 
-                MATCHES_BLANK(target, pat->node_ids[idx + 1])) {
-                supports = true;
-                break;
-            }
-        }
-        if (!supports) {
-            bool source_in_pattern = false;
-            for (uint32_t idx = 0; idx < pat->length; idx++) {
-                if (MATCHES_BLANK(source, pat->node_ids[idx])) {
-                    source_in_pattern = true;
-                    break;
-                }
-            }
-            if (source_in_pattern) {
-                for (uint32_t pred = 0; pred < pat->prediction_count; pred++) {
-                    if (pat->predicted_nodes[pred] == target) {
-                        supports = true;
-                        break;
-                    }
-                }
-            }
-        }
-        
-        if (supports) {
-            /* THIS STEP: Pattern strength and activation (current relevance) */
-            float current_pattern_support = pat->strength * 
-                ((pat->activation - pat->threshold) / (1.0f - pat->threshold + 0.001f));
-            
-            pattern_contribution += current_pattern_support;
-            
-            /* PAST INFO: Modulates confidence (how much to trust this pattern) */
-            /* But doesn't change the contribution itself - just how much we trust it */
-            float pat_confidence = (pat->prediction_attempts > 0) ?
-                ((float)pat->prediction_successes / (float)pat->prediction_attempts) : 0.5f;
-            if (pat->rule_confidence > 0.0f) {
-                pat_confidence = (pat_confidence + pat->rule_confidence) / 2.0f;
-            }
-            pattern_confidence_modulator *= (0.5f + pat_confidence * 0.5f);  /* Modulate, don't dominate */
-        }
-    }
-    
-    /* Apply confidence modulation (past informs trust, not dominance) */
-    pattern_contribution *= pattern_confidence_modulator;
-    /* Also modulate by system confidence (but don't let it dominate) */
-    pattern_contribution *= (0.5f + g->state.pattern_confidence * 0.5f);
-    /* Normalize to 0-1 range */
-    if (pattern_contribution > 1.0f) pattern_contribution = 1.0f;
+    /* Apply confidence modulation (past informs trust, not dominance) */
+    pattern_contribution *= pattern_confidence_modulator;
+    /* Also modulate by system confidence (but don't let it dominate) */
+    pattern_contribution *= (0.5f + g->state.pattern_confidence * 0.5f);
+    /* Normalize to 0-1 range */
+    if (pattern_contribution > 1.0f) pattern_contribution = 1.0f;
     
     
     /* 2. CONTEXT FIT CONTRIBUTION */
@@ -2269,69 +2713,19 @@ float compute_relative_coherence(MelvinGraph *g, uint32_t source, uint32_t targe
     
     /* PAST INFO: Usage informs confidence (well-tested edges are more reliable) */
     /* But don't let past usage dominate - current success rate is primary */
-    for (uint32_t e = 0; e < source_edges->count; e++) {
-        if (source_edges->edges[e].to_id == target && source_edges->edges[e].active) {
-            Edge *edge = &source_edges->edges[e];
-            /* Usage confidence: more used = more reliable, but don't let it dominate */
-            float usage_confidence = (edge->use_count > 10) ? 1.0f : (edge->use_count / 10.0f);
-            /* Modulate by usage confidence (past informs trust) */
-            sequence_contribution = sequence_contribution * 0.7f + (sequence_contribution * usage_confidence * 0.3f);
-            break;
-        }
+    if (edge) {
+        /* Usage confidence: more used = more reliable, but don't let it dominate */
+        float usage_confidence = (edge->use_count > 10) ? 1.0f : (edge->use_count / 10.0f);
+        /* Modulate by usage confidence (past informs trust) */
+        sequence_contribution = sequence_contribution * 0.7f + (sequence_contribution * usage_confidence * 0.3f);
     }
     if (sequence_contribution > 1.0f) sequence_contribution = 1.0f;
     
     
-    /* 4. GENERALIZATION CONTRIBUTION */
+    /* 4. GENERALIZATION CONTRIBUTION (Blank node hypothesis testing) */
     /* Compute: Would this edge help generalize patterns RIGHT NOW? */
-    /* Past info: Exploration need (when uncertain, explore more) */
-    float generalization_contribution = 0.0f;
-    
-    for (uint32_t p = 0; p < g->pattern_count; p++) {
-        Pattern *pat = &g->patterns[p];
-        if (pat->activation <= pat->threshold) continue;
-        
-        bool has_blank = false;
-        for (uint32_t i = 0; i < pat->length; i++) {
-            if (IS_BLANK_NODE(pat->node_ids[i])) {
-                has_blank = true;
-                break;
-            }
-        }
-        
-        if (has_blank) {
-            bool would_match = false;
-            for (uint32_t pos = 0; pos + pat->length <= g->input_length; pos++) {
-                bool match = true;
-                for (uint32_t i = 0; i < pat->length; i++) {
-                    if (!MATCHES_BLANK(g->input_buffer[pos + i], pat->node_ids[i])) {
-                        match = false;
-                        break;
-                    }
-                }
-                if (match) {
-                    would_match = true;
-                    break;
-                }
-            }
-            
-            if (would_match) {
-                /* THIS STEP: Pattern strength (current relevance) */
-                float current_generalization = pat->strength;
-                
-                /* PAST INFO: Exploration need modulates when to explore */
-                /* Low confidence = explore more, but don't let it dominate */
-                float exploration_modulator = 1.0f - (g->state.pattern_confidence * 0.5f);  /* Max 0.5x boost */
-                
-                /* Pattern novelty: new patterns need exploration */
-                float pattern_novelty = (pat->prediction_attempts < 10) ? 1.0f : 
-                    (1.0f - ((float)pat->prediction_successes / (float)pat->prediction_attempts) * 0.5f);
-                
-                generalization_contribution += current_generalization * exploration_modulator * pattern_novelty;
-            }
-        }
-    }
-    if (generalization_contribution > 1.0f) generalization_contribution = 1.0f;
+    /* Doesn't depend on the edge - computed once per step in the context */
+    float generalization_contribution = ctx->generalization_contribution;
     
     
     /* ========================================================================
@@ -2435,110 +2829,141 @@ float compute_relative_coherence(MelvinGraph *g, uint32_t source, uint32_t targe
  * Returns the most coherent node (no separate selection step).
  * ============================================================================ */
 
-uint32_t propagate_with_coherence(MelvinGraph *g) {
-    /* Track best coherent node during propagation */
-    uint32_t best_node = BYTE_VALUES;
-    float best_coherence_score = 0.0f;
-    
-    /* Temporary storage for new activations */
-    float new_activations[BYTE_VALUES] = {0.0f};
-    float node_coherence[BYTE_VALUES] = {0.0f};
+/* Does the pattern match the input, or the end of the output so far? */
+static bool pattern_matches_context(MelvinGraph *g, Pattern *pat) {
+    /* Check if pattern matches input or output */
+    bool matches = false;
     
-    /* First: Activate patterns based on current context */
-    for (uint32_t p = 0; p < g->pattern_count; p++) {
-        Pattern *pat = &g->patterns[p];
-        
-        /* Check if pattern matches input or output */
-        bool matches = false;
-        
-        /* Match against input */
-        for (uint32_t pos = 0; pos + pat->length <= g->input_length; pos++) {
-            bool match = true;
-            for (uint32_t i = 0; i < pat->length; i++) {
-                if (!MATCHES_BLANK(g->input_buffer[pos + i], pat->node_ids[i])) {
-                    match = false;
-                    break;
-                }
-            }
-            if (match) {
-                matches = true;
+    /* Match against input */
+    for (uint32_t pos = 0; pos + pat->length <= g->input_length; pos++) {
+        bool match = true;
+        for (uint32_t i = 0; i < pat->length; i++) {
+            if (!MATCHES_BLANK(g->input_buffer[pos + i], pat->node_ids[i])) {
+                match = false;
                 break;
             }
         }
-        
-        /* Match against output end */
-        if (!matches && g->output_length >= pat->length) {
-            bool match = true;
-            uint32_t start = g->output_length - pat->length;
-            for (uint32_t i = 0; i < pat->length; i++) {
-                if (!MATCHES_BLANK(g->output_buffer[start + i], pat->node_ids[i])) {
-                    match = false;
-                    break;
-                }
-            }
-            if (match) matches = true;
-        }
-        
-        if (matches) {
-            pat->activation = pat->strength * 2.0f;  /* Activate pattern */
-        } else {
-            pat->activation *= 0.8f;  /* Decay inactive patterns */
+        if (match) {
+            matches = true;
+            break;
         }
     }
     
-    /* Second: Propagate through edges with coherence evaluation */
-    for (uint32_t source = 0; source < BYTE_VALUES; source++) {
-        if (!g->nodes[source].exists) continue;
-        if (g->nodes[source].activation < 0.01f) continue;  /* Not active enough */
-        
-        EdgeList *out = &g->outgoing[source];
-        
-        for (uint32_t e = 0; e < out->count; e++) {
-            Edge *edge = &out->edges[e];
-            if (!edge->active) continue;
-            
-            uint32_t target = edge->to_id;
-            if (target >= BYTE_VALUES) continue;
-            
-            /* Compute relative coherence (on-the-fly, right now) */
-            float coherence = compute_relative_coherence(g, source, target);
-            
-            /* ========================================================================
-             * COHERENCE MULTIPLIER: Coherent paths strengthen, incoherent paths decay
-             * ======================================================================== */
-            
-            float coherence_multiplier;
-            
-            if (coherence > 0.5f) {
-                /* Coherent: Strengthen signal */
-                /* Scale: 0.5 → 1.0, 1.0 → 2.0 */
-                coherence_multiplier = 1.0f + ((coherence - 0.5f) * 2.0f);
-            } else {
-                /* Incoherent: Decay signal */
-                /* Scale: 0.5 → 1.0, 0.0 → 0.1 (strong decay) */
-                coherence_multiplier = 0.1f + (coherence * 1.8f);
+    /* Match against output end */
+    if (!matches && g->output_length >= pat->length) {
+        bool match = true;
+        uint32_t start = g->output_length - pat->length;
+        for (uint32_t i = 0; i < pat->length; i++) {
+            if (!MATCHES_BLANK(g->output_buffer[start + i], pat->node_ids[i])) {
+                match = false;
+                break;
             }
-            
-            /* Base signal strength */
-            float base_signal = g->nodes[source].activation * edge->weight;
-            
-            /* Apply coherence multiplier */
-            float coherent_signal = base_signal * coherence_multiplier;
-            
-            /* Accumulate in temporary storage */
-            new_activations[target] += coherent_signal;
-            
-            /* Track coherence for this node */
-            if (coherence > node_coherence[target]) {
-                node_coherence[target] = coherence;
+        }
+        if (match) matches = true;
+    }
+    
+    return matches;
+}
+
+/* First phase for one pattern: activate it if it matches context, else decay */
+static void update_pattern_context_activation(MelvinGraph *g, Pattern *pat) {
+    if (pattern_matches_context(g, pat)) {
+        pat->activation = pat->strength * 2.0f;  /* Activate pattern */
+    } else {
+        pat->activation *= 0.8f;  /* Decay inactive patterns */
+    }
+}
+
+/* Is this node active enough to send signal along its edges? */
+static bool node_propagates(MelvinGraph *g, uint32_t source) {
+    return g->nodes[source].exists && g->nodes[source].activation >= 0.01f;
+}
+
+/* Can this edge carry signal to a byte node? */
+static bool edge_propagates(const Edge *edge) {
+    return edge->active && edge->to_id < BYTE_VALUES;
+}
+
+/* Patterns from ids that contain node - a pattern can only support edges
+ * from nodes it contains, so this narrows the search once per source */
+static uint32_t patterns_containing(MelvinGraph *g, const uint32_t *ids, uint32_t count,
+                                    uint32_t node, uint32_t *out) {
+    uint32_t found = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        Pattern *pat = &g->patterns[ids[i]];
+        for (uint32_t idx = 0; idx < pat->length; idx++) {
+            if (MATCHES_BLANK(node, pat->node_ids[idx])) {
+                out[found++] = ids[i];
+                break;
             }
         }
     }
+    return found;
+}
+
+/* Patterns from ids that support source -> target */
+static uint32_t patterns_supporting(MelvinGraph *g, const uint32_t *ids, uint32_t count,
+                                    uint32_t source, uint32_t target, uint32_t *out) {
+    uint32_t found = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (pattern_supports_edge(&g->patterns[ids[i]], source, target)) {
+            out[found++] = ids[i];
+        }
+    }
+    return found;
+}
+
+/* Second phase for one edge: accumulate its coherence-weighted signal */
+static void propagate_coherent_edge(MelvinGraph *g, const CoherenceContext *ctx, const Edge *edge,
+                                    const EdgeEvidence *ev,
+                                    float *new_activations, float *node_coherence) {
+    uint32_t source = ev->source;
+    uint32_t target = edge->to_id;
+    
+    /* Compute relative coherence (on-the-fly, right now) */
+    float coherence = compute_relative_coherence(g, ctx, ev);
+    
+    /* ========================================================================
+     * COHERENCE MULTIPLIER: Coherent paths strengthen, incoherent paths decay
+     * ======================================================================== */
+    
+    float coherence_multiplier;
+    
+    if (coherence > 0.5f) {
+        /* Coherent: Strengthen signal */
+        /* Scale: 0.5 → 1.0, 1.0 → 2.0 */
+        coherence_multiplier = 1.0f + ((coherence - 0.5f) * 2.0f);
+    } else {
+        /* Incoherent: Decay signal */
+        /* Scale: 0.5 → 1.0, 0.0 → 0.1 (strong decay) */
+        coherence_multiplier = 0.1f + (coherence * 1.8f);
+    }
+    
+    /* Base signal strength */
+    float base_signal = g->nodes[source].activation * edge->weight;
+    
+    /* Apply coherence multiplier */
+    float coherent_signal = base_signal * coherence_multiplier;
+    
+    /* Accumulate in temporary storage */
+    new_activations[target] += coherent_signal;
+    
+    /* Track coherence for this node */
+    if (coherence > node_coherence[target]) {
+        node_coherence[target] = coherence;
+    }
+}
+
+/* Remaining phases: pattern predictions, apply new activations, pick the node */
+static uint32_t select_coherent_node(MelvinGraph *g, const CoherenceContext *ctx,
+                                     float *new_activations, float *node_coherence) {
+    /* Track best coherent node during propagation */
+    uint32_t best_node = BYTE_VALUES;
+    float best_coherence_score = 0.0f;
     
     /* Third: Pattern predictions boost coherent targets */
-    for (uint32_t p = 0; p < g->pattern_count; p++) {
-        Pattern *pat = &g->patterns[p];
-        if (pat->activation <= pat->threshold) continue;
+    for (uint32_t a = 0; a < ctx->active_count; a++) {
+        Pattern *pat = &g->patterns[ctx->active[a]];
         
         for (uint32_t pred = 0; pred < pat->prediction_count; pred++) {
             uint32_t target = pat->predicted_nodes[pred];
@@ -2678,9 +3103,8 @@ uint32_t propagate_with_coherence(MelvinGraph *g) {
     
     /* Check END_MARKER */
     float end_marker_coherence = 0.0f;
-    for (uint32_t p = 0; p < g->pattern_count; p++) {
-        Pattern *pat = &g->patterns[p];
-        if (pat->activation <= pat->threshold) continue;
+    for (uint32_t a = 0; a < ctx->active_count; a++) {
+        Pattern *pat = &g->patterns[ctx->active[a]];
         
         for (uint32_t pred = 0; pred < pat->prediction_count; pred++) {
             if (pat->predicted_nodes[pred] == END_MARKER) {
@@ -2715,6 +3139,49 @@ uint32_t propagate_with_coherence(MelvinGraph *g) {
     return best_node;
 }
 
+uint32_t propagate_with_coherence(MelvinGraph *g) {
+    /* Temporary storage for new activations */
+    float new_activations[BYTE_VALUES] = {0.0f};
+    float node_coherence[BYTE_VALUES] = {0.0f};
+    
+    /* First: Activate patterns based on current context */
+    for (uint32_t p = 0; p < g->pattern_count; p++) {
+        update_pattern_context_activation(g, &g->patterns[p]);
+    }
+    
+    CoherenceContext ctx;
+    coherence_context_build(g, &ctx);
+    
+    /* Second: Propagate through edges with coherence evaluation */
+    uint32_t first_edge[BYTE_VALUES];
+    for (uint32_t source = 0; source < BYTE_VALUES; source++) {
+        if (!node_propagates(g, source)) continue;  /* Not active enough */
+        
+        EdgeList *out = &g->outgoing[source];
+        if (out->count == 0) continue;
+        index_first_edges(out, first_edge);
+        uint32_t candidates = patterns_containing(g, ctx.active, ctx.active_count, source, ctx.candidates);
+        
+        for (uint32_t e = 0; e < out->count; e++) {
+            Edge *edge = &out->edges[e];
+            if (!edge_propagates(edge)) continue;
+            
+            EdgeEvidence ev;
+            ev.source = source;
+            ev.target = edge->to_id;
+            ev.first_edge = &out->edges[first_edge[edge->to_id]];
+            ev.supporting = ctx.supporting;
+            ev.supporting_count = patterns_supporting(g, ctx.candidates, candidates,
+                                                      source, edge->to_id, ctx.supporting);
+            propagate_coherent_edge(g, &ctx, edge, &ev, new_activations, node_coherence);
+        }
+    }
+    
+    uint32_t best_node = select_coherent_node(g, &ctx, new_activations, node_coherence);
+    coherence_context_free(&ctx);
+    return best_node;
+}
+
 /* ============================================================================
  * LEGACY WAVE PROPAGATION (kept for compatibility)
  * ============================================================================ */
@@ -3025,11 +3492,6 @@ void propagate_activation(MelvinGraph *g) {
             
             for (uint32_t p = 0; p < g->pattern_count && p < 500; p++) {
                 Pattern *pat = &g->patterns[p];
-                /* DEBUG: Check why patterns aren't boosting */
-                if (p < 2 && i == 'a' && (target == 'c' || target == 't') && g->output_length == 0) {
-                    fprintf(stderr, "PATTERN_CHECK: Pattern %u: activation=%.3f, threshold=%.3f, prediction_count=%u\n",
-                            p, pat->activation, pat->threshold, pat->prediction_count);
-                }
                 /* Check if pattern supports this edge */
                 /* Pattern can support edge in two ways:
                  * 1. Edge is IN the pattern (sequence like "ac" contains edge a->c)
@@ -3077,11 +3539,9 @@ void propagate_activation(MelvinGraph *g) {
                 bool pattern_active = (pat->activation > pat->threshold) || (pat->activation > 0.1f);
                 
                 if (!pattern_active) {
-                    /* DEBUG: Why pattern not active */
-                    if (p < 2 && i == 'a' && (target == 'c' || target == 't') && g->output_length == 0) {
-                        fprintf(stderr, "PATTERN_SKIP: Pattern %u has edge but activation=%.3f < threshold=%.3f\n",
-                                p, pat->activation, pat->threshold);
-                    }
+                    TRACE(g, MELVIN_TRACE_DETAIL, "pattern_inactive",
+                          "\"pattern\":%u,\"from\":%d,\"to\":%u,\"activation\":%.3f,\"threshold\":%.3f",
+                          p, i, target, pat->activation, pat->threshold);
                     continue;
                 }
                 
@@ -3126,11 +3586,9 @@ void propagate_activation(MelvinGraph *g) {
                 pattern_boost *= pattern_influence;  /* Multiplicative: patterns compound */
                 total_pattern_activation += pat->activation;
                 
-                /* DEBUG: Pattern boosting edge */
-                if (p < 2 && i == 'a' && (target == 'c' || target == 't') && g->output_length == 0) {
-                    fprintf(stderr, "PATTERN_BOOST: Pattern %u boosting edge '%c'->%c': activation=%.3f, influence=%.3f, pattern_boost=%.3f\n",
-                            p, (char)i, (char)target, pat->activation, pattern_influence, pattern_boost);
-                }
+                TRACE(g, MELVIN_TRACE_DETAIL, "pattern_boost",
+                      "\"pattern\":%u,\"from\":%d,\"to\":%u,\"activation\":%.3f,\"influence\":%.3f,\"boost\":%.3f",
+                      p, i, target, pat->activation, pattern_influence, pattern_boost);
             }
             
             /* Effective edge strength = base * pattern boost (patterns directly amplify edges) */
@@ -3203,14 +3661,12 @@ void propagate_activation(MelvinGraph *g) {
             /* Ensure minimum quality for exploration (prevent zero-sum) */
             if (path_qualities[j] < 0.001f) path_qualities[j] = 0.001f;
             
-            /* DEBUG: Detailed path quality breakdown for key edges */
-            if ((i == 'a' && (target == 'c' || target == 't')) && g->output_length == 0) {
-                fprintf(stderr, "PATH_QUAL: '%c'->%c': base_weight=%.3f, pattern_boost=%.3f, sigmoid_boost=%.3f, effective_str=%.3f, context_support=%.3f, hist_coherence=%.3f, path_qual=%.3f\n",
-                       (char)i, (char)target, base_edge_strength, pattern_boost, sigmoid_boost, 
-                       effective_edge_strength, context_support, history_coherence, path_quality);
-            }
+            TRACE(g, MELVIN_TRACE_DETAIL, "path_quality",
+                  "\"from\":%d,\"to\":%u,\"base_weight\":%.3f,\"pattern_boost\":%.3f,\"sigmoid_boost\":%.3f,"
+                  "\"effective_strength\":%.3f,\"context_support\":%.3f,\"history_coherence\":%.3f,\"quality\":%.3f",
+                  i, target, base_edge_strength, pattern_boost, sigmoid_boost,
+                  effective_edge_strength, context_support, history_coherence, path_quality);
             
-            /* Debug logging removed - simplified path quality */
             total_path_quality += path_qualities[j];
         }
         
@@ -3313,12 +3769,11 @@ void propagate_activation(MelvinGraph *g) {
                 }
             }
 
-            /* DEBUG: Log activation transfer for key edges during first generation step */
-            if ((i == 'a' && (target == 'c' || target == 't')) && g->output_length == 0) {
-                fprintf(stderr, "WAVE_PROP: '%c'->%c': src_act=%.3f, path_qual=%.3f, norm_qual=%.3f, learned_rate=%.3f, transfer=%.3f → tgt_act=%.3f\n",
-                       (char)i, (char)target, g->nodes[i].activation, path_qualities[j], normalized_quality,
-                       learned_transfer_rate, transfer, g->nodes[target].activation);
-            }
+            TRACE(g, MELVIN_TRACE_DETAIL, "wave_transfer",
+                  "\"from\":%d,\"to\":%u,\"source_activation\":%.3f,\"quality\":%.3f,\"normalized_quality\":%.3f,"
+                  "\"learned_rate\":%.3f,\"transfer\":%.3f,\"target_activation\":%.3f",
+                  i, target, g->nodes[i].activation, path_qualities[j], normalized_quality,
+                  learned_transfer_rate, transfer, g->nodes[target].activation);
             
             /* SELF-REGULATION: Node activation naturally bounded by decay and competition */
             /* High activation → increased competition pressure → natural regulation */
@@ -3459,11 +3914,8 @@ void create_edges_from_coactivation(MelvinGraph *g) {
         }
     }
     
-    // #region agent log
-    FILE *f_log = fopen(".cursor/debug.log", "a");
-    static int log_counter = 0;
-    if (f_log && log_counter++ % 10 == 0) {
-        /* Log activation state at end of propagation (Hypothesis A, D) */
+    if (TRACE_ON(g, MELVIN_TRACE_STEP)) {
+        /* Activation state at end of propagation */
         float max_act = 0.0f;
         uint32_t max_node = BYTE_VALUES;
         uint32_t active_count = 0;
@@ -3476,11 +3928,10 @@ void create_edges_from_coactivation(MelvinGraph *g) {
                 }
             }
         }
-        fprintf(f_log, "{\"location\":\"melvin.c:2657\",\"message\":\"propagate_end\",\"data\":{\"max_activation\":%.6f,\"max_node\":%u,\"active_nodes\":%u,\"input_len\":%u,\"output_len\":%u},\"timestamp\":%lld,\"sessionId\":\"debug-session\",\"runId\":\"run1\",\"hypothesisId\":\"A,D\"}\n",
-                max_act, max_node, active_count, g->input_length, g->output_length, (long long)time(NULL) * 1000);
-        fclose(f_log);
+        TRACE(g, MELVIN_TRACE_STEP, "propagate_end",
+              "\"max_activation\":%.6f,\"max_node\":%u,\"active_nodes\":%u,\"input_len\":%u,\"output_len\":%u",
+              max_act, max_node, active_count, g->input_length, g->output_length);
     }
-    // #endregion
 }
 
 /* ============================================================================
@@ -3521,7 +3972,10 @@ void connect_to_similar_patterns(MelvinGraph *g, const uint32_t *sequence, uint3
     if (seq_len < 2) return;
     
     /* Find patterns with blank nodes that match this sequence */
-    for (uint32_t p = 0; p < g->pattern_count; p++) {
+    uint32_t scan_count;
+    const uint32_t *scan = context_scan(g, &scan_count);  /* Patterns this context admits */
+    for (uint32_t at = 0; at < scan_count; at++) {
+        uint32_t p = scan[at];
         Pattern *pat = &g->patterns[p];
         if (pat->length == 0 || pat->length > seq_len) continue;
         
@@ -3580,7 +4034,10 @@ void create_edges_from_patterns(MelvinGraph *g) {
      * Intelligence scales with pattern complexity and connections.
      */
     
-    for (uint32_t p = 0; p < g->pattern_count; p++) {
+    uint32_t scan_count;
+    const uint32_t *scan = context_scan(g, &scan_count);  /* Patterns this context admits */
+    for (uint32_t at = 0; at < scan_count; at++) {
+        uint32_t p = scan[at];
         Pattern *pat = &g->patterns[p];
         
         /* If pattern is active and has predictions */
@@ -3636,7 +4093,10 @@ void learn_pattern_sequences_automatic(MelvinGraph *g) {
     /* Learn from input sequence: detect when patterns follow each other */
     if (g->input_length >= 2) {
         /* Check all pattern pairs in input */
-        for (uint32_t p1 = 0; p1 < g->pattern_count; p1++) {
+        uint32_t scan_count;
+        const uint32_t *scan = context_scan(g, &scan_count);  /* Patterns this context admits */
+        for (uint32_t at = 0; at < scan_count; at++) {
+            uint32_t p1 = scan[at];
             Pattern *pat1 = &g->patterns[p1];
             if (pat1->length == 0) continue;
             
@@ -3647,7 +4107,8 @@ void learn_pattern_sequences_automatic(MelvinGraph *g) {
                     
                     /* Check if another pattern matches right after */
                     if (next_pos < g->input_length) {
-                        for (uint32_t p2 = 0; p2 < g->pattern_count; p2++) {
+                        for (uint32_t at2 = 0; at2 < scan_count; at2++) {
+                            uint32_t p2 = scan[at2];
                             if (p1 == p2) continue;
                             
                             Pattern *pat2 = &g->patterns[p2];
@@ -3772,7 +4233,7 @@ void update_pattern_context_frequency(MelvinGraph *g) {
         
         /* Check if pattern matches current input */
         bool matches = false;
-        for (uint32_t pos = 0; pos <= g->input_length - pat->length; pos++) {
+        for (uint32_t pos = 0; context_admits(g, pat) && pos <= g->input_length - pat->length; pos++) {
             if (pattern_matches(g, p, g->input_buffer, g->input_length, pos)) {
                 matches = true;
                 break;
@@ -3996,6 +4457,7 @@ void detect_positional_patterns(MelvinGraph *g) {
                     }
                     
                     Pattern *pos_pat = &g->patterns[g->pattern_count++];
+                    memset(pos_pat, 0, sizeof(Pattern));  /* Fields not set below start at zero */
                     pos_pat->node_ids = malloc(sizeof(uint32_t) * max_input_len);
                     pos_pat->length = max_input_len;
                     
@@ -4032,9 +4494,7 @@ void detect_positional_patterns(MelvinGraph *g) {
                     pos_pat->accumulated_meaning = 0.0f;
                     
                     /* Universal pattern - no port tracking (ports handle conversion externally) */
-                    for (int i = 0; i < 16; i++) {
-                        pos_pat->context_vector[i] = g->state.context_vector[i];
-                    }
+                    pattern_take_context(g, pos_pat);
                     
                     pos_pat->outgoing_patterns.edges = malloc(sizeof(Edge) * INITIAL_CAPACITY);
                     pos_pat->outgoing_patterns.count = 0;
@@ -4145,6 +4605,7 @@ void detect_patterns(MelvinGraph *g) {
                     }
                     
                     Pattern *blank_pat = &g->patterns[g->pattern_count++];
+                    memset(blank_pat, 0, sizeof(Pattern));  /* Fields not set below start at zero */
                     blank_pat->node_ids = malloc(sizeof(uint32_t) * 3);
                     blank_pat->node_ids[0] = BLANK_NODE;
                     blank_pat->node_ids[1] = a;
@@ -4176,9 +4637,7 @@ void detect_patterns(MelvinGraph *g) {
                     blank_pat->fired_predictions = 0;
                     
                     /* Universal pattern - no port tracking (ports handle conversion externally) */
-                    for (int i = 0; i < 16; i++) {
-                        blank_pat->context_vector[i] = g->state.context_vector[i];
-                    }
+                    pattern_take_context(g, blank_pat);
                     
                     blank_pat->outgoing_patterns.edges = malloc(sizeof(Edge) * INITIAL_CAPACITY);
                     blank_pat->outgoing_patterns.count = 0;
@@ -4249,6 +4708,7 @@ void detect_patterns(MelvinGraph *g) {
                 
                 /* Create new pattern */
                 Pattern *pat = &g->patterns[g->pattern_count++];
+                memset(pat, 0, sizeof(Pattern));  /* Fields not set below start at zero */
                 pat->node_ids = malloc(sizeof(uint32_t) * 2);
                 pat->node_ids[0] = a;
                 pat->node_ids[1] = b;
@@ -4335,9 +4795,7 @@ void detect_patterns(MelvinGraph *g) {
                 /* Universal pattern - no port tracking (ports handle conversion externally) */
                 
                 /* Also store context for backward compatibility */
-                for (int i = 0; i < 16; i++) {
-                    pat->context_vector[i] = g->state.context_vector[i];
-                }
+                pattern_take_context(g, pat);
                 
                 /* Initialize pattern-to-pattern edge lists */
                 pat->outgoing_patterns.edges = malloc(sizeof(Edge) * INITIAL_CAPACITY);
@@ -4454,7 +4912,10 @@ float compute_node_relevance(MelvinGraph *g, uint32_t node_id) {
     
     /* Check if output sequence matches any pattern's INPUT part */
     /* If pattern matches current output, its PREDICTIONS are contextually relevant */
-    for (uint32_t p = 0; p < g->pattern_count; p++) {
+    uint32_t scan_count;
+    const uint32_t *scan = context_scan(g, &scan_count);  /* Patterns this context admits */
+    for (uint32_t at = 0; at < scan_count; at++) {
+        uint32_t p = scan[at];
         Pattern *pat = &g->patterns[p];
         
         /* Does pattern match END of current output? */
@@ -4650,7 +5111,10 @@ uint32_t select_output_node(MelvinGraph *g) {
         
         /* Check if input matches any pattern (pattern memory) */
         float pattern_memory = 0.0f;
-        for (uint32_t p = 0; p < g->pattern_count; p++) {
+        uint32_t scan_count;
+        const uint32_t *scan = context_scan(g, &scan_count);  /* Patterns this context admits */
+        for (uint32_t at = 0; at < scan_count; at++) {
+            uint32_t p = scan[at];
             for (uint32_t pos = 0; pos + g->patterns[p].length <= g->input_length; pos++) {
                 if (pattern_matches(g, p, g->input_buffer, g->input_length, pos)) {
                     pattern_memory += g->patterns[p].strength;
@@ -4694,7 +5158,10 @@ uint32_t select_output_node(MelvinGraph *g) {
     float novelty_penalty = input_novel ? (1.0f - memory_strength) : 1.0f;
     
     /* COMPUTE PATTERN CONTRIBUTIONS: All patterns contribute, weighted by relative strength */
-    for (uint32_t p = 0; p < g->pattern_count; p++) {
+    uint32_t scan_count;
+    const uint32_t *scan = context_scan(g, &scan_count);  /* Patterns this context admits */
+    for (uint32_t at = 0; at < scan_count; at++) {
+        uint32_t p = scan[at];
         Pattern *pat = &g->patterns[p];
         
         /* RELATIVE STRENGTH: Compare to system max, not absolute threshold */
@@ -5147,7 +5614,10 @@ uint32_t select_output_node(MelvinGraph *g) {
                 uint32_t pattern_count_contributing = 0;
                 
                 /* Let patterns evaluate this edge based on context */
-                for (uint32_t p = 0; p < g->pattern_count; p++) {
+                uint32_t scan_count;
+                const uint32_t *scan = context_scan(g, &scan_count);  /* Patterns this context admits */
+                for (uint32_t at = 0; at < scan_count; at++) {
+                    uint32_t p = scan[at];
                     Pattern *pat = &g->patterns[p];
                     
                     /* Pattern must be active and have control authority */
@@ -5200,7 +5670,10 @@ uint32_t select_output_node(MelvinGraph *g) {
                 float pattern_factor = 0.1f;
                 uint32_t controlling_pattern = INVALID_PATTERN_ID;
                 
-                for (uint32_t p = 0; p < g->pattern_count; p++) {
+                uint32_t scan_count;
+                const uint32_t *scan = context_scan(g, &scan_count);  /* Patterns this context admits */
+                for (uint32_t at = 0; at < scan_count; at++) {
+                    uint32_t p = scan[at];
                     Pattern *pat = &g->patterns[p];
                     if (pat->activation > pat->threshold && pat->activation_control_strength > 0.2f) {
                         /* Check if pattern matches context and predicts candidate */
@@ -5506,14 +5979,8 @@ uint32_t select_output_node(MelvinGraph *g) {
     float max_activation = 0.0f;
     uint32_t winner_node = BYTE_VALUES;  /* Use invalid node ID to detect no selection */
 
-    // #region agent log
-    FILE *f_log = fopen(".cursor/debug.log", "a");
-    if (f_log && g->output_length == 0) {
-        fprintf(f_log, "{\"location\":\"melvin.c:4752\",\"message\":\"selection_start\",\"data\":{\"input_len\":%u,\"output_len\":%u},\"timestamp\":%lld,\"sessionId\":\"debug-session\",\"runId\":\"run1\",\"hypothesisId\":\"B\"}\n",
-                g->input_length, g->output_length, (long long)time(NULL) * 1000);
-        fclose(f_log);
-    }
-    // #endregion
+    TRACE(g, MELVIN_TRACE_STEP, "selection_start", "\"input_len\":%u,\"output_len\":%u",
+          g->input_length, g->output_length);
 
     /* If no nodes have activation, we can't select anything */
     /* This is a real problem - activation should exist from input injection */
@@ -5696,17 +6163,10 @@ uint32_t select_output_node(MelvinGraph *g) {
         /* Ensure score is non-negative (activation is always >= 0) */
         if (score < 0.0f) score = 0.0f;
         
-        // #region agent log
-        if (i == 'c' || i == 'a' || i == 't' || i == 's') {
-            FILE *f = fopen(".cursor/debug.log", "a");
-            if (f) {
-                fprintf(f, "{\"location\":\"melvin.c:3805\",\"message\":\"node score\",\"data\":{\"node\":\"%c\",\"activation\":%.3f,\"score\":%.6f,\"rel_info\":%.3f,\"rel_usage\":%.3f,\"rel_coh\":%.3f,\"rel_pred\":%.3f},\"timestamp\":%lld,\"sessionId\":\"debug-session\",\"runId\":\"debug3\",\"hypothesisId\":\"H\"}\n",
-                        (char)i, node_activation, score, relative_info, relative_usage, relative_coherence, relative_predictive,
-                        (long long)time(NULL) * 1000);
-                fclose(f);
-            }
-        }
-        // #endregion
+        TRACE(g, MELVIN_TRACE_DETAIL, "node_score",
+              "\"node\":%d,\"activation\":%.3f,\"score\":%.6f,\"rel_info\":%.3f,\"rel_usage\":%.3f,"
+              "\"rel_coherence\":%.3f,\"rel_predictive\":%.3f",
+              i, node_activation, score, relative_info, relative_usage, relative_coherence, relative_predictive);
         
         /* Skip nodes with negligible activation (relative to system) */
         /* Threshold is relative to system's average activation */
@@ -5776,16 +6236,8 @@ uint32_t select_output_node(MelvinGraph *g) {
         }
     }
     
-        // #region agent log
-        FILE *f_log = fopen("f:\\Melvin_Research\\Melvin_o7\\melvin_o7\\.cursor\\debug.log", "a");
-        if (f_log) {
-            /* Log final scores and winner (Hypothesis B) */
-            float winner_score = (winner_node < BYTE_VALUES) ? max_activation : 0.0f;
-            fprintf(f_log, "{\"location\":\"melvin.c:4971\",\"message\":\"selection_result\",\"data\":{\"winner\":%u,\"winner_score\":%.6f,\"max_activation\":%.6f},\"timestamp\":%lld,\"sessionId\":\"debug-session\",\"runId\":\"run1\",\"hypothesisId\":\"B\"}\n",
-                    winner_node, winner_score, max_activation, (long long)time(NULL) * 1000);
-            fclose(f_log);
-        }
-        // #endregion
+        TRACE(g, MELVIN_TRACE_STEP, "selection_result", "\"winner\":%u,\"winner_score\":%.6f",
+              winner_node, (winner_node < BYTE_VALUES) ? max_activation : 0.0f);
         
         /* Return winner (brightest light at end of intelligent path) */
         /* If no node passed threshold, it means no nodes have sufficient activation */
@@ -5826,6 +6278,9 @@ void emit_output(MelvinGraph *g, uint32_t node_id) {
     
     /* Add to output */
     g->output_buffer[g->output_length++] = node_id;
+    if (g->output_hook) {
+        g->output_hook(g->output_hook_ctx, node_id);
+    }
     
     /* Universal output - ports handle conversion externally */
     
@@ -6044,22 +6499,14 @@ void emit_output(MelvinGraph *g, uint32_t node_id) {
  * ============================================================================ */
 
 void apply_feedback(MelvinGraph *g, const uint8_t *target, uint32_t target_length) {
-    // #region agent log
-    FILE *f = fopen("f:\\Melvin_Research\\Melvin_o7\\melvin_o7\\.cursor\\debug.log", "a");
-    if (f) {
-        char output_str[32] = {0};
-        char target_str[32] = {0};
-        for (uint32_t i = 0; i < g->output_length && i < 31; i++) {
-            output_str[i] = (char)g->output_buffer[i];
-        }
-        for (uint32_t i = 0; i < target_length && i < 31; i++) {
-            target_str[i] = (char)target[i];
-        }
-        fprintf(f, "{\"location\":\"melvin.c:3908\",\"message\":\"apply_feedback called\",\"data\":{\"output\":\"%s\",\"target\":\"%s\",\"output_len\":%u,\"target_len\":%u},\"timestamp\":%lld,\"sessionId\":\"debug-session\",\"runId\":\"debug2\",\"hypothesisId\":\"F\"}\n",
-                output_str, target_str, g->output_length, target_length, (long long)time(NULL) * 1000);
-        fclose(f);
+    if (TRACE_ON(g, MELVIN_TRACE_EPISODE)) {
+        char output_str[32], target_str[32];
+        TRACE(g, MELVIN_TRACE_EPISODE, "feedback",
+              "\"output\":\"%s\",\"target\":\"%s\",\"output_len\":%u,\"target_len\":%u",
+              trace_text(output_str, sizeof(output_str), NULL, g->output_buffer, g->output_length),
+              trace_text(target_str, sizeof(target_str), target, NULL, target_length),
+              g->output_length, target_length);
     }
-    // #endregion
     
     /* Compare output to target */
     uint32_t correct = 0;
@@ -6073,17 +6520,11 @@ void apply_feedback(MelvinGraph *g, const uint8_t *target, uint32_t target_lengt
         if (predicted == expected) {
             correct++;
             
-            // #region agent log
-            FILE *f = fopen("f:\\Melvin_Research\\Melvin_o7\\melvin_o7\\.cursor\\debug.log", "a");
-            if (f) {
-                fprintf(f, "{\"location\":\"melvin.c:3928\",\"message\":\"correct prediction\",\"data\":{\"pos\":%u,\"predicted\":%u,\"expected\":%u,\"char\":\"%c\"},\"timestamp\":%lld,\"sessionId\":\"debug-session\",\"runId\":\"debug2\",\"hypothesisId\":\"F\"}\n",
-                        i, predicted, expected, (char)predicted, (long long)time(NULL) * 1000);
-                fclose(f);
-            }
-            // #endregion
-            
             /* Correct prediction - strengthen contributing components */
             OutputContribution *contrib = &g->output_contributions[i];
+            TRACE(g, MELVIN_TRACE_DETAIL, "correct_prediction",
+                  "\"pos\":%u,\"node\":%u,\"patterns\":%u,\"edges\":%u",
+                  i, predicted, contrib->pattern_count, contrib->edge_count);
             
             /* Strengthen patterns that contributed correctly */
             for (uint32_t pc = 0; pc < contrib->pattern_count; pc++) {
@@ -6123,15 +6564,6 @@ void apply_feedback(MelvinGraph *g, const uint8_t *target, uint32_t target_lengt
             }
             
             /* Strengthen edges that contributed correctly AND increment success_count */
-            // #region agent log
-            FILE *flog = fopen("f:\\Melvin_Research\\Melvin_o7\\melvin_o7\\.cursor\\debug.log", "a");
-            if (flog) {
-                fprintf(flog, "{\"location\":\"melvin.c:3970\",\"message\":\"edge contrib loop\",\"data\":{\"predicted\":%u,\"expected\":%u,\"edge_count\":%u},\"timestamp\":%lld,\"sessionId\":\"debug-session\",\"runId\":\"debug3\",\"hypothesisId\":\"G\"}\n",
-                        predicted, expected, contrib->edge_count, (long long)time(NULL) * 1000);
-                fclose(flog);
-            }
-            // #endregion
-            
             /* POSITIONAL FEEDBACK: Only strengthen sequential edges, not long-range */
             /* Don't strengthen edges from ANY active node - only from previous output */
             /* This prevents shortcuts like 'a'→'t' when 'a' is far back in sequence */
@@ -6144,16 +6576,10 @@ void apply_feedback(MelvinGraph *g, const uint8_t *target, uint32_t target_lengt
                 for (uint32_t e = 0; e < from_out->count; e++) {
                     if (from_out->edges[e].to_id == predicted && from_out->edges[e].active) {
                         from_out->edges[e].success_count++;
-                        // #region agent log
-                        FILE *f2 = fopen("f:\\Melvin_Research\\Melvin_o7\\melvin_o7\\.cursor\\debug.log", "a");
-                        if (f2) {
-                            fprintf(f2, "{\"location\":\"melvin.c:3986\",\"message\":\"edge success incremented\",\"data\":{\"from\":%u,\"to\":%u,\"success\":%llu,\"use\":%llu,\"weight\":%.3f},\"timestamp\":%lld,\"sessionId\":\"debug-session\",\"runId\":\"debug3\",\"hypothesisId\":\"G\"}\n",
-                                    prev_output, predicted, (unsigned long long)from_out->edges[e].success_count, 
-                                    (unsigned long long)from_out->edges[e].use_count, from_out->edges[e].weight,
-                                    (long long)time(NULL) * 1000);
-                            fclose(f2);
-                        }
-                        // #endregion
+                        TRACE(g, MELVIN_TRACE_DETAIL, "edge_success",
+                              "\"from\":%u,\"to\":%u,\"success\":%llu,\"use\":%llu,\"weight\":%.3f",
+                              prev_output, predicted, (unsigned long long)from_out->edges[e].success_count,
+                              (unsigned long long)from_out->edges[e].use_count, from_out->edges[e].weight);
                         break;
                     }
                 }
@@ -6514,37 +6940,325 @@ void apply_error_feedback(MelvinGraph *g, float error_magnitude) {
     g->state.learning_pressure = g->state.error_rate * g->state.error_rate;  /* Quadratic feedback */
 }
 
+/* Budget check between steps: NATURAL while there is budget left */
+static MelvinStop budget_exceeded(const MelvinBudget *budget, uint32_t output_length,
+                                  uint64_t deadline, uint64_t now) {
+    if (budget->max_output > 0 && output_length >= budget->max_output) return MELVIN_STOP_OUTPUT;
+    if (deadline > 0 && now >= deadline) return MELVIN_STOP_DEADLINE;
+    return MELVIN_STOP_NATURAL;
+}
+
 /* ============================================================================
- * 5. EPISODE EXECUTION
+ * PROFILER: Where a sampled episode's time goes
  * 
- * Complete input -> process -> output -> feedback cycle
- * Output length emerges from activation dynamics (not predetermined)
+ * The phase counters (melvin_get_stats) are always on but coarse. The profiler
+ * splits run_episode into the sections of MelvinProfileSection and counts
+ * calls, nanoseconds and time-stamp-counter cycles for each, but only on one
+ * episode in sample_every - the others pay a single branch per section.
  * ============================================================================ */
 
-void run_episode(MelvinGraph *g, const uint8_t *input, uint32_t input_len,
-                 const uint8_t *target, uint32_t target_len) {
+typedef struct {
+    uint64_t ns;
+    uint64_t cycles;
+} ProfileMark;
 
-    DEBUG_PRINT("DEBUG: run_episode START, input_len=%u, target_len=%u\n", input_len, target_len);
+static inline uint64_t profile_cycles(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __builtin_ia32_rdtsc();
+#else
+    return 0;
+#endif
+}
 
-    /* CRITICAL: Clear input buffer at start of each episode */
-    /* Otherwise input accumulates: "cat" + "dog" = "catdog" */
-    g->input_length = 0;
+/* Decide whether this episode is a sample */
+static void profile_episode_begin(MelvinGraph *g) {
+    MelvinProfile *prof = &g->profile;
+    g->profiling = prof->sample_every > 0 && prof->episodes_seen++ % prof->sample_every == 0;
+    if (g->profiling) prof->episodes_sampled++;
+}
 
-    /* Reset output and contribution tracking */
-    g->output_length = 0;
+static inline void profile_begin(const MelvinGraph *g, ProfileMark *mark) {
+    if (!g->profiling) return;
+    mark->ns = clock_ns();
+    mark->cycles = profile_cycles();
+}
+
+/* Charge the time since profile_begin to section */
+static inline void profile_end(MelvinGraph *g, const ProfileMark *mark, MelvinProfileSection section) {
+    if (!g->profiling) return;
+    MelvinProfileCounter *counter = &g->profile.sections[section];
+    counter->cycles += profile_cycles() - mark->cycles;
+    counter->ns += clock_ns() - mark->ns;
+    counter->calls++;
+}
+
+/* Profile one episode in sample_every (1: all of them, 0: off). Counters are kept. */
+void melvin_set_profiling(MelvinGraph *g, uint32_t sample_every) {
+    g->profile.sample_every = sample_every;
+}
+
+void melvin_get_profile(const MelvinGraph *g, MelvinProfile *profile) {
+    *profile = g->profile;
+}
+
+/* Zero the counters, keeping the sampling rate */
+void melvin_reset_profile(MelvinGraph *g) {
+    uint32_t sample_every = g->profile.sample_every;
+    memset(&g->profile, 0, sizeof(g->profile));
+    g->profile.sample_every = sample_every;
+}
+
+/* Short lowercase name for a profile section (metric labels, dumps) */
+const char* melvin_profile_section_name(MelvinProfileSection section) {
+    switch (section) {
+        case MELVIN_PROF_RESET:             return "reset";
+        case MELVIN_PROF_INJECT:            return "inject";
+        case MELVIN_PROF_CONNECT_SIMILAR:   return "connect_similar";
+        case MELVIN_PROF_SYSTEM_STATE:      return "system_state";
+        case MELVIN_PROF_PROPAGATE:         return "propagate";
+        case MELVIN_PROF_EMIT:              return "emit";
+        case MELVIN_PROF_LEARN_PATTERNS:    return "learn_patterns";
+        case MELVIN_PROF_LEARN_EDGES:       return "learn_edges";
+        case MELVIN_PROF_FEEDBACK:          return "feedback";
+        case MELVIN_PROF_VALIDATE:          return "validate";
+        case MELVIN_PROF_DETECT_SEQUENTIAL: return "detect_sequential";
+        case MELVIN_PROF_DETECT_POSITIONAL: return "detect_positional";
+        case MELVIN_PROF_LEARN_PARAMETERS:  return "learn_parameters";
+        default:                            return "unknown";
+    }
+}
+
+/* Text table, one line per section:
+ *   section  calls  total_ms  ns/call  cycles/call  share
+ * share is of all sampled episode time; "other" is what no section claimed
+ * (resets, budget checks, glue). */
+void melvin_dump_profile(const MelvinProfile *profile, FILE *out) {
+    fprintf(out, "# profile: %llu of %llu episodes sampled (1 in %u)\n",
+            (unsigned long long)profile->episodes_sampled, (unsigned long long)profile->episodes_seen,
+            profile->sample_every);
+    fprintf(out, "%-18s %10s %12s %12s %12s %7s\n",
+            "section", "calls", "total_ms", "ns/call", "cycles/call", "share");
+    double episode_ns = (profile->episode_ns > 0) ? (double)profile->episode_ns : 1.0;
+    uint64_t claimed = 0;
+    for (int s = 0; s < MELVIN_PROF_COUNT; s++) {
+        const MelvinProfileCounter *c = &profile->sections[s];
+        uint64_t calls = (c->calls > 0) ? c->calls : 1;
+        fprintf(out, "%-18s %10llu %12.3f %12llu %12llu %6.1f%%\n",
+                melvin_profile_section_name((MelvinProfileSection)s), (unsigned long long)c->calls,
+                c->ns / 1e6, (unsigned long long)(c->ns / calls), (unsigned long long)(c->cycles / calls),
+                100.0 * c->ns / episode_ns);
+        claimed += c->ns;
+    }
+    uint64_t other = (profile->episode_ns > claimed) ? profile->episode_ns - claimed : 0;
+    fprintf(out, "%-18s %10s %12.3f %12s %12s %6.1f%%\n", "other", "-", other / 1e6, "-", "-",
+            100.0 * other / episode_ns);
+}
+
+/* ============================================================================
+ * EPISODE STEP: Emit the selected node, then check the stop conditions
+ *
+ * Shared by run_episode and batched inference. Returns true when the
+ * episode should stop generating.
+ * ============================================================================ */
+
+static bool episode_step(MelvinGraph *g, uint32_t output_node, uint32_t step,
+                         const uint8_t *target, uint32_t target_len,
+                         uint32_t *consecutive_no_selection) {
     
-    /* CRITICAL: Reset node activations between episodes */
-    /* Each episode starts fresh - structure (edges/patterns) persists, activation doesn't */
-    /* This prevents cross-episode contamination */
-    for (int n = 0; n < BYTE_VALUES; n++) {
-        g->nodes[n].activation = 0.0f;
-        g->nodes[n].activated_by = 0;
-        g->nodes[n].adaptation = 0.0f;  /* Reset fatigue each episode */
+    if (TRACE_ON(g, MELVIN_TRACE_STEP)) {
+        /* Selected node against the most active one */
+        float max_act = 0.0f;
+        uint32_t max_node = BYTE_VALUES;
+        for (int i = 0; i < BYTE_VALUES; i++) {
+            if (g->nodes[i].exists && g->nodes[i].activation > max_act) {
+                max_act = g->nodes[i].activation;
+                max_node = i;
+            }
+        }
+        bool node_exists = (output_node < BYTE_VALUES && g->nodes[output_node].exists);
+        TRACE(g, MELVIN_TRACE_STEP, "node_selected",
+              "\"step\":%u,\"node\":%u,\"exists\":%s,\"activation\":%.6f,\"max_node\":%u,\"max_activation\":%.6f",
+              step, output_node, node_exists ? "true" : "false",
+              node_exists ? g->nodes[output_node].activation : 0.0f, max_node, max_act);
     }
     
-    /* Clear old contributions */
-    for (uint32_t i = 0; i < g->output_contrib_capacity; i++) {
-        if (g->output_contributions[i].patterns) {
+    /* ====================================================================
+     * SELF-REGULATING OUTPUT: Stop based on system signals, not hard limits
+     * ==================================================================== */
+    
+    /* Check for END_MARKER prediction (learned termination) */
+    if (output_node == END_MARKER) {
+        DEBUG_PRINT("DEBUG: END_MARKER won at step %u\n", step);
+        return true;  /* System learned to predict END - stop generating */
+    }
+    
+    /* Check if valid node selected */
+    if (output_node < BYTE_VALUES && g->nodes[output_node].exists) {
+        if (step == 0) { DEBUG_PRINT("DEBUG: emit_output...\n"); }
+        
+        emit_output(g, output_node);
+        if (step == 0) { DEBUG_PRINT("DEBUG: emit_output done, len=%u\n", g->output_length); }
+        
+        TRACE(g, MELVIN_TRACE_STEP, "emit", "\"step\":%u,\"node\":%u,\"output_len\":%u",
+              step, output_node, g->output_length);
+        
+        /* BIOLOGICAL: Input activation decays naturally, not killed instantly */
+        /* Input is the SPARK that triggers patterns - patterns then sustain themselves */
+        /* The sequence should persist through recurrent pattern support, not input */
+        /* 
+         * RELATIVE: Decay proportional to how much output has been generated
+         * INFLUENCES: How much input context remains
+         * INFLUENCED BY: Output length, pattern strength
+         */
+        if (g->output_length >= 1) {
+            /* Gradual decay of input - proportional to progress through sequence */
+            /* More output = less need for input context */
+            /* RELATIVE: Decay proportional to progress, but not too aggressive */
+            float progress_factor = fminf((float)g->output_length / 10.0f, 1.0f);
+            float input_decay = 0.2f + progress_factor * 0.2f;  /* 0.2-0.4 decay (reduced from 0.5-0.8) */
+            
+            for (uint32_t in = 0; in < g->input_length; in++) {
+                uint32_t input_node = g->input_buffer[in];
+                if (input_node < BYTE_VALUES) {
+                    g->nodes[input_node].activation *= (1.0f - input_decay);
+                }
+            }
+        }
+    } else {
+        /* No valid node selected - allow propagation to continue */
+        /* This gives the system time to build activation for next characters */
+        (*consecutive_no_selection)++;
+        DEBUG_PRINT("DEBUG: No valid node at step %u, output_len=%u, consecutive_no_selection=%u\n", 
+               step, g->output_length, *consecutive_no_selection);
+        
+        /* SAFETY: If we've tried many times and still can't generate any output, break */
+        /* This prevents infinite loops when system can't activate any nodes */
+        if (step >= 20 && g->output_length == 0) {
+            DEBUG_PRINT("DEBUG: Breaking after %u steps with no output\n", step);
+            return true;  /* System stuck - can't generate any output */
+        }
+        
+        /* RELATIVE STOPPING: If we've had output but can't select next node for many steps */
+        /* Allow 5-10 steps to build activation, but don't loop forever */
+        /* This balances: give time to build activation vs prevent infinite loops */
+        if (g->output_length > 0 && *consecutive_no_selection >= 10) {
+            DEBUG_PRINT("DEBUG: Breaking after %u consecutive steps without selection (output_len=%u)\n", 
+                   *consecutive_no_selection, g->output_length);
+            return true;  /* Had output but can't continue - likely sequence complete or stuck */
+        }
+        
+        /* The other stop conditions (confidence, energy, completion) will handle natural stopping */
+    }
+    
+    if (step == 0) { DEBUG_PRINT("DEBUG: Checking stop conditions...\n"); }
+    
+    /* Debug every 10 steps */
+    if (step % 10 == 0 && step > 0) {
+        DEBUG_PRINT("DEBUG: Step %u, output_len=%u, conf=%.3f\n", 
+               step, g->output_length, g->state.selection_confidence);
+    }
+    
+    /* SELF-REGULATING STOP CONDITIONS (all based on system state) */
+    if (step == 0) { DEBUG_PRINT("DEBUG: Stop cond A\n"); }
+    
+    /* Minimum output before self-regulation kicks in */
+    /* Training: reach target length */
+    /* Generation: minimum 3 outputs to allow patterns to develop */
+    bool min_output_reached = (target != NULL && target_len > 0) ? 
+        (g->output_length >= target_len) : (g->output_length >= 3);
+    
+    if (step == 0) { DEBUG_PRINT("DEBUG: Stop cond B, min_reached=%d\n", min_output_reached); }
+    
+    /* 1. Confidence collapse: Nothing strong enough to output */
+    /* Only stop if confidence is very low AND we've generated minimum output */
+    if (g->state.selection_confidence < 0.01f && min_output_reached) {
+        return true;  /* Low confidence = uncertain what comes next = stop */
+    }
+    
+    if (step == 0) { DEBUG_PRINT("DEBUG: Stop cond C\n"); }
+    
+    /* 2. Energy depletion: Activation has dissipated */
+    if (g->state.activation_energy < 0.005f && min_output_reached) {
+        return true;  /* No energy left in system = stop */
+    }
+    
+    if (step == 0) { DEBUG_PRINT("DEBUG: Stop cond D\n"); }
+    
+    /* 3. Loop detection: Stuck in repetitive cycle */
+    if (g->state.loop_pressure > 0.95f && g->output_length > 3) {
+        return true;  /* Stuck in loop = stop */
+    }
+    
+    if (step == 0) { DEBUG_PRINT("DEBUG: Stop cond E\n"); }
+    
+    /* 4. Completion pressure: Output getting long relative to input */
+    /* Only activate after reaching target length (when target exists) */
+    if (g->state.completion_pressure > 0.9f && min_output_reached) {
+        return true;  /* Natural pressure to complete = stop */
+    }
+    
+    if (step == 0) { DEBUG_PRINT("DEBUG: Stop cond F\n"); }
+    
+    /* 5. TRAINING MODE: Use target length as guide */
+    /* Stop at target length to get accurate feedback (learning needs accurate comparison) */
+    if (target != NULL && target_len > 0) {
+        if (g->output_length >= target_len) {
+            return true;  /* Reached target length, stop for accurate feedback */
+        }
+    }
+    
+    if (step == 0) { DEBUG_PRINT("DEBUG: Stop cond G\n"); }
+    
+    /* NO HARD CAP: System learns to stop via END_MARKER competing as output */
+    /* Silence wins when patterns/edges predict END_MARKER more strongly than any byte */
+    /* Only safety: extreme runaway prevention (1000+ chars with no learned stopping) */
+    if (g->output_length >= 10000) {
+        return true;  /* Emergency only - system should learn to stop before this */
+    }
+    
+    if (step == 0) { DEBUG_PRINT("DEBUG: End of loop iteration 0\n"); }
+    
+    return false;
+}
+
+/* ============================================================================
+ * 5. EPISODE EXECUTION
+ * 
+ * Complete input -> process -> output -> feedback cycle
+ * Output length emerges from activation dynamics (not predetermined)
+ * ============================================================================ */
+
+void run_episode(MelvinGraph *g, const uint8_t *input, uint32_t input_len,
+                 const uint8_t *target, uint32_t target_len) {
+
+    DEBUG_PRINT("DEBUG: run_episode START, input_len=%u, target_len=%u\n", input_len, target_len);
+    uint64_t phase_start = clock_ns();
+    uint64_t phase_end;
+    uint64_t deadline = (g->budget.time_limit_ns > 0) ? phase_start + g->budget.time_limit_ns : 0;
+    uint64_t episode_start = phase_start;
+    ProfileMark mark = {0, 0};
+    profile_episode_begin(g);
+
+    /* CRITICAL: Clear input buffer at start of each episode */
+    /* Otherwise input accumulates: "cat" + "dog" = "catdog" */
+    profile_begin(g, &mark);
+    g->input_length = 0;
+
+    /* Reset output and contribution tracking */
+    g->output_length = 0;
+    
+    /* CRITICAL: Reset node activations between episodes */
+    /* Each episode starts fresh - structure (edges/patterns) persists, activation doesn't */
+    /* This prevents cross-episode contamination */
+    for (int n = 0; n < BYTE_VALUES; n++) {
+        g->nodes[n].activation = 0.0f;
+        g->nodes[n].activated_by = 0;
+        g->nodes[n].adaptation = 0.0f;  /* Reset fatigue each episode */
+    }
+    
+    /* Clear old contributions */
+    for (uint32_t i = 0; i < g->output_contrib_capacity; i++) {
+        if (g->output_contributions[i].patterns) {
             free(g->output_contributions[i].patterns);
             g->output_contributions[i].patterns = NULL;
         }
@@ -6563,8 +7277,10 @@ void run_episode(MelvinGraph *g, const uint8_t *input, uint32_t input_len,
         g->patterns[p].has_fired = false;
         g->patterns[p].fired_predictions = 0;
     }
+    profile_end(g, &mark, MELVIN_PROF_RESET);
     
     /* Inject input */
+    profile_begin(g, &mark);
     inject_input(g, input, input_len);
     
     /* UNIVERSAL PATTERN DETECTION: Store input in history for positional pattern detection */
@@ -6590,17 +7306,22 @@ void run_episode(MelvinGraph *g, const uint8_t *input, uint32_t input_len,
     for (uint32_t i = 0; i < input_len; i++) {
         g->input_history[hist_idx][i] = g->input_buffer[i];
     }
+    profile_end(g, &mark, MELVIN_PROF_INJECT);
     
     /* GENERALIZATION: Connect new words to similar patterns */
     /* When a new word is seen, find similar patterns based on byte values and context */
     /* This allows "quokka" to connect to similar patterns like "cat", "bat" */
     if (g->input_length >= 2) {
+        profile_begin(g, &mark);
         connect_to_similar_patterns(g, g->input_buffer, g->input_length);
+        profile_end(g, &mark, MELVIN_PROF_CONNECT_SIMILAR);
     }
     
     /* CRITICAL: Compute system state BEFORE propagation */
     /* Wave prop needs current system state (avg_activation, etc.) */
+    profile_begin(g, &mark);
     compute_system_state(g);
+    profile_end(g, &mark, MELVIN_PROF_SYSTEM_STATE);
     
     /* INPUT CONTEXT: Input provides context for which paths to activate */
     /* When input changes, different paths should activate - input drives context */
@@ -6626,17 +7347,29 @@ void run_episode(MelvinGraph *g, const uint8_t *input, uint32_t input_len,
     
     /* Emergency cap: higher for training (with target), lower for generation */
     uint32_t max_steps = (target != NULL && target_len > 0) ? 1000 : 200;
+    if (g->budget.max_steps > 0 && g->budget.max_steps < max_steps) {
+        max_steps = g->budget.max_steps;
+    }
+    g->stop_reason = MELVIN_STOP_STEPS;  /* Unless something ends the loop first */
     
     /* Track consecutive steps without selection (for intelligent stopping) */
     uint32_t consecutive_no_selection = 0;
     
+    phase_end = clock_ns();
+    g->phase_ns[MELVIN_PHASE_SETUP] += phase_end - phase_start;
+    phase_start = phase_end;
+    
     DEBUG_PRINT("DEBUG: Starting loop, max_steps=%u, has_target=%d\n", max_steps, (target != NULL));
     
     for (uint32_t step = 0; step < max_steps; step++) {  /* Emergency cap only */
+        g->step_count++;
+        
         /* Compute system state periodically (less frequent for chat) */
         if (step % state_update_interval == 0) {
             if (step == 0) { DEBUG_PRINT("DEBUG: compute_system_state...\n"); }
+            profile_begin(g, &mark);
             compute_system_state(g);
+            profile_end(g, &mark, MELVIN_PROF_SYSTEM_STATE);
             if (step == 0) { DEBUG_PRINT("DEBUG: compute_system_state done\n"); }
         }
         
@@ -6646,209 +7379,33 @@ void run_episode(MelvinGraph *g, const uint8_t *input, uint32_t input_len,
          * No separate selection step - the wave commits to the most coherent path
          * ======================================================================== */
         if (step == 0) { DEBUG_PRINT("DEBUG: propagate_with_coherence...\n"); }
+        profile_begin(g, &mark);
         uint32_t output_node = propagate_with_coherence(g);
+        profile_end(g, &mark, MELVIN_PROF_PROPAGATE);
         if (step == 0) { DEBUG_PRINT("DEBUG: propagate_with_coherence=%u\n", output_node); }
-        
-        #if !SKIP_AGENT_LOG
-        // #region agent log
-        FILE *f_log = fopen("f:\\Melvin_Research\\Melvin_o7\\melvin_o7\\.cursor\\debug.log", "a");
-        if (f_log && step == 0) {
-            /* Log selected node and validation (Hypothesis B, C) */
-            bool node_exists = (output_node < BYTE_VALUES && g->nodes[output_node].exists);
-            float selected_act = (output_node < BYTE_VALUES) ? g->nodes[output_node].activation : 0.0f;
-            
-            /* Find actual max activation for comparison */
-            float actual_max_act = 0.0f;
-            uint32_t actual_max_node = BYTE_VALUES;
-            for (int i = 0; i < BYTE_VALUES; i++) {
-                if (g->nodes[i].exists && g->nodes[i].activation > actual_max_act) {
-                    actual_max_act = g->nodes[i].activation;
-                    actual_max_node = i;
-                }
-            }
-            
-            fprintf(f_log, "{\"location\":\"melvin.c:5740\",\"message\":\"node_selected\",\"data\":{\"selected\":%u,\"exists\":%s,\"selected_activation\":%.15f,\"actual_max_activation\":%.15f,\"actual_max_node\":%u,\"diff\":%.15f,\"is_valid\":%s},\"timestamp\":%lld,\"sessionId\":\"debug-session\",\"runId\":\"run1\",\"hypothesisId\":\"B,C\"}\n",
-                    output_node, node_exists ? "true" : "false", selected_act, actual_max_act, actual_max_node,
-                    selected_act - actual_max_act,
-                    (output_node < BYTE_VALUES && node_exists) ? "true" : "false", (long long)time(NULL) * 1000);
-            fclose(f_log);
-        }
-        // #endregion
-        
-        // #region agent log
-        FILE *f = fopen(".cursor/debug.log", "a");
-        if (f) {
-            fprintf(f, "{\"location\":\"melvin.c:4233\",\"message\":\"node selected\",\"data\":{\"selected\":%u,\"activations\":{\"c\":%.3f,\"a\":%.3f,\"t\":%.3f,\"s\":%.3f}},\"timestamp\":%lld,\"sessionId\":\"debug-session\",\"hypothesisId\":\"D,E\"}\n",
-                    output_node, 
-                    g->nodes['c'].exists ? g->nodes['c'].activation : 0.0f,
-                    g->nodes['a'].exists ? g->nodes['a'].activation : 0.0f,
-                    g->nodes['t'].exists ? g->nodes['t'].activation : 0.0f,
-                    g->nodes['s'].exists ? g->nodes['s'].activation : 0.0f,
-                    (long long)time(NULL) * 1000);
-            fclose(f);
-        }
-        // #endregion
-        #endif
-        
-        /* ====================================================================
-         * SELF-REGULATING OUTPUT: Stop based on system signals, not hard limits
-         * ==================================================================== */
-        
-        /* Check for END_MARKER prediction (learned termination) */
-        if (output_node == END_MARKER) {
-            DEBUG_PRINT("DEBUG: END_MARKER won at step %u\n", step);
-            break;  /* System learned to predict END - stop generating */
-        }
-        
-        /* Check if valid node selected */
-        if (output_node < BYTE_VALUES && g->nodes[output_node].exists) {
-            if (step == 0) { DEBUG_PRINT("DEBUG: emit_output...\n"); }
-            
-            #if !SKIP_AGENT_LOG
-            // #region agent log
-            f_log = fopen("f:\\Melvin_Research\\Melvin_o7\\melvin_o7\\.cursor\\debug.log", "a");
-            uint32_t output_len_before = g->output_length;
-            if (f_log && step == 0) {
-                fprintf(f_log, "{\"location\":\"melvin.c:5768\",\"message\":\"before_emit\",\"data\":{\"node\":%u,\"output_len_before\":%u},\"timestamp\":%lld,\"sessionId\":\"debug-session\",\"runId\":\"run1\",\"hypothesisId\":\"E\"}\n",
-                        output_node, output_len_before, (long long)time(NULL) * 1000);
-                fclose(f_log);
-            }
-            // #endregion
-            #endif
-            
-            emit_output(g, output_node);
-            if (step == 0) { DEBUG_PRINT("DEBUG: emit_output done, len=%u\n", g->output_length); }
-            
-            #if !SKIP_AGENT_LOG
-            // #region agent log
-            f_log = fopen("f:\\Melvin_Research\\Melvin_o7\\melvin_o7\\.cursor\\debug.log", "a");
-            if (f_log && step == 0) {
-                /* Log output buffer state (Hypothesis E) */
-                uint32_t output_len_after = g->output_length;
-                uint32_t last_output = (output_len_after > 0) ? g->output_buffer[output_len_after - 1] : BYTE_VALUES;
-                fprintf(f_log, "{\"location\":\"melvin.c:5771\",\"message\":\"after_emit\",\"data\":{\"node\":%u,\"output_len_after\":%u,\"buffer_last\":%u,\"match\":%s},\"timestamp\":%lld,\"sessionId\":\"debug-session\",\"runId\":\"run1\",\"hypothesisId\":\"E\"}\n",
-                        output_node, output_len_after, last_output, (last_output == output_node) ? "true" : "false", (long long)time(NULL) * 1000);
-                fclose(f_log);
-            }
-            // #endregion
-            #endif
-            
-            /* BIOLOGICAL: Input activation decays naturally, not killed instantly */
-            /* Input is the SPARK that triggers patterns - patterns then sustain themselves */
-            /* The sequence should persist through recurrent pattern support, not input */
-            /* 
-             * RELATIVE: Decay proportional to how much output has been generated
-             * INFLUENCES: How much input context remains
-             * INFLUENCED BY: Output length, pattern strength
-             */
-            if (g->output_length >= 1) {
-                /* Gradual decay of input - proportional to progress through sequence */
-                /* More output = less need for input context */
-                /* RELATIVE: Decay proportional to progress, but not too aggressive */
-                float progress_factor = fminf((float)g->output_length / 10.0f, 1.0f);
-                float input_decay = 0.2f + progress_factor * 0.2f;  /* 0.2-0.4 decay (reduced from 0.5-0.8) */
-                
-                for (uint32_t in = 0; in < g->input_length; in++) {
-                    uint32_t input_node = g->input_buffer[in];
-                    if (input_node < BYTE_VALUES) {
-                        g->nodes[input_node].activation *= (1.0f - input_decay);
-                    }
-                }
-            }
-        } else {
-            /* No valid node selected - allow propagation to continue */
-            /* This gives the system time to build activation for next characters */
-            consecutive_no_selection++;
-            DEBUG_PRINT("DEBUG: No valid node at step %u, output_len=%u, consecutive_no_selection=%u\n", 
-                   step, g->output_length, consecutive_no_selection);
-            
-            /* SAFETY: If we've tried many times and still can't generate any output, break */
-            /* This prevents infinite loops when system can't activate any nodes */
-            if (step >= 20 && g->output_length == 0) {
-                DEBUG_PRINT("DEBUG: Breaking after %u steps with no output\n", step);
-                break;  /* System stuck - can't generate any output */
-            }
-            
-            /* RELATIVE STOPPING: If we've had output but can't select next node for many steps */
-            /* Allow 5-10 steps to build activation, but don't loop forever */
-            /* This balances: give time to build activation vs prevent infinite loops */
-            if (g->output_length > 0 && consecutive_no_selection >= 10) {
-                DEBUG_PRINT("DEBUG: Breaking after %u consecutive steps without selection (output_len=%u)\n", 
-                       consecutive_no_selection, g->output_length);
-                break;  /* Had output but can't continue - likely sequence complete or stuck */
-            }
-            
-            /* The other stop conditions (confidence, energy, completion) will handle natural stopping */
-        }
-        
-        if (step == 0) { DEBUG_PRINT("DEBUG: Checking stop conditions...\n"); }
-        
-        /* Debug every 10 steps */
-        if (step % 10 == 0 && step > 0) {
-            DEBUG_PRINT("DEBUG: Step %u, output_len=%u, conf=%.3f\n", 
-                   step, g->output_length, g->state.selection_confidence);
-        }
-        
-        /* SELF-REGULATING STOP CONDITIONS (all based on system state) */
-        if (step == 0) { DEBUG_PRINT("DEBUG: Stop cond A\n"); }
-        
-        /* Minimum output before self-regulation kicks in */
-        /* Training: reach target length */
-        /* Generation: minimum 3 outputs to allow patterns to develop */
-        bool min_output_reached = (target != NULL && target_len > 0) ? 
-            (g->output_length >= target_len) : (g->output_length >= 3);
-        
-        if (step == 0) { DEBUG_PRINT("DEBUG: Stop cond B, min_reached=%d\n", min_output_reached); }
-        
-        /* 1. Confidence collapse: Nothing strong enough to output */
-        /* Only stop if confidence is very low AND we've generated minimum output */
-        if (g->state.selection_confidence < 0.01f && min_output_reached) {
-            break;  /* Low confidence = uncertain what comes next = stop */
-        }
-        
-        if (step == 0) { DEBUG_PRINT("DEBUG: Stop cond C\n"); }
-        
-        /* 2. Energy depletion: Activation has dissipated */
-        if (g->state.activation_energy < 0.005f && min_output_reached) {
-            break;  /* No energy left in system = stop */
-        }
-        
-        if (step == 0) { DEBUG_PRINT("DEBUG: Stop cond D\n"); }
-        
-        /* 3. Loop detection: Stuck in repetitive cycle */
-        if (g->state.loop_pressure > 0.95f && g->output_length > 3) {
-            break;  /* Stuck in loop = stop */
-        }
-        
-        if (step == 0) { DEBUG_PRINT("DEBUG: Stop cond E\n"); }
-        
-        /* 4. Completion pressure: Output getting long relative to input */
-        /* Only activate after reaching target length (when target exists) */
-        if (g->state.completion_pressure > 0.9f && min_output_reached) {
-            break;  /* Natural pressure to complete = stop */
-        }
-        
-        if (step == 0) { DEBUG_PRINT("DEBUG: Stop cond F\n"); }
-        
-        /* 5. TRAINING MODE: Use target length as guide */
-        /* Stop at target length to get accurate feedback (learning needs accurate comparison) */
-        if (target != NULL && target_len > 0) {
-            if (g->output_length >= target_len) {
-                break;  /* Reached target length, stop for accurate feedback */
-            }
+        phase_end = clock_ns();
+        g->phase_ns[MELVIN_PHASE_PROPAGATE] += phase_end - phase_start;
+        phase_start = phase_end;
+        
+        profile_begin(g, &mark);
+        bool stop = episode_step(g, output_node, step, target, target_len, &consecutive_no_selection);
+        profile_end(g, &mark, MELVIN_PROF_EMIT);
+        phase_end = clock_ns();
+        g->phase_ns[MELVIN_PHASE_EMIT] += phase_end - phase_start;
+        phase_start = phase_end;
+        if (stop) {
+            g->stop_reason = MELVIN_STOP_NATURAL;
+            break;
         }
         
-        if (step == 0) { DEBUG_PRINT("DEBUG: Stop cond G\n"); }
-        
-        /* NO HARD CAP: System learns to stop via END_MARKER competing as output */
-        /* Silence wins when patterns/edges predict END_MARKER more strongly than any byte */
-        /* Only safety: extreme runaway prevention (1000+ chars with no learned stopping) */
-        if (g->output_length >= 10000) {
-            break;  /* Emergency only - system should learn to stop before this */
+        /* BUDGET: Caller's limits - keep the partial output */
+        MelvinStop over = budget_exceeded(&g->budget, g->output_length, deadline, phase_end);
+        if (over != MELVIN_STOP_NATURAL) {
+            g->stop_reason = over;
+            break;
         }
-        
-        if (step == 0) { DEBUG_PRINT("DEBUG: End of loop iteration 0\n"); }
     }
+    g->stop_count[g->stop_reason]++;
     
     DEBUG_PRINT("DEBUG: After loop\n");
     
@@ -6864,6 +7421,7 @@ void run_episode(MelvinGraph *g, const uint8_t *input, uint32_t input_len,
         /* CRITICAL: Create patterns from input sequence BEFORE learning predictions */
         /* If no pattern exists for the input, create one so it can learn predictions */
         /* This enables single-character inputs like 'a' to create pattern "a" */
+        profile_begin(g, &mark);
         for (uint32_t seq_len = 1; seq_len <= g->input_length && seq_len <= 5; seq_len++) {
             /* Check if pattern for this input sequence already exists */
             bool pattern_exists = false;
@@ -6894,6 +7452,7 @@ void run_episode(MelvinGraph *g, const uint8_t *input, uint32_t input_len,
                 
                 /* Create new pattern from input sequence */
                 Pattern *pat = &g->patterns[g->pattern_count++];
+                memset(pat, 0, sizeof(Pattern));  /* Fields not set below start at zero */
                 pat->node_ids = malloc(sizeof(uint32_t) * seq_len);
                 for (uint32_t i = 0; i < seq_len; i++) {
                     pat->node_ids[i] = g->input_buffer[i];
@@ -6940,9 +7499,7 @@ void run_episode(MelvinGraph *g, const uint8_t *input, uint32_t input_len,
                 }
                 
                 /* Context vector */
-                for (int i = 0; i < 16; i++) {
-                    pat->context_vector[i] = g->state.context_vector[i];
-                }
+                pattern_take_context(g, pat);
                 
                 /* Initialize pattern-to-pattern edge lists */
                 pat->outgoing_patterns.edges = malloc(sizeof(Edge) * INITIAL_CAPACITY);
@@ -6957,18 +7514,20 @@ void run_episode(MelvinGraph *g, const uint8_t *input, uint32_t input_len,
                 pat->incoming_patterns.total_weight = 0.0f;
                 pat->incoming_patterns.metabolic_load = 0.0f;
                 
-                fprintf(stderr, "CREATED_PATTERN: Pattern %u created from input (len=%u): ", 
-                        g->pattern_count - 1, seq_len);
-                for (uint32_t i = 0; i < seq_len && i < 10; i++) {
-                    fprintf(stderr, "%c", (char)pat->node_ids[i]);
+                if (TRACE_ON(g, MELVIN_TRACE_EPISODE)) {
+                    char text[32];
+                    TRACE(g, MELVIN_TRACE_EPISODE, "pattern_created",
+                          "\"pattern\":%u,\"length\":%u,\"text\":\"%s\"", g->pattern_count - 1, seq_len,
+                          trace_text(text, sizeof(text), NULL, pat->node_ids, seq_len));
                 }
-                fprintf(stderr, "\n");
             }
         }
         
         learn_pattern_predictions(g, target, target_len);
+        profile_end(g, &mark, MELVIN_PROF_LEARN_PATTERNS);
         
         /* Create direct input→target edges */
+        profile_begin(g, &mark);
         /* CRITICAL: Set input context BEFORE creating edges */
         for (uint32_t i = 0; i < g->input_length; i++) {
             g->nodes[g->input_buffer[i]].activated_by = BYTE_VALUES;  /* Force INPUT context */
@@ -6976,15 +7535,23 @@ void run_episode(MelvinGraph *g, const uint8_t *input, uint32_t input_len,
         for (uint32_t i = 0; i < g->input_length && i < target_len; i++) {
             create_or_strengthen_edge(g, g->input_buffer[i], target[i]);
         }
+        profile_end(g, &mark, MELVIN_PROF_LEARN_EDGES);
         
         /* Apply feedback */
+        profile_begin(g, &mark);
         apply_feedback(g, target, target_len);
+        profile_end(g, &mark, MELVIN_PROF_FEEDBACK);
     }
     
+    phase_end = clock_ns();
+    g->phase_ns[MELVIN_PHASE_LEARN_SUPERVISED] += phase_end - phase_start;
+    phase_start = phase_end;
+    
     /* SELF-SUPERVISED LEARNING: Always learn from data structure itself */
     /* Data structure provides feedback - sequences, co-occurrence, patterns */
     
     /* 1. Learn from input sequence structure (data is answer key) */
+    profile_begin(g, &mark);
     if (g->input_length > 1) {
         /* Learn sequential patterns from input */
         for (uint32_t i = 0; i < g->input_length - 1; i++) {
@@ -7003,10 +7570,12 @@ void run_episode(MelvinGraph *g, const uint8_t *input, uint32_t input_len,
             create_or_strengthen_edge(g, g->output_buffer[i], g->output_buffer[i+1]);
         }
     }
+    profile_end(g, &mark, MELVIN_PROF_LEARN_EDGES);
     
     /* 3. Hierarchical validation: Higher patterns check lower patterns */
     /* Patterns at deeper levels (more abstract) validate patterns at shallower levels */
     DEBUG_PRINT("DEBUG: Hierarchical validation, pattern_count=%u\n", g->pattern_count);
+    profile_begin(g, &mark);
     for (uint32_t p1 = 0; p1 < g->pattern_count; p1++) {
         Pattern *pat1 = &g->patterns[p1];
         if (pat1->chain_depth == 0) continue;  /* Skip root patterns */
@@ -7039,11 +7608,15 @@ void run_episode(MelvinGraph *g, const uint8_t *input, uint32_t input_len,
     /* 4. Pattern co-occurrence validation (patterns check each other) */
     /* If patterns co-occur frequently, they validate each other */
     DEBUG_PRINT("DEBUG: Co-occurrence validation...\n");
-    for (uint32_t p1 = 0; p1 < g->pattern_count; p1++) {
+    uint32_t scan_count;
+    const uint32_t *scan = context_scan(g, &scan_count);  /* Patterns this context admits */
+    for (uint32_t at = 0; at < scan_count; at++) {
+        uint32_t p1 = scan[at];
         Pattern *pat1 = &g->patterns[p1];
         if (pat1->activation < pat1->threshold) continue;
         
-        for (uint32_t p2 = p1 + 1; p2 < g->pattern_count; p2++) {
+        for (uint32_t at2 = at + 1; at2 < scan_count; at2++) {
+            uint32_t p2 = scan[at2];
             Pattern *pat2 = &g->patterns[p2];
             if (pat2->activation < pat2->threshold) continue;
             
@@ -7129,22 +7702,44 @@ void run_episode(MelvinGraph *g, const uint8_t *input, uint32_t input_len,
         }
     }
     
+    profile_end(g, &mark, MELVIN_PROF_VALIDATE);
     DEBUG_PRINT("DEBUG: After self-consistency\n");
     
+    phase_end = clock_ns();
+    g->phase_ns[MELVIN_PHASE_LEARN_STRUCTURE] += phase_end - phase_start;
+    phase_start = phase_end;
+    
     /* 6. Pattern detection from data structure (always on, not just supervised) */
     /* Detect patterns in input/output sequences - data structure provides patterns */
     DEBUG_PRINT("DEBUG: Pattern detection, input_len=%u, output_len=%u\n", g->input_length, g->output_length);
     if (g->input_length > 1 || g->output_length > 1) {
+        profile_begin(g, &mark);
         detect_patterns(g);  /* Learn sequential patterns from data structure */
+        profile_end(g, &mark, MELVIN_PROF_DETECT_SEQUENTIAL);
+        profile_begin(g, &mark);
         detect_positional_patterns(g);  /* Learn positional patterns across input history */
+        profile_end(g, &mark, MELVIN_PROF_DETECT_POSITIONAL);
     }
     DEBUG_PRINT("DEBUG: After detect_patterns\n");
     
+    phase_end = clock_ns();
+    g->phase_ns[MELVIN_PHASE_DETECT_PATTERNS] += phase_end - phase_start;
+    phase_start = phase_end;
+    
     /* 7. Learn propagation and selection parameters from data */
     /* Patterns learn HOW to propagate and HOW to select from what works */
     DEBUG_PRINT("DEBUG: Before learn_prop_selection\n");
+    profile_begin(g, &mark);
     learn_propagation_selection_parameters(g, target, target_len);
+    profile_end(g, &mark, MELVIN_PROF_LEARN_PARAMETERS);
     DEBUG_PRINT("DEBUG: After learn_prop_selection, DONE!\n");
+    
+    phase_end = clock_ns();
+    g->phase_ns[MELVIN_PHASE_LEARN_STRUCTURE] += phase_end - phase_start;
+    if (g->profiling) g->profile.episode_ns += phase_end - episode_start;
+    g->episode_count++;
+    g->output_count += g->output_length;
+    if (g->record) record_episode(g, input, input_len, target, target_len, phase_end - episode_start);
 }
 
 /* ============================================================================
@@ -7271,15 +7866,19 @@ void learn_propagation_selection_parameters(MelvinGraph *g, const uint8_t *targe
 void learn_pattern_predictions(MelvinGraph *g, const uint8_t *target, uint32_t target_len) {
     if (target == NULL || target_len == 0) return;
     
-    fprintf(stderr, "LEARN_PATTERN_PRED: Called with target_len=%u, pattern_count=%u, input_len=%u\n", 
-            target_len, g->pattern_count, g->input_length);
+    TRACE(g, MELVIN_TRACE_EPISODE, "learn_pattern_predictions",
+          "\"target_len\":%u,\"patterns\":%u,\"input_len\":%u",
+          target_len, g->pattern_count, g->input_length);
     
     /* AUTOMATIC PATTERN-TO-PATTERN LEARNING: System learns pattern chains from raw data */
     /* This enables automatic chunking and generalization - patterns compose into concepts */
     
     /* First, learn pattern-to-pattern associations (concept-level) */
     /* Check all pattern pairs: does pattern A followed by pattern B appear in target? */
-    for (uint32_t p1 = 0; p1 < g->pattern_count; p1++) {
+    uint32_t scan_count;
+    const uint32_t *scan = context_scan(g, &scan_count);  /* Patterns this context admits */
+    for (uint32_t at = 0; at < scan_count; at++) {
+        uint32_t p1 = scan[at];
         Pattern *pat1 = &g->patterns[p1];
         
         /* Check if pattern1 matches ANY position in target */
@@ -7298,7 +7897,8 @@ void learn_pattern_predictions(MelvinGraph *g, const uint8_t *target, uint32_t t
                     
                     if (next_pos < target_len) {
                         /* Check all other patterns to see if they match at next_pos */
-                        for (uint32_t p2 = 0; p2 < g->pattern_count; p2++) {
+                        for (uint32_t at2 = 0; at2 < scan_count; at2++) {
+                            uint32_t p2 = scan[at2];
                             if (p1 == p2) continue;  /* Don't predict self */
                             
                             Pattern *pat2 = &g->patterns[p2];
@@ -7374,7 +7974,8 @@ void learn_pattern_predictions(MelvinGraph *g, const uint8_t *target, uint32_t t
      * RELATIVE: Pattern predicts based on WHERE it appears in sequence
      * SELF-REGULATING: Predictions strengthen with repeated observations
      * ======================================================================== */
-    for (uint32_t p = 0; p < g->pattern_count; p++) {
+    for (uint32_t at = 0; at < scan_count; at++) {
+        uint32_t p = scan[at];
         Pattern *pat = &g->patterns[p];
         
         /* Convert target to node IDs for matching */
@@ -7434,7 +8035,8 @@ void learn_pattern_predictions(MelvinGraph *g, const uint8_t *target, uint32_t t
     
     /* Also learn pattern-to-node predictions (for output generation) */
     /* For each pattern, check if it matches input and what comes next in target */
-    for (uint32_t p = 0; p < g->pattern_count; p++) {
+    for (uint32_t at = 0; at < scan_count; at++) {
+        uint32_t p = scan[at];
         Pattern *pat = &g->patterns[p];
         
         /* Check if pattern matches ANY position in input (not just end) */
@@ -7543,7 +8145,8 @@ void learn_pattern_predictions(MelvinGraph *g, const uint8_t *target, uint32_t t
     
     /* LEARN END MARKER: Patterns that match end of target learn to predict END */
     /* This allows the system to learn when to stop generating output */
-    for (uint32_t p = 0; p < g->pattern_count; p++) {
+    for (uint32_t at = 0; at < scan_count; at++) {
+        uint32_t p = scan[at];
         Pattern *pat = &g->patterns[p];
         
         /* Check if pattern matches END of target */
@@ -7602,6 +8205,12 @@ void melvin_set_context(MelvinGraph *g, float *context) {
     for (int i = 0; i < 16; i++) {
         g->state.context_vector[i] = context[i];
     }
+    uint16_t previous = g->state.context_class;
+    g->state.context_class = context_intern(g, g->state.context_vector);
+    if (g->state.context_class != previous || previous == CONTEXT_UNCLASSED) {
+        g->context_scan_valid = false;  /* Other partitions apply now */
+    }
+    if (g->record) record_context(g);
 }
 
 /* Set input port (0=text, 1=audio, 2=vision, 3=motor, etc.) */
@@ -7739,6 +8348,7 @@ MelvinGraph* melvin_load_brain(const char *filename) {
             }
             
             Pattern *pat = &g->patterns[g->pattern_count++];
+            memset(pat, 0, sizeof(Pattern));  /* Fields not set below start at zero */
             pat->node_ids = malloc(sizeof(uint32_t) * seq_len);
             pat->length = 0;
             
@@ -7795,6 +8405,8 @@ MelvinGraph* melvin_load_brain(const char *filename) {
             } else {
                 for (int i = 0; i < 16; i++) pat->context_vector[i] = 0.0f;
             }
+            pat->context_class = context_intern(g, pat->context_vector);
+            context_partition_add(g, g->pattern_count - 1);
             
             /* Parse strength */
             char *strength_str = strstr(line, "strength:");
@@ -7915,6 +8527,7 @@ MelvinGraph* melvin_load_brain(const char *filename) {
 /* Destroy graph and free all memory */
 void melvin_destroy(MelvinGraph *g) {
     if (!g) return;
+    melvin_record_stop(g);  /* Its checksum needs the brain intact */
     
     /* Free pattern memory */
     for (uint32_t p = 0; p < g->pattern_count; p++) {
@@ -7924,10 +8537,20 @@ void melvin_destroy(MelvinGraph *g) {
         if (pat->predicted_nodes) free(pat->predicted_nodes);
         if (pat->prediction_weights) free(pat->prediction_weights);
         if (pat->input_weights) free(pat->input_weights);
+        if (pat->predicted_patterns) free(pat->predicted_patterns);
+        if (pat->pattern_prediction_weights) free(pat->pattern_prediction_weights);
+        if (pat->associated_patterns) free(pat->associated_patterns);
+        if (pat->association_strengths) free(pat->association_strengths);
+        if (pat->rule_condition_patterns) free(pat->rule_condition_patterns);
+        if (pat->rule_target_patterns) free(pat->rule_target_patterns);
+        if (pat->rule_boost_amounts) free(pat->rule_boost_amounts);
+        if (pat->rule_strengths) free(pat->rule_strengths);
         if (pat->outgoing_patterns.edges) free(pat->outgoing_patterns.edges);
         if (pat->incoming_patterns.edges) free(pat->incoming_patterns.edges);
     }
     if (g->patterns) free(g->patterns);
+    for (uint32_t c = 0; c <= CONTEXT_CLASS_MAX; c++) free(g->context_partitions[c].ids);
+    free(g->context_scan_list.ids);
     
     /* Free edge lists */
     for (int i = 0; i < BYTE_VALUES; i++) {
@@ -7957,9 +8580,602 @@ void melvin_destroy(MelvinGraph *g) {
         free(g->input_history_lengths);
     }
     
+    melvin_trace_disable(g);
     free(g);
 }
 
+/* ============================================================================
+ * CLONE: Deep copy of a brain
+ *
+ * The copy shares nothing with the source - both can learn independently
+ * (e.g. one clone of a base brain per chat session). Per-episode scratch
+ * (output contributions) starts empty in the copy.
+ * ============================================================================ */
+
+/* Duplicate count elements of elem_size, allocating room for capacity.
+ * Clears *ok if the allocation fails */
+static void* clone_array(const void *src, size_t elem_size, uint32_t count, uint32_t capacity, bool *ok) {
+    if (!src || capacity == 0) return NULL;
+    if (capacity < count) capacity = count;
+    void *dst = malloc(elem_size * capacity);
+    if (!dst) {
+        *ok = false;
+        return NULL;
+    }
+    if (count > 0) memcpy(dst, src, elem_size * count);
+    return dst;
+}
+
+/* Prediction arrays grow in steps of 4 (see apply_feedback) - keep that invariant */
+static uint32_t prediction_capacity(uint32_t count) {
+    return (count + 3) & ~3u;
+}
+
+static void clone_edge_list(EdgeList *dst, const EdgeList *src, bool *ok) {
+    *dst = *src;
+    dst->edges = clone_array(src->edges, sizeof(Edge), src->count, src->capacity, ok);
+}
+
+MelvinGraph* melvin_clone(const MelvinGraph *src) {
+    if (!src) return NULL;
+
+    MelvinGraph *g = malloc(sizeof(MelvinGraph));
+    if (!g) return NULL;
+    bool ok = true;  /* Every owned pointer below is replaced even after a
+                      * failure, so melvin_destroy can free a partial copy */
+    *g = *src;  /* Scalars, nodes and system state */
+    g->output_hook = NULL;  /* The hook belongs to whoever owns src */
+    g->output_hook_ctx = NULL;
+    g->trace = NULL;  /* Clones start untraced and unrecorded */
+    g->record = NULL;
+    melvin_reset_profile(g);  /* Same sampling rate, counters from zero */
+    g->episode_count = g->step_count = g->output_count = 0;
+    memset(g->phase_ns, 0, sizeof(g->phase_ns));
+    memset(&g->budget, 0, sizeof(g->budget));  /* Per-call setting, like the hook */
+    memset(g->stop_count, 0, sizeof(g->stop_count));
+
+    /* Edges */
+    for (int i = 0; i < BYTE_VALUES; i++) {
+        clone_edge_list(&g->outgoing[i], &src->outgoing[i], &ok);
+        clone_edge_list(&g->incoming[i], &src->incoming[i], &ok);
+    }
+
+    /* Patterns */
+    g->patterns = malloc(sizeof(Pattern) * src->pattern_capacity);
+    if (!g->patterns && src->pattern_capacity > 0) {
+        ok = false;
+        g->pattern_count = 0;
+    }
+    for (uint32_t p = 0; p < g->pattern_count; p++) {
+        const Pattern *sp = &src->patterns[p];
+        Pattern *pat = &g->patterns[p];
+        *pat = *sp;
+
+        pat->node_ids = clone_array(sp->node_ids, sizeof(uint32_t), sp->length, sp->length, &ok);
+        pat->sub_pattern_ids = clone_array(sp->sub_pattern_ids, sizeof(uint32_t),
+                                           sp->sub_pattern_count, sp->sub_pattern_count, &ok);
+        pat->predicted_nodes = clone_array(sp->predicted_nodes, sizeof(uint32_t), sp->prediction_count,
+                                           prediction_capacity(sp->prediction_count), &ok);
+        pat->prediction_weights = clone_array(sp->prediction_weights, sizeof(float), sp->prediction_count,
+                                              prediction_capacity(sp->prediction_count), &ok);
+        pat->predicted_patterns = clone_array(sp->predicted_patterns, sizeof(uint32_t), sp->pattern_prediction_count,
+                                              prediction_capacity(sp->pattern_prediction_count), &ok);
+        pat->pattern_prediction_weights = clone_array(sp->pattern_prediction_weights, sizeof(float),
+                                                      sp->pattern_prediction_count,
+                                                      prediction_capacity(sp->pattern_prediction_count), &ok);
+        pat->input_weights = clone_array(sp->input_weights, sizeof(float), sp->input_size, sp->input_size, &ok);
+        pat->associated_patterns = clone_array(sp->associated_patterns, sizeof(uint32_t),
+                                               sp->association_count, sp->association_capacity, &ok);
+        pat->association_strengths = clone_array(sp->association_strengths, sizeof(float),
+                                                 sp->association_count, sp->association_capacity, &ok);
+        pat->rule_condition_patterns = clone_array(sp->rule_condition_patterns, sizeof(uint32_t),
+                                                   sp->rule_count, sp->rule_capacity, &ok);
+        pat->rule_target_patterns = clone_array(sp->rule_target_patterns, sizeof(uint32_t),
+                                                sp->rule_count, sp->rule_capacity, &ok);
+        pat->rule_boost_amounts = clone_array(sp->rule_boost_amounts, sizeof(float),
+                                              sp->rule_count, sp->rule_capacity, &ok);
+        pat->rule_strengths = clone_array(sp->rule_strengths, sizeof(float),
+                                          sp->rule_count, sp->rule_capacity, &ok);
+        clone_edge_list(&pat->outgoing_patterns, &sp->outgoing_patterns, &ok);
+        clone_edge_list(&pat->incoming_patterns, &sp->incoming_patterns, &ok);
+    }
+    for (uint32_t c = 0; c <= CONTEXT_CLASS_MAX; c++) {
+        const PatternIdList *part = &src->context_partitions[c];
+        g->context_partitions[c].ids = clone_array(part->ids, sizeof(uint32_t), part->count, part->capacity, &ok);
+    }
+    memset(&g->context_scan_list, 0, sizeof(g->context_scan_list));  /* Rebuilt on first use */
+    g->context_scan_valid = false;
+
+    /* Buffers */
+    g->input_buffer = clone_array(src->input_buffer, sizeof(uint32_t), src->input_length, src->input_capacity, &ok);
+    g->output_buffer = clone_array(src->output_buffer, sizeof(uint32_t), src->output_length, src->output_capacity, &ok);
+
+    /* Contribution tracking starts empty */
+    g->output_contributions = calloc(src->output_contrib_capacity, sizeof(OutputContribution));
+    if (!g->output_contributions && src->output_contrib_capacity > 0) ok = false;
+
+    /* Input history */
+    g->input_history = calloc(src->input_history_capacity, sizeof(uint32_t*));
+    g->input_history_lengths = calloc(src->input_history_capacity, sizeof(uint32_t));
+    if ((!g->input_history || !g->input_history_lengths) && src->input_history_capacity > 0) {
+        ok = false;
+        free(g->input_history);
+        free(g->input_history_lengths);
+        g->input_history = NULL;
+        g->input_history_lengths = NULL;
+        g->input_history_count = 0;
+    }
+    for (uint32_t i = 0; i < g->input_history_count; i++) {
+        g->input_history_lengths[i] = src->input_history_lengths[i];
+        g->input_history[i] = clone_array(src->input_history[i], sizeof(uint32_t),
+                                          src->input_history_lengths[i], src->input_history_lengths[i], &ok);
+    }
+
+    if (!ok) {
+        melvin_destroy(g);
+        return NULL;
+    }
+    return g;
+}
+
+/* ============================================================================
+ * SESSIONS: Inference state kept apart from the brain
+ *
+ * A brain (MelvinGraph) holds learned structure - edges, pattern sequences
+ * and predictions - next to per-episode scratch: node activations, pattern
+ * firing state, input/output buffers and system state. A MelvinSession owns
+ * its own copy of that scratch. melvin_session_infer runs the generation
+ * loop in a view of the brain that shares the edge arrays and pattern data
+ * read-only and points everything transient at the session, so any number
+ * of sessions may infer against one brain at once, on any threads, without
+ * locks. The brain must not be trained while sessions are reading it.
+ *
+ * A session keeps its pattern table and buffers between calls and only
+ * grows them, so a session reused for many requests stops allocating.
+ * Nothing is learned: this is run_episode without a target or learning.
+ * ============================================================================ */
+
+struct MelvinSession {
+    MelvinGraph view;              /* Brain's scalars, nodes and state; session's buffers */
+    Pattern *patterns;             /* Copies of the Pattern structs (activations, firing) */
+    uint32_t pattern_capacity;
+    uint32_t *input_buffer;
+    uint32_t input_capacity;
+    uint32_t *output_buffer;
+    uint32_t output_capacity;
+    PatternIdList scan;            /* The view's context_scan list */
+    MelvinBudget budget;
+    MelvinStop stop_reason;
+    MelvinOutputHook output_hook;
+    void *output_hook_ctx;
+};
+
+MelvinSession* melvin_session_create(void) {
+    MelvinSession *s = calloc(1, sizeof(MelvinSession));
+    if (!s) return NULL;
+    s->output_capacity = 64;
+    s->output_buffer = malloc(sizeof(uint32_t) * s->output_capacity);
+    if (!s->output_buffer) {
+        free(s);
+        return NULL;
+    }
+    return s;
+}
+
+void melvin_session_destroy(MelvinSession *s) {
+    if (!s) return;
+    free(s->patterns);
+    free(s->input_buffer);
+    free(s->output_buffer);
+    free(s->scan.ids);
+    free(s);
+}
+
+/* Limits for the session's following calls (NULL: built-in caps only) */
+void melvin_session_set_budget(MelvinSession *s, const MelvinBudget *budget) {
+    if (budget) s->budget = *budget;
+    else memset(&s->budget, 0, sizeof(s->budget));
+}
+
+/* Stream output: hook(ctx, node) runs inside melvin_session_infer */
+void melvin_session_set_output_hook(MelvinSession *s, MelvinOutputHook hook, void *ctx) {
+    s->output_hook = hook;
+    s->output_hook_ctx = ctx;
+}
+
+/* Output of the last call - valid until the next call on this session */
+void melvin_session_get_output(const MelvinSession *s, uint32_t **output, uint32_t *length) {
+    *output = s->view.output_buffer;
+    *length = s->view.output_length;
+}
+
+MelvinStop melvin_session_get_stop_reason(const MelvinSession *s) {
+    return s->stop_reason;
+}
+
+/* Point the session's view at g and inject the input (run_episode's
+ * preamble). Returns false if the session's tables could not grow. */
+static bool session_begin(MelvinSession *s, const MelvinGraph *g,
+                          const uint8_t *input, uint32_t input_len) {
+    if (g->pattern_count > s->pattern_capacity) {
+        Pattern *patterns = realloc(s->patterns, sizeof(Pattern) * g->pattern_count);
+        if (!patterns) return false;
+        s->patterns = patterns;
+        s->pattern_capacity = g->pattern_count;
+    }
+    if (input_len > s->input_capacity || !s->input_buffer) {
+        uint32_t capacity = (input_len > 0) ? input_len : 1;
+        uint32_t *buffer = realloc(s->input_buffer, sizeof(uint32_t) * capacity);
+        if (!buffer) return false;
+        s->input_buffer = buffer;
+        s->input_capacity = capacity;
+    }
+
+    MelvinGraph *v = &s->view;
+    *v = *g;  /* Shares edges and pattern sequences; nodes and state are copies */
+    v->output_hook = s->output_hook;
+    v->output_hook_ctx = s->output_hook_ctx;
+    v->trace = NULL;  /* The ring isn't safe to share between sessions */
+    v->record = NULL;
+
+    v->patterns = s->patterns;
+    v->pattern_capacity = s->pattern_capacity;
+    if (g->pattern_count > 0) {
+        memcpy(v->patterns, g->patterns, sizeof(Pattern) * g->pattern_count);
+    }
+
+    v->input_buffer = s->input_buffer;
+    v->input_capacity = s->input_capacity;
+    v->input_length = 0;
+    v->output_buffer = s->output_buffer;
+    v->output_capacity = s->output_capacity;
+    v->output_length = 0;
+    v->output_contributions = NULL;  /* Only used by learning */
+    v->output_contrib_capacity = 0;
+    v->context_scan_list = s->scan;  /* The brain's list may be stale; don't rebuild it here */
+    v->context_scan_valid = false;
+
+    for (int n = 0; n < BYTE_VALUES; n++) {
+        v->nodes[n].activation = 0.0f;
+        v->nodes[n].activated_by = 0;
+        v->nodes[n].adaptation = 0.0f;
+    }
+    for (uint32_t p = 0; p < v->pattern_count; p++) {
+        v->patterns[p].has_fired = false;
+        v->patterns[p].fired_predictions = 0;
+    }
+
+    inject_input(v, input, input_len);
+    compute_system_state(v);
+
+    /* INPUT CONTEXT: Input provides context for which paths to activate */
+    for (uint32_t i = 0; i < input_len && i < v->input_length; i++) {
+        uint32_t node_id = v->input_buffer[i];
+        if (node_id < BYTE_VALUES && v->nodes[node_id].exists) {
+            v->nodes[node_id].activation = 1.0f;
+        }
+    }
+    return true;
+}
+
+/* Keep buffers the episode grew (inject_input and emit_output realloc) */
+static void session_end(MelvinSession *s) {
+    s->input_buffer = s->view.input_buffer;
+    s->input_capacity = s->view.input_capacity;
+    s->output_buffer = s->view.output_buffer;
+    s->output_capacity = s->view.output_capacity;
+    s->scan = s->view.context_scan_list;
+}
+
+/* ============================================================================
+ * BATCHED INFERENCE: Many sessions stepped together against one brain
+ *
+ * The sessions advance in lock-step, so every step walks each edge list
+ * once for the whole batch, and whether a pattern supports an edge (which
+ * only depends on shared data) is decided once per edge for all of them.
+ * Results do not depend on how requests are grouped into batches; a single
+ * melvin_session_infer is a batch of one.
+ * ============================================================================ */
+
+typedef struct {
+    MelvinSession *session;
+    const MelvinBudget *budget;
+    MelvinStop stop;
+    CoherenceContext ctx;
+    float new_activations[BYTE_VALUES];
+    float node_coherence[BYTE_VALUES];
+    uint32_t consecutive_no_selection;
+    uint32_t max_steps;
+    uint64_t deadline;
+} InferMember;
+
+/* Generate for every member; each session's view is already set up */
+static void infer_run(const MelvinGraph *g, InferMember *members, uint32_t count) {
+    uint32_t *live = malloc(sizeof(uint32_t) * count);     /* Members still generating */
+    uint32_t *senders = malloc(sizeof(uint32_t) * count);  /* Live members where a source node fires */
+    uint32_t live_count = 0;
+
+    /* Patterns active for any live member, and the ones supporting one edge */
+    uint32_t pattern_slots = (g->pattern_count > 0) ? g->pattern_count : 1;
+    uint8_t *in_union = calloc(pattern_slots, sizeof(uint8_t));
+    uint32_t *union_active = malloc(sizeof(uint32_t) * pattern_slots);
+    uint32_t *union_candidates = malloc(sizeof(uint32_t) * pattern_slots);
+    uint32_t *union_supporting = malloc(sizeof(uint32_t) * pattern_slots);
+    uint32_t first_edge[BYTE_VALUES];
+
+    /* Same cadence and step cap as run_episode without a target */
+    const uint32_t state_update_interval = 5;
+    const uint32_t max_steps = 200;
+    uint64_t start = clock_ns();
+
+    for (uint32_t m = 0; m < count; m++) {
+        const MelvinBudget *budget = members[m].budget;
+        members[m].max_steps = (budget->max_steps > 0 && budget->max_steps < max_steps) ? budget->max_steps : max_steps;
+        members[m].deadline = (budget->time_limit_ns > 0) ? start + budget->time_limit_ns : 0;
+        members[m].stop = MELVIN_STOP_STEPS;
+        members[m].consecutive_no_selection = 0;
+        live[live_count++] = m;
+    }
+
+    for (uint32_t step = 0; step < max_steps && live_count > 0; step++) {
+        if (step % state_update_interval == 0) {
+            for (uint32_t k = 0; k < live_count; k++) {
+                compute_system_state(&members[live[k]].session->view);
+            }
+        }
+
+        /* First: Activate patterns - each pattern is visited once for the batch */
+        for (uint32_t p = 0; p < g->pattern_count; p++) {
+            for (uint32_t k = 0; k < live_count; k++) {
+                MelvinGraph *v = &members[live[k]].session->view;
+                update_pattern_context_activation(v, &v->patterns[p]);
+            }
+        }
+
+        for (uint32_t k = 0; k < live_count; k++) {
+            InferMember *m = &members[live[k]];
+            coherence_context_build(&m->session->view, &m->ctx);
+            memset(m->new_activations, 0, sizeof(m->new_activations));
+            memset(m->node_coherence, 0, sizeof(m->node_coherence));
+            for (uint32_t a = 0; a < m->ctx.active_count; a++) {
+                in_union[m->ctx.active[a]] = 1;
+            }
+        }
+        uint32_t union_count = 0;
+        for (uint32_t p = 0; p < g->pattern_count; p++) {
+            if (in_union[p]) {
+                union_active[union_count++] = p;
+                in_union[p] = 0;
+            }
+        }
+
+        /* Second: Propagate through edges - each edge list is walked once for the batch */
+        for (uint32_t source = 0; source < BYTE_VALUES; source++) {
+            const EdgeList *out = &g->outgoing[source];
+            if (out->count == 0) continue;
+
+            uint32_t sender_count = 0;
+            for (uint32_t k = 0; k < live_count; k++) {
+                if (node_propagates(&members[live[k]].session->view, source)) {
+                    senders[sender_count++] = live[k];
+                }
+            }
+            if (sender_count == 0) continue;
+            index_first_edges(out, first_edge);
+            uint32_t candidates = patterns_containing((MelvinGraph*)g, union_active, union_count,
+                                                      source, union_candidates);
+
+            for (uint32_t e = 0; e < out->count; e++) {
+                const Edge *edge = &out->edges[e];
+                if (!edge_propagates(edge)) continue;
+
+                /* Support only reads shared pattern data - test each active pattern once */
+                uint32_t supporting_count = patterns_supporting((MelvinGraph*)g, union_candidates, candidates,
+                                                                source, edge->to_id, union_supporting);
+
+                EdgeEvidence ev;
+                ev.source = source;
+                ev.target = edge->to_id;
+                ev.first_edge = &out->edges[first_edge[edge->to_id]];
+
+                for (uint32_t k = 0; k < sender_count; k++) {
+                    InferMember *m = &members[senders[k]];
+                    uint32_t own = 0;
+                    for (uint32_t i = 0; i < supporting_count; i++) {
+                        if (m->ctx.is_active[union_supporting[i]]) {
+                            m->ctx.supporting[own++] = union_supporting[i];
+                        }
+                    }
+                    ev.supporting = m->ctx.supporting;
+                    ev.supporting_count = own;
+                    propagate_coherent_edge(&m->session->view, &m->ctx, edge, &ev,
+                                            m->new_activations, m->node_coherence);
+                }
+            }
+        }
+
+        /* Rest of the step is per session: select, emit, stop conditions */
+        uint32_t still_live = 0;
+        uint64_t now = clock_ns();
+        for (uint32_t k = 0; k < live_count; k++) {
+            InferMember *m = &members[live[k]];
+            MelvinGraph *v = &m->session->view;
+            uint32_t output_node = select_coherent_node(v, &m->ctx, m->new_activations, m->node_coherence);
+            coherence_context_free(&m->ctx);
+            if (episode_step(v, output_node, step, NULL, 0, &m->consecutive_no_selection)) {
+                m->stop = MELVIN_STOP_NATURAL;
+                continue;
+            }
+            m->stop = budget_exceeded(m->budget, v->output_length, m->deadline, now);
+            if (m->stop != MELVIN_STOP_NATURAL) continue;
+            if (step + 1 >= m->max_steps) {
+                m->stop = MELVIN_STOP_STEPS;
+                continue;
+            }
+            live[still_live++] = live[k];
+        }
+        live_count = still_live;
+    }
+
+    free(union_supporting);
+    free(union_candidates);
+    free(union_active);
+    free(in_union);
+    free(senders);
+    free(live);
+}
+
+/* Inference against a read-only brain: run_episode without a target or
+ * learning, with all transient state in s. Returns false if s could not
+ * hold the brain's patterns (out of memory). */
+bool melvin_session_infer(const MelvinGraph *g, MelvinSession *s,
+                          const uint8_t *input, uint32_t input_len) {
+    if (!g || !s || !session_begin(s, g, input, input_len)) return false;
+
+    InferMember member;
+    member.session = s;
+    member.budget = &s->budget;
+    infer_run(g, &member, 1);
+    s->stop_reason = member.stop;
+    session_end(s);
+    return true;
+}
+
+void melvin_infer_batch(const MelvinGraph *g, MelvinInferRequest *requests, uint32_t count) {
+    if (!g || !requests || count == 0) return;
+
+    InferMember *members = malloc(sizeof(InferMember) * count);
+    uint32_t ready = 0;
+    for (uint32_t m = 0; m < count; m++) {
+        MelvinSession *s = melvin_session_create();
+        if (s && session_begin(s, g, requests[m].input, requests[m].input_len)) {
+            members[ready].session = s;
+            members[ready].budget = &requests[m].budget;
+            ready++;
+        } else {
+            melvin_session_destroy(s);
+            break;
+        }
+    }
+    infer_run(g, members, ready);
+
+    for (uint32_t m = 0; m < count; m++) {
+        MelvinInferRequest *req = &requests[m];
+        MelvinGraph *v = (m < ready) ? &members[m].session->view : NULL;
+        req->output_len = v ? v->output_length : 0;
+        req->output = malloc(sizeof(uint32_t) * (req->output_len > 0 ? req->output_len : 1));
+        if (req->output && req->output_len > 0) {
+            memcpy(req->output, v->output_buffer, sizeof(uint32_t) * req->output_len);
+        }
+        req->stop = (m < ready) ? members[m].stop : MELVIN_STOP_STEPS;
+        if (m < ready) {
+            session_end(members[m].session);
+            melvin_session_destroy(members[m].session);
+        }
+    }
+    free(members);
+}
+
+/* Stream output: hook(ctx, node) runs inside run_episode for every emitted
+ * node, on the calling thread. Pass NULL to stop. */
+void melvin_set_output_hook(MelvinGraph *g, MelvinOutputHook hook, void *ctx) {
+    g->output_hook = hook;
+    g->output_hook_ctx = ctx;
+}
+
+/* Limits for every following run_episode on g (NULL: built-in caps only).
+ * When a limit ends generation early the episode keeps its partial output
+ * and still learns from it; melvin_get_stop_reason says what happened. */
+void melvin_set_budget(MelvinGraph *g, const MelvinBudget *budget) {
+    if (budget) g->budget = *budget;
+    else memset(&g->budget, 0, sizeof(g->budget));
+}
+
+MelvinStop melvin_get_stop_reason(const MelvinGraph *g) {
+    return g->stop_reason;
+}
+
+/* Short lowercase name for a stop reason (metric labels, responses) */
+const char* melvin_stop_name(MelvinStop reason) {
+    switch (reason) {
+        case MELVIN_STOP_NATURAL:  return "natural";
+        case MELVIN_STOP_STEPS:    return "steps";
+        case MELVIN_STOP_OUTPUT:   return "output";
+        case MELVIN_STOP_DEADLINE: return "deadline";
+        default:                   return "unknown";
+    }
+}
+
+/* Short lowercase name for a phase (metric labels, dumps) */
+const char* melvin_phase_name(MelvinPhase phase) {
+    switch (phase) {
+        case MELVIN_PHASE_SETUP:            return "setup";
+        case MELVIN_PHASE_PROPAGATE:        return "propagate";
+        case MELVIN_PHASE_EMIT:             return "emit";
+        case MELVIN_PHASE_LEARN_SUPERVISED: return "learn_supervised";
+        case MELVIN_PHASE_LEARN_STRUCTURE:  return "learn_structure";
+        case MELVIN_PHASE_DETECT_PATTERNS:  return "detect_patterns";
+        default:                            return "unknown";
+    }
+}
+
+/* Bytes held by an edge list */
+static uint64_t edge_list_bytes(const EdgeList *list) {
+    return (list->edges ? (uint64_t)list->capacity * sizeof(Edge) : 0);
+}
+
+/* Counters, structure and approximate memory use. Walks every edge list
+ * and pattern, so call it between episodes rather than per step. */
+void melvin_get_stats(const MelvinGraph *g, MelvinStats *stats) {
+    memset(stats, 0, sizeof(MelvinStats));
+    stats->episodes = g->episode_count;
+    stats->steps = g->step_count;
+    stats->outputs = g->output_count;
+    memcpy(stats->phase_ns, g->phase_ns, sizeof(stats->phase_ns));
+    memcpy(stats->stops, g->stop_count, sizeof(stats->stops));
+    stats->patterns = g->pattern_count;
+    stats->context_classes = g->context_class_count;
+    stats->memory_graph = sizeof(MelvinGraph);
+
+    for (int i = 0; i < BYTE_VALUES; i++) {
+        const EdgeList *out = &g->outgoing[i];
+        for (uint32_t e = 0; e < out->count; e++) {
+            if (out->edges[e].active) stats->edges_active++;
+            else stats->edges_tombstoned++;
+        }
+        stats->memory_edges += edge_list_bytes(out) + edge_list_bytes(&g->incoming[i]);
+    }
+
+    stats->memory_patterns = (uint64_t)g->pattern_capacity * sizeof(Pattern);
+    for (uint32_t c = 0; c <= CONTEXT_CLASS_MAX; c++) {
+        stats->memory_patterns += (uint64_t)g->context_partitions[c].capacity * sizeof(uint32_t);
+    }
+    stats->memory_patterns += (uint64_t)g->context_scan_list.capacity * sizeof(uint32_t);
+    for (uint32_t p = 0; p < g->pattern_count; p++) {
+        const Pattern *pat = &g->patterns[p];
+        stats->pattern_edges += pat->outgoing_patterns.count;
+        stats->memory_pattern_edges += edge_list_bytes(&pat->outgoing_patterns) +
+                                       edge_list_bytes(&pat->incoming_patterns);
+        stats->memory_patterns +=
+            (uint64_t)pat->length * sizeof(uint32_t) +
+            (uint64_t)pat->sub_pattern_count * sizeof(uint32_t) +
+            (uint64_t)pat->prediction_count * (sizeof(uint32_t) + sizeof(float)) +
+            (uint64_t)pat->pattern_prediction_count * (sizeof(uint32_t) + sizeof(float)) +
+            (uint64_t)pat->input_size * sizeof(float) +
+            (uint64_t)pat->association_capacity * (sizeof(uint32_t) + sizeof(float)) +
+            (uint64_t)pat->rule_capacity * (2 * sizeof(uint32_t) + 2 * sizeof(float));
+    }
+
+    stats->memory_buffers =
+        (uint64_t)g->input_capacity * sizeof(uint32_t) +
+        (uint64_t)g->output_capacity * sizeof(uint32_t) +
+        (uint64_t)g->output_contrib_capacity * sizeof(OutputContribution) +
+        (uint64_t)g->input_history_capacity * (sizeof(uint32_t*) + sizeof(uint32_t));
+    for (uint32_t h = 0; h < g->input_history_count; h++) {
+        stats->memory_buffers += (uint64_t)g->input_history_lengths[h] * sizeof(uint32_t);
+    }
+}
+
 /* Get output buffer (for testing) */
 void melvin_get_output(MelvinGraph *g, uint32_t **output, uint32_t *length) {
     *output = g->output_buffer;
@@ -8022,6 +9238,162 @@ float melvin_get_edge_weight(MelvinGraph *g, uint32_t from_id, uint32_t to_id) {
     return 0.0f;
 }
 
+/* ============================================================================
+ * INTROSPECTION: Iterators behind the public views in melvin.h
+ *
+ * Each iterator is a position in storage (outer: node or pattern, inner:
+ * index into its array); next copies the item out and advances. Nothing is
+ * allocated, so tools can walk brains of any size.
+ * ============================================================================ */
+
+enum {
+    ITER_PATTERNS = 1,
+    ITER_EDGES,
+    ITER_PATTERN_EDGES,
+    ITER_PREDICTIONS
+};
+
+_Static_assert(MELVIN_BLANK_NODE == BLANK_NODE && MELVIN_END_MARKER == END_MARKER &&
+               MELVIN_NO_PATTERN == INVALID_PATTERN_ID && MELVIN_NO_CONTEXT_CLASS == CONTEXT_UNCLASSED,
+               "melvin.h constants out of sync");
+
+static void fill_pattern_info(const MelvinGraph *g, uint32_t id, MelvinPatternInfo *info) {
+    const Pattern *pat = &g->patterns[id];
+    info->id = id;
+    info->nodes = pat->node_ids;
+    info->length = pat->length;
+    info->generalized = false;
+    for (uint32_t i = 0; i < pat->length; i++) {
+        if (IS_BLANK_NODE(pat->node_ids[i])) info->generalized = true;
+    }
+    info->strength = pat->strength;
+    info->threshold = pat->threshold;
+    info->dynamic_importance = pat->dynamic_importance;
+    info->prediction_attempts = pat->prediction_attempts;
+    info->prediction_successes = pat->prediction_successes;
+    info->prediction_count = pat->prediction_count;
+    info->pattern_prediction_count = pat->pattern_prediction_count;
+    info->pattern_edge_count = pat->outgoing_patterns.count;
+    info->chain_depth = pat->chain_depth;
+    info->parent = pat->parent_pattern_id;
+    info->accumulated_meaning = pat->accumulated_meaning;
+    info->context = pat->context_vector;
+    info->context_class = pat->context_class;
+}
+
+bool melvin_pattern_info(const MelvinGraph *g, uint32_t id, MelvinPatternInfo *info) {
+    if (id >= g->pattern_count) return false;
+    fill_pattern_info(g, id, info);
+    return true;
+}
+
+/* Copy of the public state: just the fields worth showing outside */
+void melvin_get_state(const MelvinGraph *g, MelvinStateInfo *state) {
+    const SystemState *s = &g->state;
+    state->error_rate = s->error_rate;
+    state->learning_rate = s->learning_rate;
+    state->learning_pressure = s->learning_pressure;
+    state->exploration_pressure = s->exploration_pressure;
+    state->metabolic_pressure = s->metabolic_pressure;
+    state->loop_pressure = s->loop_pressure;
+    state->pattern_confidence = s->pattern_confidence;
+    state->avg_pattern_utility = s->avg_pattern_utility;
+    memcpy(state->context, s->context_vector, sizeof(state->context));
+    state->context_class = s->context_class;
+    state->step = s->step;
+}
+
+static void iter_begin(const MelvinGraph *g, uint32_t kind, uint32_t scope, MelvinIter *it) {
+    it->graph = g;
+    it->kind = kind;
+    it->scope = scope;
+    it->outer = (scope == MELVIN_ALL) ? 0 : scope;
+    it->inner = 0;
+}
+
+void melvin_iter_patterns(const MelvinGraph *g, MelvinIter *it) {
+    iter_begin(g, ITER_PATTERNS, MELVIN_ALL, it);
+}
+
+bool melvin_next_pattern(MelvinIter *it, MelvinPatternInfo *info) {
+    const MelvinGraph *g = it->graph;
+    if (it->kind != ITER_PATTERNS || it->outer >= g->pattern_count) return false;
+    fill_pattern_info(g, it->outer++, info);
+    return true;
+}
+
+void melvin_iter_edges(const MelvinGraph *g, uint32_t from, MelvinIter *it) {
+    iter_begin(g, ITER_EDGES, from, it);
+}
+
+void melvin_iter_pattern_edges(const MelvinGraph *g, uint32_t from, MelvinIter *it) {
+    iter_begin(g, ITER_PATTERN_EDGES, from, it);
+}
+
+/* Node edges and pattern edges share the walk; only the list differs */
+bool melvin_next_edge(MelvinIter *it, MelvinEdgeInfo *info) {
+    const MelvinGraph *g = it->graph;
+    uint32_t limit;
+    if (it->kind == ITER_EDGES) limit = BYTE_VALUES;
+    else if (it->kind == ITER_PATTERN_EDGES) limit = g->pattern_count;
+    else return false;
+
+    while (it->outer < limit) {
+        const EdgeList *list = (it->kind == ITER_EDGES) ? &g->outgoing[it->outer]
+                                                        : &g->patterns[it->outer].outgoing_patterns;
+        if (it->inner < list->count) {
+            const Edge *e = &list->edges[it->inner++];
+            info->from = it->outer;
+            info->to = e->to_id;
+            info->pattern_edge = e->is_pattern_edge;
+            info->active = e->active;
+            info->weight = e->weight;
+            info->use_count = e->use_count;
+            info->success_count = e->success_count;
+            info->context_node = e->context_node;
+            return true;
+        }
+        if (it->scope != MELVIN_ALL) break;
+        it->outer++;
+        it->inner = 0;
+    }
+    it->outer = limit;
+    return false;
+}
+
+void melvin_iter_predictions(const MelvinGraph *g, uint32_t pattern, MelvinIter *it) {
+    iter_begin(g, ITER_PREDICTIONS, pattern, it);
+}
+
+bool melvin_next_prediction(MelvinIter *it, MelvinPredictionInfo *info) {
+    const MelvinGraph *g = it->graph;
+    if (it->kind != ITER_PREDICTIONS) return false;
+
+    while (it->outer < g->pattern_count) {
+        const Pattern *pat = &g->patterns[it->outer];
+        uint32_t i = it->inner;
+        if (i < pat->prediction_count + pat->pattern_prediction_count) {
+            it->inner++;
+            info->pattern = it->outer;
+            info->pattern_target = i >= pat->prediction_count;
+            if (info->pattern_target) {
+                i -= pat->prediction_count;
+                info->target = pat->predicted_patterns[i];
+                info->weight = pat->pattern_prediction_weights[i];
+            } else {
+                info->target = pat->predicted_nodes[i];
+                info->weight = pat->prediction_weights[i];
+            }
+            return true;
+        }
+        if (it->scope != MELVIN_ALL) break;
+        it->outer++;
+        it->inner = 0;
+    }
+    it->outer = g->pattern_count;
+    return false;
+}
+
 /* ============================================================================
  * MAIN: Input/Output Test - Watch the system learn
  * (Comment out when compiling with test.c)
@@ -0,0 +1,320 @@
+/* ============================================================================
+ * MELVIN O7: Public interface
+ *
+ * Everything a program using the engine may rely on. Link against libmelvin
+ * (./build.sh lib) or compile melvin.c alongside. The brain is an opaque
+ * handle; its layout lives in melvin.c and can change without notice.
+ * Structure is read through the introspection calls below, never by
+ * mirroring the engine's structs.
+ * ============================================================================ */
+
+#ifndef MELVIN_H
+#define MELVIN_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Exported from the shared library (built with -fvisibility=hidden) */
+#if defined(__GNUC__) || defined(__clang__)
+#define MELVIN_API __attribute__((visibility("default")))
+#else
+#define MELVIN_API
+#endif
+
+typedef struct MelvinGraph MelvinGraph;
+
+/* ============================================================================
+ * BRAIN: Create, learn, answer, persist
+ * ============================================================================ */
+
+MELVIN_API MelvinGraph* melvin_create(void);
+MELVIN_API void melvin_destroy(MelvinGraph *g);
+/* Independent copy for a session (see melvin.c CLONING); NULL if out of memory */
+MELVIN_API MelvinGraph* melvin_clone(const MelvinGraph *src);
+MELVIN_API int melvin_save_brain(MelvinGraph *g, const char *filename);
+MELVIN_API MelvinGraph* melvin_load_brain(const char *filename);
+
+/* One input -> output cycle; with a target the brain also learns from it */
+MELVIN_API void run_episode(MelvinGraph *g, const uint8_t *input, uint32_t input_len,
+                            const uint8_t *target, uint32_t target_len);
+/* Output of the last episode; the buffer belongs to the brain */
+MELVIN_API void melvin_get_output(MelvinGraph *g, uint32_t **output, uint32_t *length);
+/* 16-float modality context for the following episodes */
+MELVIN_API void melvin_set_context(MelvinGraph *g, float *context);
+
+/* Receives each output node the moment it is emitted */
+typedef void (*MelvinOutputHook)(void *ctx, uint32_t node_id);
+MELVIN_API void melvin_set_output_hook(MelvinGraph *g, MelvinOutputHook hook, void *ctx);
+
+/* ============================================================================
+ * BUDGET: Limits on the generation loop
+ * ============================================================================ */
+
+/* Why an episode stopped generating */
+typedef enum {
+    MELVIN_STOP_NATURAL,            /* END_MARKER, confidence, energy, target length... */
+    MELVIN_STOP_STEPS,              /* Ran out of propagation steps */
+    MELVIN_STOP_OUTPUT,             /* Budget's output cap reached */
+    MELVIN_STOP_DEADLINE,           /* Budget's time limit passed */
+    MELVIN_STOP_COUNT
+} MelvinStop;
+
+/* Per-call limits on the generation loop - zero fields keep the built-in caps */
+typedef struct {
+    uint32_t max_steps;             /* At most the built-in 200 (1000 with a target) */
+    uint32_t max_output;            /* Nodes emitted */
+    uint64_t time_limit_ns;         /* Measured from the start of the call */
+} MelvinBudget;
+
+MELVIN_API void melvin_set_budget(MelvinGraph *g, const MelvinBudget *budget);
+MELVIN_API MelvinStop melvin_get_stop_reason(const MelvinGraph *g);
+MELVIN_API const char* melvin_stop_name(MelvinStop reason);
+
+/* ============================================================================
+ * SESSIONS: Read-only inference against a shared brain
+ * ============================================================================ */
+
+/* One input in a melvin_infer_batch call */
+typedef struct {
+    const uint8_t *input;
+    uint32_t input_len;
+    uint32_t *output;          /* Filled by melvin_infer_batch (malloc'd, caller frees) */
+    uint32_t output_len;
+    MelvinBudget budget;       /* Zero for the built-in caps */
+    MelvinStop stop;           /* Filled: anything but NATURAL means output is partial */
+} MelvinInferRequest;
+
+/* Transient state for inference against a shared brain */
+typedef struct MelvinSession MelvinSession;
+
+MELVIN_API void melvin_infer_batch(const MelvinGraph *g, MelvinInferRequest *requests, uint32_t count);
+MELVIN_API MelvinSession* melvin_session_create(void);
+MELVIN_API void melvin_session_destroy(MelvinSession *s);
+MELVIN_API bool melvin_session_infer(const MelvinGraph *g, MelvinSession *s,
+                                     const uint8_t *input, uint32_t input_len);
+MELVIN_API void melvin_session_get_output(const MelvinSession *s, uint32_t **output, uint32_t *length);
+MELVIN_API void melvin_session_set_budget(MelvinSession *s, const MelvinBudget *budget);
+MELVIN_API void melvin_session_set_output_hook(MelvinSession *s, MelvinOutputHook hook, void *ctx);
+MELVIN_API MelvinStop melvin_session_get_stop_reason(const MelvinSession *s);
+
+/* ============================================================================
+ * STATISTICS
+ * ============================================================================ */
+
+/* Parts of run_episode timed by the episode counters */
+typedef enum {
+    MELVIN_PHASE_SETUP,             /* Reset, inject input, connect to similar patterns */
+    MELVIN_PHASE_PROPAGATE,         /* System state and coherence propagation, every step */
+    MELVIN_PHASE_EMIT,              /* Output and stop conditions, every step */
+    MELVIN_PHASE_LEARN_SUPERVISED,  /* Learning from the target */
+    MELVIN_PHASE_LEARN_STRUCTURE,   /* Self-supervised learning from the data itself */
+    MELVIN_PHASE_DETECT_PATTERNS,   /* Sequential and positional pattern detection */
+    MELVIN_PHASE_COUNT
+} MelvinPhase;
+
+typedef struct {
+    /* Cumulative since the brain was created (clones start at zero) */
+    uint64_t episodes;
+    uint64_t steps;
+    uint64_t outputs;
+    uint64_t phase_ns[MELVIN_PHASE_COUNT];
+    uint64_t stops[MELVIN_STOP_COUNT];  /* Episodes by how generation ended */
+
+    /* Current structure */
+    uint32_t patterns;
+    uint32_t edges_active;
+    uint32_t edges_tombstoned;      /* Deactivated but still stored */
+    uint32_t pattern_edges;         /* Pattern-to-pattern edges */
+    uint32_t context_classes;       /* Distinct context vectors seen, including none */
+
+    /* Approximate heap use in bytes */
+    uint64_t memory_graph;          /* The MelvinGraph itself (nodes, state) */
+    uint64_t memory_edges;
+    uint64_t memory_patterns;       /* Pattern table and per-pattern arrays */
+    uint64_t memory_pattern_edges;
+    uint64_t memory_buffers;        /* Input, output, contributions, input history */
+} MelvinStats;
+
+/* Counters, structure and memory; walks the whole brain */
+MELVIN_API void melvin_get_stats(const MelvinGraph *g, MelvinStats *stats);
+MELVIN_API const char* melvin_phase_name(MelvinPhase phase);
+MELVIN_API float melvin_get_error_rate(MelvinGraph *g);
+MELVIN_API uint32_t melvin_get_pattern_count(MelvinGraph *g);
+
+/* Self-regulated system state after the last episode */
+typedef struct {
+    float error_rate;               /* Proportion of incorrect predictions */
+    float learning_rate;
+    float learning_pressure;
+    float exploration_pressure;
+    float metabolic_pressure;       /* From graph density */
+    float loop_pressure;            /* From repeated output */
+    float pattern_confidence;
+    float avg_pattern_utility;
+    float context[16];              /* Current modality context */
+    uint32_t context_class;         /* Its interned class; MELVIN_NO_CONTEXT_CLASS past the table */
+    uint64_t step;                  /* Global step counter */
+} MelvinStateInfo;
+
+MELVIN_API void melvin_get_state(const MelvinGraph *g, MelvinStateInfo *state);
+
+/* ============================================================================
+ * PROFILING: Sampled section timings inside run_episode
+ * ============================================================================ */
+
+/* Sections of run_episode timed by the profiler */
+typedef enum {
+    MELVIN_PROF_RESET,              /* Clear activations, contributions and firing state */
+    MELVIN_PROF_INJECT,             /* inject_input and input history */
+    MELVIN_PROF_CONNECT_SIMILAR,    /* connect_to_similar_patterns */
+    MELVIN_PROF_SYSTEM_STATE,       /* compute_system_state (setup and every few steps) */
+    MELVIN_PROF_PROPAGATE,          /* propagate_with_coherence, every step */
+    MELVIN_PROF_EMIT,               /* emit_output and stop conditions, every step */
+    MELVIN_PROF_LEARN_PATTERNS,     /* Input pattern and learn_pattern_predictions */
+    MELVIN_PROF_LEARN_EDGES,        /* Input->target, input and output sequence edges */
+    MELVIN_PROF_FEEDBACK,           /* apply_feedback */
+    MELVIN_PROF_VALIDATE,           /* Hierarchical, co-occurrence and self-consistency checks */
+    MELVIN_PROF_DETECT_SEQUENTIAL,  /* detect_patterns */
+    MELVIN_PROF_DETECT_POSITIONAL,  /* detect_positional_patterns */
+    MELVIN_PROF_LEARN_PARAMETERS,   /* learn_propagation_selection_parameters */
+    MELVIN_PROF_COUNT
+} MelvinProfileSection;
+
+typedef struct {
+    uint64_t calls;
+    uint64_t ns;
+    uint64_t cycles;                /* Time-stamp counter ticks; 0 where there is none */
+} MelvinProfileCounter;
+
+/* Per-section counters over the sampled episodes */
+typedef struct {
+    uint32_t sample_every;          /* Profile one episode in this many; 0 is off */
+    uint64_t episodes_seen;         /* Episodes run while profiling was on */
+    uint64_t episodes_sampled;
+    uint64_t episode_ns;            /* Whole sampled episodes, for the unattributed rest */
+    MelvinProfileCounter sections[MELVIN_PROF_COUNT];
+} MelvinProfile;
+
+MELVIN_API void melvin_set_profiling(MelvinGraph *g, uint32_t sample_every);
+MELVIN_API void melvin_get_profile(const MelvinGraph *g, MelvinProfile *profile);
+MELVIN_API void melvin_reset_profile(MelvinGraph *g);
+MELVIN_API const char* melvin_profile_section_name(MelvinProfileSection section);
+MELVIN_API void melvin_dump_profile(const MelvinProfile *profile, FILE *out);
+
+/* ============================================================================
+ * TRACING AND RECORDING
+ * ============================================================================ */
+
+/* Trace levels; the engine keeps those up to its MELVIN_TRACE_LEVEL build flag */
+#define MELVIN_TRACE_EPISODE 1     /* A few events per episode: learning, feedback */
+#define MELVIN_TRACE_STEP 2        /* Every generation step: propagation, selection */
+#define MELVIN_TRACE_DETAIL 3      /* Per node, edge and pattern inside a step */
+
+MELVIN_API bool melvin_trace_enable(MelvinGraph *g, int level, uint32_t capacity);
+MELVIN_API void melvin_trace_disable(MelvinGraph *g);
+MELVIN_API uint32_t melvin_trace_flush(MelvinGraph *g, FILE *out);
+
+/* Episodes and context changes written for bench/replay */
+MELVIN_API bool melvin_record_start(MelvinGraph *g, const char *path);
+MELVIN_API bool melvin_record_stop(MelvinGraph *g);
+/* Hash of everything learned; equal brains give equal checksums */
+MELVIN_API uint64_t melvin_checksum(const MelvinGraph *g);
+
+/* ============================================================================
+ * INTROSPECTION: Read-only views of patterns, edges and predictions
+ *
+ * Iterators visit items in storage order and allocate nothing, so walking a
+ * large brain costs one call per item. Begin, then call next until it
+ * returns false. Don't run episodes on a brain while iterating it. Pointers
+ * inside an info struct (a pattern's nodes and context) borrow the brain's
+ * memory and are valid until its next episode.
+ * ============================================================================ */
+
+#define MELVIN_BLANK_NODE 256u          /* In a pattern: matches any node */
+#define MELVIN_END_MARKER 257u          /* As a prediction: end of output */
+#define MELVIN_NO_PATTERN 0xFFFFFFFFu   /* Parent of a root pattern */
+#define MELVIN_ALL 0xFFFFFFFFu          /* Iterate every node or pattern */
+#define MELVIN_NO_CONTEXT_CLASS 0xFFFFu /* Context seen after the class table filled */
+
+typedef struct {
+    uint32_t id;
+    const uint32_t *nodes;          /* Sequence; MELVIN_BLANK_NODE matches anything */
+    uint32_t length;
+    bool generalized;               /* At least one blank */
+    float strength;
+    float threshold;
+    float dynamic_importance;
+    uint64_t prediction_attempts;
+    uint64_t prediction_successes;
+    uint32_t prediction_count;      /* Node predictions */
+    uint32_t pattern_prediction_count;
+    uint32_t pattern_edge_count;    /* Outgoing pattern-to-pattern edges */
+    uint32_t chain_depth;           /* 0 for a root */
+    uint32_t parent;                /* MELVIN_NO_PATTERN for a root */
+    float accumulated_meaning;
+    const float *context;           /* 16 floats: context it was learned in */
+    uint32_t context_class;         /* Interned class of context (0 = none), as in MelvinStateInfo */
+} MelvinPatternInfo;
+
+typedef struct {
+    uint32_t from;                  /* Node, or pattern for a pattern edge */
+    uint32_t to;
+    bool pattern_edge;
+    bool active;                    /* False: tombstoned, kept for its history */
+    float weight;
+    uint64_t use_count;
+    uint64_t success_count;
+    uint32_t context_node;          /* Typical predecessor of `from`; 256 for input */
+} MelvinEdgeInfo;
+
+typedef struct {
+    uint32_t pattern;               /* Pattern making the prediction */
+    uint32_t target;                /* Node, or pattern when pattern_target */
+    bool pattern_target;
+    float weight;
+} MelvinPredictionInfo;
+
+/* Iterator position; the fields are private */
+typedef struct {
+    const MelvinGraph *graph;
+    uint32_t kind;
+    uint32_t scope;                 /* Node or pattern, or MELVIN_ALL */
+    uint32_t outer;
+    uint32_t inner;
+} MelvinIter;
+
+/* One pattern by id; false if there is none */
+MELVIN_API bool melvin_pattern_info(const MelvinGraph *g, uint32_t id, MelvinPatternInfo *info);
+
+/* Every pattern */
+MELVIN_API void melvin_iter_patterns(const MelvinGraph *g, MelvinIter *it);
+MELVIN_API bool melvin_next_pattern(MelvinIter *it, MelvinPatternInfo *info);
+
+/* Edges from one node (0-255), or from every node with MELVIN_ALL */
+MELVIN_API void melvin_iter_edges(const MelvinGraph *g, uint32_t from, MelvinIter *it);
+/* Pattern-to-pattern edges from one pattern, or from every pattern */
+MELVIN_API void melvin_iter_pattern_edges(const MelvinGraph *g, uint32_t from, MelvinIter *it);
+MELVIN_API bool melvin_next_edge(MelvinIter *it, MelvinEdgeInfo *info);
+
+/* A pattern's predictions (nodes, then patterns), or every pattern's */
+MELVIN_API void melvin_iter_predictions(const MelvinGraph *g, uint32_t pattern, MelvinIter *it);
+MELVIN_API bool melvin_next_prediction(MelvinIter *it, MelvinPredictionInfo *info);
+
+/* Older single-item getters, kept for existing tests */
+MELVIN_API void melvin_get_pattern_info(MelvinGraph *g, uint32_t pattern_id,
+                                        uint32_t **node_ids, uint32_t *length, float *strength);
+MELVIN_API void melvin_get_pattern_predictions(MelvinGraph *g, uint32_t pattern_id,
+                                               uint32_t **predicted_nodes, float **prediction_weights,
+                                               uint32_t *prediction_count);
+MELVIN_API float melvin_get_edge_weight(MelvinGraph *g, uint32_t from_id, uint32_t to_id);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MELVIN_H */
@@ -0,0 +1,567 @@
+/* ============================================================================
+ * MELVIN DISTILL: Pipelined teacher/student training
+ *
+ * The bridge and trainer wait for each teacher response before training on
+ * it, so Melvin idles while the model generates and the model idles while
+ * Melvin trains. Here a producer thread keeps --inflight requests open over
+ * persistent connections and a trainer thread takes finished responses from
+ * a bounded queue, training on prompt -> response as each arrives.
+ *
+ *   ./melvin_distill                              built-in prompts, local Ollama
+ *   ./melvin_distill --teacher 127.0.0.1:11500    another teacher (or the stub,
+ *                                                 melvin_teacher_stub.c)
+ *   ./melvin_distill --prompts FILE --passes 5    one prompt per line, 5 times
+ *   ./melvin_distill --inflight 8 --queue 32      more requests in flight
+ *   ./melvin_distill --stream                     ask for streamed replies
+ *   ./melvin_distill --brain brain.m              continue brain.m, save it after
+ *   ./melvin_distill --out report.json            machine-readable report
+ *   ./melvin_distill --cache teacher.cache        answer repeated prompts from
+ *                    [--cache-mb 256]             disk, asking the teacher only
+ *                                                 for new ones (capped size)
+ *
+ * Responses are handed to the trainer in prompt order however the teacher
+ * schedules them, so the same responses always give the same brain; a prompt
+ * whose request fails MAX_ATTEMPTS times is skipped and counted. Ctrl+C stops
+ * new requests, trains what is in flight and saves.
+ *
+ * The teacher and trainer rates are reported separately: the trainer's time
+ * starved on an empty queue means the teacher is the bottleneck, the
+ * producer's time blocked on a full queue means Melvin is.
+ * ============================================================================ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include <signal.h>
+#include <pthread.h>
+#include <poll.h>
+#include <sys/types.h>
+
+#include "melvin.h"
+#include "melvin_teacher.h"
+
+#define MAX_ATTEMPTS 3              /* Tries per prompt before it is skipped */
+#define POLL_MS 100
+#define REORDER_WINDOW 4            /* Requests issued ahead of delivery, per slot */
+
+static const char *default_prompts[] = {
+    "Say hello", "What is 2+2?", "Write a simple sentence", "Count to three",
+    "Tell me a fact", "What is a cat?", "Explain patterns", "Give an example",
+    "What is learning?", "Describe the sky", "Name three colors", "What do dogs eat?",
+    "Say hello world", "Why is water wet?", "What is a word?", "Describe intelligence",
+};
+#define DEFAULT_PROMPT_COUNT (sizeof(default_prompts) / sizeof(default_prompts[0]))
+
+static volatile sig_atomic_t stop_requested = 0;
+
+static void on_sigint(int sig) {
+    (void)sig;
+    stop_requested = 1;
+}
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/* ============================================================================
+ * LESSON QUEUE: Bounded, producer -> trainer
+ * ============================================================================ */
+
+typedef struct {
+    const char *prompt;
+    char *response;                 /* Owned by the queue until popped */
+    size_t length;
+} Lesson;
+
+typedef struct {
+    Lesson *items;
+    uint32_t capacity;
+    uint32_t head;
+    uint32_t count;
+    bool closed;
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    uint64_t push_wait_ns;          /* Producer blocked on a full queue */
+    uint64_t pop_wait_ns;           /* Trainer starved on an empty queue */
+} LessonQueue;
+
+static bool queue_init(LessonQueue *q, uint32_t capacity) {
+    memset(q, 0, sizeof(*q));
+    q->items = calloc(capacity, sizeof(Lesson));
+    if (!q->items) return false;
+    q->capacity = capacity;
+    pthread_mutex_init(&q->lock, NULL);
+    pthread_cond_init(&q->not_empty, NULL);
+    pthread_cond_init(&q->not_full, NULL);
+    return true;
+}
+
+static void queue_free(LessonQueue *q) {
+    for (uint32_t i = 0; i < q->count; i++) free(q->items[(q->head + i) % q->capacity].response);
+    free(q->items);
+    pthread_mutex_destroy(&q->lock);
+    pthread_cond_destroy(&q->not_empty);
+    pthread_cond_destroy(&q->not_full);
+}
+
+static void queue_push(LessonQueue *q, Lesson lesson) {
+    pthread_mutex_lock(&q->lock);
+    if (q->count == q->capacity) {
+        uint64_t start = now_ns();
+        while (q->count == q->capacity) pthread_cond_wait(&q->not_full, &q->lock);
+        q->push_wait_ns += now_ns() - start;
+    }
+    q->items[(q->head + q->count) % q->capacity] = lesson;
+    q->count++;
+    pthread_cond_signal(&q->not_empty);
+    pthread_mutex_unlock(&q->lock);
+}
+
+/* False once the queue is closed and empty */
+static bool queue_pop(LessonQueue *q, Lesson *out) {
+    pthread_mutex_lock(&q->lock);
+    if (q->count == 0 && !q->closed) {
+        uint64_t start = now_ns();
+        while (q->count == 0 && !q->closed) pthread_cond_wait(&q->not_empty, &q->lock);
+        q->pop_wait_ns += now_ns() - start;
+    }
+    bool got = q->count > 0;
+    if (got) {
+        *out = q->items[q->head];
+        q->head = (q->head + 1) % q->capacity;
+        q->count--;
+        pthread_cond_signal(&q->not_full);
+    }
+    pthread_mutex_unlock(&q->lock);
+    return got;
+}
+
+static void queue_close(LessonQueue *q) {
+    pthread_mutex_lock(&q->lock);
+    q->closed = true;
+    pthread_cond_broadcast(&q->not_empty);
+    pthread_mutex_unlock(&q->lock);
+}
+
+/* ============================================================================
+ * PRODUCER: N requests in flight, delivered in prompt order
+ * ============================================================================ */
+
+typedef struct {
+    TeacherConn *conn;
+    int64_t job;                    /* -1: free */
+    uint32_t attempts;
+    uint64_t sent_ns;
+} Slot;
+
+typedef struct {
+    /* Settings */
+    TeacherConfig cfg;
+    const char **prompts;
+    uint32_t prompt_count;
+    uint32_t jobs;                  /* prompt_count * passes; job i asks prompts[i % count] */
+    uint32_t inflight;
+    bool quiet;
+    LessonQueue *queue;
+    TeacherCache *cache;            /* NULL: always ask the teacher */
+
+    /* Responses waiting for the ones before them */
+    char **ready;
+    size_t *ready_len;
+    bool *finished;
+
+    /* Results */
+    uint64_t start_ns;
+    uint64_t end_ns;
+    uint32_t issued;
+    uint32_t responses;
+    uint32_t failed;
+    uint32_t retries;
+    uint32_t connects;
+    uint64_t bytes;
+    uint64_t cached_bytes;
+    bool cache_failed;
+    double *latency_ms;             /* One per response */
+} Producer;
+
+static bool answer_from_cache(Producer *p, uint32_t job) {
+    if (!p->cache) return false;
+    size_t len;
+    char *text = teacher_cache_get(p->cache, p->cfg.model, p->prompts[job % p->prompt_count], &len);
+    if (!text) return false;
+    p->ready[job] = text;
+    p->ready_len[job] = len;
+    p->finished[job] = true;
+    p->cached_bytes += len;
+    return true;
+}
+
+static void send_job(Producer *p, Slot *s) {
+    s->attempts++;
+    s->sent_ns = now_ns();
+    teacher_send(s->conn, p->prompts[s->job % p->prompt_count]);
+}
+
+/* Handles a finished or failed request; retries go out immediately */
+static void settle(Producer *p, Slot *s) {
+    for (;;) {
+        TeacherState state = teacher_state(s->conn);
+        if (state == TEACHER_DONE) {
+            size_t len;
+            char *text = teacher_take_response(s->conn, &len);
+            p->latency_ms[p->responses++] = (double)(now_ns() - s->sent_ns) / 1e6;
+            p->bytes += len;
+            if (p->cache && !teacher_cache_put(p->cache, p->cfg.model, p->prompts[s->job % p->prompt_count],
+                                               text, len) && !p->cache_failed) {
+                fprintf(stderr, "teacher cache: could not store a response, continuing without\n");
+                p->cache_failed = true;
+            }
+            p->ready[s->job] = text;
+            p->ready_len[s->job] = len;
+            p->finished[s->job] = true;
+            s->job = -1;
+            return;
+        }
+        if (state != TEACHER_FAILED) return;
+        if (s->attempts >= MAX_ATTEMPTS || stop_requested) {
+            fprintf(stderr, "teacher: giving up on \"%s\": %s\n",
+                    p->prompts[s->job % p->prompt_count], teacher_error(s->conn));
+            p->failed++;
+            p->finished[s->job] = true;
+            s->job = -1;
+            return;
+        }
+        p->retries++;
+        send_job(p, s);
+    }
+}
+
+static void* producer_run(void *arg) {
+    Producer *p = arg;
+    Slot *slots = calloc(p->inflight, sizeof(Slot));
+    struct pollfd *fds = calloc(p->inflight, sizeof(struct pollfd));
+    uint32_t *polled = calloc(p->inflight, sizeof(uint32_t));
+    for (uint32_t i = 0; i < p->inflight; i++) {
+        slots[i].conn = teacher_open(&p->cfg);
+        slots[i].job = -1;
+    }
+
+    p->start_ns = now_ns();
+    uint32_t delivered = 0;
+    uint32_t window = p->inflight * REORDER_WINDOW;
+    for (;;) {
+        /* Fill free slots, staying within the reorder window; cached
+         * prompts are answered on the spot and take no slot */
+        for (uint32_t i = 0; i < p->inflight; i++) {
+            while (slots[i].job < 0 && !stop_requested && p->issued < p->jobs &&
+                   p->issued - delivered < window) {
+                uint32_t job = p->issued++;
+                if (answer_from_cache(p, job)) continue;
+                slots[i].job = job;
+                slots[i].attempts = 0;
+                send_job(p, &slots[i]);
+                settle(p, &slots[i]);
+            }
+        }
+
+        /* Hand over everything that is next in order */
+        while (delivered < p->issued && p->finished[delivered]) {
+            if (p->ready[delivered]) {
+                Lesson lesson = {p->prompts[delivered % p->prompt_count],
+                                 p->ready[delivered], p->ready_len[delivered]};
+                p->ready[delivered] = NULL;
+                queue_push(p->queue, lesson);
+            }
+            delivered++;
+        }
+
+        uint32_t nfds = 0;
+        for (uint32_t i = 0; i < p->inflight; i++) {
+            if (slots[i].job >= 0 && teacher_state(slots[i].conn) == TEACHER_PENDING) {
+                fds[nfds].fd = teacher_fd(slots[i].conn);
+                fds[nfds].events = POLLIN;
+                fds[nfds].revents = 0;
+                polled[nfds++] = i;
+            }
+        }
+        if (nfds == 0) {
+            if (delivered == p->jobs || (stop_requested && delivered == p->issued)) break;
+            continue;
+        }
+        if (poll(fds, nfds, POLL_MS) <= 0) continue;
+        for (uint32_t k = 0; k < nfds; k++) {
+            if (!fds[k].revents) continue;
+            Slot *s = &slots[polled[k]];
+            teacher_read(s->conn);
+            settle(p, s);
+        }
+    }
+    p->end_ns = now_ns();
+
+    for (uint32_t i = 0; i < p->inflight; i++) {
+        p->connects += teacher_connects(slots[i].conn);
+        teacher_close(slots[i].conn);
+    }
+    free(polled);
+    free(fds);
+    free(slots);
+    queue_close(p->queue);
+    return NULL;
+}
+
+/* ============================================================================
+ * TRAINER: prompt -> response episodes as lessons arrive
+ * ============================================================================ */
+
+typedef struct {
+    MelvinGraph *g;
+    LessonQueue *queue;
+    bool quiet;
+    uint32_t episodes;
+    uint64_t bytes;
+    uint64_t busy_ns;
+} Trainer;
+
+static void* trainer_run(void *arg) {
+    Trainer *t = arg;
+    Lesson lesson;
+    while (queue_pop(t->queue, &lesson)) {
+        uint64_t start = now_ns();
+        run_episode(t->g, (const uint8_t*)lesson.prompt, (uint32_t)strlen(lesson.prompt),
+                    (const uint8_t*)lesson.response, (uint32_t)lesson.length);
+        t->busy_ns += now_ns() - start;
+        t->episodes++;
+        t->bytes += lesson.length;
+        if (!t->quiet) {
+            printf("[%u] %s -> %.60s%s\n", t->episodes, lesson.prompt, lesson.response,
+                   lesson.length > 60 ? "..." : "");
+        }
+        free(lesson.response);
+    }
+    return NULL;
+}
+
+/* ============================================================================
+ * REPORT
+ * ============================================================================ */
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+/* Latencies must be sorted */
+static double percentile(const double *sorted, uint32_t n, double pct) {
+    if (n == 0) return 0.0;
+    return sorted[(uint32_t)((n - 1) * pct / 100.0 + 0.5)];
+}
+
+static const char **read_prompts(const char *path, uint32_t *count) {
+    FILE *f = fopen(path, "r");
+    if (!f) return NULL;
+    const char **prompts = NULL;
+    uint32_t n = 0, cap = 0;
+    char *line = NULL;
+    size_t line_cap = 0;
+    ssize_t len;
+    while ((len = getline(&line, &line_cap, f)) > 0) {
+        while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) line[--len] = '\0';
+        if (len == 0) continue;
+        if (n == cap) {
+            cap = cap ? cap * 2 : 64;
+            const char **grown = realloc(prompts, cap * sizeof(char*));
+            if (!grown) break;
+            prompts = grown;
+        }
+        prompts[n++] = strdup(line);
+    }
+    free(line);
+    fclose(f);
+    *count = n;
+    return prompts;
+}
+
+static void usage(const char *argv0) {
+    fprintf(stderr,
+            "usage: %s [--teacher HOST:PORT] [--model NAME] [--prompts FILE] [--passes N]\n"
+            "          [--inflight N] [--queue N] [--stream] [--cache FILE] [--cache-mb N]\n"
+            "          [--brain FILE] [--out FILE] [--quiet]\n", argv0);
+}
+
+int main(int argc, char **argv) {
+    Producer p;
+    memset(&p, 0, sizeof(p));
+    teacher_config_init(&p.cfg);
+    const char *prompts_path = NULL, *brain_path = NULL, *out_path = NULL, *cache_path = NULL;
+    uint32_t passes = 1, queue_capacity = 16;
+    double cache_mb = 256.0;
+    p.inflight = 4;
+
+    for (int i = 1; i < argc; i++) {
+        const char *value = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (strcmp(argv[i], "--teacher") == 0 && value) {
+            if (!teacher_config_set_address(&p.cfg, argv[++i])) {
+                fprintf(stderr, "bad teacher address: %s\n", argv[i]);
+                return 2;
+            }
+        }
+        else if (strcmp(argv[i], "--model") == 0 && value) snprintf(p.cfg.model, sizeof(p.cfg.model), "%s", argv[++i]);
+        else if (strcmp(argv[i], "--prompts") == 0 && value) prompts_path = argv[++i];
+        else if (strcmp(argv[i], "--passes") == 0 && value) passes = (uint32_t)atoi(argv[++i]);
+        else if (strcmp(argv[i], "--inflight") == 0 && value) p.inflight = (uint32_t)atoi(argv[++i]);
+        else if (strcmp(argv[i], "--queue") == 0 && value) queue_capacity = (uint32_t)atoi(argv[++i]);
+        else if (strcmp(argv[i], "--brain") == 0 && value) brain_path = argv[++i];
+        else if (strcmp(argv[i], "--out") == 0 && value) out_path = argv[++i];
+        else if (strcmp(argv[i], "--cache") == 0 && value) cache_path = argv[++i];
+        else if (strcmp(argv[i], "--cache-mb") == 0 && value) cache_mb = atof(argv[++i]);
+        else if (strcmp(argv[i], "--stream") == 0) p.cfg.stream = true;
+        else if (strcmp(argv[i], "--quiet") == 0) p.quiet = true;
+        else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+    if (passes == 0 || p.inflight == 0 || queue_capacity == 0 || cache_mb < 0) {
+        usage(argv[0]);
+        return 2;
+    }
+
+    if (prompts_path) {
+        p.prompts = read_prompts(prompts_path, &p.prompt_count);
+        if (!p.prompts || p.prompt_count == 0) {
+            fprintf(stderr, "no prompts in %s\n", prompts_path);
+            return 2;
+        }
+    } else {
+        p.prompts = default_prompts;
+        p.prompt_count = DEFAULT_PROMPT_COUNT;
+    }
+    p.jobs = p.prompt_count * passes;
+    p.ready = calloc(p.jobs, sizeof(char*));
+    p.ready_len = calloc(p.jobs, sizeof(size_t));
+    p.finished = calloc(p.jobs, sizeof(bool));
+    p.latency_ms = calloc(p.jobs, sizeof(double));
+
+    MelvinGraph *g = brain_path ? melvin_load_brain(brain_path) : NULL;
+    bool continued = g != NULL;
+    if (!g) g = melvin_create();
+    if (!g || !p.ready || !p.ready_len || !p.finished || !p.latency_ms) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    LessonQueue queue;
+    if (!queue_init(&queue, queue_capacity)) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    p.queue = &queue;
+    if (cache_path) {
+        p.cache = teacher_cache_open(cache_path, (uint64_t)(cache_mb * 1024 * 1024));
+        if (!p.cache) {
+            fprintf(stderr, "cannot use %s as a teacher cache\n", cache_path);
+            return 2;
+        }
+    }
+    Trainer t = {g, &queue, p.quiet, 0, 0, 0};
+
+    printf("Distilling from %s at %s:%d: %u prompts x %u passes, %u in flight, queue %u%s\n",
+           p.cfg.model, p.cfg.host, p.cfg.port, p.prompt_count, passes, p.inflight, queue_capacity,
+           continued ? " (continuing brain)" : "");
+    fflush(stdout);
+
+    signal(SIGINT, on_sigint);
+    signal(SIGPIPE, SIG_IGN);
+    uint64_t wall_start = now_ns();
+    pthread_t producer_thread, trainer_thread;
+    pthread_create(&trainer_thread, NULL, trainer_run, &t);
+    pthread_create(&producer_thread, NULL, producer_run, &p);
+    pthread_join(producer_thread, NULL);
+    pthread_join(trainer_thread, NULL);
+    double wall = (double)(now_ns() - wall_start) / 1e9;
+
+    if (brain_path && melvin_save_brain(g, brain_path) != 0) {
+        fprintf(stderr, "could not save %s\n", brain_path);
+    }
+
+    /* Report */
+    double teacher_s = (double)(p.end_ns - p.start_ns) / 1e9;
+    double busy_s = (double)t.busy_ns / 1e9;
+    double starved_s = (double)queue.pop_wait_ns / 1e9;
+    double blocked_s = (double)queue.push_wait_ns / 1e9;
+    qsort(p.latency_ms, p.responses, sizeof(double), compare_double);
+    double p50 = percentile(p.latency_ms, p.responses, 50);
+    double p95 = percentile(p.latency_ms, p.responses, 95);
+    double p99 = percentile(p.latency_ms, p.responses, 99);
+    const char *bottleneck = starved_s > 0.5 * wall ? "teacher" : blocked_s > 0.5 * wall ? "trainer" : "balanced";
+    uint64_t checksum = melvin_checksum(g);
+
+    printf("\nTeacher:  %u responses in %.2f s = %.1f responses/s, %.1f KB/s\n",
+           p.responses, teacher_s, teacher_s > 0 ? p.responses / teacher_s : 0.0,
+           teacher_s > 0 ? p.bytes / 1024.0 / teacher_s : 0.0);
+    printf("          latency p50 %.1f ms, p95 %.1f ms, p99 %.1f ms\n", p50, p95, p99);
+    printf("          %u connections, %u retries, %u failed%s\n", p.connects, p.retries, p.failed,
+           stop_requested ? ", interrupted" : "");
+    TeacherCacheStats cache;
+    memset(&cache, 0, sizeof(cache));
+    if (p.cache) {
+        teacher_cache_stats(p.cache, &cache);
+        printf("Cache:    %llu hits (%.1f KB), %llu misses; %u entries, %.1f KB on disk, %llu evicted\n",
+               (unsigned long long)cache.hits, p.cached_bytes / 1024.0, (unsigned long long)cache.misses,
+               cache.entries, cache.file_bytes / 1024.0, (unsigned long long)cache.evicted);
+    }
+    printf("Trainer:  %u episodes in %.2f s busy = %.1f episodes/s, starved %.2f s\n",
+           t.episodes, busy_s, busy_s > 0 ? t.episodes / busy_s : 0.0, starved_s);
+    printf("Pipeline: %.2f s wall, producer blocked %.2f s on a full queue, bottleneck: %s\n",
+           wall, blocked_s, bottleneck);
+    printf("Brain:    checksum %016llx%s%s\n", (unsigned long long)checksum,
+           brain_path ? ", saved to " : "", brain_path ? brain_path : "");
+
+    if (out_path) {
+        FILE *f = fopen(out_path, "w");
+        if (!f) {
+            fprintf(stderr, "cannot write %s\n", out_path);
+        } else {
+            fprintf(f, "{\n");
+            fprintf(f, "  \"prompts\": %u, \"passes\": %u, \"inflight\": %u, \"queue\": %u,\n",
+                    p.prompt_count, passes, p.inflight, queue_capacity);
+            fprintf(f, "  \"teacher\": {\"responses\": %u, \"failed\": %u, \"retries\": %u, "
+                       "\"connections\": %u, \"seconds\": %.4f, \"responses_per_sec\": %.2f, "
+                       "\"bytes\": %llu, \"latency_p50_ms\": %.2f, \"latency_p95_ms\": %.2f, "
+                       "\"latency_p99_ms\": %.2f},\n",
+                    p.responses, p.failed, p.retries, p.connects, teacher_s,
+                    teacher_s > 0 ? p.responses / teacher_s : 0.0, (unsigned long long)p.bytes, p50, p95, p99);
+            fprintf(f, "  \"cache\": {\"enabled\": %s, \"hits\": %llu, \"misses\": %llu, "
+                       "\"hit_bytes\": %llu, \"entries\": %u, \"file_bytes\": %llu, \"evicted\": %llu},\n",
+                    p.cache ? "true" : "false", (unsigned long long)cache.hits, (unsigned long long)cache.misses,
+                    (unsigned long long)p.cached_bytes, cache.entries, (unsigned long long)cache.file_bytes,
+                    (unsigned long long)cache.evicted);
+            fprintf(f, "  \"trainer\": {\"episodes\": %u, \"busy_seconds\": %.4f, "
+                       "\"episodes_per_sec\": %.2f, \"starved_seconds\": %.4f},\n",
+                    t.episodes, busy_s, busy_s > 0 ? t.episodes / busy_s : 0.0, starved_s);
+            fprintf(f, "  \"producer_blocked_seconds\": %.4f, \"wall_seconds\": %.4f, "
+                       "\"bottleneck\": \"%s\", \"interrupted\": %s,\n",
+                    blocked_s, wall, bottleneck, stop_requested ? "true" : "false");
+            fprintf(f, "  \"checksum\": \"%016llx\"\n}\n", (unsigned long long)checksum);
+            fclose(f);
+        }
+    }
+
+    queue_free(&queue);
+    teacher_cache_close(p.cache);
+    melvin_destroy(g);
+    for (uint32_t i = 0; i < p.jobs; i++) free(p.ready[i]);
+    free(p.ready);
+    free(p.ready_len);
+    free(p.finished);
+    free(p.latency_ms);
+    return p.failed == 0 ? 0 : 1;
+}
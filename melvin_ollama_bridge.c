@@ -5,8 +5,17 @@
  * - Melvin output → Ollama input
  * 
  * No changes to either system - just a pipe/bridge
+ *
+ * Talks to the teacher through melvin_teacher.c over one keep-alive
+ * connection, with replies streamed so they show as they are generated.
+ *   OLLAMA_HOST=host:port, OLLAMA_MODEL=name   pick the teacher
+ *   MELVIN_STREAM_TRAIN=1                      train on each sentence of the
+ *                                              feedback as it arrives
+ *   MELVIN_TEACHER_CACHE=file                  answer prompts seen before from
+ *   MELVIN_TEACHER_CACHE_MB=256                disk (see teacher_cache_open)
  */
 
+#define _POSIX_C_SOURCE 199309L  /* nanosleep */
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -14,29 +23,15 @@
 #include <stdbool.h>
 
 #ifdef _WIN32
-#include <winsock2.h>
-#include <ws2tcpip.h>
 #include <windows.h>
-#pragma comment(lib, "ws2_32.lib")
 #else
-#include <sys/socket.h>
-#include <netinet/in.h>
-#include <arpa/inet.h>
 #include <unistd.h>
 #include <signal.h>
+#include <time.h>
 #endif
 
-/* Forward declarations for Melvin functions */
-typedef struct MelvinGraph MelvinGraph;
-
-extern MelvinGraph* melvin_create(void);
-extern void melvin_destroy(MelvinGraph *g);
-extern MelvinGraph* melvin_load_brain(const char *filename);
-extern int melvin_save_brain(MelvinGraph *g, const char *filename);
-extern void inject_input_from_port(MelvinGraph *g, const uint8_t *bytes, uint32_t length, uint32_t port_id);
-extern void run_episode(MelvinGraph *g, const uint8_t *input, uint32_t input_len,
-                       const uint8_t *target, uint32_t target_len);
-extern void melvin_get_output(MelvinGraph *g, uint32_t **output, uint32_t *length);
+#include "melvin.h"
+#include "melvin_teacher.h"
 
 /* Global for signal handler */
 #ifndef _WIN32
@@ -67,149 +62,106 @@ void signal_handler(int sig) {
 }
 #endif
 
-#define OLLAMA_HOST "localhost"
-#define OLLAMA_PORT 11434
-#define BUFFER_SIZE 4096
+/* Keep-alive connection to the teacher, reused every round */
+static TeacherConn *teacher = NULL;
+static TeacherCache *teacher_cache = NULL;
+static const char *teacher_model = NULL;
 
-/* Simple HTTP POST to Ollama API */
-char* ollama_generate(const char *prompt) {
-    /* Build JSON body (escape quotes in prompt) */
-    char json_body[4096];
-    char escaped_prompt[2048];
-    int j = 0;
-    for (int i = 0; prompt[i] && j < sizeof(escaped_prompt) - 1; i++) {
-        if (prompt[i] == '"') {
-            escaped_prompt[j++] = '\\';
-            escaped_prompt[j++] = '"';
-        } else if (prompt[i] == '\\') {
-            escaped_prompt[j++] = '\\';
-            escaped_prompt[j++] = '\\';
-        } else if (prompt[i] == '\n') {
-            escaped_prompt[j++] = '\\';
-            escaped_prompt[j++] = 'n';
-        } else {
-            escaped_prompt[j++] = prompt[i];
-        }
-    }
-    escaped_prompt[j] = '\0';
-    
-    snprintf(json_body, sizeof(json_body),
-        "{\"model\":\"llama3.2\",\"prompt\":\"%s\",\"stream\":false}",
-        escaped_prompt);
-    
-    size_t json_len = strlen(json_body);
-    
-    char request[8192];
-    snprintf(request, sizeof(request),
-        "POST /api/generate HTTP/1.1\r\n"
-        "Host: %s:%d\r\n"
-        "Content-Type: application/json\r\n"
-        "Content-Length: %zu\r\n"
-        "\r\n"
-        "%s",
-        OLLAMA_HOST, OLLAMA_PORT,
-        json_len,
-        json_body);
-    
-    char response[32768] = {0};
-    
-#ifdef _WIN32
-    WSADATA wsa;
-    if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) {
-        return NULL;
-    }
-    
-    SOCKET sock = socket(AF_INET, SOCK_STREAM, 0);
-    if (sock == INVALID_SOCKET) {
-        WSACleanup();
-        return NULL;
-    }
-    
-    struct sockaddr_in server;
-    server.sin_family = AF_INET;
-    server.sin_port = htons(OLLAMA_PORT);
-    inet_pton(AF_INET, "127.0.0.1", &server.sin_addr);
-    
-    if (connect(sock, (struct sockaddr*)&server, sizeof(server)) == SOCKET_ERROR) {
-        closesocket(sock);
-        WSACleanup();
-        return NULL;
-    }
-    
-    send(sock, request, (int)strlen(request), 0);
-    int bytes_received = recv(sock, response, sizeof(response) - 1, 0);
-    closesocket(sock);
-    WSACleanup();
-    
-    if (bytes_received <= 0) {
-        return NULL;
-    }
-    response[bytes_received] = '\0';
-#else
-    int sock = socket(AF_INET, SOCK_STREAM, 0);
-    if (sock < 0) return NULL;
-    
-    struct sockaddr_in server;
-    server.sin_family = AF_INET;
-    server.sin_port = htons(OLLAMA_PORT);
-    inet_pton(AF_INET, "127.0.0.1", &server.sin_addr);
-    
-    if (connect(sock, (struct sockaddr*)&server, sizeof(server)) < 0) {
-        close(sock);
-        return NULL;
-    }
-    
-    send(sock, request, strlen(request), 0);
-    int bytes_received = recv(sock, response, sizeof(response) - 1, 0);
-    close(sock);
-    
-    if (bytes_received <= 0) {
-        return NULL;
-    }
-    response[bytes_received] = '\0';
-#endif
-    
-    /* Extract JSON response (simple parsing - find "response":"..." ) */
-    char *response_start = strstr(response, "\"response\":\"");
-    if (!response_start) {
-        return NULL;
+typedef void (*TextFn)(const char *text, size_t len, void *user);
+
+/* Asks the teacher and reads the streamed reply: prints label and the first
+ * preview bytes as they arrive, and passes every piece to on_text (if set).
+ * Returns the whole reply (caller frees) or NULL. */
+static char* ollama_generate(const char *prompt, const char *label, size_t preview,
+                             TextFn on_text, void *user) {
+    size_t cached_len;
+    char *cached = teacher_cache ? teacher_cache_get(teacher_cache, teacher_model, prompt, &cached_len) : NULL;
+    if (cached) {
+        printf("%s%.*s%s (cached)\n", label, (int)(cached_len < preview ? cached_len : preview), cached,
+               cached_len > preview ? "..." : "");
+        if (on_text) on_text(cached, cached_len, user);
+        return cached;
     }
-    
-    response_start += 12;  /* Skip "response":" */
-    char *response_end = strchr(response_start, '"');
-    if (!response_end) {
-        return NULL;
+    if (!teacher_send(teacher, prompt)) return NULL;
+    size_t total = 0;
+    TeacherState state;
+    do {
+        state = teacher_read(teacher);
+        size_t len;
+        const char *text = teacher_partial(teacher, &len);
+        if (len == 0) continue;
+        if (total == 0) printf("%s", label);
+        if (total < preview) {
+            size_t show = len < preview - total ? len : preview - total;
+            fwrite(text, 1, show, stdout);
+            fflush(stdout);
+        }
+        total += len;
+        if (on_text) on_text(text, len, user);
+    } while (state == TEACHER_PENDING);
+    if (state != TEACHER_DONE) return NULL;
+    printf("%s\n", total > preview ? "..." : "");
+    size_t len;
+    char *reply = teacher_take_response(teacher, &len);
+    if (teacher_cache) teacher_cache_put(teacher_cache, teacher_model, prompt, reply, len);
+    return reply;
+}
+
+/* With MELVIN_STREAM_TRAIN=1 each sentence of the teacher's feedback trains
+ * Melvin as soon as it arrives, instead of the whole reply once it is done */
+typedef struct {
+    MelvinGraph *g;
+    const uint8_t *input;
+    uint32_t input_len;
+    char *pending;                  /* Text since the last sentence end */
+    size_t len;
+    size_t cap;
+    uint32_t episodes;
+} SentenceTrainer;
+
+static void train_sentences(const char *text, size_t len, void *user) {
+    SentenceTrainer *t = user;
+    if (t->len + len > t->cap) {
+        size_t cap = t->cap ? t->cap : 256;
+        while (cap < t->len + len) cap *= 2;
+        char *grown = realloc(t->pending, cap);
+        if (!grown) return;
+        t->pending = grown;
+        t->cap = cap;
     }
-    
-    size_t len = response_end - response_start;
-    char *result = malloc(len + 1);
-    if (!result) return NULL;
-    
-    memcpy(result, response_start, len);
-    result[len] = '\0';
-    
-    /* Unescape JSON strings (\n, \", etc.) */
-    char *out = result;
-    for (const char *in = result; *in; in++) {
-        if (*in == '\\' && in[1] == 'n') {
-            *out++ = '\n';
-            in++;
-        } else if (*in == '\\' && in[1] == '"') {
-            *out++ = '"';
-            in++;
-        } else {
-            *out++ = *in;
+    memcpy(t->pending + t->len, text, len);
+    t->len += len;
+
+    size_t start = 0;
+    for (size_t i = 0; i < t->len; i++) {
+        char c = t->pending[i];
+        if (c != '.' && c != '!' && c != '?' && c != '\n') continue;
+        if (i + 1 > start) {
+            run_episode(t->g, t->input, t->input_len,
+                        (const uint8_t*)t->pending + start, (uint32_t)(i + 1 - start));
+            t->episodes++;
         }
+        start = i + 1;
     }
-    *out = '\0';
-    
-    return result;
+    memmove(t->pending, t->pending + start, t->len - start);
+    t->len -= start;
 }
 
 int main(void) {
     printf("=================================================================\n");
     printf("Melvin-Ollama Bridge\n");
-    printf("Connecting: Ollama (llama3.2) <-> Melvin o7\n");
+
+    /* OLLAMA_HOST and OLLAMA_MODEL pick the teacher; replies are streamed */
+    TeacherConfig teacher_cfg;
+    teacher_config_init(&teacher_cfg);
+    teacher_cfg.stream = true;
+    teacher = teacher_open(&teacher_cfg);
+    teacher_model = teacher_cfg.model;
+    teacher_cache = teacher_cache_from_env();
+    const char *stream_train = getenv("MELVIN_STREAM_TRAIN");
+    bool train_as_streamed = stream_train && strcmp(stream_train, "1") == 0;
+    printf("Connecting: Ollama (%s at %s:%d) <-> Melvin o7\n",
+           teacher_cfg.model, teacher_cfg.host, teacher_cfg.port);
     printf("=================================================================\n\n");
     
     /* Set up signal handler for graceful shutdown */
@@ -276,19 +228,13 @@ int main(void) {
         /* Step 1: Send to Ollama, get output */
         printf("  [Ollama] Processing... ");
         fflush(stdout);
-        char *ollama_output = ollama_generate(input);
+        char *ollama_output = ollama_generate(input, "Output: ", 100, NULL, NULL);
         if (!ollama_output) {
-            printf("ERROR: Failed to get response from Ollama\n");
+            printf("ERROR: Failed to get response from Ollama (%s)\n", teacher_error(teacher));
             fflush(stdout);
             continue;
         }
         
-        /* Show first 100 chars of Ollama output */
-        int output_preview_len = strlen(ollama_output);
-        if (output_preview_len > 100) output_preview_len = 100;
-        printf("Output: %.100s%s\n", ollama_output, (strlen(ollama_output) > 100) ? "..." : "");
-        fflush(stdout);
-        
         /* Step 2: Feed Ollama output to Melvin (as byte input) */
         printf("  [Melvin] Processing (%u bytes)... ", (unsigned int)strlen(ollama_output));
         fflush(stdout);
@@ -340,13 +286,19 @@ int main(void) {
             
             printf("  [Ollama] Receiving Melvin output... ");
             fflush(stdout);
-            char *ollama_response = ollama_generate(melvin_str);
-            if (ollama_response) {
-                int response_preview = strlen(ollama_response);
-                if (response_preview > 80) response_preview = 80;
-                printf("Response: %.80s%s\n", ollama_response, (strlen(ollama_response) > 80) ? "..." : "");
+            SentenceTrainer sentences = {g, bytes, len, NULL, 0, 0, 0};
+            char *ollama_response = ollama_generate(melvin_str, "Response: ", 80,
+                                                    train_as_streamed ? train_sentences : NULL, &sentences);
+            if (ollama_response && train_as_streamed) {
+                /* Whatever followed the last sentence end */
+                if (sentences.len > 0) {
+                    run_episode(g, bytes, len, (const uint8_t*)sentences.pending, (uint32_t)sentences.len);
+                    sentences.episodes++;
+                }
+                printf("  [Melvin] Trained on %u sentences as they arrived\n", sentences.episodes);
                 fflush(stdout);
-                
+                free(ollama_response);
+            } else if (ollama_response) {
                 /* CRITICAL: Use Ollama's response as training target for Melvin */
                 /* This is how Melvin learns from Ollama's feedback */
                 printf("  [Melvin] Training on Ollama feedback... ");
@@ -363,9 +315,10 @@ int main(void) {
                 
                 free(ollama_response);
             } else {
-                printf("No response\n");
+                printf("No response (%s)\n", teacher_error(teacher));
                 fflush(stdout);
             }
+            free(sentences.pending);
         }
         
         free(ollama_output);
@@ -381,7 +334,8 @@ int main(void) {
         #ifdef _WIN32
         Sleep(500);  /* 0.5 second */
         #else
-        usleep(500000);  /* 0.5 second */
+        struct timespec delay = {0, 500000000L};  /* 0.5 second */
+        nanosleep(&delay, NULL);
         #endif
     }
     
@@ -389,6 +343,8 @@ int main(void) {
     melvin_save_brain(g, "melvin_brain.m");
     printf("\n[Final] Brain saved. Exiting.\n");
     melvin_destroy(g);
+    teacher_close(teacher);
+    teacher_cache_close(teacher_cache);
     
     return 0;
     
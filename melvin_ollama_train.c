@@ -12,171 +12,34 @@
 #include <time.h>
 
 #ifdef _WIN32
-#include <winsock2.h>
-#include <ws2tcpip.h>
-#pragma comment(lib, "ws2_32.lib")
+#include <windows.h>
 #else
-#include <sys/socket.h>
-#include <netinet/in.h>
-#include <arpa/inet.h>
 #include <unistd.h>
 #endif
 
-/* Forward declarations for Melvin functions */
-typedef struct MelvinGraph MelvinGraph;
+#include "melvin.h"
+#include "melvin_teacher.h"
 
-extern MelvinGraph* melvin_create(void);
-extern void melvin_destroy(MelvinGraph *g);
-extern MelvinGraph* melvin_load_brain(const char *filename);
-extern int melvin_save_brain(MelvinGraph *g, const char *filename);
-extern void inject_input_from_port(MelvinGraph *g, const uint8_t *bytes, uint32_t length, uint32_t port_id);
-extern void run_episode(MelvinGraph *g, const uint8_t *input, uint32_t input_len,
-                       const uint8_t *target, uint32_t target_len);
-extern void melvin_get_output(MelvinGraph *g, uint32_t **output, uint32_t *length);
-
-#define OLLAMA_HOST "localhost"
-#define OLLAMA_PORT 11434
-#define BUFFER_SIZE 4096
-
-/* Simple HTTP POST to Ollama API */
-char* ollama_generate(const char *prompt) {
-    /* Build JSON body (escape quotes in prompt) */
-    char json_body[4096];
-    char escaped_prompt[2048];
-    int j = 0;
-    for (int i = 0; prompt[i] && j < sizeof(escaped_prompt) - 1; i++) {
-        if (prompt[i] == '"') {
-            escaped_prompt[j++] = '\\';
-            escaped_prompt[j++] = '"';
-        } else if (prompt[i] == '\\') {
-            escaped_prompt[j++] = '\\';
-            escaped_prompt[j++] = '\\';
-        } else if (prompt[i] == '\n') {
-            escaped_prompt[j++] = '\\';
-            escaped_prompt[j++] = 'n';
-        } else {
-            escaped_prompt[j++] = prompt[i];
-        }
-    }
-    escaped_prompt[j] = '\0';
-    
-    snprintf(json_body, sizeof(json_body),
-        "{\"model\":\"llama3.2\",\"prompt\":\"%s\",\"stream\":false}",
-        escaped_prompt);
-    
-    size_t json_len = strlen(json_body);
-    
-    char request[8192];
-    snprintf(request, sizeof(request),
-        "POST /api/generate HTTP/1.1\r\n"
-        "Host: %s:%d\r\n"
-        "Content-Type: application/json\r\n"
-        "Content-Length: %zu\r\n"
-        "\r\n"
-        "%s",
-        OLLAMA_HOST, OLLAMA_PORT,
-        json_len,
-        json_body);
-    
-    char response[32768] = {0};
-    
-#ifdef _WIN32
-    WSADATA wsa;
-    if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) {
-        return NULL;
-    }
-    
-    SOCKET sock = socket(AF_INET, SOCK_STREAM, 0);
-    if (sock == INVALID_SOCKET) {
-        WSACleanup();
-        return NULL;
-    }
-    
-    struct sockaddr_in server;
-    server.sin_family = AF_INET;
-    server.sin_port = htons(OLLAMA_PORT);
-    inet_pton(AF_INET, "127.0.0.1", &server.sin_addr);
-    
-    if (connect(sock, (struct sockaddr*)&server, sizeof(server)) == SOCKET_ERROR) {
-        closesocket(sock);
-        WSACleanup();
-        return NULL;
-    }
-    
-    send(sock, request, (int)strlen(request), 0);
-    int bytes_received = recv(sock, response, sizeof(response) - 1, 0);
-    closesocket(sock);
-    WSACleanup();
-    
-    if (bytes_received <= 0) {
-        return NULL;
-    }
-    response[bytes_received] = '\0';
-#else
-    int sock = socket(AF_INET, SOCK_STREAM, 0);
-    if (sock < 0) return NULL;
-    
-    struct sockaddr_in server;
-    server.sin_family = AF_INET;
-    server.sin_port = htons(OLLAMA_PORT);
-    inet_pton(AF_INET, "127.0.0.1", &server.sin_addr);
-    
-    if (connect(sock, (struct sockaddr*)&server, sizeof(server)) < 0) {
-        close(sock);
-        return NULL;
-    }
-    
-    send(sock, request, strlen(request), 0);
-    int bytes_received = recv(sock, response, sizeof(response) - 1, 0);
-    close(sock);
-    
-    if (bytes_received <= 0) {
-        return NULL;
-    }
-    response[bytes_received] = '\0';
-#endif
-    
-    /* Extract JSON response (simple parsing - find "response":"..." ) */
-    char *response_start = strstr(response, "\"response\":\"");
-    if (!response_start) {
-        return NULL;
-    }
-    
-    response_start += 12;  /* Skip "response":" */
-    char *response_end = strchr(response_start, '"');
-    if (!response_end) {
-        return NULL;
-    }
-    
-    size_t len = response_end - response_start;
-    char *result = malloc(len + 1);
-    if (!result) return NULL;
-    
-    memcpy(result, response_start, len);
-    result[len] = '\0';
-    
-    /* Unescape JSON strings (\n, \", etc.) */
-    char *out = result;
-    for (const char *in = result; *in; in++) {
-        if (*in == '\\' && in[1] == 'n') {
-            *out++ = '\n';
-            in++;
-        } else if (*in == '\\' && in[1] == '"') {
-            *out++ = '"';
-            in++;
-        } else {
-            *out++ = *in;
-        }
-    }
-    *out = '\0';
-    
-    return result;
+/* The teacher's reply, from MELVIN_TEACHER_CACHE when it has been asked before */
+static char* ask_teacher(TeacherConn *teacher, TeacherCache *cache, const char *model, const char *prompt) {
+    char *reply = cache ? teacher_cache_get(cache, model, prompt, NULL) : NULL;
+    if (reply) return reply;
+    reply = teacher_generate(teacher, prompt);
+    if (reply && cache) teacher_cache_put(cache, model, prompt, reply, strlen(reply));
+    return reply;
 }
 
 int main(void) {
     printf("=================================================================\n");
     printf("Melvin-Ollama Automated Training\n");
-    printf("Ollama (llama3.2) <-> Melvin o7 Training Loop\n");
+
+    /* OLLAMA_HOST and OLLAMA_MODEL pick the teacher; one keep-alive connection */
+    TeacherConfig teacher_cfg;
+    teacher_config_init(&teacher_cfg);
+    TeacherConn *teacher = teacher_open(&teacher_cfg);
+    TeacherCache *cache = teacher_cache_from_env();
+    printf("Ollama (%s at %s:%d) <-> Melvin o7 Training Loop\n",
+           teacher_cfg.model, teacher_cfg.host, teacher_cfg.port);
     printf("=================================================================\n\n");
     
     /* Create Melvin graph */
@@ -223,9 +86,9 @@ int main(void) {
         
         /* Step 1: Send to Ollama, get output */
         printf("[Ollama] Generating...\n");
-        char *ollama_output = ollama_generate(prompt);
+        char *ollama_output = ask_teacher(teacher, cache, teacher_cfg.model, prompt);
         if (!ollama_output) {
-            printf("ERROR: Failed to get response from Ollama\n");
+            printf("ERROR: Failed to get response from Ollama (%s)\n", teacher_error(teacher));
             continue;
         }
         
@@ -237,10 +100,7 @@ int main(void) {
         uint8_t *bytes = (uint8_t*)ollama_output;
         uint32_t len = (uint32_t)strlen(ollama_output);
         
-        /* Inject into Melvin with port 0 (text) */
-        inject_input_from_port(g, bytes, len, 0);
-        
-        /* Run Melvin episode (generate output) */
+        /* Run Melvin episode (injects the bytes, generates output) */
         run_episode(g, bytes, len, NULL, 0);
         
         /* Get Melvin's output */
@@ -263,7 +123,7 @@ int main(void) {
             }
             
             printf("[Ollama] Receiving Melvin feedback...\n");
-            char *ollama_response = ollama_generate(melvin_str);
+            char *ollama_response = ask_teacher(teacher, cache, teacher_cfg.model, melvin_str);
             if (ollama_response) {
                 printf("[Ollama] Feedback: %.100s%s\n", ollama_response,
                        strlen(ollama_response) > 100 ? "..." : "");
@@ -295,9 +155,17 @@ int main(void) {
     printf("Training complete!\n");
     printf("Brain saved to melvin_brain.m\n");
     printf("Total iterations: %d\n", iteration);
+    if (cache) {
+        TeacherCacheStats stats;
+        teacher_cache_stats(cache, &stats);
+        printf("Teacher cache: %llu hits, %llu misses, %u entries\n",
+               (unsigned long long)stats.hits, (unsigned long long)stats.misses, stats.entries);
+    }
     printf("=================================================================\n");
     
     melvin_destroy(g);
+    teacher_close(teacher);
+    teacher_cache_close(cache);
     return 0;
 }
 
@@ -1,51 +1,58 @@
 /* ============================================================================
  * MELVIN HTTP SERVER
- * 
- * Simple HTTP server for web chat interface with melvin
+ *
+ * HTTP server for web chat interface with melvin
+ *
+ * Event-driven: one epoll loop owns every socket (non-blocking, HTTP/1.1
+ * keep-alive, pipelined requests). Engine work never runs on the loop -
+ * chat requests are handed to a pool of worker threads and the reply is
+ * posted back through an eventfd, so static files and /api/status keep
+ * flowing while episodes are computing. Each chat session gets its own
+ * brain, cloned from a shared base brain. Read-only /api/infer requests are
+ * micro-batched against the base brain instead.
  * ============================================================================ */
 
-#ifdef _WIN32
-#include <winsock2.h>
-#include <ws2tcpip.h>
-#pragma comment(lib, "ws2_32.lib")
-#define close_socket closesocket
-#define SOCKET_ERROR_CODE WSAGetLastError()
-#else
+#define _GNU_SOURCE
+
+#ifndef __linux__
+#error "melvin_server uses epoll - build on Linux (or WSL on Windows)"
+#endif
+
 #include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/stat.h>
+#include <sys/un.h>
 #include <netinet/in.h>
+#include <netinet/tcp.h>
 #include <arpa/inet.h>
 #include <unistd.h>
 #include <pthread.h>
-#define SOCKET int
-#define INVALID_SOCKET -1
-#define SOCKET_ERROR -1
-#define close_socket close
-#define SOCKET_ERROR_CODE errno
-#endif
+#include <signal.h>
+#include <strings.h>
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdarg.h>
 #include <string.h>
 #include <stdint.h>
 #include <stdbool.h>
 #include <errno.h>
+#include <time.h>
 
-/* Include melvin */
-typedef struct MelvinGraph MelvinGraph;
-extern MelvinGraph* melvin_create(void);
-extern void melvin_destroy(MelvinGraph *g);
-extern void run_episode(MelvinGraph *g, const uint8_t *input, uint32_t input_len,
-                       const uint8_t *target, uint32_t target_len);
-extern void melvin_get_output(MelvinGraph *g, uint32_t **output, uint32_t *length);
-extern float melvin_get_error_rate(MelvinGraph *g);
-
-/* Global melvin instance */
-static MelvinGraph *g_melvin = NULL;
+#include "melvin.h"
 
 /* HTTP Server Configuration */
 #define DEFAULT_PORT 8080
+#define DEFAULT_BACKLOG 511          /* listen() backlog (override: MELVIN_BACKLOG) */
+#define DEFAULT_IDLE_TIMEOUT 30      /* Seconds before an idle keep-alive connection is closed */
+#define DEFAULT_DEADLINE_MS 10000    /* Longest a chat or inference may take (override: MELVIN_DEADLINE_MS) */
 #define BUFFER_SIZE 8192
 #define MAX_PATH_LENGTH 256
+#define MAX_HEADER_SIZE 16384        /* Request line + headers */
+#define MAX_BODY_SIZE (1024 * 1024)  /* Largest accepted request body */
+#define MAX_EVENTS 128
+#define MAX_SESSION_ID 64            /* Longest chat session id */
 
 /* Get port from environment or use default */
 static int get_port(void) {
@@ -59,88 +66,509 @@ static int get_port(void) {
     return DEFAULT_PORT;
 }
 
-/* HTTP Response Helpers */
-void send_response(SOCKET client, int status, const char *status_text, 
-                   const char *content_type, const char *body, size_t body_len) {
-    char response[BUFFER_SIZE];
-    int len = snprintf(response, sizeof(response),
+/* Positive integer from environment, or fallback */
+static int get_env_int(const char *name, int fallback) {
+    const char *str = getenv(name);
+    if (str) {
+        int value = atoi(str);
+        if (value > 0) return value;
+    }
+    return fallback;
+}
+
+/* Monotonic clock in nanoseconds */
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/* ============================================================================
+ * BYTE BUFFER: growable buffer used for socket reads and queued writes
+ * ============================================================================ */
+
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+} Buffer;
+
+static bool buf_reserve(Buffer *b, size_t extra) {
+    if (b->len + extra <= b->cap) return true;
+    size_t cap = b->cap ? b->cap : 1024;
+    while (cap < b->len + extra) cap *= 2;
+    char *data = realloc(b->data, cap);
+    if (!data) return false;
+    b->data = data;
+    b->cap = cap;
+    return true;
+}
+
+static bool buf_append(Buffer *b, const void *data, size_t len) {
+    if (!buf_reserve(b, len)) return false;
+    memcpy(b->data + b->len, data, len);
+    b->len += len;
+    return true;
+}
+
+/* Drop the first n bytes */
+static void buf_consume(Buffer *b, size_t n) {
+    if (n >= b->len) {
+        b->len = 0;
+        return;
+    }
+    memmove(b->data, b->data + n, b->len - n);
+    b->len -= n;
+}
+
+/* Little-endian integers (binary RPC frames) */
+static void put_le32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static uint32_t get_le32(const uint8_t *p) {
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static void put_le64(uint8_t *p, uint64_t v) {
+    put_le32(p, (uint32_t)v);
+    put_le32(p + 4, (uint32_t)(v >> 32));
+}
+
+static void buf_free(Buffer *b) {
+    free(b->data);
+    b->data = NULL;
+    b->len = b->cap = 0;
+}
+
+/* ============================================================================
+ * CONNECTIONS
+ * ============================================================================ */
+
+typedef struct Connection {
+    int fd;
+    Buffer rbuf;               /* Bytes received but not yet parsed */
+    Buffer wbuf;               /* Bytes queued for sending */
+    size_t wpos;               /* How much of wbuf has been sent */
+    bool keep_alive;           /* Current request allows another one after it */
+    bool close_after_write;    /* Close once wbuf drains */
+    bool waiting_engine;       /* A request is being processed by a worker */
+    bool peer_closed;          /* Socket is gone but an engine job still references us */
+    bool read_closed;          /* Peer half-closed - answer what we have, then close */
+    bool want_write;           /* EPOLLOUT currently registered */
+    bool stream_chunked;       /* Streamed reply uses chunked encoding (HTTP/1.1) */
+    bool read_paused;          /* Not reading: a training upload is ahead of the workers */
+    bool rpc;                  /* Speaks binary RPC frames instead of HTTP */
+    struct TrainIngest *ingest;  /* Non-NULL while a /api/train body is being read */
+    int endpoint;              /* Metrics: HTTP route, or RPC op, of the request being answered */
+    int status;                /* Metrics: status of the last reply queued */
+    uint64_t request_start_ns; /* Metrics: when the current request was parsed */
+    uint32_t client_addr;      /* Peer IPv4 address (rate limiting), 0 on a Unix socket */
+    uint32_t retry_after;      /* Next reply carries Retry-After (seconds) */
+    time_t last_active;
+    struct Connection *prev, *next;  /* All live connections (idle sweep) */
+} Connection;
+
+typedef struct {
+    int epoll_fd;
+    int listen_fd;
+    int rpc_listen_fd;         /* MELVIN_RPC_PORT, -1 if off */
+    int rpc_unix_fd;           /* MELVIN_RPC_SOCKET, -1 if off */
+    int wake_fd;               /* eventfd: workers -> loop */
+    int idle_timeout;
+    bool log_requests;         /* MELVIN_LOG_REQUESTS: one stderr line per request */
+    uint32_t deadline_ms;      /* Generation limits - requests may only lower them (0 = none) */
+    uint32_t max_steps;
+    uint32_t max_output;
+    double rate_limit;         /* Engine requests per second per client, 0 = unlimited */
+    double rate_burst;         /* Bucket size */
+    uint32_t max_connections;
+    const char *save_dir;      /* Where RPC saves write session brains */
+    uint32_t profile_sample;   /* MELVIN_PROFILE_SAMPLE: profile 1 episode in N, 0 = off */
+    Connection *connections;
+    uint32_t connection_count;
+} Server;
+
+static Server g_server;
+
+/* Sentinels stored in epoll_event.data.ptr for non-connection descriptors */
+static int g_listen_tag;
+static int g_rpc_listen_tag;
+static int g_rpc_unix_tag;
+static int g_wake_tag;
+
+static void train_ingest_abort(Connection *c);
+static void conn_process(Connection *c);
+
+static void conn_update_events(Connection *c) {
+    struct epoll_event ev;
+    ev.events = (c->read_closed || c->read_paused ? 0 : EPOLLIN | EPOLLRDHUP) |
+                (c->want_write ? EPOLLOUT : 0);
+    ev.data.ptr = c;
+    epoll_ctl(g_server.epoll_fd, EPOLL_CTL_MOD, c->fd, &ev);
+}
+
+static void conn_free(Connection *c) {
+    buf_free(&c->rbuf);
+    buf_free(&c->wbuf);
+    free(c);
+}
+
+static void conn_close(Connection *c) {
+    if (c->fd >= 0) {
+        epoll_ctl(g_server.epoll_fd, EPOLL_CTL_DEL, c->fd, NULL);
+        close(c->fd);
+        c->fd = -1;
+    }
+
+    if (c->prev) c->prev->next = c->next;
+    else g_server.connections = c->next;
+    if (c->next) c->next->prev = c->prev;
+    c->prev = c->next = NULL;
+    g_server.connection_count--;
+
+    if (c->ingest) train_ingest_abort(c);
+
+    /* An engine job still holds a pointer - it frees us when it completes */
+    if (c->waiting_engine) {
+        c->peer_closed = true;
+        return;
+    }
+    conn_free(c);
+}
+
+/* Send as much of wbuf as the socket accepts. Returns false if the connection was closed. */
+static bool conn_flush(Connection *c) {
+    while (c->wpos < c->wbuf.len) {
+        ssize_t sent = send(c->fd, c->wbuf.data + c->wpos, c->wbuf.len - c->wpos, MSG_NOSIGNAL);
+        if (sent > 0) {
+            c->wpos += (size_t)sent;
+            continue;
+        }
+        if (sent < 0 && errno == EINTR) continue;
+        if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            if (!c->want_write) {
+                c->want_write = true;
+                conn_update_events(c);
+            }
+            return true;
+        }
+        conn_close(c);
+        return false;
+    }
+
+    /* Everything written */
+    c->wbuf.len = 0;
+    c->wpos = 0;
+    if (c->want_write) {
+        c->want_write = false;
+        conn_update_events(c);
+    }
+    if (c->close_after_write) {
+        conn_close(c);
+        return false;
+    }
+    return true;
+}
+
+/* ============================================================================
+ * HTTP RESPONSES
+ * ============================================================================ */
+
+static const char* status_text(int status) {
+    switch (status) {
+        case 200: return "OK";
+        case 202: return "Accepted";
+        case 204: return "No Content";
+        case 400: return "Bad Request";
+        case 403: return "Forbidden";
+        case 404: return "Not Found";
+        case 405: return "Method Not Allowed";
+        case 413: return "Payload Too Large";
+        case 429: return "Too Many Requests";
+        case 431: return "Request Header Fields Too Large";
+        case 500: return "Internal Server Error";
+        case 503: return "Service Unavailable";
+        default:  return "Unknown";
+    }
+}
+
+/* Queue a complete response on the connection (sent by conn_flush) */
+void send_response(Connection *c, int status, const char *content_type,
+                   const char *body, size_t body_len) {
+    c->status = status;
+    char retry[32] = "";
+    if (c->retry_after) {
+        snprintf(retry, sizeof(retry), "Retry-After: %u\r\n", c->retry_after);
+        c->retry_after = 0;
+    }
+    char header[512];
+    int len = snprintf(header, sizeof(header),
         "HTTP/1.1 %d %s\r\n"
         "Content-Type: %s\r\n"
         "Content-Length: %zu\r\n"
+        "%s"
         "Access-Control-Allow-Origin: *\r\n"
         "Access-Control-Allow-Methods: GET, POST, OPTIONS\r\n"
         "Access-Control-Allow-Headers: Content-Type\r\n"
-        "Connection: close\r\n"
+        "Connection: %s\r\n"
         "\r\n",
-        status, status_text, content_type, body_len);
-    
-    send(client, response, len, 0);
-    if (body && body_len > 0) {
-        send(client, body, body_len, 0);
+        status, status_text(status), content_type, body_len, retry,
+        c->keep_alive ? "keep-alive" : "close");
+
+    if (!buf_append(&c->wbuf, header, (size_t)len) ||
+        (body && body_len > 0 && !buf_append(&c->wbuf, body, body_len))) {
+        c->close_after_write = true;  /* Out of memory - give up on this connection */
+        return;
+    }
+    if (!c->keep_alive) {
+        c->close_after_write = true;
     }
 }
 
-void send_json(SOCKET client, int status, const char *json) {
-    send_response(client, status, "OK", "application/json", json, strlen(json));
+void send_json(Connection *c, int status, const char *json) {
+    send_response(c, status, "application/json", json, strlen(json));
 }
 
-void send_error(SOCKET client, int status, const char *message) {
+void send_error(Connection *c, int status, const char *message) {
     char json[512];
     snprintf(json, sizeof(json), "{\"error\":\"%s\"}", message);
-    send_json(client, status, json);
+    send_json(c, status, json);
+}
+
+/* 429/503 telling the client when to try again (seconds) */
+void send_busy(Connection *c, int status, const char *message, uint32_t retry_after) {
+    c->retry_after = retry_after;
+    send_error(c, status, message);
+}
+
+/* Start a Server-Sent Events reply. HTTP/1.1 clients get chunked encoding
+ * and keep the connection; HTTP/1.0 clients read until we close. */
+void send_stream_start(Connection *c, int version_minor) {
+    c->status = 200;
+    c->stream_chunked = (version_minor >= 1);
+    if (!c->stream_chunked) c->keep_alive = false;
+
+    char header[512];
+    int len = snprintf(header, sizeof(header),
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Type: text/event-stream\r\n"
+        "Cache-Control: no-cache\r\n"
+        "%s"
+        "Access-Control-Allow-Origin: *\r\n"
+        "Access-Control-Allow-Methods: GET, POST, OPTIONS\r\n"
+        "Access-Control-Allow-Headers: Content-Type\r\n"
+        "Connection: %s\r\n"
+        "\r\n",
+        c->stream_chunked ? "Transfer-Encoding: chunked\r\n" : "",
+        c->keep_alive ? "keep-alive" : "close");
+    if (!buf_append(&c->wbuf, header, (size_t)len)) {
+        c->close_after_write = true;
+    }
+}
+
+/* Queue part of a streamed body */
+void send_stream_data(Connection *c, const char *data, size_t len) {
+    if (len == 0) return;
+    bool ok = true;
+    if (c->stream_chunked) {
+        char size_line[32];
+        int n = snprintf(size_line, sizeof(size_line), "%zx\r\n", len);
+        ok = buf_append(&c->wbuf, size_line, (size_t)n) &&
+             buf_append(&c->wbuf, data, len) &&
+             buf_append(&c->wbuf, "\r\n", 2);
+    } else {
+        ok = buf_append(&c->wbuf, data, len);
+    }
+    if (!ok) c->close_after_write = true;
+}
+
+/* Finish a streamed body */
+void send_stream_end(Connection *c) {
+    if (c->stream_chunked) {
+        if (!buf_append(&c->wbuf, "0\r\n\r\n", 5)) c->close_after_write = true;
+    }
+    if (!c->keep_alive) {
+        c->close_after_write = true;
+    }
 }
 
-/* Parse HTTP request */
+/* ============================================================================
+ * HTTP REQUEST FRAMING
+ * ============================================================================ */
+
 typedef struct {
     char method[16];
     char path[MAX_PATH_LENGTH];
-    char body[BUFFER_SIZE];
+    int version_minor;         /* HTTP/1.x */
+    bool keep_alive;
+    char session[MAX_SESSION_ID + 1];  /* X-Melvin-Session header, empty if absent */
+    bool bad_session;          /* Header too long to be a session id */
+    bool accept_stream;        /* Accept: text/event-stream */
+    char if_none_match[128];   /* If-None-Match header, empty if absent or too long */
+    bool body_streamed;        /* Body is left in the buffer for the handler to read */
+    bool chunked;              /* Transfer-Encoding: chunked (streamed bodies only) */
+    bool expect_continue;      /* Expect: 100-continue */
+    size_t content_length;
+    const char *body;          /* Points into the connection's read buffer */
     size_t body_len;
 } HttpRequest;
 
+/* Find the end of the header block, or NULL if it hasn't arrived yet */
+static const char* find_header_end(const char *buf, size_t len) {
+    if (len < 4) return NULL;
+    for (size_t i = 0; i + 3 < len; i++) {
+        if (buf[i] == '\r' && buf[i + 1] == '\n' && buf[i + 2] == '\r' && buf[i + 3] == '\n') {
+            return buf + i + 4;
+        }
+    }
+    return NULL;
+}
+
+/* Does a comma-separated header value contain token (case-insensitive)? */
+static bool header_has_token(const char *value, size_t value_len, const char *token) {
+    size_t token_len = strlen(token);
+    size_t i = 0;
+    while (i < value_len) {
+        while (i < value_len && (value[i] == ' ' || value[i] == '\t' || value[i] == ',')) i++;
+        size_t start = i;
+        while (i < value_len && value[i] != ',') i++;
+        size_t end = i;
+        while (end > start && (value[end - 1] == ' ' || value[end - 1] == '\t')) end--;
+        if (end - start == token_len && strncasecmp(value + start, token, token_len) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Requests whose body may be any size and is read as it arrives */
+static bool request_streams_body(const HttpRequest *req) {
+    return strcmp(req->method, "POST") == 0 && strcmp(req->path, "/api/train") == 0;
+}
+
+/*
+ * Parse one request from the front of buf.
+ * Returns bytes consumed (> 0) when a full request is available, 0 when more
+ * data is needed, or a negative HTTP status (-400, -413, -431, ...) on error.
+ */
 int parse_request(const char *buffer, size_t len, HttpRequest *req) {
     memset(req, 0, sizeof(HttpRequest));
-    
-    /* Parse first line: METHOD PATH HTTP/1.1 */
-    if (sscanf(buffer, "%15s %255s", req->method, req->path) != 2) {
-        return -1;
+
+    const char *header_end = find_header_end(buffer, len);
+    if (!header_end) {
+        return (len > MAX_HEADER_SIZE) ? -431 : 0;
     }
-    
-    /* Find body (after \r\n\r\n) */
-    const char *body_start = strstr(buffer, "\r\n\r\n");
-    if (body_start) {
-        body_start += 4;
-        size_t body_size = len - (body_start - buffer);
-        
-        /* Validate body size - reject if too large */
-        if (body_size >= sizeof(req->body)) {
-            return -1; /* Body too large */
-        }
-        
-        if (body_size > 0) {
-            memcpy(req->body, body_start, body_size);
-            req->body_len = body_size;
+    if ((size_t)(header_end - buffer) > MAX_HEADER_SIZE) {
+        return -431;
+    }
+
+    /* Parse first line: METHOD PATH HTTP/1.x. The buffer is not
+     * NUL-terminated, so the line is copied out before sscanf sees it */
+    const char *first_eol = memmem(buffer, header_end - buffer, "\r\n", 2);
+    char first[16 + MAX_PATH_LENGTH + 32];
+    size_t first_len = first_eol - buffer;
+    if (first_len >= sizeof(first)) first_len = sizeof(first) - 1;
+    memcpy(first, buffer, first_len);
+    first[first_len] = '\0';
+    int major = 1, minor = 0;
+    if (sscanf(first, "%15s %255s HTTP/%d.%d", req->method, req->path, &major, &minor) < 2) {
+        return -400;
+    }
+    req->version_minor = (major == 1) ? minor : 0;
+    req->keep_alive = (req->version_minor >= 1);  /* HTTP/1.1 defaults to keep-alive */
+
+    /* Parse headers we care about */
+    size_t content_length = 0;
+    bool has_length = false;
+    bool streamed = request_streams_body(req);
+    const char *line = first_eol + 2;
+    while (line < header_end - 2) {
+        const char *eol = memmem(line, header_end - line, "\r\n", 2);
+        if (!eol || eol > header_end - 2) break;
+        const char *colon = memchr(line, ':', eol - line);
+        if (colon) {
+            size_t name_len = colon - line;
+            const char *value = colon + 1;
+            while (value < eol && (*value == ' ' || *value == '\t')) value++;
+            size_t value_len = eol - value;
+
+            if (name_len == 14 && strncasecmp(line, "Content-Length", 14) == 0) {
+                char number[32];
+                if (value_len == 0 || value_len >= sizeof(number)) return -400;
+                memcpy(number, value, value_len);
+                number[value_len] = '\0';
+                char *end = NULL;
+                unsigned long long parsed = strtoull(number, &end, 10);
+                if (end == number || *end != '\0') return -400;
+                /* A second, different length would let a proxy and this
+                 * server disagree on where the next request starts */
+                if (has_length && (size_t)parsed != content_length) return -400;
+                if (parsed > MAX_BODY_SIZE && !streamed) return -413;
+                content_length = (size_t)parsed;
+                has_length = true;
+            } else if (name_len == 17 && strncasecmp(line, "Transfer-Encoding", 17) == 0) {
+                /* Chunked bodies are only read by streaming handlers */
+                if (!streamed || !header_has_token(value, value_len, "chunked")) return -400;
+                req->chunked = true;
+            } else if (name_len == 6 && strncasecmp(line, "Expect", 6) == 0) {
+                req->expect_continue = header_has_token(value, value_len, "100-continue");
+            } else if (name_len == 10 && strncasecmp(line, "Connection", 10) == 0) {
+                if (header_has_token(value, value_len, "close")) req->keep_alive = false;
+                if (header_has_token(value, value_len, "keep-alive")) req->keep_alive = true;
+            } else if (name_len == 13 && strncasecmp(line, "If-None-Match", 13) == 0) {
+                if (value_len < sizeof(req->if_none_match)) {
+                    memcpy(req->if_none_match, value, value_len);
+                    req->if_none_match[value_len] = '\0';
+                }
+            } else if (name_len == 6 && strncasecmp(line, "Accept", 6) == 0) {
+                if (header_has_token(value, value_len, "text/event-stream")) req->accept_stream = true;
+            } else if (name_len == 16 && strncasecmp(line, "X-Melvin-Session", 16) == 0) {
+                if (value_len > MAX_SESSION_ID) {
+                    req->bad_session = true;
+                } else {
+                    memcpy(req->session, value, value_len);
+                    req->session[value_len] = '\0';
+                }
+            }
         }
+        line = eol + 2;
     }
-    
-    return 0;
+    if (has_length && req->chunked) return -400;  /* Ambiguous framing */
+
+    size_t header_len = header_end - buffer;
+    if (streamed) {
+        req->body_streamed = true;
+        req->content_length = content_length;
+        return (int)header_len;  /* The handler reads the body */
+    }
+    if (len - header_len < content_length) {
+        return 0;  /* Body still arriving */
+    }
+
+    req->body = header_end;
+    req->body_len = content_length;
+    return (int)(header_len + content_length);
 }
 
-/* Extract JSON value (simple parser) */
+/* Extract JSON value (simple parser) - json must be NUL-terminated */
 int extract_json_string(const char *json, const char *key, char *value, size_t value_size) {
     char search[128];
     snprintf(search, sizeof(search), "\"%s\"", key);
     const char *key_pos = strstr(json, search);
     if (!key_pos) return -1;
-    
+
     /* Find colon after key */
     const char *colon = strchr(key_pos, ':');
     if (!colon) return -1;
-    
+
     /* Find value (string or number) */
     const char *value_start = colon + 1;
     while (*value_start == ' ' || *value_start == '\t') value_start++;
-    
+
     if (*value_start == '"') {
         /* String value - handle escaped quotes */
         value_start++;
@@ -153,7 +581,7 @@ int extract_json_string(const char *json, const char *key, char *value, size_t v
             }
         }
         if (!*value_end) return -1; /* No closing quote */
-        
+
         /* Copy value, handling escape sequences */
         size_t len = 0;
         const char *src = value_start;
@@ -175,7 +603,7 @@ int extract_json_string(const char *json, const char *key, char *value, size_t v
     } else {
         /* Number or other - just copy until comma or } */
         const char *value_end = value_start;
-        while (*value_end && *value_end != ',' && *value_end != '}' && 
+        while (*value_end && *value_end != ',' && *value_end != '}' &&
                *value_end != '\n' && *value_end != '\r' && *value_end != ' ') {
             value_end++;
         }
@@ -184,315 +612,2741 @@ int extract_json_string(const char *json, const char *key, char *value, size_t v
         memcpy(value, value_start, len);
         value[len] = '\0';
     }
-    
+
     return 0;
 }
 
-/* Handle /api/chat endpoint */
-void handle_chat(SOCKET client, const HttpRequest *req) {
-    if (!g_melvin) {
-        send_error(client, 500, "Melvin not initialized");
-        return;
-    }
-    
-    /* Extract message from JSON body */
-    char message[BUFFER_SIZE] = {0};
-    if (extract_json_string(req->body, "message", message, sizeof(message)) != 0) {
-        send_error(client, 400, "Missing 'message' field in JSON");
-        return;
-    }
-    
-    if (strlen(message) == 0) {
-        send_error(client, 400, "Message cannot be empty");
-        return;
-    }
-    
-    /* Process message through melvin */
-    const uint8_t *input = (const uint8_t*)message;
-    uint32_t input_len = strlen(message);
-    
-    /* Run episode (no target - pure inference/chat) */
-    run_episode(g_melvin, input, input_len, NULL, 0);
-    
-    /* Get output */
-    uint32_t *output;
-    uint32_t output_len;
-    melvin_get_output(g_melvin, &output, &output_len);
-    
-    /* Convert output to string and escape for JSON */
-    char response_text[BUFFER_SIZE] = {0};
-    char escaped_response[BUFFER_SIZE * 2] = {0}; /* Enough space for escaped chars */
-    size_t escaped_len = 0;
-    size_t response_pos = 0; /* Track position in response_text */
-    
-    /* Convert output array to string, handling all values correctly */
-    for (uint32_t i = 0; i < output_len && response_pos < sizeof(response_text) - 1; i++) {
-        if (output[i] < 256) {
-            response_text[response_pos++] = (char)output[i];
-        }
-        /* Skip values >= 256 (they're not valid ASCII/UTF-8 bytes) */
-    }
-    response_text[response_pos] = '\0'; /* Ensure null termination */
-    
-    /* Escape JSON special characters */
-    for (size_t i = 0; i < strlen(response_text) && escaped_len < sizeof(escaped_response) - 1; i++) {
-        char c = response_text[i];
-        if (c == '"') {
-            escaped_response[escaped_len++] = '\\';
-            escaped_response[escaped_len++] = '"';
-        } else if (c == '\\') {
-            escaped_response[escaped_len++] = '\\';
-            escaped_response[escaped_len++] = '\\';
-        } else if (c == '\n') {
-            escaped_response[escaped_len++] = '\\';
-            escaped_response[escaped_len++] = 'n';
-        } else if (c == '\r') {
-            escaped_response[escaped_len++] = '\\';
-            escaped_response[escaped_len++] = 'r';
-        } else if (c == '\t') {
-            escaped_response[escaped_len++] = '\\';
-            escaped_response[escaped_len++] = 't';
-        } else if (c >= 32 && c < 127) {
-            /* Printable ASCII */
-            escaped_response[escaped_len++] = c;
-        } else {
-            /* Skip non-printable characters */
+/* ============================================================================
+ * ENGINE: WORKER POOL AND SESSIONS
+ *
+ * The loop never calls into melvin.c. Every chat belongs to a session (named
+ * by the client, or "default"); each session owns a private brain cloned
+ * from the base brain the first time it is used. Sessions with pending jobs
+ * sit on a ready list and a worker takes a whole session at a time, so a
+ * session's messages run in order on one thread while different sessions
+ * run in parallel. Finished jobs are handed back to the loop via eventfd.
+ *
+ * Training uploads (/api/train) arrive as chunks of (input, target) pairs
+ * queued on a session like chat messages, so they run in order with that
+ * session's chats. A finished chunk goes back on the done list without a
+ * connection, which tells the loop to read more of the upload. Binary RPC
+ * training and saves are ordinary jobs on their session as well.
+ *
+ * Streaming chats also hand back partial output: the brain's output hook
+ * appends each emitted byte to the job as a Server-Sent Event and puts the
+ * job on a stream list, which the loop drains on the same eventfd.
+ *
+ * The base brain is never trained - it is only read by melvin_clone().
+ * ============================================================================ */
+
+#define DEFAULT_MAX_SESSIONS 64      /* Live session brains (override: MELVIN_MAX_SESSIONS) */
+#define DEFAULT_QUEUE_MAX 256        /* Chat jobs queued or running (override: MELVIN_QUEUE_MAX) */
+#define DEFAULT_TRAIN_QUEUE_MAX 64   /* Training chunks queued or running, all uploads together
+                                        (override: MELVIN_TRAIN_QUEUE_MAX) */
+#define SESSION_BUCKETS 1024
+#define DEFAULT_SESSION_ID "default"
+
+#define TRAIN_CHUNK_PAIRS 64         /* Pairs per training job */
+#define TRAIN_MAX_IN_FLIGHT 16       /* Chunks queued per upload before reading pauses */
+
+struct Session;
+
+/* One /api/train upload. Counters marked (lock) are shared with workers
+ * under g_engine.lock; the rest belong to the loop. */
+typedef struct TrainJob {
+    uint32_t id;
+    char session_id[MAX_SESSION_ID + 1];
+    struct Session *session;   /* Kept alive by its train_refs until finished */
+    bool receiving;            /* Body still arriving */
+    bool aborted;              /* Upload ended early (closed, truncated or malformed) */
+    bool finished;             /* Received and every pair trained */
+    uint64_t bytes;            /* Body bytes received */
+    uint64_t lines;            /* Non-empty lines */
+    uint64_t bad_lines;        /* Lines that were not {"input", "target"} */
+    uint64_t pairs_queued;
+    uint64_t pairs_trained;    /* (lock) */
+    uint32_t chunks_in_flight; /* (lock) */
+    uint64_t started_ns, finished_ns;
+    Connection *conn;          /* Uploading connection, NULL once the body is done */
+} TrainJob;
+
+/* Why a request was turned away instead of run (metrics) */
+enum {
+    SHED_RATE_LIMIT,           /* Client over its token bucket - 429 */
+    SHED_QUEUE_FULL,           /* MELVIN_QUEUE_MAX reached or no session slot - 503 */
+    SHED_EXPECTED_WAIT,        /* Queue wait would pass the request's deadline - 503 */
+    SHED_EXPIRED,              /* Deadline passed while queued - 503 */
+    SHED_CONNECTIONS,          /* MELVIN_MAX_CONNECTIONS reached - 503, connection closed */
+    SHED_COUNT
+};
+
+static const char *shed_names[SHED_COUNT] = {
+    "rate_limit", "queue_full", "expected_wait", "expired", "connections"
+};
+
+/* Generation budget of a chat or inference request */
+typedef struct {
+    uint32_t max_steps;        /* 0 = built-in caps */
+    uint32_t max_output;
+    uint64_t deadline_ns;      /* now_ns() time by which generation stops, 0 = none */
+} JobLimits;
+
+/* Binary RPC operations (see BINARY RPC); engine jobs from RPC carry theirs */
+enum { RPC_NONE, RPC_CHAT, RPC_TRAIN, RPC_STATUS, RPC_SAVE, RPC_OP_COUNT };
+
+/* Reply status byte of an RPC frame */
+enum { RPC_OK, RPC_BAD_REQUEST, RPC_BUSY, RPC_ERROR, RPC_STATUS_COUNT };
+
+typedef struct EngineJob {
+    Connection *conn;
+    struct Session *session;
+    char *message;             /* NUL-terminated chat message */
+    uint32_t message_len;      /* RPC messages may contain NULs */
+    int status;                /* Filled by the worker */
+    char *response;            /* JSON body, filled by the worker */
+    size_t response_len;       /* RPC reply payload length */
+    uint8_t rpc_op;            /* RPC_NONE for HTTP requests */
+    uint32_t rpc_id;           /* Echoed in the RPC reply */
+    uint64_t submitted_ns;     /* Inference jobs: when the request was queued */
+    JobLimits limits;          /* Chat and inference generation budget */
+    bool stream;               /* Reply as Server-Sent Events while generating */
+    Buffer stream_out;         /* Events not yet taken by the loop (g_engine.lock) */
+    bool stream_queued;        /* On the stream list */
+    struct EngineJob *stream_next;
+    TrainJob *train;           /* Training chunk (no connection) */
+    Buffer pairs;              /* Training chunk: packed [len][input][len][target] records */
+    uint32_t pair_count;
+    struct EngineJob *next;
+} EngineJob;
+
+typedef struct Session {
+    char id[MAX_SESSION_ID + 1];
+    MelvinGraph *brain;        /* NULL until the first job clones the base brain */
+    EngineJob *jobs_head, *jobs_tail;   /* Waiting for this session's worker */
+    bool queued;               /* On the ready list */
+    bool running;              /* A worker is processing one of its jobs */
+    bool pinned;               /* Never evicted (the default session) */
+    uint32_t train_refs;       /* Unfinished training uploads - not evictable */
+    MelvinStats stats;         /* Brain snapshot after its last episode */
+    MelvinProfile profile;     /* Same, for the profiler's counters */
+    struct Session *hash_next;
+    struct Session *ready_next;
+    struct Session *lru_prev, *lru_next;  /* Most recently used first */
+} Session;
+
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t ready;
+    Session *buckets[SESSION_BUCKETS];
+    Session *ready_head, *ready_tail;     /* Sessions with jobs and no worker */
+    Session *lru_head, *lru_tail;
+    Session *default_session;
+    EngineJob *done_head, *done_tail;     /* Workers -> loop */
+    EngineJob *stream_head, *stream_tail; /* Jobs with new streamed output */
+    uint32_t session_count;
+    uint32_t max_sessions;
+    uint32_t pending_jobs;                /* Queued + running */
+    uint32_t max_pending;                 /* Bound on pending jobs other than training chunks */
+    uint32_t train_chunks;                /* Training chunks among pending_jobs */
+    uint32_t max_train_chunks;
+    uint32_t worker_count;
+    uint32_t busy_workers;
+    MelvinStats totals;                   /* Episode counters summed over every session ever */
+    MelvinProfile profile;                /* Sampled profile, likewise */
+    uint64_t train_pairs;                 /* Training pairs learned */
+    uint64_t service_ns;                  /* Moving average of a chat's run time */
+    uint64_t shed[SHED_COUNT];            /* Requests turned away, by reason */
+} EnginePool;
+
+static EnginePool g_engine = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .ready = PTHREAD_COND_INITIALIZER
+};
+
+static void count_shed(int reason) {
+    pthread_mutex_lock(&g_engine.lock);
+    g_engine.shed[reason]++;
+    pthread_mutex_unlock(&g_engine.lock);
+}
+
+/* Seconds until the chat queue has likely drained - Retry-After for 503s.
+ * Caller holds g_engine.lock. */
+static uint32_t engine_retry_after_locked(void) {
+    uint64_t rounds = g_engine.pending_jobs / (g_engine.worker_count ? g_engine.worker_count : 1) + 1;
+    uint64_t seconds = (rounds * g_engine.service_ns + 999999999ull) / 1000000000ull;
+    return seconds < 1 ? 1 : seconds > 60 ? 60 : (uint32_t)seconds;
+}
+
+static uint32_t engine_retry_after(void) {
+    pthread_mutex_lock(&g_engine.lock);
+    uint32_t seconds = engine_retry_after_locked();
+    pthread_mutex_unlock(&g_engine.lock);
+    return seconds;
+}
+
+/* Immutable base brain every session starts from */
+static MelvinGraph *g_base = NULL;
+
+/* Session ids are short printable tokens: [A-Za-z0-9._-] */
+static bool valid_session_id(const char *id, size_t len) {
+    if (len == 0 || len > MAX_SESSION_ID) return false;
+    for (size_t i = 0; i < len; i++) {
+        char ch = id[i];
+        if (!((ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') ||
+              (ch >= '0' && ch <= '9') || ch == '-' || ch == '_' || ch == '.')) {
+            return false;
         }
     }
-    escaped_response[escaped_len] = '\0';
-    
-    /* Get system state */
-    float error_rate = melvin_get_error_rate(g_melvin);
-    
-    /* Build JSON response */
-    char json_response[BUFFER_SIZE * 2];
-    snprintf(json_response, sizeof(json_response),
-        "{\"response\":\"%s\",\"error_rate\":%.3f}",
-        escaped_response, error_rate);
-    
-    send_json(client, 200, json_response);
+    return true;
 }
 
-/* Handle /api/status endpoint */
-void handle_status(SOCKET client) {
-    if (!g_melvin) {
-        send_error(client, 500, "Melvin not initialized");
-        return;
+static uint32_t session_hash(const char *id) {
+    uint32_t h = 2166136261u;  /* FNV-1a */
+    while (*id) {
+        h ^= (uint8_t)*id++;
+        h *= 16777619u;
     }
-    
-    float error_rate = melvin_get_error_rate(g_melvin);
-    
-    char json[256];
-    snprintf(json, sizeof(json),
-        "{\"status\":\"running\",\"error_rate\":%.3f}",
-        error_rate);
-    
-    send_json(client, 200, json);
+    return h % SESSION_BUCKETS;
 }
 
-/* Serve static file */
-void serve_file(SOCKET client, const char *path) {
-    /* Security: prevent directory traversal */
-    if (strstr(path, "..") != NULL) {
-        send_error(client, 403, "Forbidden");
-        return;
-    }
-    
-    /* Map root to index.html */
-    if (strcmp(path, "/") == 0) {
-        path = "/index.html";
-    }
-    
-    /* Build file path */
-    char filepath[MAX_PATH_LENGTH];
-    snprintf(filepath, sizeof(filepath), "web%s", path);
-    
-    /* Open file */
-    FILE *f = fopen(filepath, "rb");
-    if (!f) {
-        fprintf(stderr, "File not found: %s\n", filepath);
-        send_error(client, 404, "File not found");
-        return;
-    }
-    
-    /* Get file size */
-    fseek(f, 0, SEEK_END);
-    long file_size = ftell(f);
-    fseek(f, 0, SEEK_SET);
-    
-    /* Determine content type */
-    const char *content_type = "text/plain";
-    if (strstr(path, ".html")) content_type = "text/html";
-    else if (strstr(path, ".css")) content_type = "text/css";
-    else if (strstr(path, ".js")) content_type = "application/javascript";
-    else if (strstr(path, ".json")) content_type = "application/json";
-    
-    /* Read file */
-    char *file_content = malloc(file_size);
-    if (!file_content) {
-        fclose(f);
-        send_error(client, 500, "Memory error");
-        return;
+/* The following session_* helpers require g_engine.lock */
+
+static void session_lru_unlink(Session *s) {
+    if (s->lru_prev) s->lru_prev->lru_next = s->lru_next;
+    else g_engine.lru_head = s->lru_next;
+    if (s->lru_next) s->lru_next->lru_prev = s->lru_prev;
+    else g_engine.lru_tail = s->lru_prev;
+    s->lru_prev = s->lru_next = NULL;
+}
+
+static void session_touch(Session *s) {
+    if (g_engine.lru_head == s) return;
+    session_lru_unlink(s);
+    s->lru_next = g_engine.lru_head;
+    if (s->lru_next) s->lru_next->lru_prev = s;
+    g_engine.lru_head = s;
+    if (!g_engine.lru_tail) g_engine.lru_tail = s;
+}
+
+static bool session_idle(const Session *s) {
+    return !s->pinned && !s->running && !s->queued && !s->jobs_head && s->train_refs == 0;
+}
+
+/* Unlink the least recently used idle session; caller destroys it after unlocking */
+static Session* session_evict(void) {
+    Session *victim = g_engine.lru_tail;
+    while (victim && !session_idle(victim)) victim = victim->lru_prev;
+    if (!victim) return NULL;
+
+    Session **link = &g_engine.buckets[session_hash(victim->id)];
+    while (*link != victim) link = &(*link)->hash_next;
+    *link = victim->hash_next;
+    session_lru_unlink(victim);
+    g_engine.session_count--;
+    return victim;
+}
+
+/* Find or create a session. *evicted receives a session to destroy, if any.
+ * Returns NULL when the table is full of busy sessions. */
+static Session* session_get(const char *id, Session **evicted) {
+    *evicted = NULL;
+    uint32_t bucket = session_hash(id);
+    for (Session *s = g_engine.buckets[bucket]; s; s = s->hash_next) {
+        if (strcmp(s->id, id) == 0) {
+            session_touch(s);
+            return s;
+        }
     }
-    
-    size_t read = fread(file_content, 1, file_size, f);
-    fclose(f);
-    
-    /* Send response */
-    send_response(client, 200, "OK", content_type, file_content, read);
-    free(file_content);
-}
-
-/* Handle HTTP request */
-void handle_request(SOCKET client) {
-    char buffer[BUFFER_SIZE];
-    int bytes_received = recv(client, buffer, sizeof(buffer) - 1, 0);
-    
-    if (bytes_received <= 0) {
-        close_socket(client);
-        return;
+
+    if (g_engine.session_count >= g_engine.max_sessions) {
+        *evicted = session_evict();
+        if (!*evicted) return NULL;
     }
-    
-    buffer[bytes_received] = '\0';
-    
-    HttpRequest req;
-    if (parse_request(buffer, bytes_received, &req) != 0) {
-        send_error(client, 400, "Invalid request");
-        close_socket(client);
-        return;
+
+    Session *s = calloc(1, sizeof(Session));
+    if (!s) return NULL;
+    snprintf(s->id, sizeof(s->id), "%s", id);
+    s->hash_next = g_engine.buckets[bucket];
+    g_engine.buckets[bucket] = s;
+    g_engine.session_count++;
+    session_touch(s);
+    return s;
+}
+
+static void session_destroy(Session *s) {
+    if (!s) return;
+    if (s->brain) melvin_destroy(s->brain);
+    free(s);
+}
+
+static void session_make_ready(Session *s) {
+    s->queued = true;
+    s->ready_next = NULL;
+    if (g_engine.ready_tail) g_engine.ready_tail->ready_next = s;
+    else g_engine.ready_head = s;
+    g_engine.ready_tail = s;
+    pthread_cond_signal(&g_engine.ready);
+}
+
+/* Append a job to a session's queue and wake a worker if needed */
+static void session_push_job(Session *s, EngineJob *job) {
+    job->session = s;
+    job->next = NULL;
+    if (s->jobs_tail) s->jobs_tail->next = job;
+    else s->jobs_head = job;
+    s->jobs_tail = job;
+    g_engine.pending_jobs++;
+    if (!s->queued && !s->running) session_make_ready(s);
+}
+
+/* JSON-escaped form of one output byte in out; 0 if the byte isn't sent
+ * (non-printable, or not a byte). Streamed and whole replies both use it, so
+ * the tokens of a stream add up to the "response" of the same episode. */
+static size_t json_escape_byte(uint32_t node_id, char out[2]) {
+    if (node_id >= 256) return 0;  /* Not a valid byte */
+    char c = (char)node_id;
+    switch (c) {
+        case '"':  out[0] = '\\'; out[1] = '"';  return 2;
+        case '\\': out[0] = '\\'; out[1] = '\\'; return 2;
+        case '\n': out[0] = '\\'; out[1] = 'n';  return 2;
+        case '\r': out[0] = '\\'; out[1] = 'r';  return 2;
+        case '\t': out[0] = '\\'; out[1] = 't';  return 2;
     }
-    
-    /* Debug: log request */
-    fprintf(stderr, "Request: %s %s\n", req.method, req.path);
-    
-    /* Handle OPTIONS (CORS preflight) */
-    if (strcmp(req.method, "OPTIONS") == 0) {
-        send_response(client, 200, "OK", "text/plain", "", 0);
-        close_socket(client);
-        return;
+    if (c >= 32 && c < 127) {
+        out[0] = c;  /* Printable ASCII */
+        return 1;
     }
-    
-    /* Route requests */
-    if (strcmp(req.path, "/api/chat") == 0 && strcmp(req.method, "POST") == 0) {
-        handle_chat(client, &req);
-    } else if (strcmp(req.path, "/api/status") == 0 && strcmp(req.method, "GET") == 0) {
-        handle_status(client);
-    } else {
-        /* Serve static file */
-        serve_file(client, req.path);
+    return 0;  /* Skip non-printable characters */
+}
+
+/* Escape the engine's output as a JSON string body; fields are extra
+ * pre-formatted members appended after "response" */
+static char* build_chat_response(const uint32_t *output, uint32_t output_len, const char *fields) {
+    Buffer json = {0};
+    buf_append(&json, "{\"response\":\"", 13);
+
+    for (uint32_t i = 0; i < output_len; i++) {
+        char escaped[2];
+        size_t n = json_escape_byte(output[i], escaped);
+        if (n > 0) buf_append(&json, escaped, n);
     }
-    
-    close_socket(client);
+
+    buf_append(&json, "\",", 2);
+    buf_append(&json, fields, strlen(fields));
+    buf_append(&json, "}", 2);  /* Includes the NUL terminator */
+    return json.data;
 }
 
-/* Initialize networking */
-int init_networking(void) {
-#ifdef _WIN32
-    WSADATA wsa;
-    if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) {
-        fprintf(stderr, "WSAStartup failed\n");
-        return -1;
+/* RPC chat reply: u8 stop | u8[3] | f32 error_rate | output bytes */
+static char* build_chat_rpc(const uint32_t *output, uint32_t output_len, MelvinStop stop,
+                            float error_rate, size_t *len) {
+    uint8_t *body = malloc(8 + output_len);
+    if (!body) return NULL;
+    uint32_t bits;
+    memcpy(&bits, &error_rate, sizeof(bits));
+    memset(body, 0, 8);
+    body[0] = (uint8_t)stop;
+    put_le32(body + 4, bits);
+
+    size_t n = 8;
+    for (uint32_t i = 0; i < output_len; i++) {
+        if (output[i] < 256) body[n++] = (uint8_t)output[i];  /* Raw bytes, nothing escaped */
     }
-#endif
-    return 0;
+    *len = n;
+    return (char*)body;
 }
 
-void cleanup_networking(void) {
-#ifdef _WIN32
-    WSACleanup();
-#endif
+static void engine_wake_loop(void) {
+    uint64_t one = 1;
+    ssize_t ignored = write(g_server.wake_fd, &one, sizeof(one));
+    (void)ignored;
 }
 
-/* Main server loop */
-int main(void) {
-    printf("MELVIN HTTP SERVER\n");
-    printf("==================\n\n");
-    
-    /* Initialize melvin */
-    printf("Initializing Melvin...\n");
-    g_melvin = melvin_create();
-    if (!g_melvin) {
-        fprintf(stderr, "Failed to create Melvin instance\n");
-        return 1;
+/* Output hook for streaming jobs: runs on the worker for every emitted node */
+static void stream_output_byte(void *ctx, uint32_t node_id) {
+    char escaped[2];
+    size_t n = json_escape_byte(node_id, escaped);
+    if (n == 0) return;  /* Left out of the reply too */
+    EngineJob *job = ctx;
+
+    char event[32];
+    int len = snprintf(event, sizeof(event), "data: {\"token\":\"%.*s\"}\n\n", (int)n, escaped);
+
+    pthread_mutex_lock(&g_engine.lock);
+    bool appended = buf_append(&job->stream_out, event, (size_t)len);
+    bool wake = appended && !job->stream_queued;
+    if (wake) {
+        job->stream_queued = true;
+        job->stream_next = NULL;
+        if (g_engine.stream_tail) g_engine.stream_tail->stream_next = job;
+        else g_engine.stream_head = job;
+        g_engine.stream_tail = job;
     }
-    printf("Melvin initialized successfully\n\n");
-    
-    /* Initialize networking */
-    if (init_networking() != 0) {
-        melvin_destroy(g_melvin);
-        return 1;
+    pthread_mutex_unlock(&g_engine.lock);
+
+    if (wake) engine_wake_loop();
+}
+
+/* Fold a session's new counters into the totals and keep its snapshot */
+static void engine_record_stats(Session *s, const MelvinStats *stats) {
+    pthread_mutex_lock(&g_engine.lock);
+    g_engine.totals.episodes += stats->episodes - s->stats.episodes;
+    g_engine.totals.steps += stats->steps - s->stats.steps;
+    g_engine.totals.outputs += stats->outputs - s->stats.outputs;
+    for (int p = 0; p < MELVIN_PHASE_COUNT; p++) {
+        g_engine.totals.phase_ns[p] += stats->phase_ns[p] - s->stats.phase_ns[p];
     }
-    
-    /* Create socket */
-    SOCKET server_socket = socket(AF_INET, SOCK_STREAM, 0);
-    if (server_socket == INVALID_SOCKET) {
-        fprintf(stderr, "Socket creation failed: %d\n", SOCKET_ERROR_CODE);
-        cleanup_networking();
-        melvin_destroy(g_melvin);
-        return 1;
+    for (int r = 0; r < MELVIN_STOP_COUNT; r++) {
+        g_engine.totals.stops[r] += stats->stops[r] - s->stats.stops[r];
     }
-    
-    /* Set socket options (reuse address) */
-    int opt = 1;
-#ifdef _WIN32
-    setsockopt(server_socket, SOL_SOCKET, SO_REUSEADDR, (char*)&opt, sizeof(opt));
-#else
-    setsockopt(server_socket, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
-#endif
-    
-    /* Get port from environment (Railway sets this) */
-    int port = get_port();
-    
-    /* Bind socket */
-    struct sockaddr_in server_addr;
-    memset(&server_addr, 0, sizeof(server_addr));
-    server_addr.sin_family = AF_INET;
-    server_addr.sin_addr.s_addr = INADDR_ANY;
-    server_addr.sin_port = htons(port);
-    
-    if (bind(server_socket, (struct sockaddr*)&server_addr, sizeof(server_addr)) == SOCKET_ERROR) {
-        fprintf(stderr, "Bind failed: %d\n", SOCKET_ERROR_CODE);
-        close_socket(server_socket);
-        cleanup_networking();
-        melvin_destroy(g_melvin);
-        return 1;
+    s->stats = *stats;
+    if (g_server.profile_sample > 0) {
+        MelvinProfile prof;
+        melvin_get_profile(s->brain, &prof);
+        g_engine.profile.episodes_seen += prof.episodes_seen - s->profile.episodes_seen;
+        g_engine.profile.episodes_sampled += prof.episodes_sampled - s->profile.episodes_sampled;
+        g_engine.profile.episode_ns += prof.episode_ns - s->profile.episode_ns;
+        for (int k = 0; k < MELVIN_PROF_COUNT; k++) {
+            MelvinProfileCounter *total = &g_engine.profile.sections[k];
+            total->calls += prof.sections[k].calls - s->profile.sections[k].calls;
+            total->ns += prof.sections[k].ns - s->profile.sections[k].ns;
+            total->cycles += prof.sections[k].cycles - s->profile.sections[k].cycles;
+        }
+        s->profile = prof;
     }
-    
-    /* Listen */
-    if (listen(server_socket, 5) == SOCKET_ERROR) {
-        fprintf(stderr, "Listen failed: %d\n", SOCKET_ERROR_CODE);
-        close_socket(server_socket);
-        cleanup_networking();
-        melvin_destroy(g_melvin);
-        return 1;
+    pthread_mutex_unlock(&g_engine.lock);
+}
+
+/* The job's limits as a budget, with the deadline turned into time left.
+ * Expired jobs are shed before this; one that expires in between gets one step. */
+static void job_budget(const EngineJob *job, MelvinBudget *budget) {
+    budget->max_steps = job->limits.max_steps;
+    budget->max_output = job->limits.max_output;
+    budget->time_limit_ns = 0;
+    if (job->limits.deadline_ns) {
+        uint64_t now = now_ns();
+        budget->time_limit_ns = (job->limits.deadline_ns > now) ? job->limits.deadline_ns - now : 1;
     }
-    
-    printf("Server listening on port %d\n", port);
-    printf("Melvin is ready to chat!\n\n");
-    
-    /* Main loop */
-    while (1) {
-        struct sockaddr_in client_addr;
-#ifdef _WIN32
-        int addr_len = sizeof(client_addr);
-#else
-        socklen_t addr_len = sizeof(client_addr);
-#endif
-        
-        SOCKET client_socket = accept(server_socket, (struct sockaddr*)&client_addr, &addr_len);
-        if (client_socket == INVALID_SOCKET) {
-            fprintf(stderr, "Accept failed: %d\n", SOCKET_ERROR_CODE);
-            continue;
-        }
-        
-        /* Handle request (sequential for simplicity) */
-        handle_request(client_socket);
+}
+
+/* "truncated":...,"stop_reason":... for a reply (no braces) */
+static void stop_fields(char *out, size_t size, MelvinStop stop) {
+    if (stop == MELVIN_STOP_NATURAL) {
+        snprintf(out, size, "\"truncated\":false");
+    } else {
+        snprintf(out, size, "\"truncated\":true,\"stop_reason\":\"%s\"", melvin_stop_name(stop));
     }
-    
-    /* Cleanup (never reached, but good practice) */
-    close_socket(server_socket);
-    cleanup_networking();
-    melvin_destroy(g_melvin);
-    
-    return 0;
+}
+
+/* Learn every pair in a training chunk */
+static void train_run_chunk(MelvinGraph *brain, EngineJob *job) {
+    const uint8_t *p = (const uint8_t*)job->pairs.data;
+    for (uint32_t i = 0; i < job->pair_count; i++) {
+        uint32_t input_len, target_len;
+        memcpy(&input_len, p, sizeof(uint32_t));
+        const uint8_t *input = p + sizeof(uint32_t);
+        p = input + input_len;
+        memcpy(&target_len, p, sizeof(uint32_t));
+        const uint8_t *target = p + sizeof(uint32_t);
+        p = target + target_len;
+        run_episode(brain, input, input_len, target, target_len);
+    }
+}
+
+static void* engine_worker_main(void *arg) {
+    (void)arg;
+    for (;;) {
+        pthread_mutex_lock(&g_engine.lock);
+        while (!g_engine.ready_head) {
+            pthread_cond_wait(&g_engine.ready, &g_engine.lock);
+        }
+        Session *s = g_engine.ready_head;
+        g_engine.ready_head = s->ready_next;
+        if (!g_engine.ready_head) g_engine.ready_tail = NULL;
+        s->queued = false;
+        s->running = true;
+
+        EngineJob *job = s->jobs_head;
+        s->jobs_head = job->next;
+        if (!s->jobs_head) s->jobs_tail = NULL;
+        g_engine.busy_workers++;
+        pthread_mutex_unlock(&g_engine.lock);
+
+        /* Only this worker touches the session's brain while it is running */
+        if (!s->brain) {
+            s->brain = melvin_clone(g_base);
+        }
+
+        uint64_t started = now_ns();
+        if (job->limits.deadline_ns && started >= job->limits.deadline_ns) {
+            job->status = 503;  /* Expired while queued - don't spend a worker on it */
+        } else if (s->brain && (job->train || job->rpc_op == RPC_TRAIN)) {
+            train_run_chunk(s->brain, job);
+
+            MelvinStats stats;
+            melvin_get_stats(s->brain, &stats);
+            engine_record_stats(s, &stats);
+            job->status = 200;
+        } else if (s->brain && job->rpc_op == RPC_SAVE) {
+            char path[1024];
+            snprintf(path, sizeof(path), "%s/%s.m", g_server.save_dir, s->id);
+            job->status = 500;
+            if (melvin_save_brain(s->brain, path) == 0 && (job->response = strdup(path))) {
+                job->response_len = strlen(path);
+                job->status = 200;
+            }
+        } else if (s->brain) {
+            /* Run episode (no target - pure inference/chat) */
+            MelvinBudget budget;
+            job_budget(job, &budget);
+            melvin_set_budget(s->brain, &budget);
+            if (job->stream) melvin_set_output_hook(s->brain, stream_output_byte, job);
+            run_episode(s->brain, (const uint8_t*)job->message, job->message_len, NULL, 0);
+            melvin_set_output_hook(s->brain, NULL, NULL);
+            melvin_set_budget(s->brain, NULL);
+
+            MelvinStats stats;
+            melvin_get_stats(s->brain, &stats);
+            engine_record_stats(s, &stats);
+
+            uint32_t *output;
+            uint32_t output_len;
+            melvin_get_output(s->brain, &output, &output_len);
+
+            /* Session ids are restricted to [A-Za-z0-9._-], no escaping needed */
+            char fields[128 + MAX_SESSION_ID];
+            int len = snprintf(fields, sizeof(fields), "\"error_rate\":%.3f,\"session\":\"%s\",",
+                               melvin_get_error_rate(s->brain), s->id);
+            stop_fields(fields + len, sizeof(fields) - (size_t)len, melvin_get_stop_reason(s->brain));
+            if (job->rpc_op) {
+                job->response = build_chat_rpc(output, output_len, melvin_get_stop_reason(s->brain),
+                                               melvin_get_error_rate(s->brain), &job->response_len);
+            } else if (job->stream) {
+                /* The bytes already went out - the reply ends with the stats */
+                job->response = malloc(strlen(fields) + 3);
+                if (job->response) sprintf(job->response, "{%s}", fields);
+            } else {
+                job->response = build_chat_response(output, output_len, fields);
+            }
+            job->status = job->response ? 200 : 500;
+        } else {
+            job->status = 500;
+        }
+
+        /* Hand the result back to the loop; requeue the session if more arrived */
+        uint64_t service = now_ns() - started;
+        pthread_mutex_lock(&g_engine.lock);
+        if (job->status == 503) {
+            g_engine.shed[SHED_EXPIRED]++;
+        } else if (job->message) {
+            g_engine.service_ns = g_engine.service_ns ? (g_engine.service_ns * 7 + service) / 8 : service;
+        }
+        if (job->pair_count && job->status == 200) {
+            g_engine.train_pairs += job->pair_count;
+            if (job->train) job->train->pairs_trained += job->pair_count;
+        }
+        if (job->train) {
+            job->train->chunks_in_flight--;
+            g_engine.train_chunks--;
+        }
+        job->next = NULL;
+        if (g_engine.done_tail) g_engine.done_tail->next = job;
+        else g_engine.done_head = job;
+        g_engine.done_tail = job;
+        g_engine.pending_jobs--;
+        g_engine.busy_workers--;
+        s->running = false;
+        if (s->jobs_head) session_make_ready(s);
+        pthread_mutex_unlock(&g_engine.lock);
+
+        engine_wake_loop();
+    }
+    return NULL;
+}
+
+/* Queue a job on its session. Returns 0, or an HTTP status to reply with instead. */
+static int engine_submit(EngineJob *job, const char *session_id, uint32_t *retry_after) {
+    Session *evicted = NULL;
+    int status = 0;
+
+    /* Jobs ahead of this one, spread over the workers, each about one service time */
+    pthread_mutex_lock(&g_engine.lock);
+    uint64_t wait_ns = (uint64_t)(g_engine.pending_jobs / g_engine.worker_count) * g_engine.service_ns;
+    if (g_engine.pending_jobs - g_engine.train_chunks >= g_engine.max_pending) {
+        status = 503;  /* Backpressure: the workers are saturated */
+        g_engine.shed[SHED_QUEUE_FULL]++;
+    } else if (job->limits.deadline_ns && now_ns() + wait_ns >= job->limits.deadline_ns) {
+        status = 503;  /* Would only expire in the queue - say so now */
+        g_engine.shed[SHED_EXPECTED_WAIT]++;
+    } else {
+        Session *s = session_get(session_id, &evicted);
+        if (!s) {
+            status = 503;  /* Every session slot is busy */
+            g_engine.shed[SHED_QUEUE_FULL]++;
+        } else {
+            session_push_job(s, job);
+        }
+    }
+    *retry_after = engine_retry_after_locked();
+    pthread_mutex_unlock(&g_engine.lock);
+
+    session_destroy(evicted);
+    return status;
+}
+
+/* Clone the base for the default session and start the workers */
+static bool engine_start(uint32_t workers, uint32_t max_sessions, uint32_t max_pending, uint32_t max_train_chunks) {
+    g_engine.worker_count = workers;
+    g_engine.max_sessions = max_sessions;
+    g_engine.max_pending = max_pending;
+    g_engine.max_train_chunks = max_train_chunks;
+
+    Session *evicted = NULL;
+    Session *def = session_get(DEFAULT_SESSION_ID, &evicted);
+    if (!def) return false;
+    def->pinned = true;
+    def->brain = melvin_clone(g_base);
+    if (!def->brain) return false;
+    melvin_get_stats(def->brain, &def->stats);
+    g_engine.default_session = def;
+
+    for (uint32_t i = 0; i < workers; i++) {
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, engine_worker_main, NULL) != 0) {
+            return false;
+        }
+        pthread_detach(thread);
+    }
+    return true;
+}
+
+/* ============================================================================
+ * ENGINE: INFERENCE BATCHER
+ *
+ * /api/infer answers from the base brain without learning. One batcher
+ * thread gathers concurrent requests into micro-batches: it waits for the
+ * first request, then up to MELVIN_BATCH_WAIT_US for the batch to fill to
+ * MELVIN_BATCH_MAX, and melvin_infer_batch() runs the whole batch in
+ * lock-step so every step makes one pass over pattern and edge memory for
+ * all members. Finished jobs go back to the loop through the same done list
+ * as chat jobs.
+ * ============================================================================ */
+
+#define DEFAULT_BATCH_MAX 8          /* Requests per batch (override: MELVIN_BATCH_MAX) */
+#define DEFAULT_BATCH_WAIT_US 2000   /* Wait for a batch to fill (override: MELVIN_BATCH_WAIT_US) */
+#define LATENCY_WINDOW 4096          /* Recent requests kept for p50/p99 */
+#define THROUGHPUT_WINDOW_NS 10000000000ull  /* Throughput is averaged over 10s */
+
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t arrived;
+    EngineJob *head, *tail;
+    uint32_t queued;
+    uint32_t max_queued;
+    uint32_t max_batch;
+    uint64_t max_wait_ns;
+
+    /* Stats */
+    uint64_t requests;                     /* Answered */
+    uint64_t batches;
+    uint64_t stops[MELVIN_STOP_COUNT];     /* Answers by how generation ended */
+    uint64_t latency_ns[LATENCY_WINDOW];   /* Queued -> answer ready */
+    uint64_t finished_ns[LATENCY_WINDOW];  /* When each of those finished */
+    uint32_t latency_next;
+    uint32_t latency_count;
+} InferBatcher;
+
+static InferBatcher g_batcher = {
+    .lock = PTHREAD_MUTEX_INITIALIZER
+};
+
+static void* batcher_main(void *arg) {
+    (void)arg;
+    uint32_t max_batch = g_batcher.max_batch;
+    EngineJob **jobs = malloc(sizeof(EngineJob*) * max_batch);
+    MelvinInferRequest *requests = malloc(sizeof(MelvinInferRequest) * max_batch);
+    if (!jobs || !requests) {
+        fprintf(stderr, "Inference batcher: out of memory\n");
+        return NULL;
+    }
+
+    for (;;) {
+        pthread_mutex_lock(&g_batcher.lock);
+        while (!g_batcher.head) {
+            pthread_cond_wait(&g_batcher.arrived, &g_batcher.lock);
+        }
+
+        /* Give the batch a moment to fill */
+        uint64_t deadline = now_ns() + g_batcher.max_wait_ns;
+        struct timespec until = {
+            .tv_sec = (time_t)(deadline / 1000000000ull),
+            .tv_nsec = (long)(deadline % 1000000000ull)
+        };
+        while (g_batcher.queued < max_batch) {
+            if (pthread_cond_timedwait(&g_batcher.arrived, &g_batcher.lock, &until) == ETIMEDOUT) break;
+        }
+
+        uint32_t count = 0;
+        while (g_batcher.head && count < max_batch) {
+            jobs[count++] = g_batcher.head;
+            g_batcher.head = g_batcher.head->next;
+        }
+        if (!g_batcher.head) g_batcher.tail = NULL;
+        g_batcher.queued -= count;
+        pthread_mutex_unlock(&g_batcher.lock);
+
+        /* Requests whose deadline passed in the queue are answered 503 without
+         * running; the rest move to the front of jobs[] */
+        uint32_t run = 0;
+        uint64_t now = now_ns();
+        for (uint32_t i = 0; i < count; i++) {
+            EngineJob *job = jobs[i];
+            if (job->limits.deadline_ns && now >= job->limits.deadline_ns) {
+                job->status = 503;
+                count_shed(SHED_EXPIRED);
+                continue;
+            }
+            jobs[i] = jobs[run];
+            jobs[run++] = job;
+        }
+
+        for (uint32_t i = 0; i < run; i++) {
+            requests[i].input = (const uint8_t*)jobs[i]->message;
+            requests[i].input_len = jobs[i]->message_len;
+            requests[i].output = NULL;
+            requests[i].output_len = 0;
+            job_budget(jobs[i], &requests[i].budget);
+        }
+        if (run > 0) melvin_infer_batch(g_base, requests, run);
+
+        for (uint32_t i = 0; i < run; i++) {
+            char fields[96];
+            int len = snprintf(fields, sizeof(fields), "\"batch_size\":%u,", run);
+            stop_fields(fields + len, sizeof(fields) - (size_t)len, requests[i].stop);
+            jobs[i]->response = build_chat_response(requests[i].output, requests[i].output_len, fields);
+            jobs[i]->status = jobs[i]->response ? 200 : 500;
+            free(requests[i].output);
+        }
+
+        uint64_t finished = now_ns();
+        pthread_mutex_lock(&g_batcher.lock);
+        if (run > 0) g_batcher.batches++;
+        g_batcher.requests += run;
+        for (uint32_t i = 0; i < run; i++) {
+            g_batcher.stops[requests[i].stop]++;
+            g_batcher.latency_ns[g_batcher.latency_next] = finished - jobs[i]->submitted_ns;
+            g_batcher.finished_ns[g_batcher.latency_next] = finished;
+            g_batcher.latency_next = (g_batcher.latency_next + 1) % LATENCY_WINDOW;
+            if (g_batcher.latency_count < LATENCY_WINDOW) g_batcher.latency_count++;
+        }
+        pthread_mutex_unlock(&g_batcher.lock);
+
+        /* Hand the results back to the loop */
+        pthread_mutex_lock(&g_engine.lock);
+        for (uint32_t i = 0; i < count; i++) {
+            jobs[i]->next = NULL;
+            if (g_engine.done_tail) g_engine.done_tail->next = jobs[i];
+            else g_engine.done_head = jobs[i];
+            g_engine.done_tail = jobs[i];
+        }
+        pthread_mutex_unlock(&g_engine.lock);
+
+        engine_wake_loop();
+    }
+    return NULL;
+}
+
+/* Queue an inference job. Returns 0, or an HTTP status to reply with instead. */
+static int batcher_submit(EngineJob *job) {
+    int status = 0;
+    job->submitted_ns = now_ns();
+    job->next = NULL;
+
+    pthread_mutex_lock(&g_batcher.lock);
+    if (g_batcher.queued >= g_batcher.max_queued) {
+        status = 503;
+    } else {
+        if (g_batcher.tail) g_batcher.tail->next = job;
+        else g_batcher.head = job;
+        g_batcher.tail = job;
+        g_batcher.queued++;
+        pthread_cond_signal(&g_batcher.arrived);
+    }
+    pthread_mutex_unlock(&g_batcher.lock);
+    if (status) count_shed(SHED_QUEUE_FULL);
+    return status;
+}
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+/* Format the batcher's counters and latency percentiles as a JSON object */
+static void batcher_stats_json(char *out, size_t size) {
+    static uint64_t sorted[LATENCY_WINDOW];  /* Only the loop thread calls this */
+
+    pthread_mutex_lock(&g_batcher.lock);
+    uint64_t requests = g_batcher.requests;
+    uint64_t batches = g_batcher.batches;
+    uint32_t queued = g_batcher.queued;
+    uint32_t count = g_batcher.latency_count;
+    memcpy(sorted, g_batcher.latency_ns, sizeof(uint64_t) * count);
+
+    uint64_t now = now_ns();
+    uint32_t recent = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (now - g_batcher.finished_ns[i] <= THROUGHPUT_WINDOW_NS) recent++;
+    }
+    pthread_mutex_unlock(&g_batcher.lock);
+
+    double p50 = 0.0, p99 = 0.0;
+    if (count > 0) {
+        qsort(sorted, count, sizeof(uint64_t), compare_u64);
+        p50 = sorted[count / 2] / 1e6;
+        p99 = sorted[(count * 99) / 100] / 1e6;
+    }
+    snprintf(out, size,
+        "{\"requests\":%llu,\"batches\":%llu,\"avg_batch\":%.2f,\"queue_depth\":%u,"
+        "\"p50_ms\":%.3f,\"p99_ms\":%.3f,\"throughput_rps\":%.1f}",
+        (unsigned long long)requests, (unsigned long long)batches,
+        batches ? (double)requests / batches : 0.0, queued,
+        p50, p99, recent / (THROUGHPUT_WINDOW_NS / 1e9));
+}
+
+static bool batcher_start(uint32_t max_batch, uint32_t max_wait_us, uint32_t max_queued) {
+    g_batcher.max_batch = max_batch > 0 ? max_batch : 1;
+    g_batcher.max_wait_ns = (uint64_t)max_wait_us * 1000ull;
+    g_batcher.max_queued = max_queued;
+
+    /* Deadlines are CLOCK_MONOTONIC, so the condvar must be too */
+    pthread_condattr_t attr;
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&g_batcher.arrived, &attr);
+    pthread_condattr_destroy(&attr);
+
+    pthread_t thread;
+    if (pthread_create(&thread, NULL, batcher_main, NULL) != 0) {
+        return false;
+    }
+    pthread_detach(thread);
+    return true;
+}
+
+/* ============================================================================
+ * METRICS
+ *
+ * HTTP counters and latency histograms are only touched by the loop thread,
+ * so they need no lock. Engine counters come from melvin_get_stats() and
+ * melvin_get_profile(), taken by each worker after its episode (see
+ * engine_record_stats), and structure
+ * gauges are summed over the live sessions when /metrics is scraped.
+ * ============================================================================ */
+
+enum {
+    ENDPOINT_CHAT,
+    ENDPOINT_INFER,
+    ENDPOINT_TRAIN,
+    ENDPOINT_STATUS,
+    ENDPOINT_METRICS,
+    ENDPOINT_STATIC,
+    ENDPOINT_OTHER,
+    ENDPOINT_COUNT
+};
+
+static const char *endpoint_names[ENDPOINT_COUNT] = {
+    "chat", "infer", "train", "status", "metrics", "static", "other"
+};
+
+/* RPC frames are counted apart from HTTP, by op (RPC_NONE: unknown or unframeable) */
+static const char *rpc_op_names[RPC_OP_COUNT] = {"unknown", "chat", "train", "status", "save"};
+static const char *rpc_status_names[RPC_STATUS_COUNT] = {"ok", "bad_request", "busy", "error"};
+
+/* The RPC status byte for the HTTP status a reply was built from */
+static int rpc_status_byte(int status) {
+    return status == 200 ? RPC_OK :
+           status == 429 || status == 503 ? RPC_BUSY :
+           status < 500 ? RPC_BAD_REQUEST : RPC_ERROR;
+}
+
+/* Upper bounds of the latency buckets, in seconds (+Inf is implicit) */
+static const double latency_buckets[] = {
+    0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1.0, 2.5, 5.0, 10.0
+};
+#define LATENCY_BUCKETS (sizeof(latency_buckets) / sizeof(latency_buckets[0]))
+
+typedef struct {
+    uint64_t requests[ENDPOINT_COUNT][5];            /* By status class 1xx..5xx */
+    uint64_t buckets[ENDPOINT_COUNT][LATENCY_BUCKETS + 1];
+    double latency_sum[ENDPOINT_COUNT];
+    uint64_t rpc_requests[RPC_OP_COUNT][RPC_STATUS_COUNT];
+    uint64_t rpc_buckets[RPC_OP_COUNT][LATENCY_BUCKETS + 1];
+    double rpc_latency_sum[RPC_OP_COUNT];
+    uint64_t train_bad_lines;                        /* Upload lines that weren't a pair */
+} HttpMetrics;
+
+static HttpMetrics g_http_metrics;
+static MelvinStats g_base_stats;  /* The base brain never changes */
+
+/* Count the reply just queued for c's current request */
+static void metrics_record_request(Connection *c) {
+    double seconds = (now_ns() - c->request_start_ns) / 1e9;
+    size_t b = 0;
+    while (b < LATENCY_BUCKETS && seconds > latency_buckets[b]) b++;
+
+    if (c->rpc) {
+        int op = (c->endpoint > RPC_NONE && c->endpoint < RPC_OP_COUNT) ? c->endpoint : RPC_NONE;
+        g_http_metrics.rpc_requests[op][rpc_status_byte(c->status)]++;
+        g_http_metrics.rpc_latency_sum[op] += seconds;
+        g_http_metrics.rpc_buckets[op][b]++;
+        return;
+    }
+
+    int endpoint = (c->endpoint >= 0 && c->endpoint < ENDPOINT_COUNT) ? c->endpoint : ENDPOINT_OTHER;
+    int status_class = c->status / 100 - 1;
+    if (status_class < 0 || status_class > 4) status_class = 4;
+    g_http_metrics.requests[endpoint][status_class]++;
+    g_http_metrics.latency_sum[endpoint] += seconds;
+    g_http_metrics.buckets[endpoint][b]++;
+}
+
+static void metric_printf(Buffer *out, const char *fmt, ...) {
+    char line[512];
+    va_list args;
+    va_start(args, fmt);
+    int len = vsnprintf(line, sizeof(line), fmt, args);
+    va_end(args);
+    if (len > 0) buf_append(out, line, (size_t)len < sizeof(line) ? (size_t)len : sizeof(line) - 1);
+}
+
+static void metric_header(Buffer *out, const char *name, const char *type, const char *help) {
+    metric_printf(out, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+/* One labelled series of a latency histogram */
+static void metric_histogram(Buffer *out, const char *name, const char *label, const char *value,
+                             const uint64_t *buckets, double sum) {
+    uint64_t cumulative = 0;
+    for (size_t b = 0; b < LATENCY_BUCKETS; b++) {
+        cumulative += buckets[b];
+        metric_printf(out, "%s_bucket{%s=\"%s\",le=\"%g\"} %llu\n",
+                      name, label, value, latency_buckets[b], (unsigned long long)cumulative);
+    }
+    cumulative += buckets[LATENCY_BUCKETS];
+    metric_printf(out, "%s_bucket{%s=\"%s\",le=\"+Inf\"} %llu\n", name, label, value, (unsigned long long)cumulative);
+    metric_printf(out, "%s_sum{%s=\"%s\"} %.6f\n", name, label, value, sum);
+    metric_printf(out, "%s_count{%s=\"%s\"} %llu\n", name, label, value, (unsigned long long)cumulative);
+}
+
+/* Structure and memory gauges for one brain label */
+static void metrics_brain(Buffer *out, const char *brain, const MelvinStats *st, const char *part) {
+    if (strcmp(part, "patterns") == 0) {
+        metric_printf(out, "melvin_patterns{brain=\"%s\"} %u\n", brain, st->patterns);
+    } else if (strcmp(part, "edges") == 0) {
+        metric_printf(out, "melvin_edges{brain=\"%s\",state=\"active\"} %u\n", brain, st->edges_active);
+        metric_printf(out, "melvin_edges{brain=\"%s\",state=\"tombstoned\"} %u\n", brain, st->edges_tombstoned);
+        metric_printf(out, "melvin_edges{brain=\"%s\",state=\"pattern\"} %u\n", brain, st->pattern_edges);
+    } else {
+        metric_printf(out, "melvin_memory_bytes{brain=\"%s\",category=\"graph\"} %llu\n",
+                      brain, (unsigned long long)st->memory_graph);
+        metric_printf(out, "melvin_memory_bytes{brain=\"%s\",category=\"edges\"} %llu\n",
+                      brain, (unsigned long long)st->memory_edges);
+        metric_printf(out, "melvin_memory_bytes{brain=\"%s\",category=\"patterns\"} %llu\n",
+                      brain, (unsigned long long)st->memory_patterns);
+        metric_printf(out, "melvin_memory_bytes{brain=\"%s\",category=\"pattern_edges\"} %llu\n",
+                      brain, (unsigned long long)st->memory_pattern_edges);
+        metric_printf(out, "melvin_memory_bytes{brain=\"%s\",category=\"buffers\"} %llu\n",
+                      brain, (unsigned long long)st->memory_buffers);
+    }
+}
+
+/* Handle /metrics endpoint (Prometheus text format) */
+void handle_metrics(Connection *c) {
+    /* Snapshot engine state under its lock */
+    pthread_mutex_lock(&g_engine.lock);
+    MelvinStats totals = g_engine.totals;
+    MelvinProfile profile = g_engine.profile;
+    MelvinStats sessions = {0};
+    for (Session *s = g_engine.lru_head; s; s = s->lru_next) {
+        sessions.patterns += s->stats.patterns;
+        sessions.edges_active += s->stats.edges_active;
+        sessions.edges_tombstoned += s->stats.edges_tombstoned;
+        sessions.pattern_edges += s->stats.pattern_edges;
+        sessions.memory_graph += s->stats.memory_graph;
+        sessions.memory_edges += s->stats.memory_edges;
+        sessions.memory_patterns += s->stats.memory_patterns;
+        sessions.memory_pattern_edges += s->stats.memory_pattern_edges;
+        sessions.memory_buffers += s->stats.memory_buffers;
+    }
+    uint32_t workers = g_engine.worker_count;
+    uint32_t busy = g_engine.busy_workers;
+    uint32_t session_count = g_engine.session_count;
+    uint32_t chat_queued = g_engine.pending_jobs - g_engine.busy_workers;
+    uint64_t train_pairs = g_engine.train_pairs;
+    uint64_t shed[SHED_COUNT];
+    memcpy(shed, g_engine.shed, sizeof(shed));
+    pthread_mutex_unlock(&g_engine.lock);
+
+    pthread_mutex_lock(&g_batcher.lock);
+    uint64_t infer_requests = g_batcher.requests;
+    uint64_t infer_batches = g_batcher.batches;
+    uint64_t infer_stops[MELVIN_STOP_COUNT];
+    memcpy(infer_stops, g_batcher.stops, sizeof(infer_stops));
+    uint32_t infer_queued = g_batcher.queued;
+    pthread_mutex_unlock(&g_batcher.lock);
+
+    Buffer out = {0};
+    static const char *classes[5] = {"1xx", "2xx", "3xx", "4xx", "5xx"};
+
+    metric_header(&out, "melvin_http_requests_total", "counter", "HTTP requests answered, by endpoint and status class.");
+    for (int e = 0; e < ENDPOINT_COUNT; e++) {
+        for (int k = 0; k < 5; k++) {
+            if (g_http_metrics.requests[e][k] == 0) continue;
+            metric_printf(&out, "melvin_http_requests_total{endpoint=\"%s\",code=\"%s\"} %llu\n",
+                          endpoint_names[e], classes[k], (unsigned long long)g_http_metrics.requests[e][k]);
+        }
+    }
+
+    metric_header(&out, "melvin_http_request_duration_seconds", "histogram",
+                  "Time from parsing a request to queuing its complete reply.");
+    for (int e = 0; e < ENDPOINT_COUNT; e++) {
+        metric_histogram(&out, "melvin_http_request_duration_seconds", "endpoint", endpoint_names[e],
+                         g_http_metrics.buckets[e], g_http_metrics.latency_sum[e]);
+    }
+
+    metric_header(&out, "melvin_rpc_requests_total", "counter", "Binary RPC frames answered, by op and reply status.");
+    for (int op = 0; op < RPC_OP_COUNT; op++) {
+        for (int k = 0; k < RPC_STATUS_COUNT; k++) {
+            if (g_http_metrics.rpc_requests[op][k] == 0) continue;
+            metric_printf(&out, "melvin_rpc_requests_total{op=\"%s\",status=\"%s\"} %llu\n",
+                          rpc_op_names[op], rpc_status_names[k], (unsigned long long)g_http_metrics.rpc_requests[op][k]);
+        }
+    }
+
+    metric_header(&out, "melvin_rpc_request_duration_seconds", "histogram",
+                  "Time from reading an RPC frame to queuing its complete reply.");
+    for (int op = 0; op < RPC_OP_COUNT; op++) {
+        metric_histogram(&out, "melvin_rpc_request_duration_seconds", "op", rpc_op_names[op],
+                         g_http_metrics.rpc_buckets[op], g_http_metrics.rpc_latency_sum[op]);
+    }
+
+    metric_header(&out, "melvin_connections", "gauge", "Open client connections.");
+    metric_printf(&out, "melvin_connections %u\n", g_server.connection_count);
+    metric_header(&out, "melvin_workers", "gauge", "Worker threads running chat episodes.");
+    metric_printf(&out, "melvin_workers %u\n", workers);
+    metric_header(&out, "melvin_busy_workers", "gauge", "Workers currently running an episode.");
+    metric_printf(&out, "melvin_busy_workers %u\n", busy);
+    metric_header(&out, "melvin_sessions", "gauge", "Live chat sessions.");
+    metric_printf(&out, "melvin_sessions %u\n", session_count);
+    metric_header(&out, "melvin_queue_depth", "gauge", "Requests waiting for the engine.");
+    metric_printf(&out, "melvin_queue_depth{queue=\"chat\"} %u\n", chat_queued);
+    metric_printf(&out, "melvin_queue_depth{queue=\"infer\"} %u\n", infer_queued);
+
+    metric_header(&out, "melvin_requests_shed_total", "counter", "Requests and connections turned away by admission control.");
+    for (int r = 0; r < SHED_COUNT; r++) {
+        metric_printf(&out, "melvin_requests_shed_total{reason=\"%s\"} %llu\n",
+                      shed_names[r], (unsigned long long)shed[r]);
+    }
+
+    metric_header(&out, "melvin_infer_requests_total", "counter", "Inference requests answered.");
+    metric_printf(&out, "melvin_infer_requests_total %llu\n", (unsigned long long)infer_requests);
+    metric_header(&out, "melvin_infer_batches_total", "counter", "Inference batches run.");
+    metric_printf(&out, "melvin_infer_batches_total %llu\n", (unsigned long long)infer_batches);
+
+    metric_header(&out, "melvin_train_pairs_total", "counter", "Uploaded training pairs learned.");
+    metric_printf(&out, "melvin_train_pairs_total %llu\n", (unsigned long long)train_pairs);
+    metric_header(&out, "melvin_train_bad_lines_total", "counter", "Uploaded lines that were not an input/target pair.");
+    metric_printf(&out, "melvin_train_bad_lines_total %llu\n", (unsigned long long)g_http_metrics.train_bad_lines);
+
+    metric_header(&out, "melvin_episodes_total", "counter", "Chat episodes run.");
+    metric_printf(&out, "melvin_episodes_total %llu\n", (unsigned long long)totals.episodes);
+    metric_header(&out, "melvin_episode_steps_total", "counter", "Propagation steps across all chat episodes.");
+    metric_printf(&out, "melvin_episode_steps_total %llu\n", (unsigned long long)totals.steps);
+    metric_header(&out, "melvin_episode_outputs_total", "counter", "Nodes emitted by chat episodes.");
+    metric_printf(&out, "melvin_episode_outputs_total %llu\n", (unsigned long long)totals.outputs);
+    metric_header(&out, "melvin_generation_stops_total", "counter",
+                  "Episodes by how generation ended (deadline, steps, output: partial output). "
+                  "source: session brains (chat, training) or batched inference.");
+    for (int r = 0; r < MELVIN_STOP_COUNT; r++) {
+        metric_printf(&out, "melvin_generation_stops_total{source=\"session\",reason=\"%s\"} %llu\n",
+                      melvin_stop_name((MelvinStop)r), (unsigned long long)totals.stops[r]);
+        metric_printf(&out, "melvin_generation_stops_total{source=\"infer\",reason=\"%s\"} %llu\n",
+                      melvin_stop_name((MelvinStop)r), (unsigned long long)infer_stops[r]);
+    }
+    metric_header(&out, "melvin_episode_phase_seconds_total", "counter", "Time spent in each part of run_episode.");
+    for (int p = 0; p < MELVIN_PHASE_COUNT; p++) {
+        metric_printf(&out, "melvin_episode_phase_seconds_total{phase=\"%s\"} %.6f\n",
+                      melvin_phase_name((MelvinPhase)p), totals.phase_ns[p] / 1e9);
+    }
+    if (g_server.profile_sample > 0) {
+        metric_header(&out, "melvin_profile_episodes_sampled_total", "counter",
+                      "Episodes profiled (one in MELVIN_PROFILE_SAMPLE).");
+        metric_printf(&out, "melvin_profile_episodes_sampled_total %llu\n",
+                      (unsigned long long)profile.episodes_sampled);
+        metric_header(&out, "melvin_profile_episode_seconds_total", "counter", "Run time of the profiled episodes.");
+        metric_printf(&out, "melvin_profile_episode_seconds_total %.6f\n", profile.episode_ns / 1e9);
+        metric_header(&out, "melvin_profile_section_seconds_total", "counter",
+                      "Time in each section of run_episode, profiled episodes only.");
+        for (int k = 0; k < MELVIN_PROF_COUNT; k++) {
+            metric_printf(&out, "melvin_profile_section_seconds_total{section=\"%s\"} %.6f\n",
+                          melvin_profile_section_name((MelvinProfileSection)k), profile.sections[k].ns / 1e9);
+        }
+        metric_header(&out, "melvin_profile_section_calls_total", "counter",
+                      "Calls of each section of run_episode, profiled episodes only.");
+        for (int k = 0; k < MELVIN_PROF_COUNT; k++) {
+            metric_printf(&out, "melvin_profile_section_calls_total{section=\"%s\"} %llu\n",
+                          melvin_profile_section_name((MelvinProfileSection)k),
+                          (unsigned long long)profile.sections[k].calls);
+        }
+    }
+
+    static const char *parts[3][4] = {
+        {"melvin_patterns", "patterns", "gauge", "Patterns in the base brain and summed over session brains."},
+        {"melvin_edges", "edges", "gauge", "Node edges by state, plus pattern-to-pattern edges."},
+        {"melvin_memory_bytes", "memory", "gauge", "Approximate heap use by category."}
+    };
+    for (int k = 0; k < 3; k++) {
+        metric_header(&out, parts[k][0], parts[k][2], parts[k][3]);
+        metrics_brain(&out, "base", &g_base_stats, parts[k][1]);
+        metrics_brain(&out, "sessions", &sessions, parts[k][1]);
+    }
+
+    if (!out.data) {
+        send_error(c, 500, "Memory error");
+        return;
+    }
+    send_response(c, 200, "text/plain; version=0.0.4", out.data, out.len);
+    buf_free(&out);
+}
+
+/* ============================================================================
+ * ADMISSION CONTROL
+ *
+ * Engine requests (chat, infer, train) are admitted in three places: a
+ * per-client token bucket here (429), the bounded engine and batcher queues
+ * (503), and a check that the expected queue wait fits the request's
+ * deadline (503). Refusals carry Retry-After. Status, metrics and static
+ * files are answered on the loop without touching any of these, so they
+ * stay fast while the engine endpoints shed load.
+ * ============================================================================ */
+
+#define DEFAULT_MAX_CONNECTIONS 4096 /* Open connections (override: MELVIN_MAX_CONNECTIONS) */
+#define RATE_BUCKETS 4096            /* Clients tracked at once (power of two) */
+#define RATE_PROBE 8                 /* Slots searched for a client's bucket */
+
+typedef struct {
+    uint32_t addr;
+    bool used;
+    double tokens;
+    uint64_t updated_ns;
+} RateBucket;
+
+static RateBucket g_rate_buckets[RATE_BUCKETS];  /* Loop thread only */
+
+/* Add the tokens earned since the last update; returns the new count */
+static double rate_refill(RateBucket *b, uint64_t now) {
+    b->tokens += (now - b->updated_ns) / 1e9 * g_server.rate_limit;
+    if (b->tokens > g_server.rate_burst) b->tokens = g_server.rate_burst;
+    b->updated_ns = now;
+    return b->tokens;
+}
+
+/* The client's bucket. A slot is taken over once its owner's bucket is full
+ * again (they have been idle). If every probed slot is in use the client
+ * shares one, which can only make its limit stricter. */
+static RateBucket *rate_bucket(uint32_t addr, uint64_t now) {
+    uint32_t home = (addr * 2654435761u) & (RATE_BUCKETS - 1);
+    RateBucket *free_slot = NULL;
+    for (uint32_t i = 0; i < RATE_PROBE; i++) {
+        RateBucket *b = &g_rate_buckets[(home + i) & (RATE_BUCKETS - 1)];
+        if (b->used && b->addr == addr) return b;
+        if (!free_slot && (!b->used || rate_refill(b, now) >= g_server.rate_burst)) free_slot = b;
+    }
+    if (!free_slot) return &g_rate_buckets[home];
+
+    free_slot->used = true;
+    free_slot->addr = addr;
+    free_slot->tokens = g_server.rate_burst;
+    free_slot->updated_ns = now;
+    return free_slot;
+}
+
+/* Charge one engine request to its client - false if refused, with the
+ * seconds until a token is available */
+static bool admit_client(Connection *c, uint32_t *retry_after) {
+    if (g_server.rate_limit <= 0.0) return true;
+
+    uint64_t now = now_ns();
+    RateBucket *b = rate_bucket(c->client_addr, now);
+    if (rate_refill(b, now) >= 1.0) {
+        b->tokens -= 1.0;
+        return true;
+    }
+
+    *retry_after = (uint32_t)((1.0 - b->tokens) / g_server.rate_limit) + 1;
+    count_shed(SHED_RATE_LIMIT);
+    return false;
+}
+
+/* admit_client for an HTTP request - false if refused (reply queued) */
+static bool admit_request(Connection *c, const HttpRequest *req) {
+    uint32_t retry_after;
+    if (admit_client(c, &retry_after)) return true;
+
+    if (req->body_streamed) c->keep_alive = false;  /* Upload left unread - close after replying */
+    send_busy(c, 429, "Rate limit exceeded", retry_after);
+    return false;
+}
+
+/* ============================================================================
+ * REQUEST HANDLERS
+ * ============================================================================ */
+
+/* A limit from the request body, never above the server's own (0 = none) */
+static uint32_t request_limit(const char *body, const char *key, uint32_t server_limit) {
+    char value[24];
+    if (extract_json_string(body, key, value, sizeof(value)) != 0) return server_limit;
+    char *end = NULL;
+    unsigned long long v = strtoull(value, &end, 10);
+    if (end == value || v == 0 || v > UINT32_MAX) return server_limit;
+    return (server_limit == 0 || v < server_limit) ? (uint32_t)v : server_limit;
+}
+
+/* Server limits, lowered by the body's "max_steps", "max_output" and
+ * "timeout_ms". The deadline counts from when the request arrived, so
+ * time spent queued is included. */
+static void request_limits(const Connection *c, const char *body, JobLimits *limits) {
+    limits->max_steps = request_limit(body, "max_steps", g_server.max_steps);
+    limits->max_output = request_limit(body, "max_output", g_server.max_output);
+    uint32_t timeout_ms = request_limit(body, "timeout_ms", g_server.deadline_ms);
+    limits->deadline_ns = timeout_ms ? c->request_start_ns + (uint64_t)timeout_ms * 1000000ull : 0;
+}
+
+/* Handle /api/chat endpoint - returns true if the reply will arrive later */
+bool handle_chat(Connection *c, const HttpRequest *req) {
+    if (!g_base) {
+        send_error(c, 500, "Melvin not initialized");
+        return false;
+    }
+
+    /* Body is not NUL-terminated inside the read buffer */
+    char *body = malloc(req->body_len + 1);
+    if (!body) {
+        send_error(c, 500, "Memory error");
+        return false;
+    }
+    memcpy(body, req->body, req->body_len);
+    body[req->body_len] = '\0';
+
+    /* Extract message from JSON body (never longer than the body itself) */
+    char *message = malloc(req->body_len + 1);
+    if (!message) {
+        free(body);
+        send_error(c, 500, "Memory error");
+        return false;
+    }
+    message[0] = '\0';
+    int found = extract_json_string(body, "message", message, req->body_len + 1);
+
+    /* Stream: JSON "stream": true, or Accept: text/event-stream */
+    char stream_flag[8] = {0};
+    bool stream = req->accept_stream ||
+                  (extract_json_string(body, "stream", stream_flag, sizeof(stream_flag)) == 0 &&
+                   strcmp(stream_flag, "true") == 0);
+
+    /* Session: JSON "session" field, else X-Melvin-Session header, else default */
+    char session[MAX_SESSION_ID + 2] = {0};
+    bool bad_session = req->bad_session;
+    if (extract_json_string(body, "session", session, sizeof(session)) != 0) {
+        snprintf(session, sizeof(session), "%s", req->session);
+    }
+    JobLimits limits;
+    request_limits(c, body, &limits);
+    free(body);
+
+    if (found != 0) {
+        free(message);
+        send_error(c, 400, "Missing 'message' field in JSON");
+        return false;
+    }
+    if (session[0] == '\0' && !bad_session) {
+        snprintf(session, sizeof(session), "%s", DEFAULT_SESSION_ID);
+    }
+    if (bad_session || !valid_session_id(session, strlen(session))) {
+        free(message);
+        send_error(c, 400, "Invalid session id");
+        return false;
+    }
+
+    if (strlen(message) == 0) {
+        free(message);
+        send_error(c, 400, "Message cannot be empty");
+        return false;
+    }
+
+    EngineJob *job = calloc(1, sizeof(EngineJob));
+    if (!job) {
+        free(message);
+        send_error(c, 500, "Memory error");
+        return false;
+    }
+    job->conn = c;
+    job->message = message;
+    job->message_len = (uint32_t)strlen(message);
+    job->stream = stream;
+    job->limits = limits;
+
+    uint32_t retry_after;
+    int status = engine_submit(job, session, &retry_after);
+    if (status != 0) {
+        free(job->message);
+        free(job);
+        send_busy(c, status, "Server busy, try again later", retry_after);
+        return false;
+    }
+    if (stream) {
+        /* Headers go out with conn_process's flush; bytes follow as they are generated */
+        send_stream_start(c, req->version_minor);
+    }
+    c->waiting_engine = true;
+    return true;
+}
+
+/* Handle /api/infer endpoint - read-only answer from the base brain, batched */
+bool handle_infer(Connection *c, const HttpRequest *req) {
+    if (!g_base) {
+        send_error(c, 500, "Melvin not initialized");
+        return false;
+    }
+
+    char *body = malloc(req->body_len + 1);
+    if (!body) {
+        send_error(c, 500, "Memory error");
+        return false;
+    }
+    memcpy(body, req->body, req->body_len);
+    body[req->body_len] = '\0';
+
+    /* Extract message from JSON body (never longer than the body itself) */
+    char *message = malloc(req->body_len + 1);
+    if (!message) {
+        free(body);
+        send_error(c, 500, "Memory error");
+        return false;
+    }
+    message[0] = '\0';
+    int found = extract_json_string(body, "message", message, req->body_len + 1);
+    JobLimits limits;
+    request_limits(c, body, &limits);
+    free(body);
+
+    if (found != 0) {
+        free(message);
+        send_error(c, 400, "Missing 'message' field in JSON");
+        return false;
+    }
+    if (strlen(message) == 0) {
+        free(message);
+        send_error(c, 400, "Message cannot be empty");
+        return false;
+    }
+
+    EngineJob *job = calloc(1, sizeof(EngineJob));
+    if (!job) {
+        free(message);
+        send_error(c, 500, "Memory error");
+        return false;
+    }
+    job->conn = c;
+    job->message = message;
+    job->message_len = (uint32_t)strlen(message);
+    job->limits = limits;
+
+    int status = batcher_submit(job);
+    if (status != 0) {
+        free(job->message);
+        free(job);
+        send_busy(c, status, "Server busy, try again later", 1);
+        return false;
+    }
+    c->waiting_engine = true;
+    return true;
+}
+
+/* Handle /api/status endpoint */
+void handle_status(Connection *c) {
+    if (!g_engine.default_session) {
+        send_error(c, 500, "Melvin not initialized");
+        return;
+    }
+
+    /* error_rate is a single float written by a worker - a slightly stale
+     * read is fine for a status display. The default session is pinned, so
+     * its brain is never freed underneath us. */
+    float error_rate = melvin_get_error_rate(g_engine.default_session->brain);
+
+    pthread_mutex_lock(&g_engine.lock);
+    uint32_t workers = g_engine.worker_count;
+    uint32_t busy = g_engine.busy_workers;
+    uint32_t sessions = g_engine.session_count;
+    uint32_t queued = g_engine.pending_jobs - g_engine.busy_workers;
+    pthread_mutex_unlock(&g_engine.lock);
+
+    char infer[256];
+    batcher_stats_json(infer, sizeof(infer));
+
+    char json[512];
+    snprintf(json, sizeof(json),
+        "{\"status\":\"running\",\"error_rate\":%.3f,"
+        "\"workers\":%u,\"busy_workers\":%u,\"sessions\":%u,\"queue_depth\":%u,"
+        "\"infer\":%s}",
+        error_rate, workers, busy, sessions, queued, infer);
+
+    send_json(c, 200, json);
+}
+
+/* ============================================================================
+ * TRAINING UPLOADS
+ *
+ * POST /api/train takes newline-delimited JSON, one {"input": ..., "target": ...}
+ * pair per line, with Content-Length or chunked encoding and no size limit.
+ * The loop decodes the body as it arrives and queues TRAIN_CHUNK_PAIRS pairs
+ * at a time on the session. Once TRAIN_MAX_IN_FLIGHT chunks of one upload,
+ * or MELVIN_TRAIN_QUEUE_MAX chunks of all uploads together, are waiting it
+ * stops reading the socket until a worker finishes one, so a fast client is
+ * held back by TCP flow control instead of server memory, and uploads never
+ * take the queue slots chats are admitted against. The 202 reply with
+ * the job id goes out when the body ends; GET /api/train/<id> reports
+ * progress while the queued pairs are trained.
+ * ============================================================================ */
+
+#define TRAIN_JOB_SLOTS 64           /* Recent uploads kept for progress queries */
+#define TRAIN_MAX_LINE (1024 * 1024) /* Longest accepted NDJSON line */
+
+enum { BODY_LENGTH, CHUNK_SIZE, CHUNK_DATA, CHUNK_DATA_END, CHUNK_TRAILER };
+
+typedef struct TrainIngest {
+    TrainJob *job;
+    int state;
+    uint64_t remaining;        /* Body bytes left (Content-Length) or left in this chunk */
+    Buffer line;               /* Partial line */
+    bool skipping;             /* Current line is too long - drop it */
+    EngineJob *chunk;          /* Pairs being gathered */
+} TrainIngest;
+
+static TrainJob *g_train_jobs[TRAIN_JOB_SLOTS];
+static uint32_t g_train_next_id = 1;
+
+static uint32_t train_in_flight(TrainJob *job) {
+    pthread_mutex_lock(&g_engine.lock);
+    uint32_t n = job->chunks_in_flight;
+    pthread_mutex_unlock(&g_engine.lock);
+    return n;
+}
+
+/* May this upload queue another chunk? Its own window and the server-wide bound */
+static bool train_has_room(TrainJob *job) {
+    pthread_mutex_lock(&g_engine.lock);
+    bool room = job->chunks_in_flight < TRAIN_MAX_IN_FLIGHT &&
+                g_engine.train_chunks < g_engine.max_train_chunks;
+    pthread_mutex_unlock(&g_engine.lock);
+    return room;
+}
+
+/* Once the body is done and every chunk trained, release the session */
+static void train_maybe_finish(TrainJob *job) {
+    if (job->finished || job->receiving) return;
+    pthread_mutex_lock(&g_engine.lock);
+    bool done = (job->chunks_in_flight == 0);
+    if (done) {
+        job->session->train_refs--;
+        job->session = NULL;
+    }
+    pthread_mutex_unlock(&g_engine.lock);
+    if (done) {
+        job->finished = true;
+        job->finished_ns = now_ns();
+    }
+}
+
+/* Queue the pairs gathered so far */
+static void train_submit_chunk(TrainIngest *in) {
+    EngineJob *chunk = in->chunk;
+    if (!chunk) return;
+    in->chunk = NULL;
+    in->job->pairs_queued += chunk->pair_count;
+
+    pthread_mutex_lock(&g_engine.lock);
+    in->job->chunks_in_flight++;
+    g_engine.train_chunks++;
+    session_push_job(in->job->session, chunk);
+    pthread_mutex_unlock(&g_engine.lock);
+}
+
+static void train_bad_line(TrainJob *job) {
+    job->bad_lines++;
+    g_http_metrics.train_bad_lines++;
+}
+
+/* Parse one NDJSON line (NUL-terminated, writable) into the current chunk */
+static void train_take_line(TrainIngest *in, char *line, size_t len) {
+    while (len > 0 && (line[len - 1] == '\r' || line[len - 1] == ' ' || line[len - 1] == '\t')) len--;
+    line[len] = '\0';
+    while (*line == ' ' || *line == '\t') {
+        line++;
+        len--;
+    }
+    if (len == 0) return;
+    in->job->lines++;
+
+    char *input = malloc(len + 1);
+    char *target = malloc(len + 1);
+    bool ok = input && target &&
+              extract_json_string(line, "input", input, len + 1) == 0 &&
+              extract_json_string(line, "target", target, len + 1) == 0 &&
+              input[0] != '\0';
+    if (ok && !in->chunk) {
+        in->chunk = calloc(1, sizeof(EngineJob));
+        if (in->chunk) in->chunk->train = in->job;
+    }
+    if (ok) {
+        /* A failed append leaves a partial record after the last counted pair - never read */
+        EngineJob *chunk = in->chunk;
+        uint32_t input_len = (uint32_t)strlen(input);
+        uint32_t target_len = (uint32_t)strlen(target);
+        ok = chunk &&
+             buf_append(&chunk->pairs, &input_len, sizeof(uint32_t)) &&
+             buf_append(&chunk->pairs, input, input_len) &&
+             buf_append(&chunk->pairs, &target_len, sizeof(uint32_t)) &&
+             buf_append(&chunk->pairs, target, target_len);
+        if (ok) chunk->pair_count++;
+    }
+    if (!ok) train_bad_line(in->job);
+    free(input);
+    free(target);
+
+    /* A full chunk with no room is held until train_resume */
+    if (in->chunk && in->chunk->pair_count >= TRAIN_CHUNK_PAIRS && train_has_room(in->job)) {
+        train_submit_chunk(in);
+    }
+}
+
+/* Finish the buffered line; pause reading if the workers are behind */
+static void train_end_line(Connection *c, TrainIngest *in) {
+    if (!buf_append(&in->line, "", 1)) {
+        train_bad_line(in->job);
+        return;
+    }
+    train_take_line(in, in->line.data, in->line.len - 1);
+    if (!train_has_room(in->job) && !c->read_paused) {
+        c->read_paused = true;
+        conn_update_events(c);
+    }
+}
+
+/* Split body bytes into lines. Stops after a line that paused the upload. */
+static size_t train_feed(Connection *c, TrainIngest *in, const char *data, size_t len) {
+    size_t used = 0;
+    while (used < len && !c->read_paused) {
+        const char *nl = memchr(data + used, '\n', len - used);
+        size_t piece = nl ? (size_t)(nl - (data + used)) : len - used;
+        if (!in->skipping) {
+            if (in->line.len + piece > TRAIN_MAX_LINE) {
+                in->skipping = true;
+                in->job->lines++;
+                train_bad_line(in->job);
+            } else if (!buf_append(&in->line, data + used, piece)) {
+                in->skipping = true;
+                train_bad_line(in->job);
+            }
+        }
+        used += piece;
+        if (nl) {
+            used++;
+            if (!in->skipping) train_end_line(c, in);
+            in->skipping = false;
+            in->line.len = 0;
+        }
+    }
+    return used;
+}
+
+/* Stop reading the upload. complete: the body ended normally. */
+static void train_ingest_detach(Connection *c, bool complete) {
+    TrainIngest *in = c->ingest;
+    TrainJob *job = in->job;
+
+    if (complete && !in->skipping && in->line.len > 0) {
+        train_end_line(c, in);  /* Last line without a newline */
+    }
+    train_submit_chunk(in);
+
+    job->receiving = false;
+    job->aborted = !complete;
+    job->conn = NULL;
+    if (c->read_paused) {
+        c->read_paused = false;
+        if (c->fd >= 0) conn_update_events(c);
+    }
+    buf_free(&in->line);
+    free(in);
+    c->ingest = NULL;
+    train_maybe_finish(job);
+}
+
+/* The connection closed mid-upload. Pairs that arrived are still trained;
+ * the status reports "complete": false so a partial upload is never
+ * mistaken for the whole file */
+static void train_ingest_abort(Connection *c) {
+    train_ingest_detach(c, false);
+}
+
+static void train_ingest_fail(Connection *c, int status, const char *message) {
+    train_ingest_detach(c, false);
+    c->keep_alive = false;
+    send_error(c, status, message);
+    metrics_record_request(c);
+}
+
+static void train_ingest_finish(Connection *c) {
+    TrainJob *job = c->ingest->job;
+    train_ingest_detach(c, true);
+
+    char json[256];
+    snprintf(json, sizeof(json),
+        "{\"job\":%u,\"session\":\"%s\",\"lines\":%llu,\"pairs\":%llu,\"bad_lines\":%llu}",
+        job->id, job->session_id, (unsigned long long)job->lines,
+        (unsigned long long)job->pairs_queued, (unsigned long long)job->bad_lines);
+    send_json(c, 202, json);
+    metrics_record_request(c);
+}
+
+/* Decode as much of the buffered body as possible */
+static void train_ingest(Connection *c) {
+    while (c->ingest && !c->read_paused) {
+        TrainIngest *in = c->ingest;
+
+        if (in->state == BODY_LENGTH || in->state == CHUNK_DATA) {
+            if (in->remaining == 0) {
+                if (in->state == BODY_LENGTH) {
+                    train_ingest_finish(c);
+                } else {
+                    in->state = CHUNK_DATA_END;
+                }
+                continue;
+            }
+            if (c->rbuf.len == 0) return;
+            size_t avail = (c->rbuf.len < in->remaining) ? c->rbuf.len : (size_t)in->remaining;
+            size_t used = train_feed(c, in, c->rbuf.data, avail);
+            in->job->bytes += used;
+            in->remaining -= used;
+            buf_consume(&c->rbuf, used);
+            continue;
+        }
+
+        /* Chunk framing lines */
+        const char *eol = memmem(c->rbuf.data, c->rbuf.len, "\r\n", 2);
+        if (!eol) {
+            if (c->rbuf.len > 1024) train_ingest_fail(c, 400, "Bad chunked encoding");
+            return;
+        }
+        size_t line_len = (size_t)(eol - c->rbuf.data);
+
+        if (in->state == CHUNK_DATA_END) {
+            if (line_len != 0) {
+                train_ingest_fail(c, 400, "Bad chunked encoding");
+                return;
+            }
+            in->state = CHUNK_SIZE;
+        } else if (in->state == CHUNK_SIZE) {
+            char number[32];
+            const char *ext = memchr(c->rbuf.data, ';', line_len);  /* Ignore chunk extensions */
+            size_t n = ext ? (size_t)(ext - c->rbuf.data) : line_len;
+            if (n == 0 || n >= sizeof(number)) {
+                train_ingest_fail(c, 400, "Bad chunked encoding");
+                return;
+            }
+            memcpy(number, c->rbuf.data, n);
+            number[n] = '\0';
+            char *end = NULL;
+            errno = 0;
+            unsigned long long size = strtoull(number, &end, 16);
+            if (end == number || *end != '\0' || number[0] == '-' || errno == ERANGE) {
+                train_ingest_fail(c, 400, "Bad chunked encoding");
+                return;
+            }
+            if (size > MAX_BODY_SIZE) {
+                train_ingest_fail(c, 400, "Chunk too large");  /* Bodies are unbounded, chunks are not */
+                return;
+            }
+            in->remaining = size;
+            in->state = (size == 0) ? CHUNK_TRAILER : CHUNK_DATA;
+        } else if (line_len == 0) {
+            /* Empty line ends the trailers, and the body */
+            buf_consume(&c->rbuf, 2);
+            train_ingest_finish(c);
+            continue;
+        }
+        buf_consume(&c->rbuf, line_len + 2);
+    }
+}
+
+/* Read more of a paused upload once it has room again */
+static void train_resume(TrainJob *job) {
+    Connection *c = job->conn;
+    if (!c || !c->read_paused || !c->ingest) return;
+    if (train_in_flight(job) > TRAIN_MAX_IN_FLIGHT / 2 || !train_has_room(job)) return;
+    TrainIngest *in = c->ingest;
+    if (in->chunk && in->chunk->pair_count >= TRAIN_CHUNK_PAIRS) {
+        train_submit_chunk(in);  /* Held when the upload paused */
+        if (!train_has_room(job)) return;
+    }
+    c->read_paused = false;
+    conn_update_events(c);
+    conn_process(c);  /* Whatever is already buffered */
+}
+
+/* A training chunk finished - its upload, then any other waiting on the
+ * server-wide bound, may read again. Each resumed upload runs until it
+ * pauses, so the next one sees the room it left. */
+static void train_chunk_done(TrainJob *job) {
+    train_resume(job);
+    for (uint32_t i = 0; i < TRAIN_JOB_SLOTS; i++) {
+        if (g_train_jobs[i] && g_train_jobs[i] != job) train_resume(g_train_jobs[i]);
+    }
+    train_maybe_finish(job);
+}
+
+/* Handle POST /api/train - the reply is sent once the body has been read */
+bool handle_train(Connection *c, const HttpRequest *req) {
+    /* On refusal the unread body is still in the buffer - close after replying */
+    const char *session = req->session[0] ? req->session : DEFAULT_SESSION_ID;
+    if (req->bad_session || !valid_session_id(session, strlen(session))) {
+        c->keep_alive = false;
+        send_error(c, 400, "Invalid session id");
+        return false;
+    }
+
+    /* A slot is reused only once its previous upload has finished training */
+    uint32_t slot = g_train_next_id % TRAIN_JOB_SLOTS;
+    if (g_train_jobs[slot] && !g_train_jobs[slot]->finished) {
+        c->keep_alive = false;
+        send_busy(c, 503, "Too many training uploads in progress", engine_retry_after());
+        return false;
+    }
+
+    TrainJob *job = calloc(1, sizeof(TrainJob));
+    TrainIngest *in = calloc(1, sizeof(TrainIngest));
+    Session *evicted = NULL;
+    Session *s = NULL;
+    if (job && in) {
+        pthread_mutex_lock(&g_engine.lock);
+        s = session_get(session, &evicted);
+        if (s) s->train_refs++;
+        pthread_mutex_unlock(&g_engine.lock);
+        session_destroy(evicted);
+    }
+    if (!s) {
+        free(job);
+        free(in);
+        c->keep_alive = false;
+        send_busy(c, 503, "Server busy, try again later", engine_retry_after());
+        return false;
+    }
+
+    free(g_train_jobs[slot]);
+    g_train_jobs[slot] = job;
+    job->id = g_train_next_id++;
+    snprintf(job->session_id, sizeof(job->session_id), "%s", session);
+    job->session = s;
+    job->receiving = true;
+    job->started_ns = now_ns();
+    job->conn = c;
+
+    in->job = job;
+    in->state = req->chunked ? CHUNK_SIZE : BODY_LENGTH;
+    in->remaining = req->chunked ? 0 : req->content_length;
+    c->ingest = in;
+
+    if (req->expect_continue) {
+        buf_append(&c->wbuf, "HTTP/1.1 100 Continue\r\n\r\n", 25);
+    }
+    return true;
+}
+
+/* Handle GET /api/train/<id> */
+void handle_train_status(Connection *c, const char *id_str) {
+    char *end = NULL;
+    unsigned long id = strtoul(id_str, &end, 10);
+    TrainJob *job = (end != id_str && *end == '\0' && id > 0) ? g_train_jobs[id % TRAIN_JOB_SLOTS] : NULL;
+    if (!job || job->id != id) {
+        send_error(c, 404, "Unknown training job");
+        return;
+    }
+
+    pthread_mutex_lock(&g_engine.lock);
+    uint64_t trained = job->pairs_trained;
+    pthread_mutex_unlock(&g_engine.lock);
+
+    const char *state = job->receiving ? "receiving" :
+                        !job->finished ? "training" :
+                        job->aborted   ? "aborted" : "done";
+    double elapsed = ((job->finished ? job->finished_ns : now_ns()) - job->started_ns) / 1e9;
+
+    char json[512];
+    snprintf(json, sizeof(json),
+        "{\"job\":%u,\"session\":\"%s\",\"state\":\"%s\",\"bytes\":%llu,\"lines\":%llu,"
+        "\"bad_lines\":%llu,\"pairs_queued\":%llu,\"pairs_trained\":%llu,"
+        "\"complete\":%s,\"elapsed_s\":%.3f,\"pairs_per_sec\":%.1f}",
+        job->id, job->session_id, state, (unsigned long long)job->bytes,
+        (unsigned long long)job->lines, (unsigned long long)job->bad_lines,
+        (unsigned long long)job->pairs_queued, (unsigned long long)trained,
+        job->receiving || job->aborted ? "false" : "true", elapsed, elapsed > 0.0 ? trained / elapsed : 0.0);
+    send_json(c, 200, json);
+}
+
+/* ============================================================================
+ * BINARY RPC
+ *
+ * A compact protocol for programs that talk to Melvin, served on its own TCP
+ * port (MELVIN_RPC_PORT) and/or Unix socket (MELVIN_RPC_SOCKET) by the same
+ * loop, connections and engine as HTTP. Every message is one frame:
+ *
+ *   u32 length | u8 op | u8 status | u16 reserved | u32 id | payload
+ *
+ * Integers are little-endian and length counts everything after itself.
+ * Requests send status 0; a reply echoes the request's op and id. Payloads
+ * are raw bytes - nothing is escaped or searched for. Clients may pipeline
+ * any number of frames; they are answered in order, one engine job at a time
+ * per connection, exactly like pipelined HTTP.
+ *
+ *   CHAT    u8 session_len | session | message
+ *           -> u8 stop reason | u8[3] | f32 error_rate | output bytes
+ *   TRAIN   u8 session_len | session | (u32 len | input | u32 len | target)...
+ *           -> u32 pairs trained
+ *   STATUS  (empty) -> f32 error_rate | u32 count | count x u64 (rpc_status)
+ *   SAVE    u8 session_len | session -> path of the saved brain
+ *
+ * An empty session name means the default session. A refused request gets
+ * RPC_BUSY with a u32 retry-after in seconds; other failures carry a text
+ * message. A frame with an impossible length closes the connection.
+ * ============================================================================ */
+
+#define RPC_HEADER 12                /* length + op, status, reserved + id */
+#define RPC_MAX_FRAME (MAX_BODY_SIZE + RPC_HEADER)
+
+/* Queue a reply frame. status is the HTTP equivalent, kept for metrics. */
+static void rpc_send(Connection *c, uint8_t op, uint32_t id, int status, const void *payload, size_t len) {
+    uint8_t header[RPC_HEADER];
+    put_le32(header, (uint32_t)(len + RPC_HEADER - 4));
+    header[4] = op;
+    header[5] = (uint8_t)rpc_status_byte(status);
+    header[6] = header[7] = 0;
+    put_le32(header + 8, id);
+
+    c->status = status;
+    if (!buf_append(&c->wbuf, header, RPC_HEADER) ||
+        (len > 0 && !buf_append(&c->wbuf, payload, len))) {
+        c->close_after_write = true;
+    }
+}
+
+static void rpc_error(Connection *c, uint8_t op, uint32_t id, int status, const char *message) {
+    rpc_send(c, op, id, status, message, strlen(message));
+}
+
+static void rpc_busy(Connection *c, uint8_t op, uint32_t id, int status, uint32_t retry_after) {
+    uint8_t payload[4];
+    put_le32(payload, retry_after);
+    rpc_send(c, op, id, status, payload, sizeof(payload));
+}
+
+/* Session name at the start of a payload - bytes used, or 0 if invalid */
+static size_t rpc_session(const uint8_t *p, size_t len, char *session) {
+    if (len < 1 || len < 1u + p[0]) return 0;
+    if (p[0] == 0) {
+        strcpy(session, DEFAULT_SESSION_ID);
+        return 1;
+    }
+    if (!valid_session_id((const char*)p + 1, p[0])) return 0;
+    memcpy(session, p + 1, p[0]);
+    session[p[0]] = '\0';
+    return 1u + p[0];
+}
+
+/* Copy training pairs into the job's chunk format - false if malformed */
+static bool rpc_take_pairs(EngineJob *job, const uint8_t *p, size_t len) {
+    while (len > 0) {
+        for (int part = 0; part < 2; part++) {  /* Input, then target */
+            if (len < 4 || len - 4 < get_le32(p)) return false;
+            uint32_t n = get_le32(p);
+            if (!buf_append(&job->pairs, &n, sizeof(n)) || !buf_append(&job->pairs, p + 4, n)) {
+                return false;
+            }
+            p += 4 + n;
+            len -= 4 + n;
+        }
+        job->pair_count++;
+    }
+    return job->pair_count > 0;
+}
+
+/* STATUS: the /api/status numbers, fixed-width */
+static void rpc_status(Connection *c, uint32_t id) {
+    float error_rate = melvin_get_error_rate(g_engine.default_session->brain);
+
+    uint64_t fields[] = {0, 0, 0, 0, 0, 0, 0};
+    pthread_mutex_lock(&g_engine.lock);
+    fields[0] = g_engine.worker_count;
+    fields[1] = g_engine.busy_workers;
+    fields[2] = g_engine.session_count;
+    fields[3] = g_engine.pending_jobs - g_engine.busy_workers;  /* Queue depth */
+    fields[4] = g_engine.totals.episodes;
+    fields[5] = g_engine.train_pairs;
+    pthread_mutex_unlock(&g_engine.lock);
+    fields[6] = g_server.connection_count;
+
+    uint32_t count = sizeof(fields) / sizeof(fields[0]);
+    uint8_t payload[8 + sizeof(fields)];
+    uint32_t bits;
+    memcpy(&bits, &error_rate, sizeof(bits));
+    put_le32(payload, bits);
+    put_le32(payload + 4, count);
+    for (uint32_t i = 0; i < count; i++) put_le64(payload + 8 + 8 * i, fields[i]);
+    rpc_send(c, RPC_STATUS, id, 200, payload, sizeof(payload));
+}
+
+/* Answer one request frame - returns true if the reply will arrive later */
+static bool rpc_handle(Connection *c, uint8_t op, uint32_t id, const uint8_t *payload, size_t len) {
+    if (op == RPC_STATUS) {
+        rpc_status(c, id);
+        return false;
+    }
+    if (op != RPC_CHAT && op != RPC_TRAIN && op != RPC_SAVE) {
+        rpc_error(c, op, id, 400, "Unknown operation");
+        return false;
+    }
+
+    uint32_t retry_after;
+    if (!admit_client(c, &retry_after)) {
+        rpc_busy(c, op, id, 429, retry_after);
+        return false;
+    }
+
+    char session[MAX_SESSION_ID + 1];
+    size_t used = rpc_session(payload, len, session);
+    if (used == 0) {
+        rpc_error(c, op, id, 400, "Invalid session id");
+        return false;
+    }
+    payload += used;
+    len -= used;
+
+    EngineJob *job = calloc(1, sizeof(EngineJob));
+    if (!job) {
+        rpc_error(c, op, id, 500, "Memory error");
+        return false;
+    }
+    job->conn = c;
+    job->rpc_op = op;
+    job->rpc_id = id;
+
+    const char *invalid = NULL;
+    int status = 400;
+    if (op == RPC_CHAT && len == 0) {
+        invalid = "Message cannot be empty";
+    } else if (op == RPC_CHAT && !(job->message = malloc(len + 1))) {
+        invalid = "Memory error";
+        status = 500;
+    } else if (op == RPC_CHAT) {
+        memcpy(job->message, payload, len);
+        job->message[len] = '\0';
+        job->message_len = (uint32_t)len;
+        request_limits(c, "", &job->limits);  /* Server limits, deadline from now */
+    } else if (op == RPC_TRAIN && !rpc_take_pairs(job, payload, len)) {
+        invalid = "Malformed training pairs";
+    } else if (op == RPC_SAVE && len != 0) {
+        invalid = "Unexpected payload";
+    }
+
+    if (invalid) {
+        rpc_error(c, op, id, status, invalid);
+    } else if ((status = engine_submit(job, session, &retry_after)) == 0) {
+        c->waiting_engine = true;
+        return true;
+    } else {
+        rpc_busy(c, op, id, status, retry_after);
+    }
+    free(job->message);
+    buf_free(&job->pairs);
+    free(job);
+    return false;
+}
+
+/* Reply for a finished engine job */
+static void rpc_complete(Connection *c, EngineJob *job) {
+    if (job->status == 200 && job->rpc_op == RPC_TRAIN) {
+        uint8_t payload[4];
+        put_le32(payload, job->pair_count);
+        rpc_send(c, job->rpc_op, job->rpc_id, 200, payload, sizeof(payload));
+    } else if (job->status == 200) {
+        rpc_send(c, job->rpc_op, job->rpc_id, 200, job->response, job->response_len);
+    } else if (job->status == 503) {
+        rpc_busy(c, job->rpc_op, job->rpc_id, 503, engine_retry_after());
+    } else {
+        rpc_error(c, job->rpc_op, job->rpc_id, job->status,
+                  job->rpc_op == RPC_SAVE ? "Save failed" : "Engine error");
+    }
+}
+
+/* Answer the next buffered frame - false if no complete frame is waiting */
+static bool rpc_take_frame(Connection *c) {
+    if (c->rbuf.len < 4) return false;
+    const uint8_t *p = (const uint8_t*)c->rbuf.data;
+    uint32_t length = get_le32(p);
+
+    c->request_start_ns = now_ns();
+    c->endpoint = (c->rbuf.len > 4 && p[4] < RPC_OP_COUNT) ? p[4] : RPC_NONE;
+    if (length < RPC_HEADER - 4 || length > RPC_MAX_FRAME - 4) {
+        /* Can't find the next frame boundary - give up on the stream */
+        rpc_error(c, 0, 0, 400, "Invalid frame length");
+        metrics_record_request(c);
+        c->close_after_write = true;
+        c->rbuf.len = 0;
+        return false;
+    }
+    if (c->rbuf.len - 4 < length) return false;
+
+    if (!rpc_handle(c, p[4], get_le32(p + 8), p + RPC_HEADER, length + 4 - RPC_HEADER)) {
+        metrics_record_request(c);
+    }
+    buf_consume(&c->rbuf, 4 + (size_t)length);
+    return true;
+}
+
+/* RPC listening sockets (the HTTP one is set up in main) */
+static int rpc_listen_tcp(int port, int backlog) {
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    int opt = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = INADDR_ANY;
+    addr.sin_port = htons(port);
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(fd, backlog) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static int rpc_listen_unix(const char *path, int backlog) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) return -1;
+    strcpy(addr.sun_path, path);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    unlink(path);  /* Left over from a previous run */
+    if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(fd, backlog) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/* ============================================================================
+ * STATIC FILES
+ *
+ * Files under web/ are read once and kept in memory with a content ETag and
+ * ready-made response headers, so a UI asset costs one memcpy into the
+ * write buffer (or a 304). Each entry is re-checked with stat() at most once
+ * a second, so edits to web/ show up without a restart.
+ * ============================================================================ */
+
+#define STATIC_CACHE_SLOTS 128
+#define STATIC_ROOT "web"
+
+typedef struct {
+    char path[MAX_PATH_LENGTH];   /* Request path, e.g. "/index.html" */
+    char *body;
+    size_t body_len;
+    char etag[40];                /* Quoted, as sent */
+    char *headers[2][2];          /* [keep_alive][not_modified] */
+    size_t header_len[2][2];
+    time_t mtime;
+    off_t size;
+    time_t checked;               /* Last stat() */
+} StaticFile;
+
+static StaticFile g_static[STATIC_CACHE_SLOTS];
+static uint32_t g_static_count = 0;
+
+static const char* content_type_for(const char *path) {
+    static const char *types[][2] = {
+        {".html", "text/html; charset=utf-8"},
+        {".css",  "text/css; charset=utf-8"},
+        {".js",   "application/javascript; charset=utf-8"},
+        {".json", "application/json"},
+        {".wasm", "application/wasm"},
+        {".svg",  "image/svg+xml"},
+        {".png",  "image/png"},
+        {".ico",  "image/x-icon"}
+    };
+    const char *dot = strrchr(path, '.');
+    if (dot) {
+        for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); i++) {
+            if (strcmp(dot, types[i][0]) == 0) return types[i][1];
+        }
+    }
+    return "text/plain";
+}
+
+static void static_release(StaticFile *f) {
+    free(f->body);
+    for (int k = 0; k < 2; k++) {
+        for (int m = 0; m < 2; m++) {
+            free(f->headers[k][m]);
+        }
+    }
+    memset(f, 0, sizeof(StaticFile));
+}
+
+/* Read path from disk into f with its ETag and headers. Returns false if missing. */
+static bool static_load(StaticFile *f, const char *path, const char *filepath, const struct stat *st) {
+    FILE *fp = fopen(filepath, "rb");
+    if (!fp) return false;
+
+    char *body = malloc(st->st_size > 0 ? (size_t)st->st_size : 1);
+    size_t len = body ? fread(body, 1, (size_t)st->st_size, fp) : 0;
+    fclose(fp);
+    if (!body) return false;
+
+    static_release(f);
+    snprintf(f->path, sizeof(f->path), "%s", path);
+    f->body = body;
+    f->body_len = len;
+    f->mtime = st->st_mtime;
+    f->size = st->st_size;
+    f->checked = time(NULL);
+
+    uint64_t h = 14695981039346656037ull;  /* FNV-1a 64 over the content */
+    for (size_t i = 0; i < len; i++) {
+        h ^= (uint8_t)body[i];
+        h *= 1099511628211ull;
+    }
+    snprintf(f->etag, sizeof(f->etag), "\"%016llx-%zx\"", (unsigned long long)h, len);
+
+    const char *type = content_type_for(path);
+    for (int keep = 0; keep < 2; keep++) {
+        for (int nm = 0; nm < 2; nm++) {
+            /* A 304 has no body and must not describe one */
+            char entity[256] = "";
+            if (!nm) {
+                snprintf(entity, sizeof(entity), "Content-Type: %s\r\nContent-Length: %zu\r\n", type, len);
+            }
+            char header[512];
+            int n = snprintf(header, sizeof(header),
+                "HTTP/1.1 %s\r\n"
+                "%s"
+                "ETag: %s\r\n"
+                "Cache-Control: no-cache\r\n"
+                "Access-Control-Allow-Origin: *\r\n"
+                "Connection: %s\r\n"
+                "\r\n",
+                nm ? "304 Not Modified" : "200 OK", entity, f->etag,
+                keep ? "keep-alive" : "close");
+            f->headers[keep][nm] = strdup(header);
+            f->header_len[keep][nm] = (size_t)n;
+        }
+    }
+    return true;
+}
+
+/* Find a cached file, loading or refreshing it as needed. NULL if it doesn't exist. */
+static StaticFile* static_lookup(const char *path, StaticFile *scratch) {
+    char filepath[MAX_PATH_LENGTH + 8];
+    snprintf(filepath, sizeof(filepath), STATIC_ROOT "%s", path);
+
+    StaticFile *f = NULL;
+    for (uint32_t i = 0; i < g_static_count; i++) {
+        if (strcmp(g_static[i].path, path) == 0) {
+            f = &g_static[i];
+            break;
+        }
+    }
+
+    time_t now = time(NULL);
+    if (f && f->checked == now) return f;
+
+    struct stat st;
+    if (stat(filepath, &st) != 0 || !S_ISREG(st.st_mode)) {
+        if (f) {
+            /* Deleted - drop it, keeping the table dense */
+            static_release(f);
+            *f = g_static[--g_static_count];
+            memset(&g_static[g_static_count], 0, sizeof(StaticFile));
+        }
+        return NULL;
+    }
+
+    if (f) {
+        f->checked = now;
+        if (f->mtime == st.st_mtime && f->size == st.st_size) return f;
+        return static_load(f, path, filepath, &st) ? f : NULL;
+    }
+
+    /* Not cached yet: take a slot, or serve once from scratch when the table is full */
+    f = (g_static_count < STATIC_CACHE_SLOTS) ? &g_static[g_static_count] : scratch;
+    if (!static_load(f, path, filepath, &st)) return NULL;
+    if (f != scratch) g_static_count++;
+    return f;
+}
+
+/* Does an If-None-Match header value name this ETag? */
+static bool etag_matches(const char *if_none_match, const char *etag) {
+    if (if_none_match[0] == '\0') return false;
+    if (strcmp(if_none_match, "*") == 0) return true;
+    return strstr(if_none_match, etag) != NULL;
+}
+
+/* Serve static file */
+void serve_file(Connection *c, const char *path, const char *if_none_match) {
+    /* Security: prevent directory traversal */
+    if (strstr(path, "..") != NULL) {
+        send_error(c, 403, "Forbidden");
+        return;
+    }
+
+    /* Ignore the query string; map root to index.html */
+    char clean[MAX_PATH_LENGTH];
+    snprintf(clean, sizeof(clean), "%s", path);
+    clean[strcspn(clean, "?#")] = '\0';
+    if (strcmp(clean, "/") == 0) {
+        snprintf(clean, sizeof(clean), "/index.html");
+    }
+
+    StaticFile scratch = {0};
+    StaticFile *f = static_lookup(clean, &scratch);
+    if (!f) {
+        send_error(c, 404, "File not found");
+        return;
+    }
+
+    int keep = c->keep_alive ? 1 : 0;
+    int not_modified = etag_matches(if_none_match, f->etag) ? 1 : 0;
+    c->status = not_modified ? 304 : 200;
+    if (!f->headers[keep][not_modified] ||
+        !buf_append(&c->wbuf, f->headers[keep][not_modified], f->header_len[keep][not_modified]) ||
+        (!not_modified && f->body_len > 0 && !buf_append(&c->wbuf, f->body, f->body_len))) {
+        c->close_after_write = true;
+    }
+    if (!c->keep_alive) {
+        c->close_after_write = true;
+    }
+    if (f == &scratch) static_release(&scratch);
+}
+
+/* Route one parsed request - returns true if the reply is deferred to a worker */
+bool handle_request(Connection *c, const HttpRequest *req) {
+    if (g_server.log_requests) {
+        fprintf(stderr, "Request: %s %s\n", req->method, req->path);
+    }
+
+    /* Handle OPTIONS (CORS preflight) */
+    if (strcmp(req->method, "OPTIONS") == 0) {
+        send_response(c, 200, "text/plain", "", 0);
+        return false;
+    }
+
+    /* Route requests */
+    if (strcmp(req->path, "/api/chat") == 0 && strcmp(req->method, "POST") == 0) {
+        c->endpoint = ENDPOINT_CHAT;
+        return admit_request(c, req) && handle_chat(c, req);
+    } else if (strcmp(req->path, "/api/infer") == 0 && strcmp(req->method, "POST") == 0) {
+        c->endpoint = ENDPOINT_INFER;
+        return admit_request(c, req) && handle_infer(c, req);
+    } else if (strcmp(req->path, "/api/train") == 0 && strcmp(req->method, "POST") == 0) {
+        c->endpoint = ENDPOINT_TRAIN;
+        return admit_request(c, req) && handle_train(c, req);
+    } else if (strncmp(req->path, "/api/train/", 11) == 0 && strcmp(req->method, "GET") == 0) {
+        c->endpoint = ENDPOINT_TRAIN;
+        handle_train_status(c, req->path + 11);
+    } else if (strcmp(req->path, "/api/status") == 0 && strcmp(req->method, "GET") == 0) {
+        c->endpoint = ENDPOINT_STATUS;
+        handle_status(c);
+    } else if (strcmp(req->path, "/metrics") == 0 && strcmp(req->method, "GET") == 0) {
+        c->endpoint = ENDPOINT_METRICS;
+        handle_metrics(c);
+    } else {
+        /* Serve static file */
+        c->endpoint = ENDPOINT_STATIC;
+        serve_file(c, req->path, req->if_none_match);
+    }
+    return false;
+}
+
+/* Parse and dispatch every complete request buffered on the connection.
+ * Stops at a deferred (engine) request so responses stay in order. */
+static void conn_process(Connection *c) {
+    while (!c->waiting_engine && !c->close_after_write) {
+        if (c->ingest) {
+            train_ingest(c);
+            if (c->ingest) {
+                if (c->read_closed && !c->read_paused) {
+                    train_ingest_fail(c, 400, "Incomplete request body");
+                }
+                break;
+            }
+            continue;
+        }
+        if (c->rpc) {
+            if (!rpc_take_frame(c)) break;
+            continue;
+        }
+        if (c->rbuf.len == 0) break;
+
+        HttpRequest req;
+        int consumed = parse_request(c->rbuf.data, c->rbuf.len, &req);
+        if (consumed == 0) break;  /* Need more bytes */
+
+        c->request_start_ns = now_ns();
+        c->endpoint = ENDPOINT_OTHER;
+        if (consumed < 0) {
+            c->keep_alive = false;
+            send_error(c, -consumed, consumed == -413 ? "Request body too large" :
+                                     consumed == -431 ? "Request headers too large" :
+                                                        "Invalid request");
+            metrics_record_request(c);
+            c->rbuf.len = 0;
+            break;
+        }
+
+        c->keep_alive = req.keep_alive && !c->read_closed;
+        if (!handle_request(c, &req)) {
+            metrics_record_request(c);
+        }
+        /* A streamed body the handler refused is never read - the reply closes */
+        buf_consume(&c->rbuf, (size_t)consumed);
+        if (req.body_streamed && !c->ingest) {
+            c->rbuf.len = 0;
+            break;
+        }
+    }
+    if (c->read_closed && !c->waiting_engine) {
+        c->close_after_write = true;
+    }
+    conn_flush(c);
+}
+
+static void conn_on_readable(Connection *c) {
+    while (!c->read_paused) {
+        if (!buf_reserve(&c->rbuf, 16384)) {
+            conn_close(c);
+            return;
+        }
+        ssize_t n = recv(c->fd, c->rbuf.data + c->rbuf.len, c->rbuf.cap - c->rbuf.len, 0);
+        if (n > 0) {
+            c->rbuf.len += (size_t)n;
+            if (c->ingest) {
+                train_ingest(c);  /* Keeps rbuf small; may pause reading */
+            } else if (c->rbuf.len > MAX_HEADER_SIZE + MAX_BODY_SIZE + 16384) {
+                /* Client keeps pipelining faster than we answer */
+                conn_close(c);
+                return;
+            }
+            continue;
+        }
+        if (n == 0) {
+            /* Peer finished sending - answer what we have, then close */
+            if (c->rbuf.len == 0 && c->wbuf.len == 0 && !c->waiting_engine && !c->ingest) {
+                conn_close(c);
+                return;
+            }
+            c->read_closed = true;
+            conn_update_events(c);
+            break;
+        }
+        if (errno == EINTR) continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+        conn_close(c);
+        return;
+    }
+
+    c->last_active = time(NULL);
+    conn_process(c);
+}
+
+/* Accept on one listener - rpc: its connections speak binary RPC */
+static void accept_connections(int listen_fd, bool rpc) {
+    for (;;) {
+        struct sockaddr_storage client_addr;
+        socklen_t addr_len = sizeof(client_addr);
+        int fd = accept4(listen_fd, (struct sockaddr*)&client_addr, &addr_len,
+                         SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                fprintf(stderr, "Accept failed: %d\n", errno);
+            }
+            return;
+        }
+
+        if (g_server.connection_count >= g_server.max_connections) {
+            /* Full: answer before reading anything and hang up */
+            static const char busy[] =
+                "HTTP/1.1 503 Service Unavailable\r\n"
+                "Retry-After: 1\r\n"
+                "Content-Length: 0\r\n"
+                "Connection: close\r\n"
+                "\r\n";
+            static const uint8_t rpc_busy_frame[RPC_HEADER + 4] = {
+                RPC_HEADER, 0, 0, 0, 0, RPC_BUSY, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0
+            };
+            ssize_t ignored = rpc ? send(fd, rpc_busy_frame, sizeof(rpc_busy_frame), MSG_NOSIGNAL)
+                                  : send(fd, busy, sizeof(busy) - 1, MSG_NOSIGNAL);
+            (void)ignored;
+            close(fd);
+            count_shed(SHED_CONNECTIONS);
+            continue;
+        }
+
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        Connection *c = calloc(1, sizeof(Connection));
+        if (!c) {
+            close(fd);
+            continue;
+        }
+        c->fd = fd;
+        c->rpc = rpc;
+        if (client_addr.ss_family == AF_INET) {
+            c->client_addr = ((struct sockaddr_in*)&client_addr)->sin_addr.s_addr;
+        }
+        c->keep_alive = true;
+        c->last_active = time(NULL);
+
+        struct epoll_event ev;
+        ev.events = EPOLLIN | EPOLLRDHUP;
+        ev.data.ptr = c;
+        if (epoll_ctl(g_server.epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) {
+            close(fd);
+            free(c);
+            continue;
+        }
+
+        c->next = g_server.connections;
+        if (c->next) c->next->prev = c;
+        g_server.connections = c;
+        g_server.connection_count++;
+    }
+}
+
+/* Move a streaming job's pending events onto its connection */
+static void stream_take_output(EngineJob *job) {
+    pthread_mutex_lock(&g_engine.lock);
+    Buffer out = job->stream_out;
+    memset(&job->stream_out, 0, sizeof(Buffer));
+    job->stream_queued = false;
+    pthread_mutex_unlock(&g_engine.lock);
+
+    if (!job->conn->peer_closed) {
+        send_stream_data(job->conn, out.data, out.len);
+    }
+    buf_free(&out);
+}
+
+/* Deliver streamed output and finished chat and inference jobs to their connections */
+static void drain_engine_completions(void) {
+    uint64_t counter;
+    ssize_t ignored = read(g_server.wake_fd, &counter, sizeof(counter));
+    (void)ignored;
+
+    /* Both lists are taken together: a job's stream entry is always handled
+     * before its completion, which frees it */
+    pthread_mutex_lock(&g_engine.lock);
+    EngineJob *streaming = g_engine.stream_head;
+    g_engine.stream_head = g_engine.stream_tail = NULL;
+    EngineJob *job = g_engine.done_head;
+    g_engine.done_head = g_engine.done_tail = NULL;
+    pthread_mutex_unlock(&g_engine.lock);
+
+    while (streaming) {
+        EngineJob *next = streaming->stream_next;
+        stream_take_output(streaming);
+        if (!streaming->conn->peer_closed) conn_flush(streaming->conn);
+        streaming = next;
+    }
+
+    while (job) {
+        EngineJob *next = job->next;
+        if (job->train) {
+            train_chunk_done(job->train);
+            buf_free(&job->pairs);
+            free(job);
+            job = next;
+            continue;
+        }
+
+        Connection *c = job->conn;
+        c->waiting_engine = false;
+
+        if (c->peer_closed) {
+            conn_free(c);
+        } else if (job->rpc_op) {
+            rpc_complete(c, job);
+            metrics_record_request(c);
+            c->last_active = time(NULL);
+            conn_process(c);
+        } else if (job->stream) {
+            stream_take_output(job);
+            char event[256];
+            int len = (job->status == 200)
+                ? snprintf(event, sizeof(event), "event: done\ndata: %s\n\n", job->response)
+                : snprintf(event, sizeof(event), "event: error\ndata: {\"error\":\"Engine error\"}\n\n");
+            send_stream_data(c, event, (size_t)len);
+            send_stream_end(c);
+            metrics_record_request(c);
+            c->last_active = time(NULL);
+            conn_process(c);
+        } else {
+            if (job->status == 200) {
+                send_json(c, 200, job->response);
+            } else if (job->status == 503) {
+                send_busy(c, 503, "Deadline passed while queued", engine_retry_after());
+            } else {
+                send_error(c, job->status, "Engine error");
+            }
+            metrics_record_request(c);
+            c->last_active = time(NULL);
+            conn_process(c);  /* Flush and continue with pipelined requests */
+        }
+
+        buf_free(&job->stream_out);
+        buf_free(&job->pairs);
+        free(job->message);
+        free(job->response);
+        free(job);
+        job = next;
+    }
+}
+
+/* Close keep-alive connections that have been idle too long */
+static void sweep_idle_connections(void) {
+    time_t now = time(NULL);
+    Connection *c = g_server.connections;
+    while (c) {
+        Connection *next = c->next;
+        if (!c->waiting_engine && !c->read_paused && c->wbuf.len == 0 &&
+            now - c->last_active > g_server.idle_timeout) {
+            conn_close(c);
+        }
+        c = next;
+    }
+}
+
+static void run_event_loop(void) {
+    struct epoll_event events[MAX_EVENTS];
+    time_t last_sweep = time(NULL);
+
+    for (;;) {
+        int n = epoll_wait(g_server.epoll_fd, events, MAX_EVENTS, 1000);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            fprintf(stderr, "epoll_wait failed: %d\n", errno);
+            return;
+        }
+
+        for (int i = 0; i < n; i++) {
+            void *tag = events[i].data.ptr;
+            if (tag == &g_listen_tag) {
+                accept_connections(g_server.listen_fd, false);
+                continue;
+            }
+            if (tag == &g_rpc_listen_tag || tag == &g_rpc_unix_tag) {
+                accept_connections(tag == &g_rpc_listen_tag ? g_server.rpc_listen_fd : g_server.rpc_unix_fd, true);
+                continue;
+            }
+            if (tag == &g_wake_tag) {
+                drain_engine_completions();
+                continue;
+            }
+
+            Connection *c = tag;
+            uint32_t ev = events[i].events;
+            if (ev & (EPOLLERR | EPOLLHUP)) {
+                conn_close(c);
+                continue;
+            }
+            if (ev & EPOLLOUT) {
+                if (!conn_flush(c)) continue;
+            }
+            if (ev & (EPOLLIN | EPOLLRDHUP)) {
+                conn_on_readable(c);
+            }
+        }
+
+        time_t now = time(NULL);
+        if (now != last_sweep) {
+            sweep_idle_connections();
+            last_sweep = now;
+        }
+    }
+}
+
+/* Main server loop */
+int main(void) {
+    printf("MELVIN HTTP SERVER\n");
+    printf("==================\n\n");
+
+    signal(SIGPIPE, SIG_IGN);
+
+    /* Initialize the base brain (MELVIN_BRAIN: start from a saved brain) */
+    printf("Initializing Melvin...\n");
+    const char *brain_path = getenv("MELVIN_BRAIN");
+    if (brain_path && *brain_path) {
+        g_base = melvin_load_brain(brain_path);
+        if (!g_base) {
+            fprintf(stderr, "Failed to load brain from %s\n", brain_path);
+            return 1;
+        }
+        printf("Loaded base brain from %s\n", brain_path);
+    } else {
+        g_base = melvin_create();
+    }
+    if (!g_base) {
+        fprintf(stderr, "Failed to create Melvin instance\n");
+        return 1;
+    }
+    /* Clones keep the base brain's sampling rate */
+    g_server.profile_sample = (uint32_t)get_env_int("MELVIN_PROFILE_SAMPLE", 0);
+    melvin_set_profiling(g_base, g_server.profile_sample);
+    melvin_get_stats(g_base, &g_base_stats);
+    printf("Melvin initialized successfully\n\n");
+
+    /* Create socket */
+    int server_socket = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (server_socket < 0) {
+        fprintf(stderr, "Socket creation failed: %d\n", errno);
+        melvin_destroy(g_base);
+        return 1;
+    }
+
+    /* Set socket options (reuse address) */
+    int opt = 1;
+    setsockopt(server_socket, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+
+    /* Get port from environment (Railway sets this) */
+    int port = get_port();
+    int backlog = get_env_int("MELVIN_BACKLOG", DEFAULT_BACKLOG);
+
+    /* Bind socket */
+    struct sockaddr_in server_addr;
+    memset(&server_addr, 0, sizeof(server_addr));
+    server_addr.sin_family = AF_INET;
+    server_addr.sin_addr.s_addr = INADDR_ANY;
+    server_addr.sin_port = htons(port);
+
+    if (bind(server_socket, (struct sockaddr*)&server_addr, sizeof(server_addr)) < 0) {
+        fprintf(stderr, "Bind failed: %d\n", errno);
+        close(server_socket);
+        melvin_destroy(g_base);
+        return 1;
+    }
+
+    /* Listen */
+    if (listen(server_socket, backlog) < 0) {
+        fprintf(stderr, "Listen failed: %d\n", errno);
+        close(server_socket);
+        melvin_destroy(g_base);
+        return 1;
+    }
+
+    /* Event loop plumbing */
+    g_server.listen_fd = server_socket;
+    g_server.idle_timeout = get_env_int("MELVIN_IDLE_TIMEOUT", DEFAULT_IDLE_TIMEOUT);
+    g_server.log_requests = get_env_int("MELVIN_LOG_REQUESTS", 0) > 0;
+    g_server.deadline_ms = (uint32_t)get_env_int("MELVIN_DEADLINE_MS", DEFAULT_DEADLINE_MS);
+    g_server.max_steps = (uint32_t)get_env_int("MELVIN_MAX_STEPS", 0);
+    g_server.max_output = (uint32_t)get_env_int("MELVIN_MAX_OUTPUT", 0);
+    g_server.rate_limit = get_env_int("MELVIN_RATE_LIMIT", 0);
+    g_server.rate_burst = get_env_int("MELVIN_RATE_BURST", g_server.rate_limit > 1 ? (int)g_server.rate_limit * 2 : 2);
+    g_server.max_connections = (uint32_t)get_env_int("MELVIN_MAX_CONNECTIONS", DEFAULT_MAX_CONNECTIONS);
+    g_server.save_dir = getenv("MELVIN_SAVE_DIR") ? getenv("MELVIN_SAVE_DIR") : ".";
+    g_server.epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    g_server.wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (g_server.epoll_fd < 0 || g_server.wake_fd < 0) {
+        fprintf(stderr, "epoll/eventfd setup failed: %d\n", errno);
+        close(server_socket);
+        melvin_destroy(g_base);
+        return 1;
+    }
+
+    struct epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.ptr = &g_listen_tag;
+    epoll_ctl(g_server.epoll_fd, EPOLL_CTL_ADD, server_socket, &ev);
+    ev.events = EPOLLIN;
+    ev.data.ptr = &g_wake_tag;
+    epoll_ctl(g_server.epoll_fd, EPOLL_CTL_ADD, g_server.wake_fd, &ev);
+
+    /* Binary RPC listeners, off unless configured */
+    int rpc_port = get_env_int("MELVIN_RPC_PORT", 0);
+    const char *rpc_path = getenv("MELVIN_RPC_SOCKET");
+    g_server.rpc_listen_fd = rpc_port ? rpc_listen_tcp(rpc_port, backlog) : -1;
+    g_server.rpc_unix_fd = (rpc_path && *rpc_path) ? rpc_listen_unix(rpc_path, backlog) : -1;
+    if ((rpc_port && g_server.rpc_listen_fd < 0) || (rpc_path && *rpc_path && g_server.rpc_unix_fd < 0)) {
+        fprintf(stderr, "RPC listener setup failed: %d\n", errno);
+        close(server_socket);
+        melvin_destroy(g_base);
+        return 1;
+    }
+    if (g_server.rpc_listen_fd >= 0) {
+        ev.data.ptr = &g_rpc_listen_tag;
+        epoll_ctl(g_server.epoll_fd, EPOLL_CTL_ADD, g_server.rpc_listen_fd, &ev);
+    }
+    if (g_server.rpc_unix_fd >= 0) {
+        ev.data.ptr = &g_rpc_unix_tag;
+        epoll_ctl(g_server.epoll_fd, EPOLL_CTL_ADD, g_server.rpc_unix_fd, &ev);
+    }
+
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int workers = get_env_int("MELVIN_WORKERS", cpus > 0 ? (int)cpus : 1);
+    int max_sessions = get_env_int("MELVIN_MAX_SESSIONS", DEFAULT_MAX_SESSIONS);
+    int queue_max = get_env_int("MELVIN_QUEUE_MAX", DEFAULT_QUEUE_MAX);
+    int train_queue_max = get_env_int("MELVIN_TRAIN_QUEUE_MAX", DEFAULT_TRAIN_QUEUE_MAX);
+    if (train_queue_max < 1) train_queue_max = 1;  /* Uploads would never resume */
+    if (!engine_start((uint32_t)workers, (uint32_t)max_sessions, (uint32_t)queue_max, (uint32_t)train_queue_max)) {
+        fprintf(stderr, "Failed to start worker threads\n");
+        close(server_socket);
+        return 1;
+    }
+    int batch_max = get_env_int("MELVIN_BATCH_MAX", DEFAULT_BATCH_MAX);
+    int batch_wait_us = get_env_int("MELVIN_BATCH_WAIT_US", DEFAULT_BATCH_WAIT_US);
+    if (!batcher_start((uint32_t)batch_max, (uint32_t)batch_wait_us, (uint32_t)queue_max)) {
+        fprintf(stderr, "Failed to start inference batcher\n");
+        close(server_socket);
+        return 1;
+    }
+
+    printf("Server listening on port %d (backlog %d)\n", port, backlog);
+    printf("%d workers, up to %d sessions, %d queued chats, %d queued training chunks\n",
+           workers, max_sessions, queue_max, train_queue_max);
+    printf("Inference batches of up to %d, waiting up to %d us\n", batch_max, batch_wait_us);
+    if (rpc_port) printf("Binary RPC on port %d\n", rpc_port);
+    if (g_server.rpc_unix_fd >= 0) printf("Binary RPC on %s\n", rpc_path);
+    printf("Melvin is ready to chat!\n\n");
+
+    run_event_loop();
+
+    /* Cleanup (only reached if epoll fails) */
+    close(server_socket);
+    return 1;
 }
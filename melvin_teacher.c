@@ -0,0 +1,1088 @@
+/* ============================================================================
+ * MELVIN TEACHER: Client for an Ollama-compatible /api/generate endpoint
+ *
+ * One request at a time per connection, kept alive between requests. The
+ * response is decoded as it arrives (Content-Length, chunked, or until
+ * close) into growable buffers, so nothing is truncated and a caller can
+ * multiplex many connections with poll(). Streamed replies are parsed line
+ * by line, so their text is available before the model finishes.
+ * ============================================================================ */
+
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200112L  /* getaddrinfo */
+#endif
+
+#include "melvin_teacher.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <io.h>
+#pragma comment(lib, "ws2_32.lib")
+typedef SOCKET Socket;
+#define BAD_SOCKET INVALID_SOCKET
+#define close_socket closesocket
+#else
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <strings.h>
+#include <unistd.h>
+typedef int Socket;
+#define BAD_SOCKET (-1)
+#define close_socket close
+#endif
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0              /* A closed peer must fail send, not raise SIGPIPE */
+#endif
+
+#define READ_CHUNK 16384
+#define MAX_HEADER_SIZE 65536
+#define MAX_CHUNK_LINE 4096           /* Chunk size line plus extensions */
+
+/* ============================================================================
+ * BYTE BUFFER
+ * ============================================================================ */
+
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+} Buffer;
+
+static bool buf_reserve(Buffer *b, size_t extra) {
+    if (b->len + extra + 1 <= b->cap) return true;
+    size_t cap = b->cap ? b->cap : 1024;
+    while (cap < b->len + extra + 1) cap *= 2;
+    char *data = realloc(b->data, cap);
+    if (!data) return false;
+    b->data = data;
+    b->cap = cap;
+    return true;
+}
+
+/* Keeps the contents NUL-terminated so they can be searched as text */
+static bool buf_append(Buffer *b, const void *data, size_t len) {
+    if (!buf_reserve(b, len)) return false;
+    memcpy(b->data + b->len, data, len);
+    b->len += len;
+    b->data[b->len] = '\0';
+    return true;
+}
+
+static bool buf_append_str(Buffer *b, const char *s) {
+    return buf_append(b, s, strlen(s));
+}
+
+static void buf_free(Buffer *b) {
+    free(b->data);
+    b->data = NULL;
+    b->len = b->cap = 0;
+}
+
+/* ============================================================================
+ * CONFIGURATION
+ * ============================================================================ */
+
+bool teacher_config_set_address(TeacherConfig *cfg, const char *address) {
+    if (strncmp(address, "http://", 7) == 0) address += 7;
+    const char *colon = strrchr(address, ':');
+    size_t host_len = colon ? (size_t)(colon - address) : strlen(address);
+    if (colon) {
+        char *end;
+        long port = strtol(colon + 1, &end, 10);
+        if (end == colon + 1 || (*end && *end != '/') || port <= 0 || port > 65535) return false;
+        cfg->port = (int)port;
+    }
+    if (host_len > 0) {
+        if (host_len >= sizeof(cfg->host)) return false;
+        memcpy(cfg->host, address, host_len);
+        cfg->host[host_len] = '\0';
+    }
+    return true;
+}
+
+void teacher_config_init(TeacherConfig *cfg) {
+    memset(cfg, 0, sizeof(*cfg));
+    snprintf(cfg->host, sizeof(cfg->host), "%s", TEACHER_DEFAULT_HOST);
+    cfg->port = TEACHER_DEFAULT_PORT;
+    snprintf(cfg->model, sizeof(cfg->model), "%s", TEACHER_DEFAULT_MODEL);
+
+    const char *address = getenv("OLLAMA_HOST");
+    if (address && *address && !teacher_config_set_address(cfg, address)) {
+        fprintf(stderr, "warning: ignoring OLLAMA_HOST=%s\n", address);
+    }
+    const char *model = getenv("OLLAMA_MODEL");
+    if (model && *model) snprintf(cfg->model, sizeof(cfg->model), "%s", model);
+}
+
+/* ============================================================================
+ * JSON: String values and escaping
+ * ============================================================================ */
+
+/* Appends s as the inside of a JSON string */
+static bool json_escape(Buffer *out, const char *s) {
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        bool ok;
+        switch (c) {
+            case '"':  ok = buf_append(out, "\\\"", 2); break;
+            case '\\': ok = buf_append(out, "\\\\", 2); break;
+            case '\n': ok = buf_append(out, "\\n", 2); break;
+            case '\r': ok = buf_append(out, "\\r", 2); break;
+            case '\t': ok = buf_append(out, "\\t", 2); break;
+            default:
+                if (c < 0x20) {
+                    char esc[8];
+                    snprintf(esc, sizeof(esc), "\\u%04x", c);
+                    ok = buf_append(out, esc, 6);
+                } else {
+                    ok = buf_append(out, s, 1);
+                }
+        }
+        if (!ok) return false;
+    }
+    return true;
+}
+
+static int hex_value(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+static bool read_hex4(const char *p, const char *end, uint32_t *value) {
+    if (end - p < 4) return false;
+    *value = 0;
+    for (int i = 0; i < 4; i++) {
+        int h = hex_value(p[i]);
+        if (h < 0) return false;
+        *value = *value << 4 | (uint32_t)h;
+    }
+    return true;
+}
+
+static bool append_utf8(Buffer *out, uint32_t cp) {
+    char b[4];
+    size_t n;
+    if (cp < 0x80) {
+        b[0] = (char)cp; n = 1;
+    } else if (cp < 0x800) {
+        b[0] = (char)(0xC0 | cp >> 6); b[1] = (char)(0x80 | (cp & 0x3F)); n = 2;
+    } else if (cp < 0x10000) {
+        b[0] = (char)(0xE0 | cp >> 12); b[1] = (char)(0x80 | (cp >> 6 & 0x3F));
+        b[2] = (char)(0x80 | (cp & 0x3F)); n = 3;
+    } else {
+        b[0] = (char)(0xF0 | cp >> 18); b[1] = (char)(0x80 | (cp >> 12 & 0x3F));
+        b[2] = (char)(0x80 | (cp >> 6 & 0x3F)); b[3] = (char)(0x80 | (cp & 0x3F)); n = 4;
+    }
+    return buf_append(out, b, n);
+}
+
+/* Decodes the string starting after its opening quote. Returns the position
+ * after the closing quote, or NULL if it is malformed. out may be NULL. */
+static const char* json_decode_string(const char *p, const char *end, Buffer *out) {
+    while (p < end) {
+        char c = *p++;
+        if (c == '"') return p;
+        if (c != '\\') {
+            if (out && !buf_append(out, &c, 1)) return NULL;
+            continue;
+        }
+        if (p >= end) return NULL;
+        char e = *p++;
+        char plain;
+        switch (e) {
+            case '"': case '\\': case '/': plain = e; break;
+            case 'b': plain = '\b'; break;
+            case 'f': plain = '\f'; break;
+            case 'n': plain = '\n'; break;
+            case 'r': plain = '\r'; break;
+            case 't': plain = '\t'; break;
+            case 'u': {
+                uint32_t cp;
+                if (!read_hex4(p, end, &cp)) return NULL;
+                p += 4;
+                /* A high surrogate followed by a low one is one code point */
+                uint32_t low;
+                if (cp >= 0xD800 && cp < 0xDC00 && end - p >= 6 && p[0] == '\\' && p[1] == 'u' &&
+                    read_hex4(p + 2, end, &low) && low >= 0xDC00 && low < 0xE000) {
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                    p += 6;
+                }
+                if (out && !append_utf8(out, cp)) return NULL;
+                continue;
+            }
+            default: return NULL;
+        }
+        if (out && !buf_append(out, &plain, 1)) return NULL;
+    }
+    return NULL;
+}
+
+static const char* skip_space(const char *p, const char *end) {
+    while (p < end && isspace((unsigned char)*p)) p++;
+    return p;
+}
+
+/* Start of the value of "key" in the outermost object, or NULL. Only
+ * top-level keys count, so a "response" inside a nested value or a string is
+ * never mistaken for the real one. */
+static const char* json_find_value(const char *json, size_t len, const char *key) {
+    const char *p = json, *end = json + len;
+    size_t key_len = strlen(key);
+    int depth = 0;
+    while (p < end) {
+        char c = *p++;
+        if (c == '{' || c == '[') {
+            depth++;
+        } else if (c == '}' || c == ']') {
+            depth--;
+        } else if (c == '"') {
+            const char *start = p;
+            p = json_decode_string(p, end, NULL);
+            if (!p) return NULL;
+            const char *after = skip_space(p, end);
+            if (depth != 1 || after >= end || *after != ':') continue;
+            /* A key: raw comparison is enough for the plain ASCII keys we look up */
+            bool match = (size_t)(p - 1 - start) == key_len && memcmp(start, key, key_len) == 0;
+            p = skip_space(after + 1, end);
+            if (match) return p < end ? p : NULL;
+        }
+    }
+    return NULL;
+}
+
+/* Appends the decoded string value of "key"; false if absent or not a string */
+static bool json_append_string(Buffer *out, const char *json, size_t len, const char *key) {
+    const char *p = json_find_value(json, len, key);
+    return p && *p == '"' && buf_reserve(out, 0) && json_decode_string(p + 1, json + len, out);
+}
+
+static bool json_true(const char *json, size_t len, const char *key) {
+    const char *p = json_find_value(json, len, key);
+    return p && json + len - p >= 4 && memcmp(p, "true", 4) == 0;
+}
+
+char* teacher_json_string(const char *json, size_t len, const char *key, size_t *out_len) {
+    Buffer value = {0};
+    if (!json_append_string(&value, json, len, key)) {
+        buf_free(&value);
+        return NULL;
+    }
+    value.data[value.len] = '\0';
+    if (out_len) *out_len = value.len;
+    return value.data;
+}
+
+/* ============================================================================
+ * CONNECTION
+ * ============================================================================ */
+
+/* Where the chunked decoder is in the body */
+typedef enum {
+    CHUNK_SIZE,                     /* Reading a "<hex size>\r\n" line */
+    CHUNK_DATA,                     /* chunk_left bytes of data to go */
+    CHUNK_DATA_END,                 /* The \r\n after the data */
+    CHUNK_TRAILER                   /* Trailer lines up to the empty one */
+} ChunkState;
+
+struct TeacherConn {
+    TeacherConfig cfg;
+    Socket sock;
+    TeacherState state;
+    uint32_t connects;
+    char error[320];
+
+    /* Response being read */
+    Buffer in;                      /* Received bytes */
+    size_t in_pos;                  /* Decoded into body up to here */
+    bool headers_done;
+    int status;
+    long long content_length;       /* -1: chunked, or runs until the server closes */
+    bool chunked;
+    ChunkState chunk_state;
+    uint64_t chunk_left;
+    bool close_after;               /* Server sent "Connection: close" */
+    Buffer body;                    /* Decoded body */
+
+    /* Streaming ("stream":true): one JSON object per line */
+    bool streaming;
+    size_t line_pos;                /* Next line of body starts here */
+    bool saw_done;                  /* The "done":true line arrived */
+
+    Buffer response;                /* The "response" text so far */
+    size_t partial_pos;             /* Handed out by teacher_partial up to here */
+};
+
+static void conn_fail(TeacherConn *c, const char *fmt, const char *detail) {
+    snprintf(c->error, sizeof(c->error), fmt, detail ? detail : "");
+    c->state = TEACHER_FAILED;
+    if (c->sock != BAD_SOCKET) {
+        close_socket(c->sock);
+        c->sock = BAD_SOCKET;
+    }
+}
+
+static bool conn_connect(TeacherConn *c) {
+    char port[16];
+    snprintf(port, sizeof(port), "%d", c->cfg.port);
+    struct addrinfo hints, *addrs;
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    int rc = getaddrinfo(c->cfg.host, port, &hints, &addrs);
+    if (rc != 0) {
+        conn_fail(c, "cannot resolve %s", c->cfg.host);
+        return false;
+    }
+    for (struct addrinfo *a = addrs; a; a = a->ai_next) {
+        Socket s = socket(a->ai_family, a->ai_socktype, a->ai_protocol);
+        if (s == BAD_SOCKET) continue;
+        if (connect(s, a->ai_addr, (int)a->ai_addrlen) == 0) {
+            int one = 1;
+            setsockopt(s, IPPROTO_TCP, TCP_NODELAY, (const char*)&one, sizeof(one));
+            c->sock = s;
+            c->connects++;
+            break;
+        }
+        close_socket(s);
+    }
+    freeaddrinfo(addrs);
+    if (c->sock == BAD_SOCKET) {
+        conn_fail(c, "cannot connect to %s", c->cfg.host);
+        return false;
+    }
+    return true;
+}
+
+/* An idle keep-alive connection the server has since closed reads as EOF */
+static bool conn_stale(TeacherConn *c) {
+#ifdef _WIN32
+    WSAPOLLFD pfd = {c->sock, POLLRDNORM, 0};
+    if (WSAPoll(&pfd, 1, 0) <= 0) return false;
+#else
+    struct pollfd pfd = {c->sock, POLLIN, 0};
+    if (poll(&pfd, 1, 0) <= 0) return false;
+#endif
+    char byte;
+    return recv(c->sock, &byte, 1, MSG_PEEK) <= 0;
+}
+
+TeacherConn* teacher_open(const TeacherConfig *cfg) {
+#ifdef _WIN32
+    static bool started = false;
+    if (!started) {
+        WSADATA wsa;
+        if (WSAStartup(MAKEWORD(2, 2), &wsa) != 0) return NULL;
+        started = true;
+    }
+#endif
+    TeacherConn *c = calloc(1, sizeof(TeacherConn));
+    if (!c) return NULL;
+    c->cfg = *cfg;
+    c->sock = BAD_SOCKET;
+    c->state = TEACHER_IDLE;
+    return c;
+}
+
+void teacher_close(TeacherConn *c) {
+    if (!c) return;
+    if (c->sock != BAD_SOCKET) close_socket(c->sock);
+    buf_free(&c->in);
+    buf_free(&c->body);
+    buf_free(&c->response);
+    free(c);
+}
+
+bool teacher_send(TeacherConn *c, const char *prompt) {
+    c->in.len = c->in_pos = 0;
+    c->body.len = c->response.len = 0;
+    c->headers_done = false;
+    c->status = 0;
+    c->content_length = -1;
+    c->chunked = false;
+    c->chunk_state = CHUNK_SIZE;
+    c->chunk_left = 0;
+    c->close_after = false;
+    c->streaming = c->cfg.stream;
+    c->line_pos = 0;
+    c->saw_done = false;
+    c->partial_pos = 0;
+    c->error[0] = '\0';
+
+    if (c->sock != BAD_SOCKET && conn_stale(c)) {
+        close_socket(c->sock);
+        c->sock = BAD_SOCKET;
+    }
+    if (c->sock == BAD_SOCKET && !conn_connect(c)) return false;
+
+    Buffer body = {0}, request = {0};
+    char head[512];
+    bool ok = buf_append_str(&body, "{\"model\":\"") && json_escape(&body, c->cfg.model) &&
+              buf_append_str(&body, "\",\"prompt\":\"") && json_escape(&body, prompt) &&
+              buf_append_str(&body, c->streaming ? "\",\"stream\":true}" : "\",\"stream\":false}");
+    if (ok) {
+        snprintf(head, sizeof(head),
+                 "POST /api/generate HTTP/1.1\r\n"
+                 "Host: %s:%d\r\n"
+                 "Content-Type: application/json\r\n"
+                 "Content-Length: %zu\r\n"
+                 "\r\n",
+                 c->cfg.host, c->cfg.port, body.len);
+        ok = buf_append_str(&request, head) && buf_append(&request, body.data, body.len);
+    }
+    buf_free(&body);
+    if (!ok) {
+        buf_free(&request);
+        conn_fail(c, "out of memory%s", NULL);
+        return false;
+    }
+
+    size_t sent = 0;
+    while (sent < request.len) {
+        int n = send(c->sock, request.data + sent, (int)(request.len - sent), MSG_NOSIGNAL);
+        if (n <= 0) {
+            buf_free(&request);
+            conn_fail(c, "send failed%s", NULL);
+            return false;
+        }
+        sent += (size_t)n;
+    }
+    buf_free(&request);
+    c->state = TEACHER_PENDING;
+    return true;
+}
+
+int teacher_fd(const TeacherConn *c) {
+    return c->sock == BAD_SOCKET ? -1 : (int)c->sock;
+}
+
+TeacherState teacher_state(const TeacherConn *c) {
+    return c->state;
+}
+
+const char* teacher_error(const TeacherConn *c) {
+    return c->error;
+}
+
+uint32_t teacher_connects(const TeacherConn *c) {
+    return c->connects;
+}
+
+/* Case-insensitive "Name: value" lookup in a header block */
+static const char* header_value(const char *headers, const char *name, size_t *value_len) {
+    size_t name_len = strlen(name);
+    for (const char *line = strstr(headers, "\r\n"); line; line = strstr(line, "\r\n")) {
+        line += 2;
+        if (strncasecmp(line, name, name_len) == 0 && line[name_len] == ':') {
+            const char *v = line + name_len + 1;
+            while (*v == ' ' || *v == '\t') v++;
+            const char *e = strstr(v, "\r\n");
+            *value_len = e ? (size_t)(e - v) : strlen(v);
+            return v;
+        }
+    }
+    return NULL;
+}
+
+static bool parse_headers(TeacherConn *c, size_t header_len) {
+    char saved = c->in.data[header_len - 2];
+    c->in.data[header_len - 2] = '\0';  /* Keep the last line's \r\n for header_value */
+    if (sscanf(c->in.data, "HTTP/1.%*d %d", &c->status) != 1) {
+        conn_fail(c, "malformed status line%s", NULL);
+        return false;
+    }
+    size_t len;
+    const char *v = header_value(c->in.data, "Transfer-Encoding", &len);
+    if (v) {
+        c->chunked = len >= 7 && strncasecmp(v + len - 7, "chunked", 7) == 0;
+        if (!c->chunked && !(len == 8 && strncasecmp(v, "identity", 8) == 0)) {
+            conn_fail(c, "unsupported transfer encoding%s", NULL);
+            return false;
+        }
+    }
+    v = header_value(c->in.data, "Content-Length", &len);
+    if (v && !c->chunked) c->content_length = strtoll(v, NULL, 10);
+    v = header_value(c->in.data, "Connection", &len);
+    c->close_after = v && len == 5 && strncasecmp(v, "close", 5) == 0;
+    c->in.data[header_len - 2] = saved;
+    c->headers_done = true;
+    c->in_pos = header_len;         /* Whatever follows is the start of the body */
+    return true;
+}
+
+static const char* find_crlf(const char *p, size_t len) {
+    for (size_t i = 0; i + 1 < len; i++) {
+        if (p[i] == '\r' && p[i + 1] == '\n') return p + i;
+    }
+    return NULL;
+}
+
+/* Moves received bytes into body, undoing chunked encoding.
+ * Returns 1 when the body is complete, 0 for more, -1 on a framing error. */
+static int decode_body(TeacherConn *c) {
+    if (!c->chunked) {
+        size_t take = c->in.len - c->in_pos;
+        if (c->content_length >= 0 && (long long)(c->body.len + take) > c->content_length) {
+            take = (size_t)(c->content_length - (long long)c->body.len);
+        }
+        if (!buf_append(&c->body, c->in.data + c->in_pos, take)) return -1;
+        c->in_pos += take;
+        return c->content_length >= 0 && (long long)c->body.len >= c->content_length;
+    }
+    for (;;) {
+        const char *p = c->in.data + c->in_pos;
+        size_t avail = c->in.len - c->in_pos;
+        switch (c->chunk_state) {
+            case CHUNK_SIZE:
+            case CHUNK_TRAILER: {
+                const char *eol = find_crlf(p, avail);
+                if (!eol) return avail > MAX_CHUNK_LINE ? -1 : 0;
+                size_t line_len = (size_t)(eol - p);
+                c->in_pos += line_len + 2;
+                if (c->chunk_state == CHUNK_TRAILER) {
+                    if (line_len == 0) return 1;
+                    continue;
+                }
+                char *end;
+                unsigned long long size = strtoull(p, &end, 16);
+                if (end == p) return -1;
+                if (size == 0) {
+                    c->chunk_state = CHUNK_TRAILER;
+                } else {
+                    c->chunk_left = size;
+                    c->chunk_state = CHUNK_DATA;
+                }
+                continue;
+            }
+            case CHUNK_DATA: {
+                size_t take = avail < c->chunk_left ? avail : (size_t)c->chunk_left;
+                if (take == 0) return 0;
+                if (!buf_append(&c->body, p, take)) return -1;
+                c->in_pos += take;
+                c->chunk_left -= take;
+                if (c->chunk_left == 0) c->chunk_state = CHUNK_DATA_END;
+                continue;
+            }
+            case CHUNK_DATA_END:
+                if (avail < 2) return 0;
+                if (p[0] != '\r' || p[1] != '\n') return -1;
+                c->in_pos += 2;
+                c->chunk_state = CHUNK_SIZE;
+                continue;
+        }
+    }
+}
+
+/* One line of streamed output: a piece of the response, an error, or the end */
+static bool parse_stream_line(TeacherConn *c, const char *line, size_t len) {
+    const char *end = skip_space(line, line + len);
+    if (end == line + len) return true;
+    char *error = teacher_json_string(line, len, "error", NULL);
+    if (error) {
+        conn_fail(c, "teacher error: %.200s", error);
+        free(error);
+        return false;
+    }
+    size_t before = c->response.len;
+    if (json_find_value(line, len, "response") && !json_append_string(&c->response, line, len, "response")) {
+        c->response.len = before;
+        conn_fail(c, "malformed \"response\" in the stream%s", NULL);
+        return false;
+    }
+    if (json_true(line, len, "done")) c->saw_done = true;
+    return true;
+}
+
+/* Parses the complete lines of body; at_end also takes an unterminated last line */
+static bool parse_stream_lines(TeacherConn *c, bool at_end) {
+    while (c->line_pos < c->body.len) {
+        const char *line = c->body.data + c->line_pos;
+        size_t avail = c->body.len - c->line_pos;
+        const char *nl = memchr(line, '\n', avail);
+        if (!nl && !at_end) break;
+        size_t line_len = nl ? (size_t)(nl - line) : avail;
+        c->line_pos += line_len + (nl ? 1 : 0);
+        if (!parse_stream_line(c, line, line_len)) return false;
+    }
+    /* Parsed lines are not needed again */
+    if (c->line_pos == c->body.len) c->body.len = c->line_pos = 0;
+    return true;
+}
+
+/* Body complete: pull out the text, or the server's error */
+static TeacherState finish_response(TeacherConn *c) {
+    if (c->close_after || (!c->chunked && c->content_length < 0)) {
+        close_socket(c->sock);
+        c->sock = BAD_SOCKET;
+    }
+    const char *json = c->body.data ? c->body.data : "";
+    if (c->status != 200) {
+        char *text = teacher_json_string(json, c->body.len, "error", NULL);
+        char detail[120];
+        snprintf(detail, sizeof(detail), "%d %.100s", c->status, text ? text : "");
+        free(text);
+        conn_fail(c, "HTTP %s", detail);
+        return c->state;
+    }
+    if (c->streaming) {
+        if (!parse_stream_lines(c, true)) return c->state;
+        if (!c->saw_done) {
+            conn_fail(c, "stream ended before \"done\"%s", NULL);
+            return c->state;
+        }
+    } else if (!json_append_string(&c->response, json, c->body.len, "response")) {
+        conn_fail(c, "no \"response\" in the reply%s", NULL);
+        return c->state;
+    }
+    if (!buf_reserve(&c->response, 0)) {
+        conn_fail(c, "out of memory%s", NULL);
+        return c->state;
+    }
+    c->response.data[c->response.len] = '\0';
+    c->state = TEACHER_DONE;
+    return c->state;
+}
+
+TeacherState teacher_read(TeacherConn *c) {
+    if (c->state != TEACHER_PENDING) return c->state;
+    char chunk[READ_CHUNK];
+    int n = recv(c->sock, chunk, sizeof(chunk), 0);
+    if (n < 0) {
+        conn_fail(c, "receive failed%s", NULL);
+        return c->state;
+    }
+    if (n == 0) {
+        if (c->headers_done && !c->chunked && c->content_length < 0) return finish_response(c);
+        conn_fail(c, "connection closed mid-response%s", NULL);
+        return c->state;
+    }
+    if (!buf_append(&c->in, chunk, (size_t)n)) {
+        conn_fail(c, "out of memory%s", NULL);
+        return c->state;
+    }
+
+    if (!c->headers_done) {
+        const char *end = strstr(c->in.data, "\r\n\r\n");
+        if (!end) {
+            if (c->in.len > MAX_HEADER_SIZE) conn_fail(c, "response headers too large%s", NULL);
+            return c->state;
+        }
+        if (!parse_headers(c, (size_t)(end - c->in.data) + 4)) return c->state;
+    }
+
+    int complete = decode_body(c);
+    if (complete < 0) {
+        conn_fail(c, "malformed response body%s", NULL);
+        return c->state;
+    }
+    /* Drop what has been decoded */
+    if (c->in_pos == c->in.len) {
+        c->in.len = c->in_pos = 0;
+    } else if (c->in_pos >= READ_CHUNK) {
+        memmove(c->in.data, c->in.data + c->in_pos, c->in.len - c->in_pos);
+        c->in.len -= c->in_pos;
+        c->in_pos = 0;
+        c->in.data[c->in.len] = '\0';
+    }
+
+    if (c->streaming && c->status == 200 && !parse_stream_lines(c, false)) return c->state;
+    return complete ? finish_response(c) : c->state;
+}
+
+const char* teacher_partial(TeacherConn *c, size_t *length) {
+    *length = c->response.len - c->partial_pos;
+    const char *text = c->response.data ? c->response.data + c->partial_pos : "";
+    c->partial_pos = c->response.len;
+    return text;
+}
+
+char* teacher_take_response(TeacherConn *c, size_t *length) {
+    if (c->state != TEACHER_DONE) return NULL;
+    char *text = c->response.data;
+    if (length) *length = c->response.len;
+    c->response.data = NULL;
+    c->response.len = c->response.cap = 0;
+    c->partial_pos = 0;
+    c->state = TEACHER_IDLE;
+    return text;
+}
+
+char* teacher_generate(TeacherConn *c, const char *prompt) {
+    if (!teacher_send(c, prompt)) return NULL;
+    while (teacher_read(c) == TEACHER_PENDING) {}
+    return teacher_take_response(c, NULL);
+}
+
+/* ============================================================================
+ * RESPONSE CACHE: Append-only log with an in-memory index
+ *
+ * File: "MTCC", u32 version, then records of
+ *   'R', u32 model_len, u32 prompt_len, u32 response_len,
+ *   u64 FNV-1a of the three strings, model, prompt, response
+ * all little-endian. A torn or corrupt tail (a crash mid-append) is cut off
+ * when the log is opened. Putting a key again appends a new record that
+ * supersedes the old one; compaction drops superseded records and, past
+ * the size cap, the oldest entries.
+ * ============================================================================ */
+
+#define CACHE_MAGIC "MTCC"
+#define CACHE_VERSION 1
+#define CACHE_HEADER_SIZE 8
+#define CACHE_RECORD_HEADER 21      /* 'R' + 3 x u32 + u64 */
+#define CACHE_MAX_FIELD (1u << 30)
+#define CACHE_EMPTY UINT64_MAX
+
+typedef struct {
+    uint64_t key;                   /* Hash of model and prompt */
+    uint64_t offset;                /* Record start; CACHE_EMPTY for a free slot */
+    uint32_t size;                  /* Whole record */
+} CacheSlot;
+
+struct TeacherCache {
+    char *path;
+    FILE *file;
+    uint64_t max_bytes;             /* 0: no cap */
+    uint64_t file_bytes;
+    uint64_t live_bytes;            /* Records the index points at */
+    CacheSlot *slots;
+    uint32_t capacity;              /* Power of two */
+    uint32_t entries;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evicted;
+};
+
+static uint64_t fnv1a(uint64_t h, const void *data, size_t len) {
+    const uint8_t *p = data;
+    for (size_t i = 0; i < len; i++) {
+        h ^= p[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+#define FNV_OFFSET 14695981039346656037ull
+
+static uint64_t cache_key(const char *model, const char *prompt) {
+    uint64_t h = fnv1a(FNV_OFFSET, model, strlen(model) + 1);  /* NUL separates the two */
+    return fnv1a(h, prompt, strlen(prompt));
+}
+
+static void put_u32(uint8_t *b, uint32_t v) {
+    for (int i = 0; i < 4; i++) b[i] = (uint8_t)(v >> (8 * i));
+}
+
+static uint32_t get_u32(const uint8_t *b) {
+    return (uint32_t)b[0] | (uint32_t)b[1] << 8 | (uint32_t)b[2] << 16 | (uint32_t)b[3] << 24;
+}
+
+static void put_u64(uint8_t *b, uint64_t v) {
+    put_u32(b, (uint32_t)v);
+    put_u32(b + 4, (uint32_t)(v >> 32));
+}
+
+static uint64_t get_u64(const uint8_t *b) {
+    return (uint64_t)get_u32(b) | (uint64_t)get_u32(b + 4) << 32;
+}
+
+/* Slot holding key, or the free slot where it would go */
+static CacheSlot* cache_slot(TeacherCache *cache, uint64_t key) {
+    uint32_t mask = cache->capacity - 1;
+    for (uint32_t i = (uint32_t)key & mask;; i = (i + 1) & mask) {
+        CacheSlot *s = &cache->slots[i];
+        if (s->offset == CACHE_EMPTY || s->key == key) return s;
+    }
+}
+
+static bool cache_index_reset(TeacherCache *cache, uint32_t capacity) {
+    CacheSlot *slots = malloc(capacity * sizeof(CacheSlot));
+    if (!slots) return false;
+    for (uint32_t i = 0; i < capacity; i++) slots[i].offset = CACHE_EMPTY;
+    free(cache->slots);
+    cache->slots = slots;
+    cache->capacity = capacity;
+    cache->entries = 0;
+    cache->live_bytes = 0;
+    return true;
+}
+
+static bool cache_index_add(TeacherCache *cache, uint64_t key, uint64_t offset, uint32_t size) {
+    if ((cache->entries + 1) * 10 > cache->capacity * 7) {
+        CacheSlot *old = cache->slots;
+        uint32_t old_capacity = cache->capacity;
+        cache->slots = NULL;
+        if (!cache_index_reset(cache, old_capacity * 2)) {
+            cache->slots = old;
+            cache->capacity = old_capacity;
+            return false;
+        }
+        for (uint32_t i = 0; i < old_capacity; i++) {
+            if (old[i].offset == CACHE_EMPTY) continue;
+            *cache_slot(cache, old[i].key) = old[i];
+            cache->entries++;
+            cache->live_bytes += old[i].size;
+        }
+        free(old);
+    }
+    CacheSlot *s = cache_slot(cache, key);
+    if (s->offset == CACHE_EMPTY) {
+        cache->entries++;
+    } else {
+        cache->live_bytes -= s->size;
+    }
+    s->key = key;
+    s->offset = offset;
+    s->size = size;
+    cache->live_bytes += size;
+    return true;
+}
+
+/* Reads the record at offset: payload is model, prompt, response back to
+ * back (malloc'd, one extra byte for a NUL). False if it does not check out. */
+static bool cache_read_record(FILE *f, uint64_t offset, uint64_t file_bytes, uint32_t lens[3], char **payload) {
+    uint8_t head[CACHE_RECORD_HEADER];
+    if (offset + CACHE_RECORD_HEADER > file_bytes || fseek(f, (long)offset, SEEK_SET) != 0 ||
+        fread(head, 1, sizeof(head), f) != sizeof(head) || head[0] != 'R') {
+        return false;
+    }
+    uint64_t total = 0;
+    for (int i = 0; i < 3; i++) {
+        lens[i] = get_u32(head + 1 + 4 * i);
+        if (lens[i] > CACHE_MAX_FIELD) return false;
+        total += lens[i];
+    }
+    if (offset + CACHE_RECORD_HEADER + total > file_bytes) return false;
+    char *data = malloc((size_t)total + 1);
+    if (!data) return false;
+    if (fread(data, 1, (size_t)total, f) != total || fnv1a(FNV_OFFSET, data, (size_t)total) != get_u64(head + 13)) {
+        free(data);
+        return false;
+    }
+    *payload = data;
+    return true;
+}
+
+static bool cache_truncate(TeacherCache *cache, uint64_t size) {
+    fflush(cache->file);
+#ifdef _WIN32
+    return _chsize_s(_fileno(cache->file), (long long)size) == 0;
+#else
+    return ftruncate(fileno(cache->file), (off_t)size) == 0;
+#endif
+}
+
+/* Indexes every record, cutting off a bad tail */
+static bool cache_load(TeacherCache *cache) {
+    if (fseek(cache->file, 0, SEEK_END) != 0) return false;
+    cache->file_bytes = (uint64_t)ftell(cache->file);
+    if (!cache_index_reset(cache, 1024)) return false;
+    if (cache->file_bytes == 0) {
+        uint8_t head[CACHE_HEADER_SIZE];
+        memcpy(head, CACHE_MAGIC, 4);
+        put_u32(head + 4, CACHE_VERSION);
+        if (fwrite(head, 1, sizeof(head), cache->file) != sizeof(head) || fflush(cache->file) != 0) return false;
+        cache->file_bytes = CACHE_HEADER_SIZE;
+        return true;
+    }
+    uint8_t head[CACHE_HEADER_SIZE];
+    rewind(cache->file);
+    if (fread(head, 1, sizeof(head), cache->file) != sizeof(head) ||
+        memcmp(head, CACHE_MAGIC, 4) != 0 || get_u32(head + 4) != CACHE_VERSION) {
+        return false;
+    }
+    uint64_t offset = CACHE_HEADER_SIZE;
+    uint32_t lens[3];
+    char *payload;
+    while (offset < cache->file_bytes &&
+           cache_read_record(cache->file, offset, cache->file_bytes, lens, &payload)) {
+        uint64_t h = fnv1a(FNV_OFFSET, payload, lens[0]);
+        h = fnv1a(h, "", 1);
+        h = fnv1a(h, payload + lens[0], lens[1]);
+        uint32_t size = CACHE_RECORD_HEADER + lens[0] + lens[1] + lens[2];
+        free(payload);
+        if (!cache_index_add(cache, h, offset, size)) return false;
+        offset += size;
+    }
+    if (offset < cache->file_bytes) {
+        fprintf(stderr, "teacher cache: dropping %llu damaged bytes at the end of %s\n",
+                (unsigned long long)(cache->file_bytes - offset), cache->path);
+        if (!cache_truncate(cache, offset)) return false;
+        cache->file_bytes = offset;
+    }
+    return true;
+}
+
+static bool cache_compact(TeacherCache *cache);
+
+TeacherCache* teacher_cache_open(const char *path, uint64_t max_bytes) {
+    TeacherCache *cache = calloc(1, sizeof(TeacherCache));
+    if (!cache) return NULL;
+    cache->path = malloc(strlen(path) + 1);
+    if (cache->path) strcpy(cache->path, path);
+    cache->max_bytes = max_bytes;
+    cache->file = fopen(path, "r+b");
+    if (!cache->file) cache->file = fopen(path, "w+b");
+    if (!cache->path || !cache->file || !cache_load(cache) ||
+        (max_bytes && cache->file_bytes > max_bytes && !cache_compact(cache))) {
+        teacher_cache_close(cache);
+        return NULL;
+    }
+    return cache;
+}
+
+void teacher_cache_close(TeacherCache *cache) {
+    if (!cache) return;
+    if (cache->file) fclose(cache->file);
+    free(cache->slots);
+    free(cache->path);
+    free(cache);
+}
+
+char* teacher_cache_get(TeacherCache *cache, const char *model, const char *prompt, size_t *length) {
+    CacheSlot *s = cache_slot(cache, cache_key(model, prompt));
+    uint32_t lens[3];
+    char *payload;
+    if (!cache->file || s->offset == CACHE_EMPTY ||
+        !cache_read_record(cache->file, s->offset, cache->file_bytes, lens, &payload)) {
+        cache->misses++;
+        return NULL;
+    }
+    /* The hash found it; the stored strings decide */
+    if (lens[0] != strlen(model) || lens[1] != strlen(prompt) ||
+        memcmp(payload, model, lens[0]) != 0 || memcmp(payload + lens[0], prompt, lens[1]) != 0) {
+        free(payload);
+        cache->misses++;
+        return NULL;
+    }
+    memmove(payload, payload + lens[0] + lens[1], lens[2]);
+    payload[lens[2]] = '\0';
+    if (length) *length = lens[2];
+    cache->hits++;
+    return payload;
+}
+
+static int compare_offset(const void *a, const void *b) {
+    uint64_t x = ((const CacheSlot*)a)->offset, y = ((const CacheSlot*)b)->offset;
+    return (x > y) - (x < y);
+}
+
+/* Rewrites the log with only live records, oldest dropped until it fits in
+ * three quarters of the cap (so compaction is not needed again at once) */
+static bool cache_compact(TeacherCache *cache) {
+    uint32_t count = 0;
+    CacheSlot *live = malloc((cache->entries + 1) * sizeof(CacheSlot));
+    if (!live) return false;
+    for (uint32_t i = 0; i < cache->capacity; i++) {
+        if (cache->slots[i].offset != CACHE_EMPTY) live[count++] = cache->slots[i];
+    }
+    qsort(live, count, sizeof(CacheSlot), compare_offset);
+    uint64_t keep_bytes = cache->live_bytes;
+    uint32_t first = 0;
+    uint64_t target = cache->max_bytes / 4 * 3;
+    while (cache->max_bytes && first < count && CACHE_HEADER_SIZE + keep_bytes > target) {
+        keep_bytes -= live[first++].size;
+    }
+
+    size_t tmp_len = strlen(cache->path) + 5;
+    char *tmp_path = malloc(tmp_len);
+    FILE *out = NULL;
+    if (tmp_path) {
+        snprintf(tmp_path, tmp_len, "%s.tmp", cache->path);
+        out = fopen(tmp_path, "wb");
+    }
+    bool ok = out != NULL;
+    if (ok) {
+        uint8_t head[CACHE_HEADER_SIZE];
+        memcpy(head, CACHE_MAGIC, 4);
+        put_u32(head + 4, CACHE_VERSION);
+        ok = fwrite(head, 1, sizeof(head), out) == sizeof(head);
+    }
+    char *record = NULL;
+    for (uint32_t i = first; ok && i < count; i++) {
+        char *grown = realloc(record, live[i].size);
+        ok = grown && fseek(cache->file, (long)live[i].offset, SEEK_SET) == 0 &&
+             fread(grown, 1, live[i].size, cache->file) == live[i].size &&
+             fwrite(grown, 1, live[i].size, out) == live[i].size;
+        if (grown) record = grown;
+    }
+    free(record);
+    free(live);
+    if (out && (fclose(out) != 0)) ok = false;
+    if (ok) {
+        fclose(cache->file);
+#ifdef _WIN32
+        remove(cache->path);
+#endif
+        ok = rename(tmp_path, cache->path) == 0;
+        cache->file = fopen(cache->path, "r+b");
+        ok = ok && cache->file && cache_load(cache);
+        if (ok) cache->evicted += first;
+    } else if (tmp_path) {
+        remove(tmp_path);
+    }
+    free(tmp_path);
+    return ok;
+}
+
+bool teacher_cache_put(TeacherCache *cache, const char *model, const char *prompt,
+                       const char *response, size_t length) {
+    size_t lens[3] = {strlen(model), strlen(prompt), length};
+    const char *parts[3] = {model, prompt, response};
+    if (!cache->file || lens[0] > CACHE_MAX_FIELD || lens[1] > CACHE_MAX_FIELD || length > CACHE_MAX_FIELD) {
+        return false;
+    }
+    uint8_t head[CACHE_RECORD_HEADER];
+    uint64_t check = FNV_OFFSET;
+    head[0] = 'R';
+    for (int i = 0; i < 3; i++) {
+        put_u32(head + 1 + 4 * i, (uint32_t)lens[i]);
+        check = fnv1a(check, parts[i], lens[i]);
+    }
+    put_u64(head + 13, check);
+
+    uint64_t offset = cache->file_bytes;
+    bool ok = fseek(cache->file, (long)offset, SEEK_SET) == 0 &&
+              fwrite(head, 1, sizeof(head), cache->file) == sizeof(head);
+    for (int i = 0; ok && i < 3; i++) ok = fwrite(parts[i], 1, lens[i], cache->file) == lens[i];
+    ok = ok && fflush(cache->file) == 0;
+    uint32_t size = (uint32_t)(CACHE_RECORD_HEADER + lens[0] + lens[1] + lens[2]);
+    if (!ok) {
+        cache_truncate(cache, offset);
+        return false;
+    }
+    cache->file_bytes += size;
+    if (!cache_index_add(cache, cache_key(model, prompt), offset, size)) return false;
+    /* Superseded records count too: compacting drops them first */
+    if (cache->max_bytes && cache->file_bytes > cache->max_bytes) return cache_compact(cache);
+    return true;
+}
+
+void teacher_cache_stats(const TeacherCache *cache, TeacherCacheStats *stats) {
+    stats->hits = cache->hits;
+    stats->misses = cache->misses;
+    stats->evicted = cache->evicted;
+    stats->entries = cache->entries;
+    stats->file_bytes = cache->file_bytes;
+}
+
+TeacherCache* teacher_cache_from_env(void) {
+    const char *path = getenv("MELVIN_TEACHER_CACHE");
+    if (!path || !*path) return NULL;
+    const char *mb = getenv("MELVIN_TEACHER_CACHE_MB");
+    double cap = mb && *mb ? atof(mb) : 256.0;
+    TeacherCache *cache = teacher_cache_open(path, cap > 0 ? (uint64_t)(cap * 1024 * 1024) : 0);
+    if (!cache) fprintf(stderr, "warning: cannot use %s as a teacher cache\n", path);
+    return cache;
+}
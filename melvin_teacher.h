@@ -0,0 +1,107 @@
+/* ============================================================================
+ * MELVIN TEACHER: Client for an Ollama-compatible /api/generate endpoint
+ *
+ * The teacher is the model Melvin distills from. A TeacherConn is one
+ * keep-alive HTTP/1.1 connection carrying one request at a time; programs
+ * that want several requests in flight open several connections and poll()
+ * their sockets (see melvin_distill.c). teacher_generate is the blocking
+ * one-shot form used by the trainer.
+ *
+ * With stream set the teacher sends its answer a few tokens at a time
+ * (chunked NDJSON, Ollama's "stream":true); teacher_partial hands out each
+ * piece as it is read, so a caller can show or train on the text before the
+ * model has finished (see melvin_ollama_bridge.c).
+ * ============================================================================ */
+
+#ifndef MELVIN_TEACHER_H
+#define MELVIN_TEACHER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#define TEACHER_DEFAULT_HOST "127.0.0.1"
+#define TEACHER_DEFAULT_PORT 11434
+#define TEACHER_DEFAULT_MODEL "llama3.2"
+
+typedef struct {
+    char host[256];
+    int port;
+    char model[128];
+    bool stream;                    /* Ask for the reply token by token */
+} TeacherConfig;
+
+/* Defaults (not streaming), then OLLAMA_HOST ("host:port" or "http://host:port") and OLLAMA_MODEL */
+void teacher_config_init(TeacherConfig *cfg);
+/* "host:port", "host" or ":port"; false if the port is not a valid number */
+bool teacher_config_set_address(TeacherConfig *cfg, const char *address);
+
+typedef struct TeacherConn TeacherConn;
+
+/* Progress of the request on a connection */
+typedef enum {
+    TEACHER_IDLE,                   /* Nothing sent, or the response was taken */
+    TEACHER_PENDING,                /* Waiting for (more of) the response */
+    TEACHER_DONE,                   /* Response complete: teacher_take_response */
+    TEACHER_FAILED                  /* Connection or protocol error; resend to retry */
+} TeacherState;
+
+/* Connects lazily: nothing touches the network until the first send */
+TeacherConn* teacher_open(const TeacherConfig *cfg);
+void teacher_close(TeacherConn *c);
+
+/* Starts a request for prompt (reconnecting if the server closed the
+ * connection). False if it could not be sent. */
+bool teacher_send(TeacherConn *c, const char *prompt);
+/* Socket to poll() for input while PENDING; -1 when not connected */
+int teacher_fd(const TeacherConn *c);
+/* Reads what has arrived, without blocking once poll() reported input */
+TeacherState teacher_read(TeacherConn *c);
+TeacherState teacher_state(const TeacherConn *c);
+/* Response text read since the last call (streaming: while still PENDING).
+ * Not NUL-terminated; valid until the next read or take. */
+const char* teacher_partial(TeacherConn *c, size_t *length);
+/* The whole response text (malloc'd, caller frees); the connection goes IDLE */
+char* teacher_take_response(TeacherConn *c, size_t *length);
+/* Why the last request failed */
+const char* teacher_error(const TeacherConn *c);
+/* TCP connections opened over the connection's life (1 when keep-alive held) */
+uint32_t teacher_connects(const TeacherConn *c);
+
+/* send, then read until done; NULL on failure */
+char* teacher_generate(TeacherConn *c, const char *prompt);
+
+/* ============================================================================
+ * Response cache: replies kept on disk by (model, prompt), so reruns and
+ * tests against a stub read them locally instead of asking the teacher.
+ * An append-only log file with an in-memory index; not thread-safe.
+ * ============================================================================ */
+
+typedef struct TeacherCache TeacherCache;
+
+typedef struct {
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evicted;               /* Entries dropped to stay under the cap */
+    uint32_t entries;
+    uint64_t file_bytes;
+} TeacherCacheStats;
+
+/* Opens or creates the log at path. Past max_bytes (0: no cap) the log is
+ * compacted and the oldest entries dropped. NULL if it cannot be used. */
+TeacherCache* teacher_cache_open(const char *path, uint64_t max_bytes);
+void teacher_cache_close(TeacherCache *cache);
+/* The cached response (malloc'd, caller frees), or NULL on a miss */
+char* teacher_cache_get(TeacherCache *cache, const char *model, const char *prompt, size_t *length);
+/* Records a response, replacing any earlier one for the same model and prompt */
+bool teacher_cache_put(TeacherCache *cache, const char *model, const char *prompt,
+                       const char *response, size_t length);
+void teacher_cache_stats(const TeacherCache *cache, TeacherCacheStats *stats);
+/* The cache named by MELVIN_TEACHER_CACHE (capped at MELVIN_TEACHER_CACHE_MB,
+ * default 256); NULL if unset or unusable */
+TeacherCache* teacher_cache_from_env(void);
+
+/* JSON string value of "key" in an object (malloc'd, unescaped, UTF-8); NULL if absent */
+char* teacher_json_string(const char *json, size_t len, const char *key, size_t *out_len);
+
+#endif /* MELVIN_TEACHER_H */
@@ -0,0 +1,305 @@
+/* ============================================================================
+ * MELVIN TEACHER STUB
+ *
+ * Stands in for Ollama when testing the teacher client and distillation
+ * driver: answers POST /api/generate over keep-alive HTTP/1.1 with canned or
+ * derived responses after a fixed delay, so runs need no model and take a
+ * predictable time.
+ *
+ *   ./melvin_teacher_stub --port 11500 --delay-ms 40
+ *   ./melvin_teacher_stub --responses canned.tsv     "prompt<TAB>response" lines
+ *   ./melvin_teacher_stub --close-every 3            "Connection: close" on every
+ *                                                    3rd reply, to test reconnects
+ *
+ *   ./melvin_teacher_stub --token-ms 5               pause between streamed tokens
+ *
+ * A prompt without a canned response gets "The teacher says: <prompt>, and
+ * that is all." Requests with "stream":true are answered like Ollama: one
+ * JSON line per word, chunked, ending with a "done":true line. Each line is
+ * split across two chunks so clients must reassemble lines. One thread per
+ * connection; runs until killed.
+ * ============================================================================ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <signal.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include "melvin_teacher.h"
+
+#define MAX_CANNED 4096
+#define MAX_REQUEST (1 << 20)
+
+typedef struct {
+    char *prompt;
+    char *response;
+} Canned;
+
+static Canned canned[MAX_CANNED];
+static uint32_t canned_count = 0;
+static int delay_ms = 0;
+static int close_every = 0;
+static int token_ms = 0;
+
+static bool load_responses(const char *path) {
+    FILE *f = fopen(path, "r");
+    if (!f) return false;
+    char *line = NULL;
+    size_t cap = 0;
+    ssize_t len;
+    while ((len = getline(&line, &cap, f)) > 0 && canned_count < MAX_CANNED) {
+        while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) line[--len] = '\0';
+        char *tab = strchr(line, '\t');
+        if (!tab) continue;
+        *tab = '\0';
+        canned[canned_count].prompt = strdup(line);
+        canned[canned_count].response = strdup(tab + 1);
+        canned_count++;
+    }
+    free(line);
+    fclose(f);
+    return true;
+}
+
+static char* response_for(const char *prompt) {
+    for (uint32_t i = 0; i < canned_count; i++) {
+        if (strcmp(canned[i].prompt, prompt) == 0) return strdup(canned[i].response);
+    }
+    size_t len = strlen(prompt) + 64;
+    char *text = malloc(len);
+    if (text) snprintf(text, len, "The teacher says: %s, and that is all.", prompt);
+    return text;
+}
+
+/* JSON string contents; the caller's buffer must hold 6 bytes per input byte */
+static size_t json_escape(char *out, const char *s) {
+    char *o = out;
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\') { *o++ = '\\'; *o++ = (char)c; }
+        else if (c == '\n') { *o++ = '\\'; *o++ = 'n'; }
+        else if (c < 0x20) o += sprintf(o, "\\u%04x", c);
+        else *o++ = (char)c;
+    }
+    *o = '\0';
+    return (size_t)(o - out);
+}
+
+static bool send_all(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+        if (n <= 0) return false;
+        data += n;
+        len -= (size_t)n;
+    }
+    return true;
+}
+
+static void sleep_ms(int ms) {
+    if (ms <= 0) return;
+    struct timespec ts = {ms / 1000, (long)(ms % 1000) * 1000000L};
+    nanosleep(&ts, NULL);
+}
+
+static bool send_chunk(int fd, const char *data, size_t len) {
+    char size[32];
+    int n = snprintf(size, sizeof(size), "%zx\r\n", len);
+    return send_all(fd, size, (size_t)n) && send_all(fd, data, len) && send_all(fd, "\r\n", 2);
+}
+
+/* One line per word (long words in 64-byte pieces, never splitting a UTF-8
+ * character), then the done line and the last chunk */
+static bool stream_reply(int fd, const char *model, const char *text, bool close_after) {
+    char head[256];
+    int n = snprintf(head, sizeof(head),
+                     "HTTP/1.1 200 OK\r\n"
+                     "Content-Type: application/x-ndjson\r\n"
+                     "Transfer-Encoding: chunked\r\n"
+                     "%s"
+                     "\r\n",
+                     close_after ? "Connection: close\r\n" : "");
+    if (!send_all(fd, head, (size_t)n)) return false;
+
+    char token[65], escaped[64 * 6 + 1];
+    char *line = malloc(strlen(model) * 6 + sizeof(escaped) + 64);
+    char *escaped_model = malloc(strlen(model) * 6 + 1);
+    json_escape(escaped_model, model);
+    bool ok = line && escaped_model;
+    const char *p = text;
+    while (ok) {
+        size_t len = 0;
+        if (*p) {
+            while (p[len] && p[len] != ' ' && len < 64) len++;
+            if (p[len] == ' ' && len < 64) len++;
+            while (len > 1 && ((unsigned char)p[len] & 0xC0) == 0x80) len--;
+        }
+        memcpy(token, p, len);
+        token[len] = '\0';
+        p += len;
+        json_escape(escaped, token);
+        bool done = len == 0;
+        int line_len = sprintf(line, "{\"model\":\"%s\",\"response\":\"%s\",\"done\":%s}\n",
+                               escaped_model, escaped, done ? "true" : "false");
+        int half = line_len / 2;
+        ok = send_chunk(fd, line, (size_t)half) && send_chunk(fd, line + half, (size_t)(line_len - half));
+        if (done) break;
+        sleep_ms(token_ms);
+    }
+    free(escaped_model);
+    free(line);
+    return ok && send_all(fd, "0\r\n\r\n", 5);
+}
+
+static bool reply(int fd, int status, const char *body, bool close_after) {
+    char head[256];
+    int n = snprintf(head, sizeof(head),
+                     "HTTP/1.1 %d %s\r\n"
+                     "Content-Type: application/json\r\n"
+                     "Content-Length: %zu\r\n"
+                     "%s"
+                     "\r\n",
+                     status, status == 200 ? "OK" : "Bad Request", strlen(body),
+                     close_after ? "Connection: close\r\n" : "");
+    return send_all(fd, head, (size_t)n) && send_all(fd, body, strlen(body));
+}
+
+static bool whole_reply(int fd, const char *model, const char *text, bool close_after) {
+    char *escaped_text = malloc(strlen(text) * 6 + 1);
+    char *escaped_model = malloc(strlen(model) * 6 + 1);
+    size_t len = strlen(text) * 6 + strlen(model) * 6 + 64;
+    char *body = malloc(len);
+    bool ok = escaped_text && escaped_model && body;
+    if (ok) {
+        json_escape(escaped_text, text);
+        json_escape(escaped_model, model);
+        snprintf(body, len, "{\"model\":\"%s\",\"response\":\"%s\",\"done\":true}",
+                 escaped_model, escaped_text);
+        ok = reply(fd, 200, body, close_after);
+    }
+    free(body);
+    free(escaped_model);
+    free(escaped_text);
+    return ok;
+}
+
+/* One keep-alive connection: read a request, answer it, repeat until closed */
+static void* serve(void *arg) {
+    int fd = (int)(intptr_t)arg;
+    char *buf = malloc(MAX_REQUEST + 1);
+    size_t have = 0;
+    int served = 0;
+    while (buf) {
+        char *end;
+        buf[have] = '\0';
+        while (!(end = strstr(buf, "\r\n\r\n"))) {
+            if (have == MAX_REQUEST) goto done;
+            ssize_t n = recv(fd, buf + have, MAX_REQUEST - have, 0);
+            if (n <= 0) goto done;
+            have += (size_t)n;
+            buf[have] = '\0';
+        }
+        size_t header_len = (size_t)(end - buf) + 4;
+        size_t body_len = 0;
+        for (char *line = strstr(buf, "\r\n"); line && line < end; line = strstr(line + 2, "\r\n")) {
+            if (strncasecmp(line + 2, "Content-Length:", 15) == 0) body_len = strtoul(line + 17, NULL, 10);
+        }
+        if (header_len + body_len > MAX_REQUEST) goto done;
+        while (have < header_len + body_len) {
+            ssize_t n = recv(fd, buf + have, MAX_REQUEST - have, 0);
+            if (n <= 0) goto done;
+            have += (size_t)n;
+        }
+
+        char *prompt = teacher_json_string(buf + header_len, body_len, "prompt", NULL);
+        char *model = teacher_json_string(buf + header_len, body_len, "model", NULL);
+        bool stream = strstr(buf + header_len, "\"stream\":true") != NULL;
+        sleep_ms(delay_ms);
+        served++;
+        bool close_after = close_every > 0 && served % close_every == 0;
+        bool ok;
+        if (!prompt) {
+            ok = reply(fd, 400, "{\"error\":\"missing prompt\"}", close_after);
+        } else {
+            char *text = response_for(prompt);
+            const char *name = model ? model : "stub";
+            ok = stream ? stream_reply(fd, name, text, close_after) : whole_reply(fd, name, text, close_after);
+            free(text);
+        }
+        free(prompt);
+        free(model);
+        if (!ok || close_after) break;
+
+        /* Keep any pipelined bytes of the next request */
+        size_t used = header_len + body_len;
+        memmove(buf, buf + used, have - used);
+        have -= used;
+    }
+done:
+    free(buf);
+    close(fd);
+    return NULL;
+}
+
+static void usage(const char *argv0) {
+    fprintf(stderr, "usage: %s [--port N] [--delay-ms N] [--responses FILE] [--close-every N]\n"
+                    "          [--token-ms N]\n", argv0);
+}
+
+int main(int argc, char **argv) {
+    int port = TEACHER_DEFAULT_PORT;
+    for (int i = 1; i < argc; i++) {
+        const char *value = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (strcmp(argv[i], "--port") == 0 && value) port = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--delay-ms") == 0 && value) delay_ms = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--close-every") == 0 && value) close_every = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--token-ms") == 0 && value) token_ms = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--responses") == 0 && value) {
+            if (!load_responses(argv[++i])) {
+                fprintf(stderr, "cannot read %s\n", argv[i]);
+                return 2;
+            }
+        } else {
+            usage(argv[0]);
+            return 2;
+        }
+    }
+
+    signal(SIGPIPE, SIG_IGN);
+    int server = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(server, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons((uint16_t)port);
+    if (bind(server, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(server, 64) < 0) {
+        perror("bind");
+        return 1;
+    }
+    printf("Teacher stub on 127.0.0.1:%d (%u canned, %d ms delay)\n", port, canned_count, delay_ms);
+    fflush(stdout);
+
+    for (;;) {
+        int fd = accept(server, NULL, NULL);
+        if (fd < 0) continue;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        pthread_t thread;
+        if (pthread_create(&thread, NULL, serve, (void*)(intptr_t)fd) != 0) {
+            close(fd);
+            continue;
+        }
+        pthread_detach(thread);
+    }
+}
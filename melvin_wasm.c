@@ -9,16 +9,7 @@
 #include <string.h>
 #include <stdint.h>
 
-/* Include melvin - we'll compile melvin.c with this */
-typedef struct MelvinGraph MelvinGraph;
-extern MelvinGraph* melvin_create(void);
-extern void melvin_destroy(MelvinGraph *g);
-extern void run_episode(MelvinGraph *g, const uint8_t *input, uint32_t input_len,
-                       const uint8_t *target, uint32_t target_len);
-extern void melvin_get_output(MelvinGraph *g, uint32_t **output, uint32_t *length);
-extern float melvin_get_error_rate(MelvinGraph *g);
-extern int melvin_save_brain(MelvinGraph *g, const char *filename);
-extern MelvinGraph* melvin_load_brain(const char *filename);
+#include "melvin.h"
 
 /* Global instance */
 static MelvinGraph *g_melvin = NULL;
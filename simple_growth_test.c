@@ -1,5 +1,16 @@
-/* Simple growth test - just use the existing main in melvin.c with more data */
-#include "melvin.c"
+/* Simple growth test - feed short sequences for 5 minutes, watch the brain grow */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "melvin.h"
+
+/* Edges stored, tombstoned ones included */
+static uint32_t count_edges(MelvinGraph *g) {
+    MelvinStats stats;
+    melvin_get_stats(g, &stats);
+    return stats.edges_active + stats.edges_tombstoned;
+}
 
 int main(void) {
     printf("=== 5-Minute Continuous Learning Test ===\n");
@@ -39,19 +50,15 @@ int main(void) {
         /* Report every 30 seconds */
         time_t now = time(NULL);
         if (difftime(now, last_report) >= 30.0) {
+            MelvinStateInfo state;
+            melvin_get_state(g, &state);
             printf("\n[%.0f seconds] Episodes: %d, Patterns: %u\n",
-                   difftime(now, start_time), episode_count, g->pattern_count);
+                   difftime(now, start_time), episode_count, melvin_get_pattern_count(g));
             printf("  Error Rate: %.3f, Learning Rate: %.3f\n",
-                   g->state.error_rate, g->state.learning_rate);
+                   state.error_rate, state.learning_rate);
             printf("  Pattern Confidence: %.3f, Metabolic Pressure: %.3f\n",
-                   g->state.pattern_confidence, g->state.metabolic_pressure);
-            
-            /* Count edges */
-            uint32_t total_edges = 0;
-            for (int i = 0; i < 256; i++) {
-                total_edges += g->outgoing[i].count;
-            }
-            printf("  Total Edges: %u\n", total_edges);
+                   state.pattern_confidence, state.metabolic_pressure);
+            printf("  Total Edges: %u\n", count_edges(g));
             
             last_report = now;
         }
@@ -60,28 +67,24 @@ int main(void) {
     printf("\n\n=== FINAL RESULTS ===\n");
     printf("Runtime: 5 minutes\n");
     printf("Episodes: %d (%.1f/sec)\n", episode_count, episode_count / 300.0);
-    printf("Patterns: %u\n", g->pattern_count);
-    
-    /* Count edges */
-    uint32_t total_edges = 0;
-    for (int i = 0; i < 256; i++) {
-        total_edges += g->outgoing[i].count;
-    }
-    printf("Edges: %u\n", total_edges);
+    printf("Patterns: %u\n", melvin_get_pattern_count(g));
+    printf("Edges: %u\n", count_edges(g));
     
     /* Show some patterns */
     printf("\n=== SAMPLE PATTERNS (first 10 strong ones) ===\n");
     int shown = 0;
-    for (uint32_t p = 0; p < g->pattern_count && shown < 10; p++) {
-        Pattern *pat = &g->patterns[p];
-        if (pat->strength > 0.3f) {
+    MelvinIter it;
+    MelvinPatternInfo pat;
+    melvin_iter_patterns(g, &it);
+    while (shown < 10 && melvin_next_pattern(&it, &pat)) {
+        if (pat.strength > 0.3f) {
             printf("Pattern %u (strength=%.2f, depth=%u): \"",
-                   p, pat->strength, pat->chain_depth);
-            for (uint32_t i = 0; i < pat->length && i < 20; i++) {
-                if (pat->node_ids[i] == 256) {
+                   pat.id, pat.strength, pat.chain_depth);
+            for (uint32_t i = 0; i < pat.length && i < 20; i++) {
+                if (pat.nodes[i] == MELVIN_BLANK_NODE) {
                     printf("_");
-                } else if (pat->node_ids[i] < 128) {
-                    printf("%c", (char)pat->node_ids[i]);
+                } else if (pat.nodes[i] < 128) {
+                    printf("%c", (char)pat.nodes[i]);
                 }
             }
             printf("\"\n");
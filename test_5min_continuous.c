@@ -13,12 +13,7 @@
 #include <time.h>
 #include <math.h>
 
-/* Include melvin.c but skip the main() function */
-/* We need to undefine MELVIN_STANDALONE if it's set, then include */
-#ifdef MELVIN_STANDALONE
-#undef MELVIN_STANDALONE
-#endif
-#include "melvin.c"
+#include "melvin.h"
 
 /* Generate diverse test data */
 const char* word_list[] = {
@@ -72,28 +67,22 @@ const char* get_random_data(int type) {
     }
 }
 
-/* Calculate total edge count */
+/* Calculate total edge count (tombstoned edges included) */
 uint64_t count_total_edges(MelvinGraph *g) {
-    uint64_t total = 0;
-    for (int i = 0; i < BYTE_VALUES; i++) {
-        if (g->nodes[i].exists) {
-            total += g->outgoing[i].count;
-        }
-    }
-    return total;
+    MelvinStats stats;
+    melvin_get_stats(g, &stats);
+    return (uint64_t)stats.edges_active + stats.edges_tombstoned;
 }
 
 /* Calculate active edge count */
 uint64_t count_active_edges(MelvinGraph *g) {
     uint64_t total = 0;
-    for (int i = 0; i < BYTE_VALUES; i++) {
-        if (g->nodes[i].exists) {
-            EdgeList *out = &g->outgoing[i];
-            for (uint32_t j = 0; j < out->count; j++) {
-                if (out->edges[j].active) {
-                    total++;
-                }
-            }
+    MelvinIter it;
+    MelvinEdgeInfo edge;
+    melvin_iter_edges(g, MELVIN_ALL, &it);
+    while (melvin_next_edge(&it, &edge)) {
+        if (edge.active) {
+            total++;
         }
     }
     return total;
@@ -102,10 +91,12 @@ uint64_t count_active_edges(MelvinGraph *g) {
 /* Calculate max hierarchy depth */
 uint32_t get_max_hierarchy_depth(MelvinGraph *g) {
     uint32_t max_depth = 0;
-    for (uint32_t p = 0; p < g->pattern_count; p++) {
-        Pattern *pat = &g->patterns[p];
-        if (pat->chain_depth > max_depth) {
-            max_depth = pat->chain_depth;
+    MelvinIter it;
+    MelvinPatternInfo pat;
+    melvin_iter_patterns(g, &it);
+    while (melvin_next_pattern(&it, &pat)) {
+        if (pat.chain_depth > max_depth) {
+            max_depth = pat.chain_depth;
         }
     }
     return max_depth;
@@ -113,24 +104,27 @@ uint32_t get_max_hierarchy_depth(MelvinGraph *g) {
 
 /* Calculate average hierarchy depth */
 float get_avg_hierarchy_depth(MelvinGraph *g) {
-    if (g->pattern_count == 0) return 0.0f;
+    uint32_t pattern_count = melvin_get_pattern_count(g);
+    if (pattern_count == 0) return 0.0f;
     uint32_t total_depth = 0;
-    for (uint32_t p = 0; p < g->pattern_count; p++) {
-        total_depth += g->patterns[p].chain_depth;
+    MelvinIter it;
+    MelvinPatternInfo pat;
+    melvin_iter_patterns(g, &it);
+    while (melvin_next_pattern(&it, &pat)) {
+        total_depth += pat.chain_depth;
     }
-    return (float)total_depth / (float)g->pattern_count;
+    return (float)total_depth / (float)pattern_count;
 }
 
 /* Count patterns with blank nodes */
 uint32_t count_generalized_patterns(MelvinGraph *g) {
     uint32_t count = 0;
-    for (uint32_t p = 0; p < g->pattern_count; p++) {
-        Pattern *pat = &g->patterns[p];
-        for (uint32_t i = 0; i < pat->length; i++) {
-            if (pat->node_ids[i] == BLANK_NODE) {
-                count++;
-                break;
-            }
+    MelvinIter it;
+    MelvinPatternInfo pat;
+    melvin_iter_patterns(g, &it);
+    while (melvin_next_pattern(&it, &pat)) {
+        if (pat.generalized) {
+            count++;
         }
     }
     return count;
@@ -138,12 +132,9 @@ uint32_t count_generalized_patterns(MelvinGraph *g) {
 
 /* Count pattern-to-pattern edges */
 uint64_t count_pattern_edges(MelvinGraph *g) {
-    uint64_t total = 0;
-    for (uint32_t p = 0; p < g->pattern_count; p++) {
-        Pattern *pat = &g->patterns[p];
-        total += pat->outgoing_patterns.count;
-    }
-    return total;
+    MelvinStats stats;
+    melvin_get_stats(g, &stats);
+    return stats.pattern_edges;
 }
 
 /* Print statistics */
@@ -155,25 +146,28 @@ void print_stats(MelvinGraph *g, int episode, time_t start_time, time_t current_
     float avg_depth = get_avg_hierarchy_depth(g);
     uint32_t generalized = count_generalized_patterns(g);
     uint64_t pattern_edges = count_pattern_edges(g);
+    uint32_t pattern_count = melvin_get_pattern_count(g);
+    MelvinStateInfo state;
+    melvin_get_state(g, &state);
     
     printf("\n");
     printf("═══════════════════════════════════════════════════════════════\n");
     printf("STATISTICS AT %.1f SECONDS (Episode %d)\n", elapsed, episode);
     printf("═══════════════════════════════════════════════════════════════\n");
-    printf("Patterns:           %u\n", g->pattern_count);
+    printf("Patterns:           %u\n", pattern_count);
     printf("  - Generalized:    %u (%.1f%%)\n", generalized, 
-           g->pattern_count > 0 ? (100.0f * generalized / g->pattern_count) : 0.0f);
+           pattern_count > 0 ? (100.0f * generalized / pattern_count) : 0.0f);
     printf("  - Max Depth:      %u\n", max_depth);
     printf("  - Avg Depth:      %.2f\n", avg_depth);
     printf("  - Pattern Edges:   %llu\n", (unsigned long long)pattern_edges);
     printf("Edges:              %llu total, %llu active\n", 
            (unsigned long long)total_edges, (unsigned long long)active_edges);
     printf("System State:\n");
-    printf("  - Error Rate:     %.3f\n", g->state.error_rate);
-    printf("  - Learning Rate:  %.3f\n", g->state.learning_rate);
-    printf("  - Metabolic:      %.3f\n", g->state.metabolic_pressure);
-    printf("  - Pattern Conf:   %.3f\n", g->state.pattern_confidence);
-    printf("  - Loop Pressure:  %.3f\n", g->state.loop_pressure);
+    printf("  - Error Rate:     %.3f\n", state.error_rate);
+    printf("  - Learning Rate:  %.3f\n", state.learning_rate);
+    printf("  - Metabolic:      %.3f\n", state.metabolic_pressure);
+    printf("  - Pattern Conf:   %.3f\n", state.pattern_confidence);
+    printf("  - Loop Pressure:  %.3f\n", state.loop_pressure);
     printf("═══════════════════════════════════════════════════════════════\n");
 }
 
@@ -183,22 +177,24 @@ void print_sample_patterns(MelvinGraph *g, int count) {
     printf("───────────────────────────────────────────────────────────────\n");
     
     int shown = 0;
-    for (uint32_t p = 0; p < g->pattern_count && shown < count; p++) {
-        Pattern *pat = &g->patterns[p];
-        if (pat->strength < 0.1f) continue;  // Skip very weak patterns
+    MelvinIter it;
+    MelvinPatternInfo pat;
+    melvin_iter_patterns(g, &it);
+    while (shown < count && melvin_next_pattern(&it, &pat)) {
+        if (pat.strength < 0.1f) continue;  // Skip very weak patterns
         
-        printf("Pattern %u: ", p);
-        for (uint32_t i = 0; i < pat->length; i++) {
-            if (pat->node_ids[i] == BLANK_NODE) {
+        printf("Pattern %u: ", pat.id);
+        for (uint32_t i = 0; i < pat.length; i++) {
+            if (pat.nodes[i] == MELVIN_BLANK_NODE) {
                 printf("_");
-            } else if (pat->node_ids[i] < 256) {
-                printf("%c", (char)pat->node_ids[i]);
+            } else if (pat.nodes[i] < 256) {
+                printf("%c", (char)pat.nodes[i]);
             } else {
-                printf("[%u]", pat->node_ids[i]);
+                printf("[%u]", pat.nodes[i]);
             }
         }
         printf(" | Strength: %.3f | Depth: %u | Predictions: %u\n",
-               pat->strength, pat->chain_depth, pat->prediction_count);
+               pat.strength, pat.chain_depth, pat.prediction_count);
         shown++;
     }
     if (shown == 0) {
@@ -217,10 +213,6 @@ int main(void) {
         return 1;
     }
     
-    /* Set text port */
-    melvin_set_input_port(g, 0);
-    melvin_set_output_port(g, 0);
-    
     printf("Starting 5-minute continuous data feed...\n");
     printf("Feeding random words, phrases, and questions\n");
     printf("Monitoring: patterns, edges, hierarchy, growth\n\n");
@@ -256,7 +248,7 @@ int main(void) {
             
             /* Store history */
             if (history_index < 20) {
-                pattern_count_history[history_index] = g->pattern_count;
+                pattern_count_history[history_index] = melvin_get_pattern_count(g);
                 edge_count_history[history_index] = count_total_edges(g);
                 history_index++;
             }
@@ -274,7 +266,7 @@ int main(void) {
             double elapsed = difftime(current_time, start_time);
             double remaining = 300.0 - elapsed;
             printf("Progress: %d episodes | %.1f seconds elapsed | %.1f seconds remaining | Patterns: %u\n",
-                   episode, elapsed, remaining, g->pattern_count);
+                   episode, elapsed, remaining, melvin_get_pattern_count(g));
         }
     }
     
@@ -307,7 +299,7 @@ int main(void) {
     printf("Total Episodes:     %d\n", episode);
     printf("Total Time:         %.1f seconds\n", total_elapsed);
     printf("Episodes/Second:    %.2f\n", episode / total_elapsed);
-    printf("Final Patterns:     %u\n", g->pattern_count);
+    printf("Final Patterns:     %u\n", melvin_get_pattern_count(g));
     printf("Final Edges:        %llu\n", (unsigned long long)count_total_edges(g));
     printf("Max Hierarchy:      %u\n", get_max_hierarchy_depth(g));
     printf("═══════════════════════════════════════════════════════════════\n");
@@ -0,0 +1,160 @@
+/* Test: batched read-only inference
+ *
+ * 1. A request's output doesn't depend on what it was batched with
+ * 2. Inference never modifies the brain
+ * 3. Throughput and p50/p99 latency for several batch sizes
+ */
+
+#define _POSIX_C_SOURCE 199309L
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "melvin.h"
+
+#define MAX_LINES 48
+#define MAX_LINE_LENGTH 40
+#define LOAD_REQUESTS 256
+
+static char lines[MAX_LINES][MAX_LINE_LENGTH + 1];
+static int line_count = 0;
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static void load_lines(void) {
+    FILE *f = fopen("test_input.txt", "r");
+    if (!f) return;
+    char buf[4096];
+    while (line_count < MAX_LINES && fgets(buf, sizeof(buf), f)) {
+        size_t len = strcspn(buf, "\r\n");
+        if (len < 2) continue;
+        if (len > MAX_LINE_LENGTH) len = MAX_LINE_LENGTH;
+        memcpy(lines[line_count], buf, len);
+        lines[line_count][len] = '\0';
+        line_count++;
+    }
+    fclose(f);
+}
+
+static void free_outputs(MelvinInferRequest *reqs, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        free(reqs[i].output);
+        reqs[i].output = NULL;
+    }
+}
+
+int main(void) {
+    printf("=================================================================\n");
+    printf("BATCHED INFERENCE: lock-step requests against a read-only brain\n");
+    printf("=================================================================\n\n");
+
+    load_lines();
+    if (line_count < 2) {
+        const char *fallback[] = {"cat", "cats", "dog", "dogs", "hello", "world", "the cat", "sat"};
+        for (int i = 0; i < 8; i++) strcpy(lines[line_count++], fallback[i]);
+    }
+
+    /* Train: each line predicts the next */
+    MelvinGraph *g = melvin_create();
+    for (int round = 0; round < 2; round++) {
+        for (int i = 0; i + 1 < line_count; i++) {
+            run_episode(g, (const uint8_t*)lines[i], strlen(lines[i]),
+                        (const uint8_t*)lines[i + 1], strlen(lines[i + 1]));
+        }
+    }
+    uint32_t patterns_before = melvin_get_pattern_count(g);
+    printf("Trained on %d lines, %u patterns\n\n", line_count, patterns_before);
+
+    int failures = 0;
+
+    /* 1. Solo vs batched */
+    MelvinInferRequest *solo = calloc(line_count, sizeof(MelvinInferRequest));
+    MelvinInferRequest *batch = calloc(line_count, sizeof(MelvinInferRequest));
+    for (int i = 0; i < line_count; i++) {
+        solo[i].input = batch[i].input = (const uint8_t*)lines[i];
+        solo[i].input_len = batch[i].input_len = strlen(lines[i]);
+        melvin_infer_batch(g, &solo[i], 1);
+    }
+    melvin_infer_batch(g, batch, line_count);
+
+    int mismatches = 0;
+    for (int i = 0; i < line_count; i++) {
+        if (solo[i].output_len != batch[i].output_len ||
+            memcmp(solo[i].output, batch[i].output, solo[i].output_len * sizeof(uint32_t)) != 0) {
+            mismatches++;
+        }
+    }
+    if (mismatches) {
+        printf("FAIL: %d of %d batched outputs differ from solo runs\n", mismatches, line_count);
+        failures++;
+    } else {
+        printf("PASS: batch of %d matches solo runs\n", line_count);
+    }
+
+    /* 2. Brain untouched: same batch again gives the same answers */
+    free_outputs(batch, line_count);
+    melvin_infer_batch(g, batch, line_count);
+    mismatches = 0;
+    for (int i = 0; i < line_count; i++) {
+        if (solo[i].output_len != batch[i].output_len ||
+            memcmp(solo[i].output, batch[i].output, solo[i].output_len * sizeof(uint32_t)) != 0) {
+            mismatches++;
+        }
+    }
+    if (mismatches || melvin_get_pattern_count(g) != patterns_before) {
+        printf("FAIL: inference changed the brain\n");
+        failures++;
+    } else {
+        printf("PASS: repeated batch is identical, pattern count unchanged\n");
+    }
+    free_outputs(solo, line_count);
+    free_outputs(batch, line_count);
+    free(solo);
+    free(batch);
+
+    /* 3. Load: LOAD_REQUESTS requests served in batches of each size.
+     * Latency is the service time of the batch a request rode in. */
+    printf("\n%-10s %12s %12s %12s\n", "batch", "req/s", "p50 ms", "p99 ms");
+    uint32_t sizes[] = {1, 4, 8, 16, 32};
+    MelvinInferRequest *reqs = calloc(LOAD_REQUESTS, sizeof(MelvinInferRequest));
+    double *latency = malloc(sizeof(double) * LOAD_REQUESTS);
+    for (uint32_t i = 0; i < LOAD_REQUESTS; i++) {
+        reqs[i].input = (const uint8_t*)lines[i % line_count];
+        reqs[i].input_len = strlen(lines[i % line_count]);
+    }
+
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        uint32_t size = sizes[s];
+        double start = now_seconds();
+        for (uint32_t i = 0; i < LOAD_REQUESTS; i += size) {
+            uint32_t n = (LOAD_REQUESTS - i < size) ? LOAD_REQUESTS - i : size;
+            double t0 = now_seconds();
+            melvin_infer_batch(g, &reqs[i], n);
+            double elapsed = now_seconds() - t0;
+            for (uint32_t k = 0; k < n; k++) latency[i + k] = elapsed;
+        }
+        double total = now_seconds() - start;
+        free_outputs(reqs, LOAD_REQUESTS);
+
+        qsort(latency, LOAD_REQUESTS, sizeof(double), compare_double);
+        printf("%-10u %12.1f %12.3f %12.3f\n", size, LOAD_REQUESTS / total,
+               latency[LOAD_REQUESTS / 2] * 1000.0, latency[(LOAD_REQUESTS * 99) / 100] * 1000.0);
+    }
+    free(latency);
+    free(reqs);
+    melvin_destroy(g);
+
+    printf("\n%s\n", failures == 0 ? "ALL TESTS PASSED" : "TESTS FAILED");
+    return failures == 0 ? 0 : 1;
+}
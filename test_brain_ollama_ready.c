@@ -13,17 +13,7 @@
 #include <stdint.h>
 #include <string.h>
 
-typedef struct MelvinGraph MelvinGraph;
-
-extern MelvinGraph* melvin_create(void);
-extern void melvin_destroy(MelvinGraph *g);
-extern void run_episode(MelvinGraph *g, const uint8_t *input, uint32_t input_len,
-                       const uint8_t *target, uint32_t target_len);
-extern void melvin_get_output(MelvinGraph *g, uint32_t **output, uint32_t *length);
-extern int melvin_save_brain(MelvinGraph *g, const char *filename);
-extern MelvinGraph* melvin_load_brain(const char *filename);
-extern uint32_t melvin_get_pattern_count(MelvinGraph *g);
-extern float melvin_get_error_rate(MelvinGraph *g);
+#include "melvin.h"
 
 int main(void) {
     printf("=================================================================\n");
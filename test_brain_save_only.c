@@ -5,14 +5,7 @@
 #include <stdint.h>
 #include <string.h>
 
-typedef struct MelvinGraph MelvinGraph;
-
-extern MelvinGraph* melvin_create(void);
-extern void melvin_destroy(MelvinGraph *g);
-extern void run_episode(MelvinGraph *g, const uint8_t *input, uint32_t input_len,
-                       const uint8_t *target, uint32_t target_len);
-extern int melvin_save_brain(MelvinGraph *g, const char *filename);
-extern uint32_t melvin_get_pattern_count(MelvinGraph *g);
+#include "melvin.h"
 
 int main(void) {
     printf("Testing brain save to .m file...\n");
@@ -0,0 +1,118 @@
+/* Test: step, output and time budgets cut generation short, keep the
+ * partial output, and report why the episode stopped */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "melvin.h"
+
+static const char *prompt = "the cat";
+
+/* Run the prompt on a fresh clone under a budget (NULL: none) */
+static uint32_t run_budgeted(const MelvinGraph *base, const MelvinBudget *budget,
+                             uint32_t *out, uint32_t max, MelvinStop *stop) {
+    MelvinGraph *g = melvin_clone(base);
+    melvin_set_budget(g, budget);
+    run_episode(g, (const uint8_t*)prompt, strlen(prompt), NULL, 0);
+    *stop = melvin_get_stop_reason(g);
+
+    uint32_t *output;
+    uint32_t output_len;
+    melvin_get_output(g, &output, &output_len);
+    if (output_len > max) output_len = max;
+    memcpy(out, output, output_len * sizeof(uint32_t));
+    melvin_destroy(g);
+    return output_len;
+}
+
+int main(void) {
+    printf("=================================================================\n");
+    printf("BUDGET: limits return partial output and say why they stopped\n");
+    printf("=================================================================\n\n");
+
+    MelvinGraph *base = melvin_create();
+    for (int i = 0; i < 20; i++) {
+        run_episode(base, (const uint8_t*)"the cat", 7, (const uint8_t*)"sat on the mat", 14);
+        run_episode(base, (const uint8_t*)"the dog", 7, (const uint8_t*)"ran in the park", 15);
+    }
+
+    int failures = 0;
+    uint32_t full[1024], part[1024];
+    MelvinStop stop;
+    uint32_t full_len = run_budgeted(base, NULL, full, 1024, &stop);
+    printf("Unlimited: %u nodes, stopped: %s\n\n", full_len, melvin_stop_name(stop));
+    if (full_len < 3) {
+        printf("FAIL: need at least 3 output nodes to cut, got %u\n", full_len);
+        return 1;
+    }
+
+    /* 1. Output cap: a prefix of the unlimited output */
+    MelvinBudget budget = {0, 2, 0};
+    uint32_t len = run_budgeted(base, &budget, part, 1024, &stop);
+    if (len != 2 || memcmp(part, full, 2 * sizeof(uint32_t)) != 0 || stop != MELVIN_STOP_OUTPUT) {
+        printf("FAIL: max_output 2 gave %u nodes, stop %s\n", len, melvin_stop_name(stop));
+        failures++;
+    } else {
+        printf("PASS: max_output 2 keeps the first 2 nodes, stop=output\n");
+    }
+
+    /* 2. Step cap */
+    budget = (MelvinBudget){2, 0, 0};
+    len = run_budgeted(base, &budget, part, 1024, &stop);
+    if (len > 2 || memcmp(part, full, len * sizeof(uint32_t)) != 0 || stop != MELVIN_STOP_STEPS) {
+        printf("FAIL: max_steps 2 gave %u nodes, stop %s\n", len, melvin_stop_name(stop));
+        failures++;
+    } else {
+        printf("PASS: max_steps 2 gives %u nodes, stop=steps\n", len);
+    }
+
+    /* 3. Deadline already passed after the first step */
+    budget = (MelvinBudget){0, 0, 1};
+    len = run_budgeted(base, &budget, part, 1024, &stop);
+    if (len > 1 || stop != MELVIN_STOP_DEADLINE) {
+        printf("FAIL: 1ns deadline gave %u nodes, stop %s\n", len, melvin_stop_name(stop));
+        failures++;
+    } else {
+        printf("PASS: 1ns deadline stops after one step, stop=deadline\n");
+    }
+
+    /* 4. Generous budget changes nothing */
+    budget = (MelvinBudget){0, 0, 60000000000ull};
+    len = run_budgeted(base, &budget, part, 1024, &stop);
+    if (len != full_len || memcmp(part, full, len * sizeof(uint32_t)) != 0 || stop == MELVIN_STOP_DEADLINE) {
+        printf("FAIL: 60s deadline changed the output\n");
+        failures++;
+    } else {
+        printf("PASS: 60s deadline matches the unlimited output\n");
+    }
+
+    /* 5. Batched inference: each request has its own budget */
+    MelvinInferRequest reqs[3];
+    memset(reqs, 0, sizeof(reqs));
+    for (int i = 0; i < 3; i++) {
+        reqs[i].input = (const uint8_t*)prompt;
+        reqs[i].input_len = strlen(prompt);
+    }
+    reqs[1].budget.max_output = 2;
+    reqs[2].budget.time_limit_ns = 1;
+    melvin_infer_batch(base, reqs, 3);
+    if (reqs[1].output_len != 2 || reqs[1].stop != MELVIN_STOP_OUTPUT ||
+        memcmp(reqs[1].output, reqs[0].output, 2 * sizeof(uint32_t)) != 0 ||
+        reqs[2].output_len > 1 || reqs[2].stop != MELVIN_STOP_DEADLINE ||
+        reqs[0].output_len <= 2) {
+        printf("FAIL: batch stops %s/%s/%s, lengths %u/%u/%u\n",
+               melvin_stop_name(reqs[0].stop), melvin_stop_name(reqs[1].stop), melvin_stop_name(reqs[2].stop),
+               reqs[0].output_len, reqs[1].output_len, reqs[2].output_len);
+        failures++;
+    } else {
+        printf("PASS: batch members stop on their own budgets (%s, output, deadline)\n",
+               melvin_stop_name(reqs[0].stop));
+    }
+    for (int i = 0; i < 3; i++) free(reqs[i].output);
+
+    melvin_destroy(base);
+    printf("\n%s\n", failures == 0 ? "ALL TESTS PASSED" : "TESTS FAILED");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,177 @@
+/* Test: streamed /api/chat replies carry the same text as whole ones
+ *
+ * Start the server, then:
+ *   ./melvin_server &
+ *   ./test_chat_stream [host] [http_port]
+ *
+ * Two fresh sessions are trained on the same examples (UTF-8, quotes,
+ * backslashes and tabs in the targets) and asked the same questions, one
+ * with "stream": true. Every stream must end with a done event, and its
+ * tokens, joined, must equal the other session's "response" byte for byte.
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define REPLY_MAX (1 << 20)
+#define TRAIN_ROUNDS 4
+
+static int failures = 0;
+static const char *host = "127.0.0.1";
+static int port = 8080;
+
+static void check(int ok, const char *what) {
+    printf("%s: %s\n", ok ? "PASS" : "FAIL", what);
+    if (!ok) failures++;
+}
+
+/* One request on its own HTTP/1.0 connection; the reply is read to EOF
+ * (streams are close-delimited for 1.0 clients). Returns the body. */
+static char reply[REPLY_MAX];
+static const char* http_request(const char *method, const char *path, const char *session,
+                                const char *body, size_t body_len) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    inet_pton(AF_INET, host, &addr.sin_addr);
+    if (fd < 0 || connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        printf("Cannot connect to %s:%d - is melvin_server running?\n", host, port);
+        exit(1);
+    }
+
+    char head[512];
+    int len = snprintf(head, sizeof(head),
+                       "%s %s HTTP/1.0\r\nX-Melvin-Session: %s\r\nContent-Type: application/json\r\n"
+                       "Content-Length: %zu\r\n\r\n", method, path, session, body_len);
+    if (write(fd, head, (size_t)len) != len ||
+        (body_len > 0 && write(fd, body, body_len) != (ssize_t)body_len)) {
+        printf("write failed\n");
+        exit(1);
+    }
+
+    size_t total = 0;
+    ssize_t n;
+    while (total < REPLY_MAX - 1 && (n = read(fd, reply + total, REPLY_MAX - 1 - total)) > 0) {
+        total += (size_t)n;
+    }
+    reply[total] = '\0';
+    close(fd);
+
+    const char *start = strstr(reply, "\r\n\r\n");
+    return start ? start + 4 : "";
+}
+
+/* Copy a JSON string body (still escaped) up to its closing quote */
+static const char* copy_escaped(const char *p, char *out, size_t *out_len, size_t max) {
+    while (*p && *p != '"') {
+        if (*p == '\\' && p[1]) {
+            if (*out_len + 2 < max) { out[(*out_len)++] = p[0]; out[(*out_len)++] = p[1]; }
+            p += 2;
+        } else {
+            if (*out_len + 1 < max) out[(*out_len)++] = *p;
+            p++;
+        }
+    }
+    out[*out_len] = '\0';
+    return p;
+}
+
+/* Upload the examples to a session and wait until they're trained */
+static void train_session(const char *session, const char *ndjson) {
+    const char *body = http_request("POST", "/api/train", session, ndjson, strlen(ndjson));
+    const char *job = strstr(body, "\"job\":");
+    if (!job) {
+        printf("train upload failed: %s\n", body);
+        exit(1);
+    }
+    char path[64];
+    snprintf(path, sizeof(path), "/api/train/%d", atoi(job + 6));
+    for (int i = 0; i < 500; i++) {
+        if (strstr(http_request("GET", path, session, "", 0), "\"state\":\"done\"")) return;
+        struct timespec ts = {0, 10000000L};
+        nanosleep(&ts, NULL);
+    }
+    printf("training did not finish\n");
+    exit(1);
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1) host = argv[1];
+    if (argc > 2) port = atoi(argv[2]);
+
+    printf("=================================================================\n");
+    printf("CHAT STREAMING: streamed tokens match the whole reply\n");
+    printf("=================================================================\n\n");
+
+    /* UTF-8 (é is C3 A9), quotes, backslashes and tabs in the targets */
+    static const char *examples[][2] = {
+        {"cafe", "caf\xc3\xa9"},
+        {"creme", "cr\xc3\xa8me br\xc3\xbbl\xc3\xa9" "e"},
+        {"say", "\\\"hi\\\" \\\\ there"},
+        {"tab", "a\\tb"},
+        {"cat", "cats"},
+    };
+    static const char *questions[] = {"cafe", "creme", "say", "tab", "cat", "caf", "the creme"};
+    int example_count = (int)(sizeof(examples) / sizeof(examples[0]));
+    int question_count = (int)(sizeof(questions) / sizeof(questions[0]));
+
+    char ndjson[4096];
+    size_t used = 0;
+    for (int round = 0; round < TRAIN_ROUNDS; round++) {
+        for (int i = 0; i < example_count; i++) {
+            used += (size_t)snprintf(ndjson + used, sizeof(ndjson) - used,
+                                     "{\"input\":\"%s\",\"target\":\"%s\"}\n", examples[i][0], examples[i][1]);
+        }
+    }
+
+    char whole_session[64], stream_session[64];
+    snprintf(whole_session, sizeof(whole_session), "stream-test-whole-%d", (int)getpid());
+    snprintf(stream_session, sizeof(stream_session), "stream-test-sse-%d", (int)getpid());
+    train_session(whole_session, ndjson);
+    train_session(stream_session, ndjson);
+
+    int ended = 1, same = 1, nonempty = 0;
+    for (int q = 0; q < question_count; q++) {
+        char body[256];
+        static char whole[REPLY_MAX], streamed[REPLY_MAX];
+        size_t whole_len = 0, streamed_len = 0;
+
+        snprintf(body, sizeof(body), "{\"message\":\"%s\"}", questions[q]);
+        const char *p = strstr(http_request("POST", "/api/chat", whole_session, body, strlen(body)),
+                               "\"response\":\"");
+        if (p) copy_escaped(p + 12, whole, &whole_len, sizeof(whole));
+        else same = 0;
+
+        snprintf(body, sizeof(body), "{\"message\":\"%s\",\"stream\":true}", questions[q]);
+        p = http_request("POST", "/api/chat", stream_session, body, strlen(body));
+        while ((p = strstr(p, "data: {\"token\":\"")) != NULL) {
+            p = copy_escaped(p + 16, streamed, &streamed_len, sizeof(streamed));
+        }
+        ended = ended && strstr(reply, "event: done") != NULL;
+
+        printf("  %-10s -> \"%s\"\n", questions[q], whole);
+        if (whole_len != streamed_len || memcmp(whole, streamed, whole_len) != 0) {
+            printf("  streamed   -> \"%s\"\n", streamed);
+            same = 0;
+        }
+        nonempty += whole_len > 0;
+    }
+
+    check(ended, "every stream ends with a done event");
+    check(nonempty > 0, "the sessions answer");
+    check(same, "joined tokens equal the whole reply for every question");
+
+    printf("\n%s\n", failures == 0 ? "ALL TESTS PASSED" : "TESTS FAILED");
+    return failures == 0 ? 0 : 1;
+}
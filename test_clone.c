@@ -0,0 +1,73 @@
+/* Test: melvin_clone produces an independent copy that behaves identically */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "melvin.h"
+
+/* Copy the current output so the next episode can't overwrite it */
+static uint32_t copy_output(MelvinGraph *g, uint32_t *dst, uint32_t max) {
+    uint32_t *output;
+    uint32_t output_len;
+    melvin_get_output(g, &output, &output_len);
+    if (output_len > max) output_len = max;
+    memcpy(dst, output, output_len * sizeof(uint32_t));
+    return output_len;
+}
+
+int main(void) {
+    printf("=================================================================\n");
+    printf("CLONE: copies must match the original and learn independently\n");
+    printf("=================================================================\n\n");
+
+    MelvinGraph *base = melvin_create();
+    for (int i = 0; i < 20; i++) {
+        run_episode(base, (const uint8_t*)"cat", 3, (const uint8_t*)"cats", 4);
+        run_episode(base, (const uint8_t*)"dog", 3, (const uint8_t*)"dogs", 4);
+    }
+
+    MelvinGraph *copy = melvin_clone(base);
+    if (!copy) {
+        printf("FAIL: melvin_clone returned NULL\n");
+        return 1;
+    }
+
+    /* Same brain, same input -> same output */
+    uint32_t out_base[256], out_copy[256];
+    run_episode(base, (const uint8_t*)"cat", 3, NULL, 0);
+    uint32_t len_base = copy_output(base, out_base, 256);
+    run_episode(copy, (const uint8_t*)"cat", 3, NULL, 0);
+    uint32_t len_copy = copy_output(copy, out_copy, 256);
+
+    int failures = 0;
+    if (len_base != len_copy || memcmp(out_base, out_copy, len_base * sizeof(uint32_t)) != 0) {
+        printf("FAIL: clone output differs from original\n");
+        failures++;
+    } else {
+        printf("PASS: clone output matches original (%u bytes)\n", len_base);
+    }
+
+    /* Train only the copy, then free the original - the copy must survive */
+    for (int i = 0; i < 20; i++) {
+        run_episode(copy, (const uint8_t*)"bird", 4, (const uint8_t*)"birds", 5);
+    }
+    float base_error = melvin_get_error_rate(base);
+    melvin_destroy(base);
+
+    run_episode(copy, (const uint8_t*)"bird", 4, NULL, 0);
+    len_copy = copy_output(copy, out_copy, 256);
+    printf("PASS: clone still runs after original is destroyed (%u bytes, base error %.3f, clone error %.3f)\n",
+           len_copy, base_error, melvin_get_error_rate(copy));
+
+    /* Clone of a clone */
+    MelvinGraph *second = melvin_clone(copy);
+    melvin_destroy(copy);
+    run_episode(second, (const uint8_t*)"dog", 3, NULL, 0);
+    melvin_destroy(second);
+    printf("PASS: clone of a clone runs and frees cleanly\n");
+
+    printf("\n%s\n", failures == 0 ? "ALL TESTS PASSED" : "TESTS FAILED");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,178 @@
+/* Test: interned context classes gate patterns exactly like the cosine did
+ *
+ * 1. Interning: each distinct context vector gets one class, repeats reuse it,
+ *    and patterns carry the class of the context they were learned in
+ * 2. Equivalence: a brain whose class table is already full (so every
+ *    context falls back to the per-pattern cosine) learns and answers exactly
+ *    like one gated by the precomputed bits
+ * 3. Clone and save/load keep each pattern's class consistent with its vector
+ * 4. Both brains stay identical over a longer run in one modality
+ *
+ * Interning is not a speedup by itself: the bits replace one cosine per
+ * pattern, which was never the cost. Partitioning the store by class
+ * (bench/melvin_bench --modalities) is where the time is saved.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "melvin.h"
+
+#define CLASS_TABLE_SIZE 64
+#define TRAIN_ROUNDS 12
+#define LONG_EPISODES 200
+
+static int failures = 0;
+
+static void check(bool ok, const char *pass, const char *fail) {
+    printf("%s: %s\n", ok ? "PASS" : "FAIL", ok ? pass : fail);
+    if (!ok) failures++;
+}
+
+/* Text and audio are dissimilar enough to gate each other (cosine ~0.1);
+ * vision is close to text (cosine ~0.7) and admits its patterns */
+static float text_ctx[16] = {1.0f, 0.05f};
+static float audio_ctx[16] = {0.05f, 1.0f};
+static float vision_ctx[16] = {1.0f, 1.0f};
+
+static const char *text_pairs[][2] = {{"cat", "cats"}, {"dog", "dogs"}, {"the", "them"}};
+static const char *audio_pairs[][2] = {{"cat", "tac"}, {"hum", "mmm"}, {"beep", "boop"}};
+
+static void train(MelvinGraph *g) {
+    for (int round = 0; round < TRAIN_ROUNDS; round++) {
+        melvin_set_context(g, text_ctx);
+        for (int i = 0; i < 3; i++) {
+            run_episode(g, (const uint8_t*)text_pairs[i][0], (uint32_t)strlen(text_pairs[i][0]),
+                        (const uint8_t*)text_pairs[i][1], (uint32_t)strlen(text_pairs[i][1]));
+        }
+        melvin_set_context(g, audio_ctx);
+        for (int i = 0; i < 3; i++) {
+            run_episode(g, (const uint8_t*)audio_pairs[i][0], (uint32_t)strlen(audio_pairs[i][0]),
+                        (const uint8_t*)audio_pairs[i][1], (uint32_t)strlen(audio_pairs[i][1]));
+        }
+    }
+}
+
+/* Answers to "cat" in each context, appended to out */
+static uint32_t answers(MelvinGraph *g, uint32_t *out, uint32_t max) {
+    float *contexts[] = {text_ctx, audio_ctx, vision_ctx};
+    uint32_t total = 0;
+    for (int c = 0; c < 3; c++) {
+        melvin_set_context(g, contexts[c]);
+        run_episode(g, (const uint8_t*)"cat", 3, NULL, 0);
+        uint32_t *output, len;
+        melvin_get_output(g, &output, &len);
+        for (uint32_t i = 0; i < len && total < max; i++) out[total++] = output[i];
+        if (total < max) out[total++] = 0xFFFFFFFFu;  /* Separator */
+    }
+    return total;
+}
+
+/* Every pattern's class is shared only with patterns of the same vector */
+static bool classes_consistent(const MelvinGraph *g) {
+    MelvinStats stats;
+    melvin_get_stats(g, &stats);
+    const float *seen[CLASS_TABLE_SIZE] = {0};
+    MelvinIter it;
+    MelvinPatternInfo info;
+    melvin_iter_patterns(g, &it);
+    while (melvin_next_pattern(&it, &info)) {
+        if (info.context_class >= stats.context_classes) return false;
+        if (!seen[info.context_class]) seen[info.context_class] = info.context;
+        else if (memcmp(seen[info.context_class], info.context, 16 * sizeof(float)) != 0) return false;
+    }
+    for (uint32_t a = 0; a < CLASS_TABLE_SIZE; a++) {
+        for (uint32_t b = a + 1; b < CLASS_TABLE_SIZE; b++) {
+            if (seen[a] && seen[b] && memcmp(seen[a], seen[b], 16 * sizeof(float)) == 0) return false;
+        }
+    }
+    return true;
+}
+
+int main(void) {
+    printf("=================================================================\n");
+    printf("CONTEXT CLASSES: interned contexts and precomputed gating\n");
+    printf("=================================================================\n\n");
+
+    /* 1. Interning */
+    MelvinGraph *g = melvin_create();
+    MelvinStats stats;
+    MelvinStateInfo state;
+    melvin_get_stats(g, &stats);
+    uint32_t fresh = stats.context_classes;
+    melvin_set_context(g, text_ctx);
+    melvin_get_state(g, &state);
+    uint32_t text_class = state.context_class;
+    melvin_set_context(g, audio_ctx);
+    melvin_set_context(g, text_ctx);
+    melvin_get_state(g, &state);
+    melvin_get_stats(g, &stats);
+    check(fresh == 1 && text_class == 1 && state.context_class == text_class && stats.context_classes == 3,
+          "one class per distinct vector, repeats reuse it",
+          "context vectors not interned once each");
+
+    train(g);
+    melvin_get_stats(g, &stats);
+    MelvinIter it;
+    MelvinPatternInfo info;
+    uint32_t tagged = 0;
+    melvin_iter_patterns(g, &it);
+    while (melvin_next_pattern(&it, &info)) {
+        tagged += info.context_class == 1 || info.context_class == 2;
+    }
+    printf("%u patterns in %u classes\n", stats.patterns, stats.context_classes);
+    check(stats.patterns > 0 && tagged == stats.patterns && classes_consistent(g),
+          "patterns carry the class of the context they were learned in",
+          "pattern classes missing or inconsistent");
+
+    /* 2. Equivalence with the cosine */
+    MelvinGraph *cosine = melvin_create();
+    for (int c = 1; c < CLASS_TABLE_SIZE; c++) {
+        float filler[16] = {0};
+        filler[15] = (float)c;  /* Distinct vectors, fills the table */
+        melvin_set_context(cosine, filler);
+    }
+    melvin_set_context(cosine, text_ctx);
+    melvin_get_state(cosine, &state);
+    bool unclassed = state.context_class == MELVIN_NO_CONTEXT_CLASS;
+    train(cosine);
+    uint32_t out_bits[512], out_cosine[512];
+    uint32_t len_bits = answers(g, out_bits, 512);
+    uint32_t len_cosine = answers(cosine, out_cosine, 512);
+    check(unclassed && melvin_checksum(g) == melvin_checksum(cosine) && len_bits == len_cosine &&
+          memcmp(out_bits, out_cosine, len_bits * sizeof(uint32_t)) == 0,
+          "precomputed gating learns and answers exactly like the cosine",
+          "class bits disagree with the cosine rule");
+
+    /* 3. Clone and save/load */
+    MelvinGraph *copy = melvin_clone(g);
+    const char *path = "test_context_classes.m";
+    melvin_save_brain(g, path);
+    MelvinGraph *loaded = melvin_load_brain(path);
+    remove(path);
+    check(copy && loaded && classes_consistent(copy) && classes_consistent(loaded) &&
+          melvin_checksum(copy) == melvin_checksum(g),
+          "clones and reloaded brains keep consistent classes",
+          "classes lost or mixed up by clone or save/load");
+    melvin_destroy(copy);
+    melvin_destroy(loaded);
+
+    /* 4. A longer run of audio queries against both brains */
+    MelvinGraph *brains[2] = {g, cosine};
+    for (int b = 0; b < 2; b++) {
+        melvin_set_context(brains[b], audio_ctx);
+        for (int i = 0; i < LONG_EPISODES; i++) run_episode(brains[b], (const uint8_t*)"hum", 3, NULL, 0);
+    }
+    check(melvin_checksum(g) == melvin_checksum(cosine),
+          "brains still identical after a longer run",
+          "longer run diverged");
+
+    melvin_destroy(g);
+    melvin_destroy(cosine);
+
+    printf("\n%s\n", failures == 0 ? "ALL TESTS PASSED" : "TESTS FAILED");
+    return failures == 0 ? 0 : 1;
+}
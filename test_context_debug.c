@@ -4,11 +4,7 @@
 #include <stdlib.h>
 #include <stdint.h>
 
-typedef struct MelvinGraph MelvinGraph;
-extern MelvinGraph* melvin_create(void);
-extern void run_episode(MelvinGraph *g, const uint8_t *input, uint32_t input_len,
-                       const uint8_t *target, uint32_t target_len);
-extern void melvin_get_output(MelvinGraph *g, uint32_t **output, uint32_t *length);
+#include "melvin.h"
 
 int main(void) {
     MelvinGraph *g = melvin_create();
@@ -0,0 +1,180 @@
+/* Test: context partitions and scan lists stay in step with the pattern table
+ *
+ * 1. Every pattern id sits in exactly one partition, the one for its class,
+ *    in ascending order, after training in several contexts
+ * 2. context_scan returns exactly the admitted patterns, ascending, whether
+ *    rebuilt from the partitions or grown as patterns are learned
+ * 3. Both still hold for clones and reloaded brains, in every context
+ * 4. Session views scan the same patterns as the brain and answer like it
+ *
+ * Includes melvin.c for the partition internals.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "melvin.c"
+
+#define TRAIN_ROUNDS 8
+#define CONTEXT_COUNT 5
+
+static int failures = 0;
+
+static void check(bool ok, const char *pass, const char *fail) {
+    printf("%s: %s\n", ok ? "PASS" : "FAIL", ok ? pass : fail);
+    if (!ok) failures++;
+}
+
+/* Text and audio gate each other; the one-hot contexts are orthogonal to
+ * everything (cosine 0) and so admit all patterns; zero is context-free */
+static float text_ctx[16] = {1.0f, 0.05f};
+static float audio_ctx[16] = {0.05f, 1.0f};
+static float onehot_a[16] = {[4] = 1.0f};
+static float onehot_b[16] = {[9] = 1.0f};
+static float zero_ctx[16] = {0};
+static float *contexts[CONTEXT_COUNT] = {text_ctx, audio_ctx, onehot_a, onehot_b, zero_ctx};
+
+static const char *pairs[][2] = {{"cat", "cats"}, {"two", "words"}, {"hum", "mmm"}, {"the", "them"}};
+
+static void train(MelvinGraph *g) {
+    for (int round = 0; round < TRAIN_ROUNDS; round++) {
+        for (int c = 0; c < CONTEXT_COUNT; c++) {
+            melvin_set_context(g, contexts[c]);
+            for (int i = 0; i < 4; i++) {
+                const char *in = pairs[(i + c) % 4][0], *out = pairs[(i + c) % 4][1];
+                run_episode(g, (const uint8_t*)in, (uint32_t)strlen(in),
+                            (const uint8_t*)out, (uint32_t)strlen(out));
+            }
+        }
+    }
+}
+
+/* Each id once, in its class's partition, ascending */
+static bool partitions_consistent(const MelvinGraph *g) {
+    uint8_t *seen = calloc(g->pattern_count + 1, 1);
+    if (!seen) return false;
+    bool ok = true;
+    uint32_t total = 0;
+    for (uint32_t c = 0; c <= CONTEXT_CLASS_MAX && ok; c++) {
+        const PatternIdList *part = &g->context_partitions[c];
+        for (uint32_t i = 0; i < part->count && ok; i++) {
+            uint32_t id = part->ids[i];
+            uint16_t cls = (id < g->pattern_count) ? g->patterns[id].context_class : 0;
+            uint32_t slot = (cls == CONTEXT_UNCLASSED) ? CONTEXT_CLASS_MAX : cls;
+            ok = id < g->pattern_count && !seen[id] && slot == c && (i == 0 || part->ids[i - 1] < id);
+            if (ok) seen[id] = 1;
+            total++;
+        }
+    }
+    free(seen);
+    return ok && total == g->pattern_count;
+}
+
+/* A scan list is the brute-force filter of context_admits, ascending */
+static bool scan_matches(const MelvinGraph *g, const uint32_t *scan, uint32_t count) {
+    uint32_t next = 0;
+    for (uint32_t p = 0; p < g->pattern_count; p++) {
+        if (!context_admits(g, &g->patterns[p])) continue;
+        if (next >= count || scan[next] != p) return false;
+        next++;
+    }
+    return next == count;
+}
+
+/* The list kept since the last context change (if any), then a rebuilt one */
+static bool scan_consistent(MelvinGraph *g) {
+    if (g->context_scan_valid &&
+        !scan_matches(g, g->context_scan_list.ids, g->context_scan_list.count)) return false;
+    g->context_scan_valid = false;
+    uint32_t count;
+    const uint32_t *scan = context_scan(g, &count);
+    return scan_matches(g, scan, count);
+}
+
+/* Partitions, and the scan list under every context */
+static bool brain_consistent(MelvinGraph *g) {
+    if (!partitions_consistent(g)) return false;
+    for (int c = 0; c < CONTEXT_COUNT; c++) {
+        melvin_set_context(g, contexts[c]);
+        if (!scan_consistent(g)) return false;
+    }
+    return true;
+}
+
+int main(void) {
+    printf("=================================================================\n");
+    printf("CONTEXT PARTITIONS: partitions and scan lists\n");
+    printf("=================================================================\n\n");
+
+    /* 1. Partitions after training */
+    MelvinGraph *g = melvin_create();
+    train(g);
+    printf("%u patterns in %u classes\n", g->pattern_count, g->context_class_count);
+    check(g->pattern_count > 0 && partitions_consistent(g),
+          "every pattern in exactly the partition of its class",
+          "partitions lost, duplicated or misfiled patterns");
+
+    /* 2. Scan lists, kept while learning and rebuilt */
+    bool grown = true;
+    for (int c = 0; c < CONTEXT_COUNT && grown; c++) {
+        melvin_set_context(g, contexts[c]);
+        uint32_t count;
+        context_scan(g, &count);  /* Valid from here on; learning appends to it */
+        run_episode(g, (const uint8_t*)"twos", 4, (const uint8_t*)"rds", 3);
+        grown = g->context_scan_valid && scan_consistent(g);
+    }
+    check(grown && brain_consistent(g),
+          "scan lists hold exactly the admitted patterns in every context",
+          "scan list disagrees with context_admits");
+
+    /* 3. Clones and reloaded brains */
+    MelvinGraph *copy = melvin_clone(g);
+    const char *path = "test_context_partitions.m";
+    melvin_save_brain(g, path);
+    MelvinGraph *loaded = melvin_load_brain(path);
+    remove(path);
+    check(copy && loaded && brain_consistent(copy) && brain_consistent(loaded),
+          "clones and reloaded brains keep partitions and scan lists",
+          "clone or save/load broke partitions or scan lists");
+    if (copy && loaded) {
+        train(copy);
+        train(loaded);
+        check(brain_consistent(copy) && brain_consistent(loaded),
+              "and keep them while learning further",
+              "partitions broke after further learning");
+    }
+    melvin_destroy(copy);
+    melvin_destroy(loaded);
+
+    /* 4. Session views answer like the brain, context by context */
+    MelvinSession *s = melvin_session_create();
+    bool same = s != NULL;
+    for (int c = 0; c < CONTEXT_COUNT && same; c++) {
+        melvin_set_context(g, contexts[c]);
+        for (int i = 0; i < 4 && same; i++) {
+            const uint8_t *in = (const uint8_t*)pairs[i][0];
+            uint32_t len = (uint32_t)strlen(pairs[i][0]);
+            same = melvin_session_infer(g, s, in, len) && scan_consistent(&s->view);
+
+            MelvinGraph *ref = melvin_clone(g);
+            run_episode(ref, in, len, NULL, 0);
+            uint32_t *out_s, *out_r, len_s, len_r;
+            melvin_session_get_output(s, &out_s, &len_s);
+            melvin_get_output(ref, &out_r, &len_r);
+            same = same && len_s == len_r && memcmp(out_s, out_r, len_s * sizeof(uint32_t)) == 0;
+            melvin_destroy(ref);
+        }
+    }
+    check(same && brain_consistent(g),
+          "session views scan the same patterns and answer like the brain",
+          "session scan list or answers differ from the brain");
+    melvin_session_destroy(s);
+
+    melvin_destroy(g);
+
+    printf("\n%s\n", failures == 0 ? "ALL TESTS PASSED" : "TESTS FAILED");
+    return failures == 0 ? 0 : 1;
+}
@@ -8,15 +8,7 @@
 #include <stdlib.h>
 #include <stdint.h>
 
-typedef struct MelvinGraph MelvinGraph;
-extern MelvinGraph* melvin_create(void);
-extern void inject_input(MelvinGraph *g, const uint8_t *bytes, uint32_t length);
-extern void propagate_activation(MelvinGraph *g);
-extern uint32_t select_output_node(MelvinGraph *g);
-extern void emit_output(MelvinGraph *g, uint32_t node_id);
-extern void melvin_get_output(MelvinGraph *g, uint32_t **output, uint32_t *length);
-extern float melvin_get_node_activation(MelvinGraph *g, uint32_t node_id);
-extern float melvin_get_pattern_activation(MelvinGraph *g, uint32_t pattern_id);
+#include "melvin.c"
 
 /* Add accessor functions */
 float melvin_get_node_activation(MelvinGraph *g, uint32_t node_id) {
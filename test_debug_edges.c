@@ -4,15 +4,27 @@
 #include <string.h>
 #include <stdint.h>
 
-typedef struct MelvinGraph MelvinGraph;
-extern MelvinGraph* melvin_create(void);
-extern void run_episode(MelvinGraph *g, const uint8_t *input, uint32_t input_len,
-                       const uint8_t *target, uint32_t target_len);
-extern void melvin_get_output(MelvinGraph *g, uint32_t **output, uint32_t *length);
-extern float melvin_get_edge_weight(MelvinGraph *g, uint32_t from, uint32_t to);
-extern uint32_t melvin_get_edge_use_count(MelvinGraph *g, uint32_t from, uint32_t to);
-extern uint32_t melvin_get_edge_success_count(MelvinGraph *g, uint32_t from, uint32_t to);
-extern void melvin_destroy(MelvinGraph *g);
+#include "melvin.h"
+
+/* Counters of the active edge from -> to, through the introspection iterators */
+static MelvinEdgeInfo find_edge(MelvinGraph *g, uint32_t from, uint32_t to) {
+    MelvinEdgeInfo info;
+    MelvinIter it;
+    melvin_iter_edges(g, from, &it);
+    while (melvin_next_edge(&it, &info)) {
+        if (info.to == to && info.active) return info;
+    }
+    memset(&info, 0, sizeof(info));
+    return info;
+}
+
+static uint32_t edge_use_count(MelvinGraph *g, uint32_t from, uint32_t to) {
+    return (uint32_t)find_edge(g, from, to).use_count;
+}
+
+static uint32_t edge_success_count(MelvinGraph *g, uint32_t from, uint32_t to) {
+    return (uint32_t)find_edge(g, from, to).success_count;
+}
 
 int main(void) {
     printf("DEBUG: Edge Weight and Success Count Tracking\n");
@@ -24,16 +36,16 @@ int main(void) {
     printf("Before training:\n");
     printf("  c→a: weight=%.3f, use=%u, success=%u\n",
            melvin_get_edge_weight(g, 'c', 'a'),
-           melvin_get_edge_use_count(g, 'c', 'a'),
-           melvin_get_edge_success_count(g, 'c', 'a'));
+           edge_use_count(g, 'c', 'a'),
+           edge_success_count(g, 'c', 'a'));
     printf("  a→t: weight=%.3f, use=%u, success=%u\n",
            melvin_get_edge_weight(g, 'a', 't'),
-           melvin_get_edge_use_count(g, 'a', 't'),
-           melvin_get_edge_success_count(g, 'a', 't'));
+           edge_use_count(g, 'a', 't'),
+           edge_success_count(g, 'a', 't'));
     printf("  t→s: weight=%.3f, use=%u, success=%u\n\n",
            melvin_get_edge_weight(g, 't', 's'),
-           melvin_get_edge_use_count(g, 't', 's'),
-           melvin_get_edge_success_count(g, 't', 's'));
+           edge_use_count(g, 't', 's'),
+           edge_success_count(g, 't', 's'));
     
     /* Train 5 times */
     for (int i = 0; i < 5; i++) {
@@ -41,16 +53,16 @@ int main(void) {
         printf("After episode %d:\n", i + 1);
         printf("  c→a: weight=%.3f, use=%u, success=%u\n",
                melvin_get_edge_weight(g, 'c', 'a'),
-               melvin_get_edge_use_count(g, 'c', 'a'),
-               melvin_get_edge_success_count(g, 'c', 'a'));
+               edge_use_count(g, 'c', 'a'),
+               edge_success_count(g, 'c', 'a'));
         printf("  a→t: weight=%.3f, use=%u, success=%u\n",
                melvin_get_edge_weight(g, 'a', 't'),
-               melvin_get_edge_use_count(g, 'a', 't'),
-               melvin_get_edge_success_count(g, 'a', 't'));
+               edge_use_count(g, 'a', 't'),
+               edge_success_count(g, 'a', 't'));
         printf("  t→s: weight=%.3f, use=%u, success=%u\n\n",
                melvin_get_edge_weight(g, 't', 's'),
-               melvin_get_edge_use_count(g, 't', 's'),
-               melvin_get_edge_success_count(g, 't', 's'));
+               edge_use_count(g, 't', 's'),
+               edge_success_count(g, 't', 's'));
     }
     
     /* Test output */
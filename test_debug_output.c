@@ -5,21 +5,7 @@
 #include <stdint.h>
 #include <string.h>
 
-typedef struct MelvinGraph MelvinGraph;
-extern MelvinGraph* melvin_create(void);
-extern void run_episode(MelvinGraph *g, const uint8_t *input, uint32_t input_len,
-                       const uint8_t *target, uint32_t target_len);
-extern void melvin_get_output(MelvinGraph *g, uint32_t **output, uint32_t *length);
-extern void melvin_destroy(MelvinGraph *g);
-
-/* Access internal state for debugging */
-typedef struct {
-    float activation[256];
-    bool exists[256];
-} NodeDebug;
-
-extern void debug_get_node_activations(MelvinGraph *g, float *activations);
-extern uint32_t debug_get_pattern_count(MelvinGraph *g);
+#include "melvin.h"
 
 int main(void) {
     MelvinGraph *g = melvin_create();
@@ -8,17 +8,7 @@
 #include <stdint.h>
 #include <stdbool.h>
 
-typedef struct MelvinGraph MelvinGraph;
-extern MelvinGraph* melvin_create(void);
-extern void run_episode(MelvinGraph *g, const uint8_t *input, uint32_t input_len,
-                       const uint8_t *target, uint32_t target_len);
-extern void melvin_get_output(MelvinGraph *g, uint32_t **output, uint32_t *length);
-extern uint32_t melvin_get_pattern_count(MelvinGraph *g);
-extern void melvin_get_pattern_info(MelvinGraph *g, uint32_t pattern_id, 
-                                    uint32_t **node_ids, uint32_t *length, float *strength);
-extern void melvin_get_pattern_predictions(MelvinGraph *g, uint32_t pattern_id,
-                                           uint32_t **predicted_nodes, float **prediction_weights,
-                                           uint32_t *prediction_count);
+#include "melvin.h"
 
 int main(void) {
     MelvinGraph *g = melvin_create();
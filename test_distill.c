@@ -0,0 +1,243 @@
+/* Test: pipelined distillation against the stub teacher
+ *
+ * Needs ./melvin_distill and ./melvin_teacher_stub (./build.sh tools).
+ *
+ * 1. Sequential: one connection, every prompt answered in full (including a
+ *    response far larger than the bridge's old 32 KB buffer) and trained
+ * 2. Pipelined: six keep-alive connections finish the teacher's work in
+ *    under half the time and leave exactly the same brain
+ * 3. Reconnects: a teacher closing the connection every other reply still
+ *    gets every prompt through, again with the same brain
+ * 4. Streaming: chunked NDJSON replies, lines split across chunks, decode to
+ *    the same text and the same brain
+ * 5. Cache: a run with --cache fills it; rerun with the teacher gone, every
+ *    response comes from disk and the brain is the same
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+
+#define PROMPT_COUNT 12
+#define DELAY_MS "30"
+#define LONG_RESPONSE 40000
+
+static int failures = 0;
+
+static void check(bool ok, const char *pass, const char *fail) {
+    printf("%s: %s\n", ok ? "PASS" : "FAIL", ok ? pass : fail);
+    if (!ok) failures++;
+}
+
+static pid_t start_stub(int port, const char *responses, const char *close_every) {
+    char port_arg[16];
+    snprintf(port_arg, sizeof(port_arg), "%d", port);
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        freopen("/dev/null", "w", stdout);
+        execl("./melvin_teacher_stub", "melvin_teacher_stub", "--port", port_arg, "--delay-ms", DELAY_MS,
+              "--responses", responses, "--close-every", close_every, (char*)NULL);
+        _exit(127);
+    }
+    /* Wait until it accepts connections */
+    for (int tries = 0; tries < 100; tries++) {
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons((uint16_t)port);
+        inet_pton(AF_INET, "127.0.0.1", &addr.sin_addr);
+        bool up = connect(fd, (struct sockaddr*)&addr, sizeof(addr)) == 0;
+        close(fd);
+        if (up) return pid;
+        struct timespec ts = {0, 20000000L};
+        nanosleep(&ts, NULL);
+    }
+    kill(pid, SIGTERM);
+    waitpid(pid, NULL, 0);
+    return -1;
+}
+
+static void stop_stub(pid_t pid) {
+    kill(pid, SIGTERM);
+    waitpid(pid, NULL, 0);
+}
+
+/* Runs melvin_distill and reads its JSON report into report */
+static bool distill(int port, const char *prompts, int inflight, bool stream, const char *cache,
+                    const char *out, char *report, size_t size) {
+    char teacher[32], inflight_arg[16];
+    snprintf(teacher, sizeof(teacher), "127.0.0.1:%d", port);
+    snprintf(inflight_arg, sizeof(inflight_arg), "%d", inflight);
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid == 0) {
+        freopen("/dev/null", "w", stdout);
+        const char *args[20] = {"melvin_distill", "--teacher", teacher, "--prompts", prompts,
+                                "--inflight", inflight_arg, "--queue", "32", "--quiet", "--out", out};
+        int n = 12;
+        if (stream) args[n++] = "--stream";
+        if (cache) {
+            args[n++] = "--cache";
+            args[n++] = cache;
+        }
+        args[n] = NULL;
+        execv("./melvin_distill", (char* const*)args);
+        _exit(127);
+    }
+    int status;
+    waitpid(pid, &status, 0);
+    FILE *f = fopen(out, "r");
+    if (!f) return false;
+    size_t n = fread(report, 1, size - 1, f);
+    report[n] = '\0';
+    fclose(f);
+    remove(out);
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+static double number(const char *report, const char *key) {
+    char pattern[64];
+    snprintf(pattern, sizeof(pattern), "\"%s\": ", key);
+    const char *p = strstr(report, pattern);
+    return p ? strtod(p + strlen(pattern), NULL) : -1.0;
+}
+
+static void checksum(const char *report, char out[17]) {
+    const char *p = strstr(report, "\"checksum\": \"");
+    snprintf(out, 17, "%s", p ? p + 13 : "");
+}
+
+int main(void) {
+    printf("=================================================================\n");
+    printf("DISTILL: pipelined teacher requests against the stub teacher\n");
+    printf("=================================================================\n\n");
+
+    if (access("./melvin_distill", X_OK) != 0 || access("./melvin_teacher_stub", X_OK) != 0) {
+        printf("FAIL: build ./melvin_distill and ./melvin_teacher_stub first (./build.sh tools)\n");
+        return 1;
+    }
+    signal(SIGPIPE, SIG_IGN);
+
+    /* Prompts and canned responses: quotes, backslashes, UTF-8 and one long answer */
+    const char *prompts_path = "test_distill_prompts.txt";
+    const char *responses_path = "test_distill_responses.tsv";
+    FILE *pf = fopen(prompts_path, "w");
+    FILE *rf = fopen(responses_path, "w");
+    uint64_t expected_bytes = 0;
+    for (int i = 0; i < PROMPT_COUNT; i++) {
+        char prompt[64], response[128];
+        snprintf(prompt, sizeof(prompt), "Question %d: what is \"%c\"?", i, 'a' + i);
+        snprintf(response, sizeof(response), "It is the letter \"%c\" \\ caf\xc3\xa9 %d", 'a' + i, i * 7);
+        fprintf(pf, "%s\n", prompt);
+        if (i == PROMPT_COUNT - 1) {
+            fprintf(rf, "%s\t", prompt);
+            for (int k = 0; k < LONG_RESPONSE; k++) fputc('a' + k % 26, rf);
+            fputc('\n', rf);
+            expected_bytes += LONG_RESPONSE;
+        } else {
+            fprintf(rf, "%s\t%s\n", prompt, response);
+            expected_bytes += strlen(response);
+        }
+    }
+    fclose(pf);
+    fclose(rf);
+
+    int port = 20000 + (int)(getpid() % 20000);
+    pid_t stub = start_stub(port, responses_path, "0");
+    pid_t closing_stub = start_stub(port + 1, responses_path, "2");
+    if (stub < 0 || closing_stub < 0) {
+        printf("FAIL: stub teacher did not start\n");
+        return 1;
+    }
+
+    /* 1. Sequential */
+    char seq[4096], pipe[4096], reconnect[4096];
+    bool seq_ok = distill(port, prompts_path, 1, false, NULL, "test_distill_seq.json", seq, sizeof(seq));
+    printf("Sequential: teacher %.3f s, trainer %.1f episodes/s\n",
+           number(seq, "seconds"), number(seq, "episodes_per_sec"));
+    check(seq_ok && number(seq, "responses") == PROMPT_COUNT && number(seq, "episodes") == PROMPT_COUNT &&
+          number(seq, "bytes") == (double)expected_bytes && number(seq, "connections") == 1,
+          "every prompt answered in full and trained over one connection",
+          "sequential run lost, truncated or reconnected");
+
+    /* 2. Pipelined */
+    bool pipe_ok = distill(port, prompts_path, 6, false, NULL, "test_distill_pipe.json", pipe, sizeof(pipe));
+    printf("Pipelined:  teacher %.3f s, trainer %.1f episodes/s\n",
+           number(pipe, "seconds"), number(pipe, "episodes_per_sec"));
+    char seq_sum[17], pipe_sum[17];
+    checksum(seq, seq_sum);
+    checksum(pipe, pipe_sum);
+    check(pipe_ok && number(pipe, "episodes") == PROMPT_COUNT && number(pipe, "connections") == 6 &&
+          number(pipe, "bytes") == (double)expected_bytes,
+          "six connections kept alive, every prompt trained",
+          "pipelined run lost prompts or did not keep its connections");
+    check(number(pipe, "seconds") < 0.5 * number(seq, "seconds"),
+          "teacher time under half of the sequential run",
+          "requests in flight did not overlap");
+    check(seq_sum[0] && strcmp(seq_sum, pipe_sum) == 0,
+          "same brain checksum as the sequential run",
+          "pipelining changed what was learned");
+
+    /* 3. Reconnects */
+    bool reconnect_ok = distill(port + 1, prompts_path, 3, false, NULL, "test_distill_reconnect.json",
+                                reconnect, sizeof(reconnect));
+    char reconnect_sum[17];
+    checksum(reconnect, reconnect_sum);
+    check(reconnect_ok && number(reconnect, "episodes") == PROMPT_COUNT &&
+          number(reconnect, "failed") == 0 && number(reconnect, "connections") > 3 &&
+          strcmp(reconnect_sum, seq_sum) == 0,
+          "closed connections reopened, nothing lost, same brain",
+          "reconnecting after Connection: close failed");
+
+    /* 4. Streaming */
+    char streamed[4096], streamed_sum[17];
+    bool streamed_ok = distill(port + 1, prompts_path, 4, true, NULL, "test_distill_stream.json",
+                               streamed, sizeof(streamed));
+    checksum(streamed, streamed_sum);
+    check(streamed_ok && number(streamed, "episodes") == PROMPT_COUNT &&
+          number(streamed, "bytes") == (double)expected_bytes && strcmp(streamed_sum, seq_sum) == 0,
+          "streamed replies decode to the same text and brain",
+          "streamed replies were lost, garbled or truncated");
+
+    /* 5. Cache */
+    const char *cache_path = "test_distill.cache";
+    remove(cache_path);
+    char filled[4096], cached[4096], filled_sum[17], cached_sum[17];
+    bool filled_ok = distill(port, prompts_path, 4, false, cache_path, "test_distill_fill.json",
+                             filled, sizeof(filled));
+    stop_stub(stub);
+    bool cached_ok = distill(port, prompts_path, 4, false, cache_path, "test_distill_cached.json",
+                             cached, sizeof(cached));
+    checksum(filled, filled_sum);
+    checksum(cached, cached_sum);
+    printf("Cached:     %g hits, %g connections, %g s wall\n",
+           number(cached, "hits"), number(cached, "connections"), number(cached, "wall_seconds"));
+    check(filled_ok && number(filled, "misses") == PROMPT_COUNT && number(filled, "entries") == PROMPT_COUNT &&
+          cached_ok && number(cached, "hits") == PROMPT_COUNT && number(cached, "misses") == 0 &&
+          number(cached, "connections") == 0 && number(cached, "hit_bytes") == (double)expected_bytes &&
+          strcmp(filled_sum, seq_sum) == 0 && strcmp(cached_sum, seq_sum) == 0,
+          "rerun served entirely from the cache with the teacher down, same brain",
+          "cache missed, was incomplete or changed what was learned");
+    remove(cache_path);
+
+    stop_stub(closing_stub);
+    remove(prompts_path);
+    remove(responses_path);
+
+    printf("\n%s\n", failures == 0 ? "ALL TESTS PASSED" : "TESTS FAILED");
+    return failures == 0 ? 0 : 1;
+}
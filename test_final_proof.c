@@ -6,11 +6,7 @@
 #include <stdbool.h>
 #include <string.h>
 
-typedef struct MelvinGraph MelvinGraph;
-extern MelvinGraph* melvin_create(void);
-extern void run_episode(MelvinGraph *g, const uint8_t *input, uint32_t input_len,
-                       const uint8_t *target, uint32_t target_len);
-extern void melvin_get_output(MelvinGraph *g, uint32_t **output, uint32_t *length);
+#include "melvin.h"
 
 void test(MelvinGraph *g, const char *input, const char *expected, const char *test_name) {
     run_episode(g, (const uint8_t*)input, strlen(input), NULL, 0);
@@ -0,0 +1,177 @@
+/* Test: introspection through melvin.h only
+ *
+ * 1. Pattern iteration visits every pattern once, agreeing with the stats
+ *    and with the older per-pattern getters
+ * 2. Edge iteration agrees with the stats and melvin_get_edge_weight, and
+ *    walking node by node gives exactly the full walk
+ * 3. Pattern edges and predictions add up to the per-pattern counts
+ * 4. State and misuse: the state copy matches the getters, unknown ids and
+ *    the wrong next call return nothing
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "melvin.h"
+
+static const char *pairs[][2] = {
+    {"cat", "cats"}, {"dog", "dogs"}, {"hello", "world"},
+    {"the cat sat", "on the mat"}, {"the dog ran", "in the park"},
+    {"what is", "the answer"}, {"where is", "the cat"},
+};
+#define PAIR_COUNT (sizeof(pairs) / sizeof(pairs[0]))
+
+static int failures = 0;
+
+static void check(bool ok, const char *pass, const char *fail) {
+    printf("%s: %s\n", ok ? "PASS" : "FAIL", ok ? pass : fail);
+    if (!ok) failures++;
+}
+
+int main(void) {
+    printf("=================================================================\n");
+    printf("INTROSPECTION: patterns, edges, predictions through melvin.h\n");
+    printf("=================================================================\n\n");
+
+    MelvinGraph *g = melvin_create();
+    for (int round = 0; round < 6; round++) {
+        for (size_t k = 0; k < PAIR_COUNT; k++) {
+            run_episode(g, (const uint8_t*)pairs[k][0], strlen(pairs[k][0]),
+                        (const uint8_t*)pairs[k][1], strlen(pairs[k][1]));
+        }
+    }
+
+    MelvinStats stats;
+    melvin_get_stats(g, &stats);
+    printf("Brain: %u patterns, %u edges (%u tombstoned), %u pattern edges\n\n",
+           stats.patterns, stats.edges_active, stats.edges_tombstoned, stats.pattern_edges);
+
+    MelvinIter it;
+
+    /* 1. Patterns (zeroed so memcmp sees equal padding) */
+    MelvinPatternInfo pat, by_id;
+    memset(&pat, 0, sizeof(pat));
+    memset(&by_id, 0, sizeof(by_id));
+    uint32_t visited = 0, getter_mismatches = 0, predictions_expected = 0;
+    uint64_t pattern_edges_expected = 0;
+    melvin_iter_patterns(g, &it);
+    while (melvin_next_pattern(&it, &pat)) {
+        uint32_t *nodes, length;
+        float strength;
+        melvin_get_pattern_info(g, pat.id, &nodes, &length, &strength);
+        bool blank = false;
+        for (uint32_t i = 0; i < pat.length; i++) blank |= pat.nodes[i] == MELVIN_BLANK_NODE;
+        if (pat.id != visited || pat.nodes != nodes || pat.length != length ||
+            pat.strength != strength || blank != pat.generalized ||
+            !melvin_pattern_info(g, pat.id, &by_id) || memcmp(&by_id, &pat, sizeof(pat)) != 0) {
+            getter_mismatches++;
+        }
+        predictions_expected += pat.prediction_count + pat.pattern_prediction_count;
+        pattern_edges_expected += pat.pattern_edge_count;
+        visited++;
+    }
+    check(stats.patterns > 0 && visited == stats.patterns && visited == melvin_get_pattern_count(g) &&
+          getter_mismatches == 0,
+          "every pattern visited once, matching the getters",
+          "pattern iteration disagrees with the stats or getters");
+
+    /* 2. Node edges */
+    static bool seen[256][256];
+    MelvinEdgeInfo edge, expected;
+    memset(&edge, 0, sizeof(edge));
+    memset(&expected, 0, sizeof(expected));
+    uint32_t active = 0, tombstoned = 0, weight_mismatches = 0, all_count = 0;
+    melvin_iter_edges(g, MELVIN_ALL, &it);
+    while (melvin_next_edge(&it, &edge)) {
+        if (edge.active) active++;
+        else tombstoned++;
+        /* melvin_get_edge_weight reports the first active edge to a node */
+        if (edge.active && !edge.pattern_edge && edge.to < 256 && !seen[edge.from][edge.to]) {
+            seen[edge.from][edge.to] = true;
+            if (melvin_get_edge_weight(g, edge.from, edge.to) != edge.weight) weight_mismatches++;
+        }
+        all_count++;
+    }
+    check(active == stats.edges_active && tombstoned == stats.edges_tombstoned && weight_mismatches == 0,
+          "edge iteration matches the stats and melvin_get_edge_weight",
+          "edge iteration disagrees with the stats or melvin_get_edge_weight");
+
+    MelvinIter all;
+    uint32_t node_count = 0, order_mismatches = 0;
+    melvin_iter_edges(g, MELVIN_ALL, &all);
+    for (uint32_t from = 0; from < 256; from++) {
+        melvin_iter_edges(g, from, &it);
+        while (melvin_next_edge(&it, &edge)) {
+            if (edge.from != from || !melvin_next_edge(&all, &expected) ||
+                memcmp(&edge, &expected, sizeof(edge)) != 0) {
+                order_mismatches++;
+            }
+            node_count++;
+        }
+    }
+    check(node_count == all_count && order_mismatches == 0 && !melvin_next_edge(&all, &expected),
+          "walking node by node gives the full walk",
+          "per-node edge iteration differs from the full walk");
+
+    /* 3. Pattern edges and predictions */
+    uint32_t pattern_edges = 0, bad_pattern_edges = 0;
+    melvin_iter_pattern_edges(g, MELVIN_ALL, &it);
+    while (melvin_next_edge(&it, &edge)) {
+        if (edge.from >= stats.patterns) bad_pattern_edges++;
+        pattern_edges++;
+    }
+    uint32_t scoped_pattern_edges = 0;
+    for (uint32_t p = 0; p < stats.patterns; p++) {
+        melvin_iter_pattern_edges(g, p, &it);
+        while (melvin_next_edge(&it, &edge)) scoped_pattern_edges++;
+    }
+    check(pattern_edges == stats.pattern_edges && pattern_edges == pattern_edges_expected &&
+          scoped_pattern_edges == pattern_edges && bad_pattern_edges == 0,
+          "pattern edges add up to the stats and per-pattern counts",
+          "pattern edge iteration disagrees with the counts");
+
+    MelvinPredictionInfo prediction;
+    uint32_t predictions = 0, prediction_mismatches = 0, node_predictions = 0;
+    melvin_iter_predictions(g, MELVIN_ALL, &it);
+    while (melvin_next_prediction(&it, &prediction)) predictions++;
+    for (uint32_t p = 0; p < stats.patterns; p++) {
+        uint32_t *nodes, count;
+        float *weights;
+        melvin_get_pattern_predictions(g, p, &nodes, &weights, &count);
+        uint32_t i = 0;
+        melvin_iter_predictions(g, p, &it);
+        while (melvin_next_prediction(&it, &prediction)) {
+            if (prediction.pattern != p) {
+                prediction_mismatches++;
+            } else if (!prediction.pattern_target) {
+                /* Node predictions come first, in storage order */
+                if (i >= count || nodes[i] != prediction.target || weights[i] != prediction.weight) {
+                    prediction_mismatches++;
+                }
+                node_predictions++;
+            }
+            i++;
+        }
+    }
+    check(predictions == predictions_expected && prediction_mismatches == 0 && node_predictions > 0,
+          "predictions match melvin_get_pattern_predictions",
+          "prediction iteration disagrees with the pattern's predictions");
+
+    /* 4. State and misuse */
+    MelvinStateInfo state;
+    melvin_get_state(g, &state);
+    MelvinPatternInfo none;
+    melvin_iter_patterns(g, &it);
+    bool wrong_next = melvin_next_edge(&it, &edge) || melvin_next_prediction(&it, &prediction);
+    melvin_iter_edges(g, 300, &it);
+    bool bad_node = melvin_next_edge(&it, &edge);
+    check(state.error_rate == melvin_get_error_rate(g) && state.step > 0 &&
+          !melvin_pattern_info(g, stats.patterns, &none) && !wrong_next && !bad_node,
+          "state matches the getters, bad ids and mixed calls return nothing",
+          "state copy or misuse handling is wrong");
+
+    melvin_destroy(g);
+
+    printf("\n%s\n", failures == 0 ? "ALL TESTS PASSED" : "TESTS FAILED");
+    return failures == 0 ? 0 : 1;
+}
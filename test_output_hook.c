@@ -0,0 +1,80 @@
+/* Test: the output hook sees every emitted node, in order, as it is emitted */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "melvin.h"
+
+typedef struct {
+    uint32_t nodes[1024];
+    uint32_t count;
+} Captured;
+
+static void capture(void *ctx, uint32_t node_id) {
+    Captured *cap = ctx;
+    if (cap->count < 1024) cap->nodes[cap->count] = node_id;
+    cap->count++;
+}
+
+int main(void) {
+    printf("=================================================================\n");
+    printf("OUTPUT HOOK: streamed nodes must equal the final output\n");
+    printf("=================================================================\n\n");
+
+    MelvinGraph *g = melvin_create();
+    for (int i = 0; i < 20; i++) {
+        run_episode(g, (const uint8_t*)"hello", 5, (const uint8_t*)"world", 5);
+        run_episode(g, (const uint8_t*)"cat", 3, (const uint8_t*)"cats", 4);
+    }
+
+    int failures = 0;
+    const char *inputs[] = {"hello", "cat", "hel", "dog"};
+
+    for (int i = 0; i < 4; i++) {
+        Captured cap = {{0}, 0};
+        melvin_set_output_hook(g, capture, &cap);
+        run_episode(g, (const uint8_t*)inputs[i], strlen(inputs[i]), NULL, 0);
+        melvin_set_output_hook(g, NULL, NULL);
+
+        uint32_t *output;
+        uint32_t output_len;
+        melvin_get_output(g, &output, &output_len);
+
+        if (cap.count != output_len || memcmp(cap.nodes, output, output_len * sizeof(uint32_t)) != 0) {
+            printf("FAIL: '%s' streamed %u nodes, output has %u\n", inputs[i], cap.count, output_len);
+            failures++;
+        } else {
+            printf("PASS: '%s' streamed all %u nodes in order\n", inputs[i], output_len);
+        }
+    }
+
+    /* Hook removed: nothing more is captured */
+    Captured cap = {{0}, 0};
+    melvin_set_output_hook(g, capture, &cap);
+    melvin_set_output_hook(g, NULL, NULL);
+    run_episode(g, (const uint8_t*)"hello", 5, NULL, 0);
+    if (cap.count != 0) {
+        printf("FAIL: removed hook still called %u times\n", cap.count);
+        failures++;
+    } else {
+        printf("PASS: removed hook is not called\n");
+    }
+
+    /* Clones don't inherit the hook */
+    melvin_set_output_hook(g, capture, &cap);
+    MelvinGraph *copy = melvin_clone(g);
+    run_episode(copy, (const uint8_t*)"hello", 5, NULL, 0);
+    if (cap.count != 0) {
+        printf("FAIL: clone called the original's hook\n");
+        failures++;
+    } else {
+        printf("PASS: clone does not inherit the hook\n");
+    }
+    melvin_destroy(copy);
+    melvin_destroy(g);
+
+    printf("\n%s\n", failures == 0 ? "ALL TESTS PASSED" : "TESTS FAILED");
+    return failures == 0 ? 0 : 1;
+}
@@ -3,13 +3,7 @@
 #include <string.h>
 #include <stdint.h>
 
-/* Forward declarations */
-typedef struct MelvinGraph MelvinGraph;
-extern MelvinGraph* melvin_create(void);
-extern void melvin_destroy(MelvinGraph *g);
-extern void run_episode(MelvinGraph *g, const uint8_t *input, uint32_t input_len,
-                       const uint8_t *target, uint32_t target_len);
-extern void melvin_get_output(MelvinGraph *g, uint32_t **output, uint32_t *length);
+#include "melvin.h"
 
 void print_output(MelvinGraph *g, const char *label) {
     uint32_t *output;
@@ -6,28 +6,8 @@
 #include <stdlib.h>
 #include <stdint.h>
 
-typedef struct MelvinGraph MelvinGraph;
-extern MelvinGraph* melvin_create(void);
-extern void run_episode(MelvinGraph *g, const uint8_t *input, uint32_t input_len,
-                       const uint8_t *target, uint32_t target_len);
-extern void melvin_get_output(MelvinGraph *g, uint32_t **output, uint32_t *length);
+#include "melvin.h"
 
-/* Access pattern internals */
-typedef struct {
-    uint32_t *node_ids;
-    uint32_t length;
-    float strength;
-    float activation;
-    uint32_t *predicted_nodes;
-    float *prediction_weights;
-    uint32_t prediction_count;
-    bool has_fired;
-} PatternDebug;
-
-extern uint32_t melvin_get_pattern_count(MelvinGraph *g);
-extern void melvin_debug_pattern(MelvinGraph *g, uint32_t p, PatternDebug *out);
-
-/* Simplified accessor - we'll use a hack to access internals */
 int main(void) {
     printf("=================================================================\n");
     printf("PATTERN DEBUG: Trace Pattern Learning\n");
@@ -50,7 +30,7 @@ int main(void) {
         
         uint32_t *output;
         uint32_t output_len;
-        melvin_get_output(g, &output, &output_length);
+        melvin_get_output(g, &output, &output_len);
         
         printf("Input:  cat\n");
         printf("Target: cats\n");
@@ -9,17 +9,7 @@
 #include <string.h>
 #include <stdint.h>
 
-/* Forward declarations */
-typedef struct MelvinGraph MelvinGraph;
-extern MelvinGraph* melvin_create(void);
-extern void run_episode(MelvinGraph *g, const uint8_t *input, uint32_t input_len,
-                       const uint8_t *target, uint32_t target_len);
-extern void melvin_get_output(MelvinGraph *g, uint32_t **output, uint32_t *length);
-extern float melvin_get_error_rate(MelvinGraph *g);
-extern uint32_t melvin_get_pattern_count(MelvinGraph *g);
-extern void melvin_get_pattern_info(MelvinGraph *g, uint32_t pattern_id, 
-                                    uint32_t **node_ids, uint32_t *length, float *strength);
-extern float melvin_get_edge_weight(MelvinGraph *g, uint32_t from_id, uint32_t to_id);
+#include "melvin.h"
 
 int main(void) {
     printf("=================================================================\n");
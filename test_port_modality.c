@@ -5,13 +5,17 @@
 #include <stdint.h>
 #include <string.h>
 
-typedef struct MelvinGraph MelvinGraph;
-extern MelvinGraph* melvin_create(void);
-extern void melvin_set_input_port(MelvinGraph *g, uint32_t port_id);
-extern void melvin_set_output_port(MelvinGraph *g, uint32_t port_id);
-extern void run_episode(MelvinGraph *g, const uint8_t *input, uint32_t input_len,
-                       const uint8_t *target, uint32_t target_len);
-extern void melvin_get_output(MelvinGraph *g, uint32_t **output, uint32_t *length);
+#include "melvin.h"
+
+/* Ports became context vectors. Port n's context is mostly dimension n with a
+ * little of the next, so two ports' contexts are dissimilar enough to gate
+ * each other (orthogonal contexts would not) */
+static void set_port(MelvinGraph *g, uint32_t port_id) {
+    float context[16] = {0};
+    context[port_id % 16] = 1.0f;
+    context[(port_id + 1) % 16] = 0.05f;
+    melvin_set_context(g, context);
+}
 
 int main(void) {
     MelvinGraph *g = melvin_create();
@@ -22,8 +26,7 @@ int main(void) {
     
     /* Train in TEXT port (port 0) */
     printf("Training in TEXT port (port 0): 'cat' → 'cats'\n");
-    melvin_set_input_port(g, 0);   /* TEXT port */
-    melvin_set_output_port(g, 0);
+    set_port(g, 0);   /* TEXT port */
     
     for (int i = 0; i < 30; i++) {
         run_episode(g, (const uint8_t*)"cat", 3, (const uint8_t*)"cats", 4);
@@ -33,7 +36,7 @@ int main(void) {
     /* Test in TEXT port - should use learned patterns */
     printf("Test in TEXT port:\n");
     printf("  Input:  cat (bytes 99,97,116 in TEXT context)\n");
-    melvin_set_input_port(g, 0);
+    set_port(g, 0);
     run_episode(g, (const uint8_t*)"cat", 3, NULL, 0);
     uint32_t *output;
     uint32_t output_len;
@@ -47,7 +50,7 @@ int main(void) {
     /* Test in AUDIO port - same bytes, different meaning */
     printf("Test in AUDIO port (port 1):\n");
     printf("  Input:  cat (bytes 99,97,116 in AUDIO context = frequencies)\n");
-    melvin_set_input_port(g, 1);   /* AUDIO port */
+    set_port(g, 1);   /* AUDIO port */
     run_episode(g, (const uint8_t*)"cat", 3, NULL, 0);
     melvin_get_output(g, &output, &output_len);
     printf("  Output: ");
@@ -61,8 +64,7 @@ int main(void) {
     printf("- TEXT patterns only fire in TEXT port\n");
     printf("- AUDIO patterns only fire in AUDIO port\n");
     printf("- Same bytes (99,97,116), different meanings, no confusion!\n");
-    printf("- Nodes track source_port, patterns track input_port/output_port\n");
-    printf("- Wave prop learns port-to-port relationships\n");
+    printf("- Patterns carry the context class of the port they were learned in\n");
     printf("=================================================================\n");
     
     return 0;
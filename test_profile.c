@@ -0,0 +1,173 @@
+/* Test: the sampled section profiler
+ *
+ * 1. Off by default, and profiling doesn't change what the brain learns
+ * 2. One episode in sample_every is sampled
+ * 3. Every section a training episode runs has calls and time, and the
+ *    sections add up to no more than the sampled episodes
+ * 4. The dump has a line per section
+ * 5. Reset zeroes the counters and keeps the rate
+ * Then prints the dump and the cost of sampling every episode.
+ */
+
+#define _POSIX_C_SOURCE 199309L
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+
+#include "melvin.h"
+
+static const char *pairs[][2] = {
+    {"cat", "cats"}, {"dog", "dogs"}, {"hello", "world"}, {"the cat", "sat"}
+};
+#define PAIR_COUNT (sizeof(pairs) / sizeof(pairs[0]))
+
+static double now_sec(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void train(MelvinGraph *g, int rounds) {
+    for (int r = 0; r < rounds; r++) {
+        for (size_t k = 0; k < PAIR_COUNT; k++) {
+            run_episode(g, (const uint8_t*)pairs[k][0], strlen(pairs[k][0]),
+                        (const uint8_t*)pairs[k][1], strlen(pairs[k][1]));
+        }
+    }
+}
+
+static uint32_t answers(MelvinGraph *g, uint32_t *out, uint32_t cap) {
+    uint32_t n = 0;
+    for (size_t k = 0; k < PAIR_COUNT; k++) {
+        run_episode(g, (const uint8_t*)pairs[k][0], strlen(pairs[k][0]), NULL, 0);
+        uint32_t *output;
+        uint32_t len;
+        melvin_get_output(g, &output, &len);
+        for (uint32_t i = 0; i < len && n < cap; i++) out[n++] = output[i];
+    }
+    return n;
+}
+
+int main(void) {
+    printf("=================================================================\n");
+    printf("PROFILER: sampled per-section timings of run_episode\n");
+    printf("=================================================================\n\n");
+
+    int failures = 0;
+    MelvinGraph *plain = melvin_create();
+    MelvinGraph *profiled = melvin_create();
+    MelvinProfile prof;
+
+    /* 1. Off by default; same answers with it on */
+    train(plain, 10);
+    melvin_get_profile(plain, &prof);
+    melvin_set_profiling(profiled, 4);
+    train(profiled, 10);
+    uint32_t a[512], b[512];
+    uint32_t na = answers(plain, a, 512);
+    uint32_t nb = answers(profiled, b, 512);
+    if (prof.episodes_sampled != 0 || na != nb || memcmp(a, b, na * sizeof(uint32_t)) != 0) {
+        printf("FAIL: profiler on by default or changed the answers\n");
+        failures++;
+    } else {
+        printf("PASS: off by default, and profiling leaves answers unchanged\n");
+    }
+
+    /* 2. Sampling rate: 44 episodes at 1 in 4 */
+    melvin_get_profile(profiled, &prof);
+    uint64_t episodes = 10 * PAIR_COUNT + PAIR_COUNT;
+    if (prof.episodes_seen != episodes || prof.episodes_sampled != (episodes + 3) / 4) {
+        printf("FAIL: %llu episodes seen, %llu sampled\n",
+               (unsigned long long)prof.episodes_seen, (unsigned long long)prof.episodes_sampled);
+        failures++;
+    } else {
+        printf("PASS: %llu of %llu episodes sampled at 1 in 4\n",
+               (unsigned long long)prof.episodes_sampled, (unsigned long long)prof.episodes_seen);
+    }
+
+    /* 3. Sections */
+    melvin_reset_profile(profiled);
+    melvin_set_profiling(profiled, 1);
+    train(profiled, 5);
+    melvin_get_profile(profiled, &prof);
+    uint64_t claimed = 0;
+    int empty = 0;
+    for (int s = 0; s < MELVIN_PROF_COUNT; s++) {
+        claimed += prof.sections[s].ns;
+        if (prof.sections[s].calls == 0 || prof.sections[s].ns == 0) {
+            printf("  section %s: %llu calls, %llu ns\n", melvin_profile_section_name((MelvinProfileSection)s),
+                   (unsigned long long)prof.sections[s].calls, (unsigned long long)prof.sections[s].ns);
+            empty++;
+        }
+    }
+    if (empty || claimed > prof.episode_ns ||
+        prof.sections[MELVIN_PROF_FEEDBACK].calls != prof.episodes_sampled ||
+        prof.sections[MELVIN_PROF_PROPAGATE].calls < prof.episodes_sampled) {
+        printf("FAIL: %d empty sections, %llu of %llu ns claimed\n", empty,
+               (unsigned long long)claimed, (unsigned long long)prof.episode_ns);
+        failures++;
+    } else {
+        printf("PASS: all %d sections timed, %.1f%% of episode time attributed\n",
+               MELVIN_PROF_COUNT, 100.0 * claimed / prof.episode_ns);
+    }
+
+    /* 4. Dump */
+    FILE *tmp = tmpfile();
+    melvin_dump_profile(&prof, tmp);
+    rewind(tmp);
+    char line[256];
+    int section_lines = 0;
+    while (fgets(line, sizeof(line), tmp)) {
+        for (int s = 0; s < MELVIN_PROF_COUNT; s++) {
+            const char *name = melvin_profile_section_name((MelvinProfileSection)s);
+            size_t len = strlen(name);
+            if (strncmp(line, name, len) == 0 && line[len] == ' ') section_lines++;
+        }
+    }
+    fclose(tmp);
+    if (section_lines != MELVIN_PROF_COUNT) {
+        printf("FAIL: dump has %d of %d section lines\n", section_lines, MELVIN_PROF_COUNT);
+        failures++;
+    } else {
+        printf("PASS: dump lists every section\n");
+    }
+
+    /* 5. Reset */
+    melvin_reset_profile(profiled);
+    melvin_get_profile(profiled, &prof);
+    if (prof.episodes_sampled || prof.episode_ns || prof.sections[MELVIN_PROF_PROPAGATE].calls ||
+        prof.sample_every != 1) {
+        printf("FAIL: reset left counters or changed the rate\n");
+        failures++;
+    } else {
+        printf("PASS: reset zeroes counters and keeps the rate\n");
+    }
+
+    /* Profile of a longer run, and what sampling costs */
+    MelvinGraph *timed[3];
+    uint32_t rates[3] = {0, 16, 1};
+    double seconds[3];
+    for (int i = 0; i < 3; i++) {
+        timed[i] = melvin_create();
+        melvin_set_profiling(timed[i], rates[i]);
+        double start = now_sec();
+        train(timed[i], 60);
+        seconds[i] = now_sec() - start;
+    }
+    melvin_get_profile(timed[2], &prof);
+    printf("\n");
+    melvin_dump_profile(&prof, stdout);
+    printf("\n240 training episodes: off %.3fs, 1 in 16 %.3fs (%+.1f%%), every episode %.3fs (%+.1f%%)\n",
+           seconds[0], seconds[1], 100.0 * (seconds[1] / seconds[0] - 1.0),
+           seconds[2], 100.0 * (seconds[2] / seconds[0] - 1.0));
+    for (int i = 0; i < 3; i++) melvin_destroy(timed[i]);
+
+    melvin_destroy(plain);
+    melvin_destroy(profiled);
+
+    printf("\n%s\n", failures == 0 ? "ALL TESTS PASSED" : "TESTS FAILED");
+    return failures == 0 ? 0 : 1;
+}
@@ -9,12 +9,7 @@
 #include <stdbool.h>
 #include <string.h>
 
-typedef struct MelvinGraph MelvinGraph;
-extern MelvinGraph* melvin_create(void);
-extern void run_episode(MelvinGraph *g, const uint8_t *input, uint32_t input_len,
-                       const uint8_t *target, uint32_t target_len);
-extern void melvin_get_output(MelvinGraph *g, uint32_t **output, uint32_t *length);
-extern uint32_t melvin_get_pattern_count(MelvinGraph *g);
+#include "melvin.h"
 
 void test_output(MelvinGraph *g, const uint8_t *input, uint32_t input_len,
                  const char *description) {
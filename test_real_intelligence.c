@@ -12,14 +12,7 @@
 #include <stdlib.h>
 #include <string.h>
 
-/* External Melvin API */
-typedef struct MelvinGraph MelvinGraph;
-
-extern MelvinGraph* melvin_create(void);
-extern void run_episode(MelvinGraph *g, const uint8_t *input, uint32_t input_len,
-                       const uint8_t *target, uint32_t target_len);
-extern void melvin_get_output(MelvinGraph *g, uint32_t **output, uint32_t *length);
-extern void melvin_destroy(MelvinGraph *g);
+#include "melvin.h"
 
 /* Helper: Train multiple episodes */
 void train(MelvinGraph *g, const char *input, const char *target, int episodes) {
@@ -0,0 +1,218 @@
+/* Test: recording episodes for replay, and brain checksums
+ *
+ * 1. Identically trained brains have the same checksum; a clone matches its
+ *    source; one more episode changes it
+ * 2. Recording doesn't change what the brain learns
+ * 3. The recording holds every episode and context change, in order, with
+ *    the outputs the brain gave, and ends with the brain's checksum
+ * 4. Feeding the recorded calls to a fresh brain reproduces every output and
+ *    the final checksum
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "melvin.h"
+
+#define RECORD_PATH "/tmp/melvin_test_record.mlvr"
+#define MAX_STEPS 256
+#define MAX_OUTPUT 512
+
+static const char *pairs[][2] = {{"cat", "cats"}, {"dog", "dogs"}, {"hello", "world"}};
+#define PAIR_COUNT (sizeof(pairs) / sizeof(pairs[0]))
+
+static float text_context[16] = {1.0f};
+static float audio_context[16] = {0.0f, 1.0f};
+
+/* Training in two contexts, then questions without targets */
+static void session(MelvinGraph *g) {
+    for (int round = 0; round < 4; round++) {
+        melvin_set_context(g, round % 2 ? audio_context : text_context);
+        for (size_t k = 0; k < PAIR_COUNT; k++) {
+            run_episode(g, (const uint8_t*)pairs[k][0], strlen(pairs[k][0]),
+                        (const uint8_t*)pairs[k][1], strlen(pairs[k][1]));
+        }
+    }
+    melvin_set_context(g, text_context);
+    for (size_t k = 0; k < PAIR_COUNT; k++) {
+        run_episode(g, (const uint8_t*)pairs[k][0], strlen(pairs[k][0]), NULL, 0);
+    }
+}
+
+typedef struct {
+    char type;
+    float context[16];
+    uint8_t input[64];
+    uint32_t input_len;
+    uint8_t target[64];
+    uint32_t target_len;
+    bool has_target;
+    uint32_t output[MAX_OUTPUT];
+    uint32_t output_len;
+} Step;
+
+static bool read_u32(FILE *f, uint32_t *v) {
+    uint8_t b[4];
+    if (fread(b, 1, 4, f) != 4) return false;
+    *v = (uint32_t)b[0] | (uint32_t)b[1] << 8 | (uint32_t)b[2] << 16 | (uint32_t)b[3] << 24;
+    return true;
+}
+
+static bool read_u64(FILE *f, uint64_t *v) {
+    uint32_t lo, hi;
+    if (!read_u32(f, &lo) || !read_u32(f, &hi)) return false;
+    *v = (uint64_t)hi << 32 | lo;
+    return true;
+}
+
+/* Reads the whole recording; false if it's malformed */
+static bool read_recording(Step *steps, uint32_t *count, uint64_t *start, uint64_t *end, uint64_t *episodes) {
+    FILE *f = fopen(RECORD_PATH, "rb");
+    if (!f) return false;
+    char magic[4];
+    uint32_t version;
+    bool ok = fread(magic, 1, 4, f) == 4 && memcmp(magic, "MLVR", 4) == 0 &&
+              read_u32(f, &version) && version == 1 && read_u64(f, start);
+    *count = 0;
+    int type;
+    while (ok && (type = fgetc(f)) != EOF) {
+        if (type == 'Z') {
+            ok = read_u64(f, episodes) && read_u64(f, end) && fgetc(f) == EOF;
+            fclose(f);
+            return ok;
+        }
+        Step *s = &steps[*count];
+        memset(s, 0, sizeof(*s));
+        s->type = (char)type;
+        if (type == 'C') {
+            for (int i = 0; i < 16 && ok; i++) {
+                uint32_t bits;
+                ok = read_u32(f, &bits);
+                memcpy(&s->context[i], &bits, 4);
+            }
+        } else if (type == 'E') {
+            uint32_t target_len = 0;
+            uint64_t ns;
+            ok = read_u32(f, &s->input_len) && s->input_len <= 64 &&
+                 fread(s->input, 1, s->input_len, f) == s->input_len && read_u32(f, &target_len);
+            s->has_target = target_len != 0xFFFFFFFFu;
+            if (ok && s->has_target) {
+                s->target_len = target_len;
+                ok = target_len <= 64 && fread(s->target, 1, target_len, f) == target_len;
+            }
+            ok = ok && read_u32(f, &s->output_len) && s->output_len <= MAX_OUTPUT;
+            for (uint32_t i = 0; ok && i < s->output_len; i++) ok = read_u32(f, &s->output[i]);
+            ok = ok && read_u64(f, &ns);
+        } else {
+            ok = false;
+        }
+        if (ok && ++*count >= MAX_STEPS) ok = false;
+    }
+    fclose(f);
+    return false;  /* No end record */
+}
+
+int main(void) {
+    printf("=================================================================\n");
+    printf("RECORDING: episodes written for replay, brain checksums\n");
+    printf("=================================================================\n\n");
+
+    int failures = 0;
+
+    /* 1. Checksums */
+    MelvinGraph *a = melvin_create();
+    MelvinGraph *b = melvin_create();
+    uint64_t fresh = melvin_checksum(a);
+    session(a);
+    session(b);
+    MelvinGraph *c = melvin_clone(a);
+    uint64_t trained = melvin_checksum(a);
+    bool same = trained == melvin_checksum(b) && trained == melvin_checksum(c) && trained != fresh;
+    run_episode(c, (const uint8_t*)"cat", 3, (const uint8_t*)"cats", 4);
+    if (!same || melvin_checksum(c) == trained) {
+        printf("FAIL: checksums don't track the learned state\n");
+        failures++;
+    } else {
+        printf("PASS: equal brains share a checksum, learning changes it\n");
+    }
+    melvin_destroy(b);
+    melvin_destroy(c);
+
+    /* 2. Recording doesn't change learning */
+    MelvinGraph *recorded = melvin_create();
+    if (!melvin_record_start(recorded, RECORD_PATH)) {
+        printf("FAIL: cannot record to %s\n", RECORD_PATH);
+        return 1;
+    }
+    session(recorded);
+    uint64_t final = melvin_checksum(recorded);
+    bool stopped = melvin_record_stop(recorded);
+    if (!stopped || final != trained) {
+        printf("FAIL: recorded brain learned differently (or stop failed)\n");
+        failures++;
+    } else {
+        printf("PASS: recording leaves learning unchanged\n");
+    }
+
+    /* 3. Contents */
+    static Step steps[MAX_STEPS];
+    uint32_t count = 0;
+    uint64_t start = 0, end = 0, episodes = 0;
+    bool readable = read_recording(steps, &count, &start, &end, &episodes);
+    uint32_t contexts = 0, episode_steps = 0, targetless = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (steps[i].type == 'C') {
+            contexts++;
+        } else {
+            episode_steps++;
+            if (!steps[i].has_target) targetless++;
+        }
+    }
+    /* Initial context, 4 rounds, 1 before the questions; 4 x 3 training, 3 questions */
+    if (!readable || start != fresh || end != final || contexts != 6 || episode_steps != 15 ||
+        episodes != 15 || targetless != PAIR_COUNT) {
+        printf("FAIL: recording has %u contexts, %u episodes (%llu in end record), %u without target%s\n",
+               contexts, episode_steps, (unsigned long long)episodes, targetless,
+               readable ? "" : " - unreadable");
+        failures++;
+    } else {
+        printf("PASS: %u episodes and %u context changes recorded between checksums\n", episode_steps, contexts);
+    }
+
+    /* 4. Replaying the calls */
+    MelvinGraph *replayed = melvin_create();
+    uint32_t mismatches = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (steps[i].type == 'C') {
+            melvin_set_context(replayed, steps[i].context);
+            continue;
+        }
+        run_episode(replayed, steps[i].input, steps[i].input_len,
+                    steps[i].has_target ? steps[i].target : NULL, steps[i].target_len);
+        uint32_t *output;
+        uint32_t output_len;
+        melvin_get_output(replayed, &output, &output_len);
+        if (output_len != steps[i].output_len ||
+            memcmp(output, steps[i].output, sizeof(uint32_t) * output_len) != 0) {
+            mismatches++;
+        }
+    }
+    if (mismatches || melvin_checksum(replayed) != end) {
+        printf("FAIL: replay gave %u different outputs, checksum %s\n", mismatches,
+               melvin_checksum(replayed) == end ? "matched" : "differs");
+        failures++;
+    } else {
+        printf("PASS: replay reproduces every output and the final checksum\n");
+    }
+
+    melvin_destroy(a);
+    melvin_destroy(recorded);
+    melvin_destroy(replayed);
+    remove(RECORD_PATH);
+
+    printf("\n%s\n", failures == 0 ? "ALL TESTS PASSED" : "TESTS FAILED");
+    return failures == 0 ? 0 : 1;
+}
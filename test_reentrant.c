@@ -0,0 +1,117 @@
+/* Test: brains in different threads don't affect each other
+ *
+ * Each brain gets its own training stream. Every episode's output and error
+ * rate are hashed; the hashes from running all brains at once in threads
+ * must equal those from running them one after another.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "melvin.h"
+
+#define BRAINS 4
+#define ROUNDS 3
+
+static const char *pairs[][2] = {
+    {"cat", "cats"}, {"dog", "dogs"}, {"hello", "world"}, {"the cat", "sat"},
+    {"red", "blue"}, {"one", "two"}, {"sun", "moon"}, {"bird", "birds"}
+};
+#define PAIR_COUNT (sizeof(pairs) / sizeof(pairs[0]))
+
+typedef struct {
+    int index;
+    MelvinGraph *start;    /* NULL: a fresh brain; else clone this one */
+    uint64_t digest;
+} Run;
+
+static uint64_t fnv(uint64_t h, const void *data, size_t len) {
+    const uint8_t *p = data;
+    for (size_t i = 0; i < len; i++) {
+        h ^= p[i];
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+/* Brain `index` trains on the pairs starting at its own offset, then answers each input */
+static void* run_brain(void *arg) {
+    Run *run = arg;
+    MelvinGraph *g = run->start ? melvin_clone(run->start) : melvin_create();
+    uint64_t h = 14695981039346656037ull;
+
+    for (int round = 0; round < ROUNDS; round++) {
+        for (size_t k = 0; k < PAIR_COUNT; k++) {
+            const char **pair = pairs[(k + run->index) % PAIR_COUNT];
+            run_episode(g, (const uint8_t*)pair[0], strlen(pair[0]),
+                        (const uint8_t*)pair[1], strlen(pair[1]));
+            float error = melvin_get_error_rate(g);
+            h = fnv(h, &error, sizeof(error));
+        }
+    }
+    for (size_t k = 0; k < PAIR_COUNT; k++) {
+        run_episode(g, (const uint8_t*)pairs[k][0], strlen(pairs[k][0]), NULL, 0);
+        uint32_t *output;
+        uint32_t output_len;
+        melvin_get_output(g, &output, &output_len);
+        h = fnv(h, output, output_len * sizeof(uint32_t));
+    }
+    uint32_t patterns = melvin_get_pattern_count(g);
+    run->digest = fnv(h, &patterns, sizeof(patterns));
+
+    melvin_destroy(g);
+    return NULL;
+}
+
+/* Run every brain serially, then all together; returns mismatches */
+static int compare(const char *label, MelvinGraph *start) {
+    Run serial[BRAINS], threaded[BRAINS];
+    pthread_t threads[BRAINS];
+
+    for (int i = 0; i < BRAINS; i++) {
+        serial[i] = (Run){i, start, 0};
+        run_brain(&serial[i]);
+    }
+    for (int i = 0; i < BRAINS; i++) {
+        threaded[i] = (Run){i, start, 0};
+        pthread_create(&threads[i], NULL, run_brain, &threaded[i]);
+    }
+    for (int i = 0; i < BRAINS; i++) pthread_join(threads[i], NULL);
+
+    int mismatches = 0;
+    for (int i = 0; i < BRAINS; i++) {
+        if (serial[i].digest != threaded[i].digest) {
+            printf("FAIL: %s brain %d: serial %016llx, threaded %016llx\n", label, i,
+                   (unsigned long long)serial[i].digest, (unsigned long long)threaded[i].digest);
+            mismatches++;
+        }
+    }
+    if (mismatches == 0) {
+        printf("PASS: %d %s brains match their serial runs bit for bit\n", BRAINS, label);
+    }
+    return mismatches;
+}
+
+int main(void) {
+    printf("=================================================================\n");
+    printf("REENTRANCY: concurrent brains must behave as if run alone\n");
+    printf("=================================================================\n\n");
+
+    int failures = 0;
+    failures += compare("fresh", NULL);
+
+    /* Clones of one trained brain, as the server's sessions are */
+    MelvinGraph *base = melvin_create();
+    for (size_t k = 0; k < PAIR_COUNT; k++) {
+        run_episode(base, (const uint8_t*)pairs[k][0], strlen(pairs[k][0]),
+                    (const uint8_t*)pairs[k][1], strlen(pairs[k][1]));
+    }
+    failures += compare("cloned", base);
+    melvin_destroy(base);
+
+    printf("\n%s\n", failures == 0 ? "ALL TESTS PASSED" : "TESTS FAILED");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,311 @@
+/* Test: binary RPC against a running melvin_server, and a benchmark of it
+ * against the HTTP/JSON endpoints
+ *
+ * Start the server with an RPC port, then:
+ *   MELVIN_RPC_PORT=9090 ./melvin_server &
+ *   ./test_rpc [host] [http_port] [rpc_port]
+ *
+ * 1. STATUS, CHAT, TRAIN and SAVE answer with the documented payloads
+ * 2. Pipelined frames come back in order with their ids
+ * 3. Bad frames get error replies
+ * 4. Requests/s and p50/p99 latency: RPC vs HTTP, one at a time and pipelined
+ */
+
+#define _GNU_SOURCE
+
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+enum { RPC_CHAT = 1, RPC_TRAIN, RPC_STATUS, RPC_SAVE };
+enum { RPC_OK, RPC_BAD_REQUEST, RPC_BUSY, RPC_ERROR };
+
+#define BENCH_REQUESTS 2000
+#define PIPELINE_DEPTH 32
+
+typedef struct {
+    uint8_t op, status;
+    uint32_t id;
+    uint8_t payload[65536];
+    uint32_t len;
+} Frame;
+
+static int failures = 0;
+
+static double now_seconds(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double*)a, y = *(const double*)b;
+    return (x > y) - (x < y);
+}
+
+static void put32(uint8_t *p, uint32_t v) {
+    p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24;
+}
+
+static uint32_t get32(const uint8_t *p) {
+    return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+static int connect_to(const char *host, int port) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    inet_pton(AF_INET, host, &addr.sin_addr);
+    if (fd < 0 || connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+        printf("Cannot connect to %s:%d - is melvin_server running?\n", host, port);
+        exit(1);
+    }
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return fd;
+}
+
+static void write_all(int fd, const void *data, size_t len) {
+    const char *p = data;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n <= 0) { printf("write failed\n"); exit(1); }
+        p += n;
+        len -= (size_t)n;
+    }
+}
+
+static void read_all(int fd, void *data, size_t len) {
+    char *p = data;
+    while (len > 0) {
+        ssize_t n = read(fd, p, len);
+        if (n <= 0) { printf("connection closed\n"); exit(1); }
+        p += n;
+        len -= (size_t)n;
+    }
+}
+
+/* Session-prefixed payload: u8 len | session | body */
+static uint32_t session_payload(uint8_t *out, const char *session, const void *body, uint32_t len) {
+    out[0] = (uint8_t)strlen(session);
+    memcpy(out + 1, session, out[0]);
+    memcpy(out + 1 + out[0], body, len);
+    return 1 + out[0] + len;
+}
+
+static void rpc_write(int fd, uint8_t op, uint32_t id, const void *payload, uint32_t len) {
+    uint8_t frame[12 + 4096];
+    put32(frame, len + 8);
+    frame[4] = op;
+    frame[5] = frame[6] = frame[7] = 0;
+    put32(frame + 8, id);
+    memcpy(frame + 12, payload, len);
+    write_all(fd, frame, 12 + len);
+}
+
+static void rpc_read(int fd, Frame *f) {
+    uint8_t header[12];
+    read_all(fd, header, sizeof(header));
+    f->len = get32(header) - 8;
+    f->op = header[4];
+    f->status = header[5];
+    f->id = get32(header + 8);
+    if (f->len > sizeof(f->payload)) { printf("reply too large\n"); exit(1); }
+    read_all(fd, f->payload, f->len);
+}
+
+/* One HTTP request on a keep-alive connection (reply read separately) */
+static void http_write(int fd, const char *method, const char *path, const char *body) {
+    char request[4096];
+    int len = snprintf(request, sizeof(request),
+                       "%s %s HTTP/1.1\r\nHost: localhost\r\nContent-Type: application/json\r\n"
+                       "Content-Length: %zu\r\n\r\n%s", method, path, strlen(body), body);
+    write_all(fd, request, (size_t)len);
+}
+
+/* Read one response; returns its status. Buffered, so pipelined replies
+ * cost one read() per batch rather than per byte. */
+static char http_buf[1 << 20];
+static size_t http_len = 0;
+
+static int http_read(int fd) {
+    for (;;) {
+        char *end = http_len ? memmem(http_buf, http_len, "\r\n\r\n", 4) : NULL;
+        if (end) {
+            size_t head_len = (size_t)(end - http_buf) + 4;
+            char *cl = memmem(http_buf, head_len, "Content-Length: ", 16);
+            size_t total = head_len + (cl ? strtoul(cl + 16, NULL, 10) : 0);
+            if (http_len >= total) {
+                int status = atoi(http_buf + 9);
+                memmove(http_buf, http_buf + total, http_len - total);
+                http_len -= total;
+                return status;
+            }
+        }
+        if (http_len == sizeof(http_buf)) { printf("response too large\n"); exit(1); }
+        ssize_t n = read(fd, http_buf + http_len, sizeof(http_buf) - http_len);
+        if (n <= 0) { printf("connection closed\n"); exit(1); }
+        http_len += (size_t)n;
+    }
+}
+
+static void check(int ok, const char *what) {
+    printf("%s: %s\n", ok ? "PASS" : "FAIL", what);
+    if (!ok) failures++;
+}
+
+/* Time `count` requests, keeping up to `depth` in flight */
+typedef void (*SendFn)(int fd, uint32_t i);
+typedef void (*RecvFn)(int fd);
+
+static void bench(const char *name, int fd, SendFn send_one, RecvFn recv_one, uint32_t depth) {
+    double *sent = malloc(sizeof(double) * BENCH_REQUESTS);
+    double *latency = malloc(sizeof(double) * BENCH_REQUESTS);
+    uint32_t next = 0;
+    double start = now_seconds();
+    for (uint32_t done = 0; done < BENCH_REQUESTS; done++) {
+        while (next < BENCH_REQUESTS && next < done + depth) {
+            sent[next] = now_seconds();
+            send_one(fd, next++);
+        }
+        recv_one(fd);
+        latency[done] = now_seconds() - sent[done];
+    }
+    double total = now_seconds() - start;
+    qsort(latency, BENCH_REQUESTS, sizeof(double), compare_double);
+    printf("%-28s %6u %10.0f %10.3f %10.3f\n", name, depth, BENCH_REQUESTS / total,
+           latency[BENCH_REQUESTS / 2] * 1000.0, latency[(BENCH_REQUESTS * 99) / 100] * 1000.0);
+    free(sent);
+    free(latency);
+}
+
+static const char *bench_messages[] = {"hello", "the cat", "what is a dog", "cats and dogs"};
+
+static void rpc_status_send(int fd, uint32_t i) { rpc_write(fd, RPC_STATUS, i, NULL, 0); }
+static void http_status_send(int fd, uint32_t i) { (void)i; http_write(fd, "GET", "/api/status", ""); }
+
+static void rpc_chat_send(int fd, uint32_t i) {
+    uint8_t payload[256];
+    const char *m = bench_messages[i % 4];
+    rpc_write(fd, RPC_CHAT, i, payload, session_payload(payload, "bench-rpc", m, strlen(m)));
+}
+
+static void http_chat_send(int fd, uint32_t i) {
+    char body[256];
+    snprintf(body, sizeof(body), "{\"message\":\"%s\",\"session\":\"bench-http\"}", bench_messages[i % 4]);
+    http_write(fd, "POST", "/api/chat", body);
+}
+
+static Frame reply;
+static void rpc_recv(int fd) {
+    rpc_read(fd, &reply);
+    if (reply.status != RPC_OK) failures++;
+}
+static void http_recv(int fd) {
+    if (http_read(fd) != 200) failures++;
+}
+
+int main(int argc, char **argv) {
+    const char *host = argc > 1 ? argv[1] : "127.0.0.1";
+    int http_port = argc > 2 ? atoi(argv[2]) : 8080;
+    int rpc_port = argc > 3 ? atoi(argv[3]) : 9090;
+
+    printf("=================================================================\n");
+    printf("BINARY RPC: protocol checks and RPC vs HTTP/JSON\n");
+    printf("=================================================================\n\n");
+
+    int fd = connect_to(host, rpc_port);
+
+    /* 1. Each operation */
+    rpc_write(fd, RPC_STATUS, 1, NULL, 0);
+    rpc_read(fd, &reply);
+    check(reply.status == RPC_OK && reply.op == RPC_STATUS && reply.id == 1 &&
+          reply.len >= 8 && reply.len == 8 + 8 * get32(reply.payload + 4),
+          "STATUS returns error rate and u64 counters");
+
+    uint8_t payload[4096];
+    uint8_t pairs[256];
+    uint32_t n = 0;
+    const char *train[][2] = {{"cat", "cats"}, {"dog", "dogs"}};
+    for (int i = 0; i < 2; i++) {
+        for (int k = 0; k < 2; k++) {
+            put32(pairs + n, strlen(train[i][k]));
+            memcpy(pairs + n + 4, train[i][k], strlen(train[i][k]));
+            n += 4 + strlen(train[i][k]);
+        }
+    }
+    rpc_write(fd, RPC_TRAIN, 2, payload, session_payload(payload, "rpc-test", pairs, n));
+    rpc_read(fd, &reply);
+    check(reply.status == RPC_OK && reply.len == 4 && get32(reply.payload) == 2,
+          "TRAIN learns every pair in the frame");
+
+    /* Raw bytes: a NUL inside the message needs no escaping */
+    rpc_write(fd, RPC_CHAT, 3, payload, session_payload(payload, "rpc-test", "ca\0t", 4));
+    rpc_read(fd, &reply);
+    check(reply.status == RPC_OK && reply.op == RPC_CHAT && reply.len >= 8,
+          "CHAT returns stop reason, error rate and output bytes");
+
+    rpc_write(fd, RPC_SAVE, 4, payload, session_payload(payload, "rpc-test", "", 0));
+    rpc_read(fd, &reply);
+    reply.payload[reply.len < sizeof(reply.payload) ? reply.len : 0] = '\0';
+    check(reply.status == RPC_OK && strstr((char*)reply.payload, "rpc-test.m") != NULL,
+          "SAVE writes the session brain");
+    if (reply.status == RPC_OK) unlink((char*)reply.payload);
+
+    /* 2. Pipelining: send everything, then read everything */
+    for (uint32_t i = 0; i < 16; i++) {
+        if (i % 2) rpc_write(fd, RPC_STATUS, 100 + i, NULL, 0);
+        else rpc_write(fd, RPC_CHAT, 100 + i, payload, session_payload(payload, "", "hello", 5));
+    }
+    int in_order = 1;
+    for (uint32_t i = 0; i < 16; i++) {
+        rpc_read(fd, &reply);
+        if (reply.id != 100 + i || reply.status != RPC_OK) in_order = 0;
+    }
+    check(in_order, "16 pipelined frames answered in order");
+
+    /* 3. Errors keep the connection usable */
+    rpc_write(fd, 99, 200, NULL, 0);
+    rpc_read(fd, &reply);
+    check(reply.status == RPC_BAD_REQUEST && reply.id == 200, "unknown op is a bad request");
+    rpc_write(fd, RPC_CHAT, 201, payload, session_payload(payload, "bad/id", "hi", 2));
+    rpc_read(fd, &reply);
+    check(reply.status == RPC_BAD_REQUEST, "invalid session id is a bad request");
+    rpc_write(fd, RPC_TRAIN, 202, payload, session_payload(payload, "", "\xff\0\0\0x", 5));
+    rpc_read(fd, &reply);
+    check(reply.status == RPC_BAD_REQUEST, "truncated training pair is a bad request");
+    rpc_write(fd, RPC_STATUS, 203, NULL, 0);
+    rpc_read(fd, &reply);
+    check(reply.status == RPC_OK && reply.id == 203, "connection still answers after errors");
+
+    /* 4. Benchmark */
+    int http = connect_to(host, http_port);
+    int setup_failures = failures;
+    printf("\n%-28s %6s %10s %10s %10s\n", "", "depth", "req/s", "p50 ms", "p99 ms");
+    bench("status  rpc", fd, rpc_status_send, rpc_recv, 1);
+    bench("status  http", http, http_status_send, http_recv, 1);
+    bench("status  rpc", fd, rpc_status_send, rpc_recv, PIPELINE_DEPTH);
+    bench("status  http", http, http_status_send, http_recv, PIPELINE_DEPTH);
+    bench("chat    rpc", fd, rpc_chat_send, rpc_recv, 1);
+    bench("chat    http", http, http_chat_send, http_recv, 1);
+    bench("chat    rpc", fd, rpc_chat_send, rpc_recv, PIPELINE_DEPTH);
+    bench("chat    http", http, http_chat_send, http_recv, PIPELINE_DEPTH);
+    if (failures != setup_failures) {
+        printf("FAIL: %d benchmark requests were not answered with success\n", failures - setup_failures);
+    }
+    close(http);
+    close(fd);
+
+    printf("\n%s\n", failures == 0 ? "ALL TESTS PASSED" : "TESTS FAILED");
+    return failures == 0 ? 0 : 1;
+}
@@ -4,10 +4,7 @@
 #include <stdlib.h>
 #include <stdint.h>
 
-typedef struct MelvinGraph MelvinGraph;
-extern MelvinGraph* melvin_create(void);
-extern void run_episode(MelvinGraph *g, const uint8_t *input, uint32_t input_len,
-                       const uint8_t *target, uint32_t target_len);
+#include "melvin.h"
 
 /* Access internal state (for testing) */
 float get_learning_pressure(MelvinGraph *g);
@@ -0,0 +1,155 @@
+/* Test: sessions infer against one shared, read-only brain
+ *
+ * 1. A session's answer equals melvin_infer_batch's for the same input
+ * 2. A reused session gives the same answers as a fresh one
+ * 3. Many threads, one session each, all reading the same brain at once,
+ *    get exactly their single-threaded answers and leave the brain unchanged
+ * 4. Session budgets cap the output
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "melvin.h"
+
+#define THREADS 8
+#define ROUNDS 20
+#define MAX_OUTPUT 1024
+
+static const char *inputs[] = {"cat", "dog", "hello", "the cat", "bird", "red", "hel", "xyz"};
+#define INPUT_COUNT (sizeof(inputs) / sizeof(inputs[0]))
+
+static MelvinGraph *g_brain;
+static uint32_t expected[INPUT_COUNT][MAX_OUTPUT];
+static uint32_t expected_len[INPUT_COUNT];
+
+static bool output_matches(MelvinSession *s, size_t i) {
+    uint32_t *output;
+    uint32_t output_len;
+    melvin_session_get_output(s, &output, &output_len);
+    return output_len == expected_len[i] &&
+           memcmp(output, expected[i], output_len * sizeof(uint32_t)) == 0;
+}
+
+/* Each thread answers every input ROUNDS times with one session */
+static void* worker(void *arg) {
+    int *mismatches = arg;
+    MelvinSession *s = melvin_session_create();
+    for (int round = 0; round < ROUNDS; round++) {
+        for (size_t i = 0; i < INPUT_COUNT; i++) {
+            melvin_session_infer(g_brain, s, (const uint8_t*)inputs[i], strlen(inputs[i]));
+            if (!output_matches(s, i)) (*mismatches)++;
+        }
+    }
+    melvin_session_destroy(s);
+    return NULL;
+}
+
+int main(void) {
+    printf("=================================================================\n");
+    printf("SESSIONS: concurrent inference against one read-only brain\n");
+    printf("=================================================================\n\n");
+
+    g_brain = melvin_create();
+    for (int i = 0; i < 20; i++) {
+        run_episode(g_brain, (const uint8_t*)"cat", 3, (const uint8_t*)"cats", 4);
+        run_episode(g_brain, (const uint8_t*)"dog", 3, (const uint8_t*)"dogs", 4);
+        run_episode(g_brain, (const uint8_t*)"hello", 5, (const uint8_t*)"world", 5);
+    }
+    uint32_t patterns_before = melvin_get_pattern_count(g_brain);
+    int failures = 0;
+
+    /* 1. Sessions agree with the batch path */
+    int mismatches = 0;
+    for (size_t i = 0; i < INPUT_COUNT; i++) {
+        MelvinInferRequest req = {0};
+        req.input = (const uint8_t*)inputs[i];
+        req.input_len = strlen(inputs[i]);
+        melvin_infer_batch(g_brain, &req, 1);
+        expected_len[i] = req.output_len < MAX_OUTPUT ? req.output_len : MAX_OUTPUT;
+        memcpy(expected[i], req.output, expected_len[i] * sizeof(uint32_t));
+        free(req.output);
+
+        MelvinSession *s = melvin_session_create();
+        melvin_session_infer(g_brain, s, req.input, req.input_len);
+        if (!output_matches(s, i)) mismatches++;
+        melvin_session_destroy(s);
+    }
+    if (mismatches) {
+        printf("FAIL: %d session answers differ from melvin_infer_batch\n", mismatches);
+        failures++;
+    } else {
+        printf("PASS: session answers match melvin_infer_batch\n");
+    }
+
+    /* 2. One session reused for every input, twice over */
+    mismatches = 0;
+    MelvinSession *reused = melvin_session_create();
+    for (int round = 0; round < 2; round++) {
+        for (size_t i = 0; i < INPUT_COUNT; i++) {
+            melvin_session_infer(g_brain, reused, (const uint8_t*)inputs[i], strlen(inputs[i]));
+            if (!output_matches(reused, i)) mismatches++;
+        }
+    }
+    if (mismatches) {
+        printf("FAIL: reused session gave %d different answers\n", mismatches);
+        failures++;
+    } else {
+        printf("PASS: a reused session carries nothing between calls\n");
+    }
+
+    /* 3. Threads sharing the brain */
+    pthread_t threads[THREADS];
+    int thread_mismatches[THREADS] = {0};
+    for (int t = 0; t < THREADS; t++) {
+        pthread_create(&threads[t], NULL, worker, &thread_mismatches[t]);
+    }
+    mismatches = 0;
+    for (int t = 0; t < THREADS; t++) {
+        pthread_join(threads[t], NULL);
+        mismatches += thread_mismatches[t];
+    }
+    if (mismatches) {
+        printf("FAIL: %d of %d concurrent answers differ\n", mismatches, THREADS * ROUNDS * (int)INPUT_COUNT);
+        failures++;
+    } else {
+        printf("PASS: %d threads x %d answers match the single-threaded ones\n",
+               THREADS, ROUNDS * (int)INPUT_COUNT);
+    }
+
+    mismatches = 0;
+    for (size_t i = 0; i < INPUT_COUNT; i++) {
+        melvin_session_infer(g_brain, reused, (const uint8_t*)inputs[i], strlen(inputs[i]));
+        if (!output_matches(reused, i)) mismatches++;
+    }
+    if (mismatches || melvin_get_pattern_count(g_brain) != patterns_before) {
+        printf("FAIL: inference changed the brain\n");
+        failures++;
+    } else {
+        printf("PASS: brain unchanged after concurrent inference\n");
+    }
+
+    /* 4. Budget */
+    MelvinBudget budget = {0, 2, 0};
+    melvin_session_set_budget(reused, &budget);
+    melvin_session_infer(g_brain, reused, (const uint8_t*)"hello", 5);
+    uint32_t *output;
+    uint32_t output_len;
+    melvin_session_get_output(reused, &output, &output_len);
+    int stop = melvin_session_get_stop_reason(reused);
+    if (output_len > 2 || (expected_len[2] > 2 && stop != 2)) {
+        printf("FAIL: budget of 2 gave %u nodes, stop reason %d\n", output_len, stop);
+        failures++;
+    } else {
+        printf("PASS: session budget caps output at %u nodes\n", output_len);
+    }
+    melvin_session_destroy(reused);
+    melvin_destroy(g_brain);
+
+    printf("\n%s\n", failures == 0 ? "ALL TESTS PASSED" : "TESTS FAILED");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,164 @@
+/* Test: teacher response cache (append-only log + in-memory index)
+ *
+ * 1. Round trip: responses come back byte for byte, other prompts and other
+ *    models miss, and hits/misses are counted
+ * 2. Persistence: a reopened log serves the same responses; a newer response
+ *    for a key replaces the old one
+ * 3. Crash safety: a torn record at the end is dropped on open, everything
+ *    before it survives and appending carries on
+ * 4. Size cap: the log stays under the cap by dropping the oldest entries
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "melvin_teacher.h"
+
+#define CACHE_PATH "test_teacher_cache.log"
+#define ENTRY_COUNT 200
+
+static int failures = 0;
+
+static void check(bool ok, const char *pass, const char *fail) {
+    printf("%s: %s\n", ok ? "PASS" : "FAIL", ok ? pass : fail);
+    if (!ok) failures++;
+}
+
+static void make_prompt(char *buf, size_t size, int i) {
+    snprintf(buf, size, "prompt %d: tell me about the number %d", i, i * 31);
+}
+
+/* Varied lengths, embedded NULs and bytes outside ASCII */
+static size_t make_response(char *buf, int i) {
+    size_t len = 20 + (size_t)(i * 37) % 900;
+    for (size_t k = 0; k < len; k++) buf[k] = (char)((i * 7 + k * 13) % 256);
+    return len;
+}
+
+static bool expect(TeacherCache *cache, const char *model, int i) {
+    char prompt[96], response[1024];
+    make_prompt(prompt, sizeof(prompt), i);
+    size_t len = make_response(response, i), got_len = 0;
+    char *got = teacher_cache_get(cache, model, prompt, &got_len);
+    bool ok = got && got_len == len && memcmp(got, response, len) == 0 && got[len] == '\0';
+    free(got);
+    return ok;
+}
+
+static long file_size(const char *path) {
+    FILE *f = fopen(path, "rb");
+    if (!f) return -1;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fclose(f);
+    return size;
+}
+
+int main(void) {
+    printf("=================================================================\n");
+    printf("TEACHER CACHE: log, index, recovery and size cap\n");
+    printf("=================================================================\n\n");
+
+    remove(CACHE_PATH);
+    char prompt[96], response[1024];
+
+    /* 1. Round trip */
+    TeacherCache *cache = teacher_cache_open(CACHE_PATH, 0);
+    bool stored = cache != NULL;
+    for (int i = 0; stored && i < ENTRY_COUNT; i++) {
+        make_prompt(prompt, sizeof(prompt), i);
+        size_t len = make_response(response, i);
+        stored = teacher_cache_put(cache, "llama3.2", prompt, response, len);
+    }
+    int found = 0;
+    for (int i = 0; stored && i < ENTRY_COUNT; i++) found += expect(cache, "llama3.2", i);
+    make_prompt(prompt, sizeof(prompt), 0);
+    char *other_model = stored ? teacher_cache_get(cache, "mistral", prompt, NULL) : NULL;
+    char *unknown = stored ? teacher_cache_get(cache, "llama3.2", "never asked", NULL) : NULL;
+    TeacherCacheStats stats;
+    memset(&stats, 0, sizeof(stats));
+    if (cache) teacher_cache_stats(cache, &stats);
+    check(stored && found == ENTRY_COUNT && !other_model && !unknown &&
+          stats.hits == ENTRY_COUNT && stats.misses == 2 && stats.entries == ENTRY_COUNT,
+          "responses round-trip exactly; other prompts and models miss",
+          "stored responses differ, or a miss was served");
+    free(other_model);
+    free(unknown);
+
+    /* 2. Persistence and replacement */
+    make_prompt(prompt, sizeof(prompt), 5);
+    bool replaced = cache && teacher_cache_put(cache, "llama3.2", prompt, "newer answer", 12);
+    teacher_cache_close(cache);
+    cache = teacher_cache_open(CACHE_PATH, 0);
+    found = 0;
+    for (int i = 0; cache && i < ENTRY_COUNT; i++) found += i != 5 && expect(cache, "llama3.2", i);
+    size_t len = 0;
+    char *newer = cache ? teacher_cache_get(cache, "llama3.2", prompt, &len) : NULL;
+    if (cache) teacher_cache_stats(cache, &stats);
+    check(replaced && found == ENTRY_COUNT - 1 && newer && len == 12 && memcmp(newer, "newer answer", 12) == 0 &&
+          stats.entries == ENTRY_COUNT,
+          "reopened log serves every response, the newer one for a replaced key",
+          "responses lost or stale after reopening");
+    free(newer);
+    teacher_cache_close(cache);
+
+    /* 3. Torn tail: cut the last record short, as a crash mid-append would */
+    long size = file_size(CACHE_PATH);
+    FILE *f = fopen(CACHE_PATH, "r+b");
+    char *bytes = malloc((size_t)size);
+    bool torn = f && bytes && fread(bytes, 1, (size_t)size, f) == (size_t)size;
+    if (f) fclose(f);
+    f = fopen(CACHE_PATH, "wb");
+    torn = torn && f && fwrite(bytes, 1, (size_t)size - 5, f) == (size_t)size - 5;
+    if (f) fclose(f);
+    free(bytes);
+    cache = teacher_cache_open(CACHE_PATH, 0);
+    found = 0;
+    for (int i = 0; cache && i < ENTRY_COUNT; i++) found += i != 5 && expect(cache, "llama3.2", i);
+    /* The torn record was the replacement, so the original answer is back */
+    bool original = cache && expect(cache, "llama3.2", 5);
+    bool appended = cache && teacher_cache_put(cache, "llama3.2", "after the crash", "still works", 11);
+    teacher_cache_close(cache);
+    cache = teacher_cache_open(CACHE_PATH, 0);
+    char *after = cache ? teacher_cache_get(cache, "llama3.2", "after the crash", NULL) : NULL;
+    check(torn && found == ENTRY_COUNT - 1 && original && appended && after && strcmp(after, "still works") == 0,
+          "torn record dropped, earlier entries intact, appends continue",
+          "damaged tail broke the log");
+    free(after);
+    teacher_cache_close(cache);
+
+    /* 4. Size cap */
+    f = fopen(CACHE_PATH "x", "wb");
+    if (f) {
+        fputs("not a cache", f);
+        fclose(f);
+    }
+    TeacherCache *wrong = teacher_cache_open(CACHE_PATH "x", 0);
+    remove(CACHE_PATH "x");
+    remove(CACHE_PATH);
+    uint64_t cap = 32 * 1024;
+    cache = teacher_cache_open(CACHE_PATH, cap);
+    bool capped = cache != NULL;
+    for (int i = 0; capped && i < ENTRY_COUNT; i++) {
+        make_prompt(prompt, sizeof(prompt), i);
+        size_t n = make_response(response, i);
+        capped = teacher_cache_put(cache, "llama3.2", prompt, response, n) &&
+                 (uint64_t)file_size(CACHE_PATH) <= cap;
+    }
+    if (cache) teacher_cache_stats(cache, &stats);
+    bool newest = cache && expect(cache, "llama3.2", ENTRY_COUNT - 1);
+    make_prompt(prompt, sizeof(prompt), 0);
+    char *oldest = cache ? teacher_cache_get(cache, "llama3.2", prompt, NULL) : NULL;
+    printf("Capped at %llu bytes: %u entries kept, %llu evicted\n",
+           (unsigned long long)cap, stats.entries, (unsigned long long)stats.evicted);
+    check(!wrong && capped && newest && !oldest && stats.evicted > 0 &&
+          stats.entries + stats.evicted == ENTRY_COUNT && stats.file_bytes <= cap,
+          "log kept under the cap, oldest entries dropped first; foreign files refused",
+          "size cap not enforced or wrong entries dropped");
+    free(oldest);
+    teacher_cache_close(cache);
+    remove(CACHE_PATH);
+
+    printf("\n%s\n", failures == 0 ? "ALL TESTS PASSED" : "TESTS FAILED");
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,179 @@
+/* Test: the tracing ring buffer
+ *
+ * Build with every trace point compiled in:
+ *   gcc -O2 -DMELVIN_TRACE_LEVEL=3 -o test_tracing test_tracing.c melvin.c -lm
+ *
+ * 1. Tracing doesn't change what the brain learns or answers
+ * 2. Flushed events are JSON lines in sequence, and a flush empties the ring
+ * 3. The runtime level filters events
+ * 4. A small ring keeps only the newest events; "seq" shows the gap
+ * 5. Disabled, nothing is recorded
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "melvin.h"
+
+static const char *pairs[][2] = {{"cat", "cats"}, {"dog", "dogs"}, {"hello", "world"}};
+#define PAIR_COUNT (sizeof(pairs) / sizeof(pairs[0]))
+
+static void train(MelvinGraph *g, int rounds) {
+    for (int r = 0; r < rounds; r++) {
+        for (size_t k = 0; k < PAIR_COUNT; k++) {
+            run_episode(g, (const uint8_t*)pairs[k][0], strlen(pairs[k][0]),
+                        (const uint8_t*)pairs[k][1], strlen(pairs[k][1]));
+        }
+    }
+}
+
+/* Answers to every input, concatenated */
+static uint32_t answers(MelvinGraph *g, uint32_t *out, uint32_t cap) {
+    uint32_t n = 0;
+    for (size_t k = 0; k < PAIR_COUNT; k++) {
+        run_episode(g, (const uint8_t*)pairs[k][0], strlen(pairs[k][0]), NULL, 0);
+        uint32_t *output;
+        uint32_t len;
+        melvin_get_output(g, &output, &len);
+        for (uint32_t i = 0; i < len && n < cap; i++) out[n++] = output[i];
+    }
+    return n;
+}
+
+typedef struct {
+    uint32_t lines;
+    uint32_t malformed;
+    uint32_t gaps;              /* Places where seq jumped */
+    uint32_t events[4];         /* By level: episode, step, detail (index 0 unused) */
+} Flushed;
+
+static int event_level(const char *line) {
+    static const char *episode[] = {"\"feedback\"", "\"pattern_created\"", "\"learn_pattern_predictions\""};
+    static const char *step[] = {"\"propagate_end\"", "\"selection_start\"", "\"selection_result\"",
+                                 "\"node_selected\"", "\"emit\""};
+    for (size_t i = 0; i < sizeof(episode) / sizeof(episode[0]); i++) {
+        if (strstr(line, episode[i])) return MELVIN_TRACE_EPISODE;
+    }
+    for (size_t i = 0; i < sizeof(step) / sizeof(step[0]); i++) {
+        if (strstr(line, step[i])) return MELVIN_TRACE_STEP;
+    }
+    return MELVIN_TRACE_DETAIL;
+}
+
+static Flushed flush(MelvinGraph *g, uint32_t *written) {
+    Flushed f = {0};
+    FILE *tmp = tmpfile();
+    *written = melvin_trace_flush(g, tmp);
+    rewind(tmp);
+
+    char line[1024];
+    long long prev = -1;
+    while (fgets(line, sizeof(line), tmp)) {
+        f.lines++;
+        long long seq;
+        size_t len = strlen(line);
+        if (sscanf(line, "{\"seq\":%lld,", &seq) != 1 || !strstr(line, "\"data\":{") ||
+            len < 3 || strcmp(line + len - 3, "}}\n") != 0) {
+            f.malformed++;
+            continue;
+        }
+        if (prev >= 0 && seq != prev + 1) f.gaps++;
+        prev = seq;
+        f.events[event_level(line)]++;
+    }
+    fclose(tmp);
+    return f;
+}
+
+int main(void) {
+    printf("=================================================================\n");
+    printf("TRACING: ring buffer of engine events\n");
+    printf("=================================================================\n\n");
+
+    int failures = 0;
+    MelvinGraph *plain = melvin_create();
+    MelvinGraph *traced = melvin_create();
+    if (!melvin_trace_enable(traced, MELVIN_TRACE_DETAIL, 1u << 20)) {
+        printf("SKIP: built without trace points (add -DMELVIN_TRACE_LEVEL=3)\n");
+        melvin_destroy(plain);
+        melvin_destroy(traced);
+        return 0;
+    }
+
+    /* 1. Same brain with and without tracing */
+    train(plain, 10);
+    train(traced, 10);
+    uint32_t a[512], b[512];
+    uint32_t na = answers(plain, a, 512);
+    uint32_t nb = answers(traced, b, 512);
+    if (na != nb || memcmp(a, b, na * sizeof(uint32_t)) != 0) {
+        printf("FAIL: tracing changed the answers\n");
+        failures++;
+    } else {
+        printf("PASS: traced brain answers exactly as the untraced one\n");
+    }
+
+    /* 2. Flushed events */
+    uint32_t written;
+    Flushed f = flush(traced, &written);
+    if (written == 0 || f.lines != written || f.malformed || f.gaps ||
+        !f.events[MELVIN_TRACE_EPISODE] || !f.events[MELVIN_TRACE_STEP] || !f.events[MELVIN_TRACE_DETAIL]) {
+        printf("FAIL: flushed %u events, %u lines, %u malformed, %u gaps, levels %u/%u/%u\n",
+               written, f.lines, f.malformed, f.gaps,
+               f.events[MELVIN_TRACE_EPISODE], f.events[MELVIN_TRACE_STEP], f.events[MELVIN_TRACE_DETAIL]);
+        failures++;
+    } else {
+        printf("PASS: %u events flushed as JSON lines (%u episode, %u step, %u detail)\n",
+               written, f.events[MELVIN_TRACE_EPISODE], f.events[MELVIN_TRACE_STEP], f.events[MELVIN_TRACE_DETAIL]);
+    }
+    f = flush(traced, &written);
+    if (written != 0) {
+        printf("FAIL: second flush wrote %u events\n", written);
+        failures++;
+    } else {
+        printf("PASS: flush empties the ring\n");
+    }
+
+    /* 3. Runtime level */
+    melvin_trace_enable(traced, MELVIN_TRACE_EPISODE, 0);
+    train(traced, 1);
+    f = flush(traced, &written);
+    if (written == 0 || f.events[MELVIN_TRACE_STEP] || f.events[MELVIN_TRACE_DETAIL]) {
+        printf("FAIL: level %d recorded %u step and %u detail events\n",
+               MELVIN_TRACE_EPISODE, f.events[MELVIN_TRACE_STEP], f.events[MELVIN_TRACE_DETAIL]);
+        failures++;
+    } else {
+        printf("PASS: level %d records only episode events (%u)\n", MELVIN_TRACE_EPISODE, written);
+    }
+
+    /* 4. Small ring */
+    melvin_trace_disable(traced);
+    melvin_trace_enable(traced, MELVIN_TRACE_DETAIL, 64);
+    train(traced, 1);
+    f = flush(traced, &written);
+    if (written != 64 || f.malformed || f.gaps) {
+        printf("FAIL: 64-event ring flushed %u events, %u malformed, %u gaps\n", written, f.malformed, f.gaps);
+        failures++;
+    } else {
+        printf("PASS: a 64-event ring keeps the newest 64\n");
+    }
+
+    /* 5. Disabled */
+    melvin_trace_disable(traced);
+    train(traced, 1);
+    if (melvin_trace_flush(traced, stdout) != 0) {
+        printf("FAIL: events recorded while disabled\n");
+        failures++;
+    } else {
+        printf("PASS: nothing recorded while disabled\n");
+    }
+
+    melvin_destroy(plain);
+    melvin_destroy(traced);
+
+    printf("\n%s\n", failures == 0 ? "ALL TESTS PASSED" : "TESTS FAILED");
+    return failures == 0 ? 0 : 1;
+}